@@ -22,6 +22,8 @@
 #include "sqliteextension.h"
 
 #include <QString>
+#include <QCache>
+#include <QMutex>
 #include <QDebug>
 
 #include <sqlite3.h>
@@ -43,6 +45,41 @@ static int nocaseCompare( void* /*arg*/, int len1, const void* data1, int len2,
   return QString::compare( string1, string2, Qt::CaseInsensitive );
 }
 
+// Process-wide cache of compiled patterns, shared between statements and
+// connections. Entries are copied out, so the cache never hands a regexp
+// used by another thread.
+static QMutex regExpCacheMutex;
+static QCache<QString, QzRegExp> regExpCache(100);
+
+static QzRegExp cachedRegExp( const QString& pattern )
+{
+  QMutexLocker locker( &regExpCacheMutex );
+
+  QzRegExp* regExp = regExpCache.object( pattern );
+  if ( !regExp ) {
+    regExp = new QzRegExp( pattern, Qt::CaseInsensitive );
+#if (QT_VERSION >= 0x050400)
+    regExp->optimize();
+#endif
+    regExpCache.insert( pattern, regExp );
+  }
+  return *regExp;
+}
+
+static void deleteRegExp( void* regExp )
+{
+  delete static_cast<QzRegExp*>( regExp );
+}
+
+static bool regExpMatch( const QzRegExp& regExp, const QString& string )
+{
+#if (QT_VERSION >= 0x050000)
+  return regExp.match( string ).hasMatch();
+#else
+  return ( regExp.indexIn( string ) > -1 );
+#endif
+}
+
 static void regexpFunction( sqlite3_context* context, int /*argc*/, sqlite3_value** argv )
 {
   int len1 = sqlite3_value_bytes16( argv[ 0 ] );
@@ -53,14 +90,23 @@ static void regexpFunction( sqlite3_context* context, int /*argc*/, sqlite3_valu
   if ( !data1 || !data2 )
     return;
 
-  // do not use fromRawData for pattern string because it may be cached internally by the regexp engine
-  QString string1 = QString::fromRawData( reinterpret_cast<const QChar*>( data1 ), len1 / sizeof( QChar ) );
   QString string2 = QString::fromRawData( reinterpret_cast<const QChar*>( data2 ), len2 / sizeof( QChar ) );
 
-  QzRegExp pattern( string1, Qt::CaseInsensitive);
-  int pos = pattern.indexIn( string2 );
+  // Pattern compiled for previous row of the same statement
+  QzRegExp* statementRegExp = static_cast<QzRegExp*>( sqlite3_get_auxdata( context, 0 ) );
+  if ( statementRegExp ) {
+    sqlite3_result_int( context, regExpMatch( *statementRegExp, string2 ) ? 1 : 0 );
+    return;
+  }
+
+  // do not use fromRawData for pattern string because it may be cached internally by the regexp engine
+  QString string1( reinterpret_cast<const QChar*>( data1 ), len1 / sizeof( QChar ) );
+
+  QzRegExp pattern = cachedRegExp( string1 );
+  sqlite3_result_int( context, regExpMatch( pattern, string2 ) ? 1 : 0 );
 
-  sqlite3_result_int( context, (pos > -1) ? 1 : 0 );
+  // SQLite may free auxiliary data at once, so it gets its own copy
+  sqlite3_set_auxdata( context, 0, new QzRegExp( pattern ), &deleteRegExp );
 }
 
 static void upperFunction(sqlite3_context* context, int /*argc*/, sqlite3_value** argv)
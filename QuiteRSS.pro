@@ -59,6 +59,7 @@ HEADERS += \
     src/newsview/newsview.h \
     src/newsview/newsmodel.h \
     src/newsview/newsheader.h \
+    src/newsview/newspaperrenderer.h \
     src/aboutdialog.h \
     src/updateappdialog.h \
     src/feedpropertiesdialog.h \
@@ -72,11 +73,13 @@ HEADERS += \
     src/addfolderdialog.h \
     src/labeldialog.h \
     src/faviconobject.h \
+    src/imageprefetcher.h \
     src/customizetoolbardialog.h \
     src/plugins/webpluginfactory.h \
     src/plugins/clicktoflash.h \
     src/downloads/downloadmanager.h \
     src/downloads/downloaditem.h \
+    src/downloads/downloadrange.h \
     src/tabbar.h \
     src/categoriestreewidget.h \
     src/cleanupwizard.h \
@@ -108,6 +111,7 @@ HEADERS += \
     src/webview/webpage.h \
     src/webview/webview.h \
     src/database/database.h \
+    src/database/newsstateupdater.h \
     src/common/common.h \
     src/common/delegatewithoutfocus.h \
     src/common/dialog.h \
@@ -117,8 +121,16 @@ HEADERS += \
     src/newsfilters/newsfiltersdialog.h \
     src/newsfilters/itemcondition.h \
     src/newsfilters/itemaction.h \
+    src/newsfilters/userfilters.h \
+    src/newsfilters/ahocorasick.h \
     src/network/sslerrordialog.h \
     src/network/networkmanagerproxy.h \
+    src/network/hostthrottle.h \
+    src/network/replytimeouts.h \
+    src/network/feedarchive.h \
+    src/network/websubrequest.h \
+    src/network/websubserver.h \
+    src/network/networkdiskcache.h \
     src/adblock/adblockmatcher.h \
     src/feedsview/feedsproxymodel.h \
     src/main/globals.h \
@@ -129,6 +141,7 @@ SOURCES += \
     src/newsview/newsview.cpp \
     src/newsview/newsmodel.cpp \
     src/newsview/newsheader.cpp \
+    src/newsview/newspaperrenderer.cpp \
     src/aboutdialog.cpp \
     src/updateappdialog.cpp \
     src/feedpropertiesdialog.cpp \
@@ -141,11 +154,13 @@ SOURCES += \
     src/addfolderdialog.cpp \
     src/labeldialog.cpp \
     src/faviconobject.cpp \
+    src/imageprefetcher.cpp \
     src/customizetoolbardialog.cpp \
     src/plugins/webpluginfactory.cpp \
     src/plugins/clicktoflash.cpp \
     src/downloads/downloadmanager.cpp \
     src/downloads/downloaditem.cpp \
+    src/downloads/downloadrange.cpp \
     src/tabbar.cpp \
     src/categoriestreewidget.cpp \
     src/cleanupwizard.cpp \
@@ -179,6 +194,7 @@ SOURCES += \
     src/webview/webpage.cpp \
     src/webview/webview.cpp \
     src/database/database.cpp \
+    src/database/newsstateupdater.cpp \
     src/common/common.cpp \
     src/common/delegatewithoutfocus.cpp \
     src/common/dialog.cpp \
@@ -188,8 +204,16 @@ SOURCES += \
     src/newsfilters/newsfiltersdialog.cpp \
     src/newsfilters/itemcondition.cpp \
     src/newsfilters/itemaction.cpp \
+    src/newsfilters/userfilters.cpp \
+    src/newsfilters/ahocorasick.cpp \
     src/network/sslerrordialog.cpp \
     src/network/networkmanagerproxy.cpp \
+    src/network/hostthrottle.cpp \
+    src/network/replytimeouts.cpp \
+    src/network/feedarchive.cpp \
+    src/network/websubrequest.cpp \
+    src/network/websubserver.cpp \
+    src/network/networkdiskcache.cpp \
     src/adblock/adblockmatcher.cpp \
     src/feedsview/feedsproxymodel.cpp
 
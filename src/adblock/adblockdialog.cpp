@@ -34,6 +34,8 @@
 * ============================================================ */
 #include "adblockdialog.h"
 #include "adblockmanager.h"
+#include "adblockmatcher.h"
+#include "adblockrule.h"
 #include "adblocksubscription.h"
 #include "adblocktreewidget.h"
 #include "adblockaddsubscriptiondialog.h"
@@ -81,6 +83,10 @@ AdBlockDialog::AdBlockDialog(QWidget* parent)
   m_actionAddSubscription = menu->addAction(tr("Add Subscription"), this, SLOT(addSubscription()));
   m_actionRemoveSubscription = menu->addAction(tr("Remove Subscription"), this, SLOT(removeSubscription()));
   menu->addAction(tr("Update Subscriptions"), m_manager, SLOT(updateAllSubscriptions()));
+  menu->addAction(tr("Statistics"), this, SLOT(showStatistics()));
+  m_actionMeasureTime = menu->addAction(tr("Measure Matching Time"));
+  m_actionMeasureTime->setCheckable(true);
+  connect(m_actionMeasureTime, SIGNAL(toggled(bool)), this, SLOT(setTimingEnabled(bool)));
   menu->addSeparator();
   menu->addAction(tr("Learn about writing rules..."), this, SLOT(learnAboutRules()));
 
@@ -97,18 +103,13 @@ AdBlockDialog::AdBlockDialog(QWidget* parent)
   buttonBox->setFocus();
 }
 
-void AdBlockDialog::showRule(const AdBlockRule* rule) const
+void AdBlockDialog::showRule(AdBlockSubscription* subscription, const QString &filter) const
 {
-  AdBlockSubscription* subscription = rule->subscription();
-  if (!subscription) {
-    return;
-  }
-
   for (int i = 0; i < tabWidget->count(); ++i) {
     AdBlockTreeWidget* treeWidget = qobject_cast<AdBlockTreeWidget*>(tabWidget->widget(i));
 
     if (subscription == treeWidget->subscription()) {
-      treeWidget->showRule(rule);
+      treeWidget->showRule(filter);
       tabWidget->setCurrentIndex(i);
       break;
     }
@@ -185,6 +186,7 @@ void AdBlockDialog::aboutToShowMenu()
   m_actionAddRule->setEnabled(subscriptionEditable);
   m_actionRemoveRule->setEnabled(subscriptionEditable);
   m_actionRemoveSubscription->setEnabled(subscriptionRemovable);
+  m_actionMeasureTime->setChecked(m_manager->matcher()->isTimingEnabled());
 }
 
 void AdBlockDialog::learnAboutRules()
@@ -193,6 +195,53 @@ void AdBlockDialog::learnAboutRules()
   mainApp->mainWindow()->createWebTab(QUrl("https://adblockplus.org/en/filters"));
 }
 
+void AdBlockDialog::showStatistics()
+{
+  const AdBlockMatcher::Statistics statistics = m_manager->matcher()->statistics();
+  const QString microseconds = QString(QChar(0x00B5)) + QLatin1String("s");
+
+  QString text;
+  text.append(tr("Requests checked: %1").arg(statistics.checkedRequests) + "\n");
+  text.append(tr("Blocked: %1").arg(statistics.blockedRequests) + "\n");
+  text.append(tr("Allowed by exception rules: %1").arg(statistics.exemptedRequests) + "\n");
+  text.append(tr("Answered from cache: %1").arg(statistics.cachedRequests) + "\n");
+  text.append(tr("Average rules evaluated: %1").
+              arg(m_manager->matcher()->averageRulesEvaluated(), 0, 'f', 1) + "\n");
+
+  if (!m_manager->matcher()->isTimingEnabled()) {
+    text.append("\n" + tr("Matching time is not measured.") + "\n");
+  }
+  else {
+    text.append("\n" + tr("Matching time:") + "\n");
+    int lowerLimit = 0;
+    for (int i = 0; i < AdBlockMatcher::latencyBucketsCount(); ++i) {
+      int upperLimit = AdBlockMatcher::latencyBucketLimit(i);
+      if (upperLimit == -1)
+        text.append(QString(">= %1 %2").arg(lowerLimit).arg(microseconds));
+      else
+        text.append(QString("%1 - %2 %3").arg(lowerLimit).arg(upperLimit).arg(microseconds));
+      text.append(QString(": %1\n").arg(statistics.latencyHistogram.at(i)));
+      lowerLimit = upperLimit;
+    }
+  }
+
+  if (!statistics.slowestRules.isEmpty()) {
+    text.append("\n" + tr("Slowest rules:") + "\n");
+    for (int i = 0; i < statistics.slowestRules.count(); ++i) {
+      text.append(QString("%1 %2: %3\n").
+                  arg(statistics.slowestRules.at(i).second / 1000).arg(microseconds).
+                  arg(statistics.slowestRules.at(i).first));
+    }
+  }
+
+  QMessageBox::information(this, tr("AdBlock Statistics"), text);
+}
+
+void AdBlockDialog::setTimingEnabled(bool enabled)
+{
+  m_manager->matcher()->setTimingEnabled(enabled);
+}
+
 void AdBlockDialog::loadSubscriptions()
 {
   for (int i = 0; i < tabWidget->count(); ++i) {
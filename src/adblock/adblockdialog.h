@@ -51,7 +51,7 @@ class AdBlockDialog : public QDialog, public Ui_AdBlockDialog
 public:
   explicit AdBlockDialog(QWidget* parent = 0);
 
-  void showRule(const AdBlockRule* rule) const;
+  void showRule(AdBlockSubscription* subscription, const QString &filter) const;
 
 private slots:
   void addRule();
@@ -66,6 +66,8 @@ private slots:
 
   void aboutToShowMenu();
   void learnAboutRules();
+  void showStatistics();
+  void setTimingEnabled(bool enabled);
 
   void loadSubscriptions();
   void load();
@@ -81,6 +83,7 @@ private:
   QAction* m_actionRemoveRule;
   QAction* m_actionAddSubscription;
   QAction* m_actionRemoveSubscription;
+  QAction* m_actionMeasureTime;
 
   bool m_loaded;
   bool m_useLimitedEasyList;
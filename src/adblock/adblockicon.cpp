@@ -162,7 +162,7 @@ void AdBlockIcon::createMenu(QMenu* menu)
       QString actionText = tr("%1 with (%2)").arg(address, pair.first->filter()).replace(QLatin1Char('&'), QLatin1String("&&"));
 
       QAction* action = menu->addAction(actionText, manager, SLOT(showRule()));
-      action->setData(QVariant::fromValue((void*)pair.first));
+      action->setData(QStringList() << pair.first->subscription()->title() << pair.first->filter());
     }
   }
 
@@ -176,10 +176,10 @@ void AdBlockIcon::createMenu(QMenu* menu)
     menu->addAction(tr("Blocked URL (AdBlock Rule) - click to edit rule"))->setEnabled(false);
     foreach (const WebPage::AdBlockedEntry &entry, entries) {
       QString address = entry.url.toString().right(55);
-      QString actionText = tr("%1 with (%2)").arg(address, entry.rule->filter()).replace(QLatin1Char('&'), QLatin1String("&&"));
+      QString actionText = tr("%1 with (%2)").arg(address, entry.filter).replace(QLatin1Char('&'), QLatin1String("&&"));
 
       QAction* action = menu->addAction(actionText, manager, SLOT(showRule()));
-      action->setData(QVariant::fromValue((void*)entry.rule));
+      action->setData(QStringList() << entry.subscription << entry.filter);
     }
   }
 }
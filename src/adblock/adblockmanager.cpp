@@ -142,25 +142,26 @@ QNetworkReply* AdBlockManager::block(const QNetworkRequest &request)
   }
 
 #ifdef ADBLOCK_DEBUG
-  qDebug() << timer.elapsed() << request.url();
+  qDebug() << timer.elapsed() << request.url()
+           << "average rules evaluated:" << m_matcher->averageRulesEvaluated();
 #endif
 
   return 0;
 }
 
-QStringList AdBlockManager::disabledRules() const
+QSet<QString> AdBlockManager::disabledRules() const
 {
   return m_disabledRules;
 }
 
 void AdBlockManager::addDisabledRule(const QString &filter)
 {
-  m_disabledRules.append(filter);
+  m_disabledRules.insert(filter);
 }
 
 void AdBlockManager::removeDisabledRule(const QString &filter)
 {
-  m_disabledRules.removeOne(filter);
+  m_disabledRules.remove(filter);
 }
 
 AdBlockSubscription* AdBlockManager::addSubscription(const QString &title, const QString &url)
@@ -200,8 +201,12 @@ bool AdBlockManager::removeSubscription(AdBlockSubscription* subscription)
   }
 
   QFile(subscription->filePath()).remove();
+  QFile(subscription->cacheFilePath()).remove();
   m_subscriptions.removeOne(subscription);
 
+  // Matcher must not keep rules of removed subscription
+  m_matcher->update();
+
   delete subscription;
   return true;
 }
@@ -219,6 +224,11 @@ AdBlockCustomList* AdBlockManager::customList() const
   return 0;
 }
 
+AdBlockMatcher* AdBlockManager::matcher() const
+{
+  return m_matcher;
+}
+
 void AdBlockManager::load()
 {
   if (m_loaded) {
@@ -234,8 +244,9 @@ void AdBlockManager::load()
   settings.beginGroup("AdBlock");
   m_enabled = settings.value("enabled", m_enabled).toBool();
   m_useLimitedEasyList = settings.value("useLimitedEasyList", m_useLimitedEasyList).toBool();
-  m_disabledRules = settings.value("disabledRules", QStringList()).toStringList();
+  m_disabledRules = settings.value("disabledRules", QStringList()).toStringList().toSet();
   QDateTime lastUpdate = settings.value("lastUpdate", QDateTime()).toDateTime();
+  m_matcher->setTimingEnabled(settings.value("measureMatchTime", false).toBool());
   settings.endGroup();
 
   if (!m_enabled) {
@@ -302,12 +313,12 @@ void AdBlockManager::load()
     QTimer::singleShot(1000 * 60, this, SLOT(updateAllSubscriptions()));
   }
 
+  m_matcher->update();
+  m_loaded = true;
+
 #ifdef ADBLOCK_DEBUG
   qDebug() << "AdBlock loaded in" << timer.elapsed();
 #endif
-
-  m_matcher->update();
-  m_loaded = true;
 }
 
 void AdBlockManager::updateAllSubscriptions()
@@ -336,7 +347,8 @@ void AdBlockManager::save()
   settings.beginGroup("AdBlock");
   settings.setValue("enabled", m_enabled);
   settings.setValue("useLimitedEasyList", m_useLimitedEasyList);
-  settings.setValue("disabledRules", m_disabledRules);
+  settings.setValue("disabledRules", QStringList(m_disabledRules.toList()));
+  settings.setValue("measureMatchTime", m_matcher->isTimingEnabled());
   settings.endGroup();
 }
 
@@ -415,10 +427,14 @@ AdBlockDialog* AdBlockManager::showDialog()
 void AdBlockManager::showRule()
 {
   if (QAction* action = qobject_cast<QAction*>(sender())) {
-    const AdBlockRule* rule = static_cast<const AdBlockRule*>(action->data().value<void*>());
+    const QStringList data = action->data().toStringList();
+    if (data.count() != 2) {
+      return;
+    }
 
-    if (rule) {
-      showDialog()->showRule(rule);
+    AdBlockSubscription* subscription = subscriptionByName(data.at(0));
+    if (subscription) {
+      showDialog()->showRule(subscription, data.at(1));
     }
   }
 }
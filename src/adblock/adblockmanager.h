@@ -37,6 +37,7 @@
 
 #include <QObject>
 #include <QStringList>
+#include <QSet>
 #include <QPointer>
 
 class QUrl;
@@ -76,7 +77,7 @@ public:
 
   QNetworkReply* block(const QNetworkRequest &request);
 
-  QStringList disabledRules() const;
+  QSet<QString> disabledRules() const;
   void addDisabledRule(const QString &filter);
   void removeDisabledRule(const QString &filter);
 
@@ -84,6 +85,7 @@ public:
   bool removeSubscription(AdBlockSubscription* subscription);
 
   AdBlockCustomList* customList() const;
+  AdBlockMatcher* matcher() const;
 
 signals:
   void enabledChanged(bool enabled);
@@ -106,7 +108,7 @@ private:
   QList<AdBlockSubscription*> m_subscriptions;
   static AdBlockManager* s_adBlockManager;
   AdBlockMatcher* m_matcher;
-  QStringList m_disabledRules;
+  QSet<QString> m_disabledRules;
 
   QPointer<AdBlockDialog> m_adBlockDialog;
 };
@@ -38,11 +38,26 @@
 #include "adblocksubscription.h"
 #include "common.h"
 
+#include <QNetworkRequest>
+#include <QElapsedTimer>
+#include <QWebFrame>
+#include <QWebPage>
+
+#include <algorithm>
+
 AdBlockMatcher::AdBlockMatcher(AdBlockManager* manager)
   : QObject(manager)
   , m_manager(manager)
+  , m_domainCssCache(1024)
+  , m_timingEnabled(false)
+  , m_matchCache(1000)
 {
-  connect(manager, SIGNAL(enabledChanged(bool)), this, SLOT(enabledChanged(bool)));
+  resetStatistics();
+
+  // Benchmark uses matcher without manager
+  if (manager) {
+    connect(manager, SIGNAL(enabledChanged(bool)), this, SLOT(enabledChanged(bool)));
+  }
 }
 
 AdBlockMatcher::~AdBlockMatcher()
@@ -52,31 +67,244 @@ AdBlockMatcher::~AdBlockMatcher()
 
 const AdBlockRule* AdBlockMatcher::match(const QNetworkRequest &request, const QString &urlDomain, const QString &urlString) const
 {
-  // Exception rules
-  if (m_networkExceptionTree.find(request, urlDomain, urlString))
-    return 0;
+  QElapsedTimer timer;
+  if (m_timingEnabled)
+    timer.start();
+
+  ++m_statistics.checkedRequests;
+
+  const QString cacheKey = matchCacheKey(request, urlString);
+  CachedMatch* cachedMatch = m_matchCache.object(cacheKey);
+
+  if (cachedMatch) {
+    ++m_statistics.cachedRequests;
+  }
+  else {
+    const QSet<QString> tokens = urlTokens(urlDomain, urlString);
+
+    cachedMatch = new CachedMatch;
+    cachedMatch->rule = 0;
+
+    // Exception rules
+    cachedMatch->exempted = findRule(m_networkExceptionTree, m_networkExceptionTokens, m_networkExceptionRules,
+                                     tokens, request, urlDomain, urlString) != 0;
+
+    // Block rules
+    if (!cachedMatch->exempted) {
+      cachedMatch->rule = findRule(m_networkBlockTree, m_networkBlockTokens, m_networkBlockRules,
+                                   tokens, request, urlDomain, urlString);
+    }
 
-  int count = m_networkExceptionRules.count();
-  for (int i = 0; i < count; ++i) {
-    const AdBlockRule* rule = m_networkExceptionRules.at(i);
-    if (rule->networkMatch(request, urlDomain, urlString))
-      return 0;
+    m_matchCache.insert(cacheKey, cachedMatch);
   }
 
-  // Block rules
-  if (const AdBlockRule* rule = m_networkBlockTree.find(request, urlDomain, urlString))
+  const AdBlockRule* rule = cachedMatch->rule;
+  if (cachedMatch->exempted)
+    ++m_statistics.exemptedRequests;
+  else if (rule)
+    ++m_statistics.blockedRequests;
+
+  if (m_timingEnabled)
+    addLatency(timer.nsecsElapsed());
+
+  return rule;
+}
+
+const AdBlockRule* AdBlockMatcher::findRule(const AdBlockSearchTree &tree, const RulesTokenIndex &index,
+                                            const QVector<const AdBlockRule*> &rules, const QSet<QString> &tokens,
+                                            const QNetworkRequest &request, const QString &urlDomain,
+                                            const QString &urlString) const
+{
+  if (const AdBlockRule* rule = tree.find(request, urlDomain, urlString))
     return rule;
 
-  count = m_networkBlockRules.count();
-  for (int i = 0; i < count; ++i) {
-    const AdBlockRule* rule = m_networkBlockRules.at(i);
-    if (rule->networkMatch(request, urlDomain, urlString))
+  // Candidates are checked in rule list order, so the first matching rule
+  // doesn't depend on order of tokens in the set
+  QVector<int> candidates = index.value(QString());
+  foreach (const QString &token, tokens) {
+    RulesTokenIndex::const_iterator it = index.constFind(token);
+    if (it != index.constEnd())
+      candidates += it.value();
+  }
+
+  // Every rule has at most one token, so there are no duplicates
+  std::sort(candidates.begin(), candidates.end());
+
+  foreach (int i, candidates) {
+    const AdBlockRule* rule = rules.at(i);
+    if (networkMatch(rule, request, urlDomain, urlString))
       return rule;
   }
 
   return 0;
 }
 
+// Checks rule outside of search trees, remembers the slowest rules
+bool AdBlockMatcher::networkMatch(const AdBlockRule* rule, const QNetworkRequest &request,
+                                  const QString &urlDomain, const QString &urlString) const
+{
+  ++m_statistics.evaluatedRules;
+
+  if (!m_timingEnabled)
+    return rule->networkMatch(request, urlDomain, urlString);
+
+  QElapsedTimer timer;
+  timer.start();
+
+  bool matched = rule->networkMatch(request, urlDomain, urlString);
+
+  qint64 elapsed = timer.nsecsElapsed();
+
+  // Filter text is kept, rules are freed when subscriptions are updated
+  QVector<QPair<QString, qint64> > &slowestRules = m_statistics.slowestRules;
+  const int slowestRulesCount = 10;
+
+  if (slowestRules.count() == slowestRulesCount && elapsed <= slowestRules.last().second)
+    return matched;
+
+  const QString filter = rule->filter();
+  int i = 0;
+  while (i < slowestRules.count() && slowestRules.at(i).first != filter)
+    ++i;
+
+  if (i < slowestRules.count()) {
+    if (elapsed <= slowestRules.at(i).second)
+      return matched;
+    slowestRules.remove(i);
+  }
+  else if (slowestRules.count() == slowestRulesCount) {
+    slowestRules.remove(slowestRulesCount - 1);
+  }
+
+  // Keep sorted from the slowest
+  i = 0;
+  while (i < slowestRules.count() && slowestRules.at(i).second >= elapsed)
+    ++i;
+  slowestRules.insert(i, qMakePair(filter, elapsed));
+
+  return matched;
+}
+
+static const int s_latencyBucketLimits[] = { 10, 50, 100, 500, 1000, 5000, 10000 };
+
+int AdBlockMatcher::latencyBucketsCount()
+{
+  return int(sizeof(s_latencyBucketLimits) / sizeof(s_latencyBucketLimits[0])) + 1;
+}
+
+// Upper limit of bucket in microseconds, -1 for the last unlimited one
+int AdBlockMatcher::latencyBucketLimit(int bucket)
+{
+  if (bucket < 0 || bucket >= latencyBucketsCount() - 1)
+    return -1;
+
+  return s_latencyBucketLimits[bucket];
+}
+
+void AdBlockMatcher::addLatency(qint64 nsecs) const
+{
+  int bucket = 0;
+  while (latencyBucketLimit(bucket) != -1 && nsecs >= qint64(latencyBucketLimit(bucket)) * 1000)
+    ++bucket;
+
+  ++m_statistics.latencyHistogram[bucket];
+}
+
+// Average number of rules outside of search trees checked per request
+double AdBlockMatcher::averageRulesEvaluated() const
+{
+  qint64 matchedRequests = m_statistics.checkedRequests - m_statistics.cachedRequests;
+  if (matchedRequests == 0)
+    return 0;
+
+  return double(m_statistics.evaluatedRules) / matchedRequests;
+}
+
+AdBlockMatcher::Statistics AdBlockMatcher::statistics() const
+{
+  return m_statistics;
+}
+
+void AdBlockMatcher::resetStatistics()
+{
+  m_statistics.checkedRequests = 0;
+  m_statistics.blockedRequests = 0;
+  m_statistics.exemptedRequests = 0;
+  m_statistics.cachedRequests = 0;
+  m_statistics.evaluatedRules = 0;
+  m_statistics.latencyHistogram = QVector<qint64>(latencyBucketsCount(), 0);
+  m_statistics.slowestRules.clear();
+}
+
+bool AdBlockMatcher::isTimingEnabled() const
+{
+  return m_timingEnabled;
+}
+
+// Timing every match costs two clock reads per request and per evaluated
+// rule, so it is done only on request
+void AdBlockMatcher::setTimingEnabled(bool enabled)
+{
+  m_timingEnabled = enabled;
+}
+
+void AdBlockMatcher::addRule(const AdBlockRule* rule, RulesTokenIndex &index, QVector<const AdBlockRule*> &rules)
+{
+  index[rule->m_token].append(rules.count());
+  rules.append(rule);
+}
+
+// Tokens are split the same way as AdBlockRule::findToken() does,
+// domain is added because domain rules are matched against it
+QSet<QString> AdBlockMatcher::urlTokens(const QString &urlDomain, const QString &urlString)
+{
+  QSet<QString> tokens;
+  const QString strings[2] = { urlString, urlDomain };
+
+  for (int s = 0; s < 2; ++s) {
+    const QString &string = strings[s];
+    int start = -1;
+
+    for (int i = 0; i <= string.size(); ++i) {
+      if (i < string.size() && AdBlockRule::isTokenCharacter(string.at(i))) {
+        if (start < 0)
+          start = i;
+      }
+      else if (start >= 0) {
+        tokens.insert(string.mid(start, i - start));
+        start = -1;
+      }
+    }
+  }
+
+  return tokens;
+}
+
+// Besides url, rule options can depend on referer, element type,
+// XMLHttpRequest header and frame of request
+QString AdBlockMatcher::matchCacheKey(const QNetworkRequest &request, const QString &urlString)
+{
+  QString key = urlString;
+
+  key.append(QL1C('\n'));
+  key.append(QUrl(request.attribute(QNetworkRequest::Attribute(QNetworkRequest::User + 151)).toString()).host());
+  key.append(QL1C('\n'));
+  key.append(request.attribute(QNetworkRequest::Attribute(QNetworkRequest::User + 150)).toString());
+  key.append(QL1C('\n'));
+  key.append(request.rawHeader("X-Requested-With") == QByteArray("XMLHttpRequest") ? QL1C('x') : QL1C('-'));
+
+  QWebFrame* originatingFrame = static_cast<QWebFrame*>(request.originatingObject());
+  QWebPage* page = originatingFrame ? originatingFrame->page() : 0;
+  if (!page)
+    key.append(QL1C('-'));
+  else if (originatingFrame == page->mainFrame())
+    key.append(QL1C('m'));
+  else
+    key.append(QL1C('s'));
+
+  return key;
+}
+
 bool AdBlockMatcher::adBlockDisabledForUrl(const QUrl &url) const
 {
   int count = m_documentRules.count();
@@ -109,12 +337,31 @@ QString AdBlockMatcher::elementHidingRules() const
 
 QString AdBlockMatcher::elementHidingRulesForDomain(const QString &domain) const
 {
+  if (QString* cachedRules = m_domainCssCache.object(domain))
+    return *cachedRules;
+
+  // Only rules allowed on the domain or on its parent domains can match
+  QVector<int> candidates = m_domainCssRulesAnyDomain;
+  QString parentDomain = domain;
+  while (!parentDomain.isEmpty()) {
+    QHash<QString, QVector<int> >::const_iterator it = m_domainCssRulesIndex.constFind(parentDomain);
+    if (it != m_domainCssRulesIndex.constEnd())
+      candidates += it.value();
+
+    int dotIndex = parentDomain.indexOf(QL1C('.'));
+    if (dotIndex < 0)
+      break;
+    parentDomain = parentDomain.mid(dotIndex + 1);
+  }
+
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
   QString rules;
   int addedRulesCount = 0;
-  int count = m_domainRestrictedCssRules.count();
 
-  for (int i = 0; i < count; ++i) {
-    const AdBlockRule* rule = m_domainRestrictedCssRules.at(i);
+  foreach (int index, candidates) {
+    const AdBlockRule* rule = m_domainRestrictedCssRules.at(index);
     if (!rule->matchDomain(domain))
       continue;
 
@@ -124,60 +371,89 @@ QString AdBlockMatcher::elementHidingRulesForDomain(const QString &domain) const
       addedRulesCount = 0;
     }
     else {
-      rules.append(rule->cssSelector() + QLatin1Char(','));
+      rules.append(rule->cssSelector());
+      rules.append(QLatin1Char(','));
       addedRulesCount++;
     }
   }
 
   if (addedRulesCount != 0) {
-    rules = rules.left(rules.size() - 1);
+    rules.chop(1);
     rules.append(QLatin1String("{display:none !important;}\n"));
   }
 
+  m_domainCssCache.insert(domain, new QString(rules), rules.size() / 1024 + 1);
+
   return rules;
 }
 
 void AdBlockMatcher::update()
+{
+  QVector<const AdBlockRule*> rules;
+
+  foreach (AdBlockSubscription* subscription, m_manager->subscriptions()) {
+    foreach (const AdBlockRule* rule, subscription->allRules()) {
+      rules.append(rule);
+    }
+  }
+
+  setRules(rules);
+
+  // Matcher doesn't reference rules of previous subscription loads anymore
+  foreach (AdBlockSubscription* subscription, m_manager->subscriptions()) {
+    subscription->releaseSupersededRules();
+  }
+
+  int domainsCount = AdBlockRule::pruneInternedDomains();
+#ifdef ADBLOCK_DEBUG
+  qDebug() << "AdBlockMatcher: interned domains" << domainsCount;
+#else
+  Q_UNUSED(domainsCount)
+#endif
+}
+
+void AdBlockMatcher::setRules(const QVector<const AdBlockRule*> &rules)
 {
   clear();
 
   QHash<QString, const AdBlockRule*> cssRulesHash;
   QVector<const AdBlockRule*> exceptionCssRules;
 
-  foreach (AdBlockSubscription* subscription, m_manager->subscriptions()) {
-    foreach (const AdBlockRule* rule, subscription->allRules()) {
-      // Don't add internally disabled rules to cache
-      if (rule->isInternalDisabled())
-        continue;
+  foreach (const AdBlockRule* rule, rules) {
+    // Don't add internally disabled rules to cache
+    if (rule->isInternalDisabled())
+      continue;
 
-      if (rule->isCssRule()) {
-        // We will add only enabled css rules to cache, because there is no enabled/disabled
-        // check on match. They are directly embedded to pages.
-        if (!rule->isEnabled())
-          continue;
+    if (rule->isCssRule()) {
+      // We will add only enabled css rules to cache, because there is no enabled/disabled
+      // check on match. They are directly embedded to pages.
+      if (!rule->isEnabled())
+        continue;
 
-        if (rule->isException())
-          exceptionCssRules.append(rule);
-        else
-          cssRulesHash.insert(rule->cssSelector(), rule);
-      }
-      else if (rule->isDocument()) {
-        m_documentRules.append(rule);
-      }
-      else if (rule->isElemhide()) {
-        m_elemhideRules.append(rule);
-      }
-      else if (rule->isException()) {
-        if (!m_networkExceptionTree.add(rule))
-          m_networkExceptionRules.append(rule);
-      }
-      else {
-        if (!m_networkBlockTree.add(rule))
-          m_networkBlockRules.append(rule);
-      }
+      if (rule->isException())
+        exceptionCssRules.append(rule);
+      else
+        cssRulesHash.insert(rule->cssSelector(), rule);
+    }
+    else if (rule->isDocument()) {
+      m_documentRules.append(rule);
+    }
+    else if (rule->isElemhide()) {
+      m_elemhideRules.append(rule);
+    }
+    else if (rule->isException()) {
+      if (!m_networkExceptionTree.add(rule))
+        addRule(rule, m_networkExceptionTokens, m_networkExceptionRules);
+    }
+    else {
+      if (!m_networkBlockTree.add(rule))
+        addRule(rule, m_networkBlockTokens, m_networkBlockRules);
     }
   }
 
+  m_networkExceptionTree.build();
+  m_networkBlockTree.build();
+
   foreach (const AdBlockRule* rule, exceptionCssRules) {
     const AdBlockRule* originalRule = cssRulesHash.value(rule->cssSelector());
 
@@ -204,6 +480,14 @@ void AdBlockMatcher::update()
     const AdBlockRule* rule = it.value();
 
     if (rule->isDomainRestricted()) {
+      if (rule->m_allowedDomains.isEmpty()) {
+        m_domainCssRulesAnyDomain.append(m_domainRestrictedCssRules.count());
+      }
+      else {
+        foreach (const QString &domain, rule->m_allowedDomains) {
+          m_domainCssRulesIndex[domain].append(m_domainRestrictedCssRules.count());
+        }
+      }
       m_domainRestrictedCssRules.append(rule);
     }
     else if (Q_UNLIKELY(hidingRulesCount == 1000)) {
@@ -227,9 +511,15 @@ void AdBlockMatcher::clear()
 {
   m_networkExceptionTree.clear();
   m_networkExceptionRules.clear();
+  m_networkExceptionTokens.clear();
   m_networkBlockTree.clear();
   m_networkBlockRules.clear();
+  m_networkBlockTokens.clear();
+  m_matchCache.clear();
   m_domainRestrictedCssRules.clear();
+  m_domainCssRulesIndex.clear();
+  m_domainCssRulesAnyDomain.clear();
+  m_domainCssCache.clear();
   m_elementHidingRules.clear();
   m_documentRules.clear();
   m_elemhideRules.clear();
@@ -38,6 +38,10 @@
 #include <QUrl>
 #include <QObject>
 #include <QVector>
+#include <QHash>
+#include <QCache>
+#include <QSet>
+#include <QPair>
 
 #include "adblocksearchtree.h"
 
@@ -49,6 +53,19 @@ class AdBlockMatcher : public QObject
   Q_OBJECT
 
 public:
+  struct Statistics {
+    qint64 checkedRequests;
+    qint64 blockedRequests;
+    qint64 exemptedRequests;
+    qint64 cachedRequests;
+    qint64 evaluatedRules;
+    // Requests by time of match(), see latencyBucketLimit(), times are
+    // measured only with timing enabled
+    QVector<qint64> latencyHistogram;
+    // Filters of rules with the longest single check in nanoseconds
+    QVector<QPair<QString, qint64> > slowestRules;
+  };
+
   explicit AdBlockMatcher(AdBlockManager* manager);
   ~AdBlockMatcher();
 
@@ -60,6 +77,18 @@ public:
   QString elementHidingRules() const;
   QString elementHidingRulesForDomain(const QString &domain) const;
 
+  double averageRulesEvaluated() const;
+  Statistics statistics() const;
+  void resetStatistics();
+
+  bool isTimingEnabled() const;
+  void setTimingEnabled(bool enabled);
+
+  void setRules(const QVector<const AdBlockRule*> &rules);
+
+  static int latencyBucketsCount();
+  static int latencyBucketLimit(int bucket);
+
 public slots:
   void update();
   void clear();
@@ -68,6 +97,26 @@ private slots:
   void enabledChanged(bool enabled);
 
 private:
+  // Indexes of rules by token, ascending so rules are checked in list order
+  typedef QHash<QString, QVector<int> > RulesTokenIndex;
+
+  struct CachedMatch {
+    const AdBlockRule* rule;
+    bool exempted;
+  };
+
+  static void addRule(const AdBlockRule* rule, RulesTokenIndex &index, QVector<const AdBlockRule*> &rules);
+  static QSet<QString> urlTokens(const QString &urlDomain, const QString &urlString);
+  static QString matchCacheKey(const QNetworkRequest &request, const QString &urlString);
+
+  const AdBlockRule* findRule(const AdBlockSearchTree &tree, const RulesTokenIndex &index,
+                              const QVector<const AdBlockRule*> &rules, const QSet<QString> &tokens,
+                              const QNetworkRequest &request, const QString &urlDomain,
+                              const QString &urlString) const;
+  bool networkMatch(const AdBlockRule* rule, const QNetworkRequest &request,
+                    const QString &urlDomain, const QString &urlString) const;
+  void addLatency(qint64 nsecs) const;
+
   AdBlockManager* m_manager;
 
   QVector<AdBlockRule*> m_createdRules;
@@ -77,9 +126,26 @@ private:
   QVector<const AdBlockRule*> m_documentRules;
   QVector<const AdBlockRule*> m_elemhideRules;
 
+  // Domain restricted css rules by their allowed domains, rules with only
+  // blocked domains can match any domain
+  QHash<QString, QVector<int> > m_domainCssRulesIndex;
+  QVector<int> m_domainCssRulesAnyDomain;
+  mutable QCache<QString, QString> m_domainCssCache;
+
+  bool m_timingEnabled;
+
   QString m_elementHidingRules;
   AdBlockSearchTree m_networkBlockTree;
   AdBlockSearchTree m_networkExceptionTree;
+
+  // Network rules that are not in trees are in m_networkExceptionRules and
+  // m_networkBlockRules, found by their token. Rules without token are
+  // indexed by empty token
+  RulesTokenIndex m_networkBlockTokens;
+  RulesTokenIndex m_networkExceptionTokens;
+
+  mutable QCache<QString, CachedMatch> m_matchCache;
+  mutable Statistics m_statistics;
 };
 
 #endif // ADBLOCKMATCHER_H
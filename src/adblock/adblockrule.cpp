@@ -66,9 +66,13 @@
 #include "common.h"
 
 #include <QDebug>
+#include <QDataStream>
 #include <QUrl>
 #include <QString>
 #include <QStringList>
+#include <QSet>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QNetworkRequest>
 #include <QWebFrame>
 #include <QWebPage>
@@ -111,6 +115,42 @@ static QString toSecondLevelDomain(const QUrl &url)
 #endif
 }
 
+// Same domains are used by many rules, keep only one copy of each
+static QSet<QString> s_internedDomains;
+static QMutex s_internedDomainsMutex;
+
+static QString internDomain(const QString &domain)
+{
+  QMutexLocker locker(&s_internedDomainsMutex);
+
+  QSet<QString>::const_iterator it = s_internedDomains.constFind(domain);
+  if (it != s_internedDomains.constEnd()) {
+    return *it;
+  }
+
+  s_internedDomains.insert(domain);
+  return domain;
+}
+
+// Removes domains not shared with any rule anymore, returns count of
+// domains left in pool
+int AdBlockRule::pruneInternedDomains()
+{
+  QMutexLocker locker(&s_internedDomainsMutex);
+
+  QSet<QString>::iterator it = s_internedDomains.begin();
+  while (it != s_internedDomains.end()) {
+    if ((*it).isDetached()) {
+      it = s_internedDomains.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+
+  return s_internedDomains.count();
+}
+
 AdBlockRule::AdBlockRule(const QString &filter, AdBlockSubscription* subscription)
   : m_subscription(subscription)
   , m_type(StringContainsMatchRule)
@@ -138,6 +178,7 @@ AdBlockRule* AdBlockRule::copy() const
   rule->m_filter = m_filter;
   rule->m_matchString = m_matchString;
   rule->m_caseSensitivity = m_caseSensitivity;
+  rule->m_token = m_token;
   rule->m_isEnabled = m_isEnabled;
   rule->m_isException = m_isException;
   rule->m_isInternalDisabled = m_isInternalDisabled;
@@ -511,7 +552,14 @@ void AdBlockRule::parseFilter()
     m_type = RegExpMatchRule;
     m_regExp = new RegExp;
     m_regExp->regExp = QzRegExp(parsedLine, m_caseSensitivity);
-    m_regExp->matchers = createStringMatchers(parseRegExpFilter(parsedLine));
+
+    const QStringList matchStrings = parseRegExpFilter(parsedLine);
+    m_regExp->matchers = createStringMatchers(matchStrings);
+
+    // Url must contain all match strings, so tokens inside them can be used
+    foreach (const QString &matchString, matchStrings) {
+      findToken(matchString, false, false, &m_token);
+    }
     return;
   }
 
@@ -531,6 +579,7 @@ void AdBlockRule::parseFilter()
 
     m_type = DomainMatchRule;
     m_matchString = parsedLine;
+    findToken(parsedLine, true, true, &m_token);
     return;
   }
 
@@ -540,6 +589,7 @@ void AdBlockRule::parseFilter()
 
     m_type = StringEndsMatchRule;
     m_matchString = parsedLine;
+    findToken(parsedLine, false, true, &m_token);
     return;
   }
 
@@ -553,6 +603,18 @@ void AdBlockRule::parseFilter()
     m_regExp = new RegExp;
     m_regExp->regExp = QzRegExp(createRegExpFromFilter(parsedLine), m_caseSensitivity);
     m_regExp->matchers = createStringMatchers(parseRegExpFilter(parsedLine));
+
+    // Starting | or || and ending | anchor the filter at url separators
+    int tokenStart = 0;
+    int tokenEnd = parsedLine.size();
+    while (tokenStart < tokenEnd && tokenStart < 2 && parsedLine.at(tokenStart) == QL1C('|')) {
+      ++tokenStart;
+    }
+    if (tokenEnd > tokenStart && parsedLine.at(tokenEnd - 1) == QL1C('|')) {
+      --tokenEnd;
+    }
+    findToken(parsedLine.mid(tokenStart, tokenEnd - tokenStart), tokenStart > 0,
+              tokenEnd < parsedLine.size(), &m_token);
     return;
   }
 
@@ -570,10 +632,10 @@ void AdBlockRule::parseDomains(const QString &domains, const QChar &separator)
       continue;
     }
     if (domain.startsWith(QL1C('~'))) {
-      m_blockedDomains.append(domain.mid(1));
+      m_blockedDomains.append(internDomain(domain.mid(1)));
     }
     else {
-      m_allowedDomains.append(domain);
+      m_allowedDomains.append(internDomain(domain));
     }
   }
 
@@ -687,6 +749,54 @@ QList<QStringMatcher> AdBlockRule::createStringMatchers(const QStringList &filte
   return matchers;
 }
 
+static bool isCommonToken(const QString &token)
+{
+  return token == QL1S("http") || token == QL1S("https") ||
+      token == QL1S("www") || token == QL1S("com");
+}
+
+bool AdBlockRule::isTokenCharacter(const QChar &c)
+{
+  return c.isLetterOrNumber();
+}
+
+// Find runs of token characters in filter which are bounded by separators on
+// both sides, so matching url has to contain them as whole tokens.
+// Longer and less common runs are preferred, the best one is kept in token.
+void AdBlockRule::findToken(const QString &filter, bool startBounded, bool endBounded, QString* token)
+{
+  int start = -1;
+  bool leftBounded = startBounded;
+
+  for (int i = 0; i <= filter.size(); ++i) {
+    if (i < filter.size() && isTokenCharacter(filter.at(i))) {
+      if (start < 0)
+        start = i;
+      continue;
+    }
+
+    if (start >= 0) {
+      bool rightBounded = (i < filter.size()) ? filter.at(i) != QL1C('*') : endBounded;
+
+      if (leftBounded && rightBounded) {
+        const QString candidate = filter.mid(start, i - start).toLower();
+        bool better = token->isEmpty();
+
+        if (!better && isCommonToken(*token) != isCommonToken(candidate))
+          better = isCommonToken(*token);
+        else if (!better)
+          better = candidate.size() > token->size();
+
+        if (better)
+          *token = candidate;
+      }
+      start = -1;
+    }
+
+    leftBounded = (i < filter.size()) && filter.at(i) != QL1C('*');
+  }
+}
+
 bool AdBlockRule::isMatchingDomain(const QString &domain, const QString &filter) const
 {
   return Common::matchDomain(filter, domain);
@@ -752,3 +862,65 @@ void AdBlockRule::setException(const AdBlockRule::RuleOption &opt, bool on)
     m_exceptions |= opt;
   }
 }
+
+QDataStream &operator<<(QDataStream &stream, const AdBlockRule &rule)
+{
+  stream << qint32(rule.m_type) << qint32(rule.m_options) << qint32(rule.m_exceptions);
+  stream << rule.m_filter << rule.m_matchString << qint32(rule.m_caseSensitivity);
+  stream << rule.m_isEnabled << rule.m_isException << rule.m_isInternalDisabled;
+  stream << rule.m_allowedDomains << rule.m_blockedDomains << rule.m_token;
+
+  stream << bool(rule.m_regExp);
+  if (rule.m_regExp) {
+    QStringList patterns;
+    foreach (const QStringMatcher &matcher, rule.m_regExp->matchers) {
+      patterns.append(matcher.pattern());
+    }
+
+    stream << rule.m_regExp->regExp.pattern() << patterns;
+  }
+
+  return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, AdBlockRule &rule)
+{
+  qint32 type;
+  qint32 options;
+  qint32 exceptions;
+  qint32 caseSensitivity;
+  bool hasRegExp;
+
+  stream >> type >> options >> exceptions;
+  stream >> rule.m_filter >> rule.m_matchString >> caseSensitivity;
+  stream >> rule.m_isEnabled >> rule.m_isException >> rule.m_isInternalDisabled;
+  stream >> rule.m_allowedDomains >> rule.m_blockedDomains >> rule.m_token;
+
+  for (int i = 0; i < rule.m_allowedDomains.count(); ++i) {
+    rule.m_allowedDomains[i] = internDomain(rule.m_allowedDomains.at(i));
+  }
+  for (int i = 0; i < rule.m_blockedDomains.count(); ++i) {
+    rule.m_blockedDomains[i] = internDomain(rule.m_blockedDomains.at(i));
+  }
+
+  rule.m_type = AdBlockRule::RuleType(type);
+  rule.m_options = AdBlockRule::RuleOptions(QFlag(options));
+  rule.m_exceptions = AdBlockRule::RuleOptions(QFlag(exceptions));
+  rule.m_caseSensitivity = Qt::CaseSensitivity(caseSensitivity);
+
+  delete rule.m_regExp;
+  rule.m_regExp = 0;
+
+  stream >> hasRegExp;
+  if (hasRegExp) {
+    QString pattern;
+    QStringList patterns;
+    stream >> pattern >> patterns;
+
+    rule.m_regExp = new AdBlockRule::RegExp;
+    rule.m_regExp->regExp = QzRegExp(pattern, rule.m_caseSensitivity);
+    rule.m_regExp->matchers = rule.createStringMatchers(patterns);
+  }
+
+  return stream;
+}
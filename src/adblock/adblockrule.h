@@ -68,6 +68,7 @@
 #include <qzregexp.h>
 
 class QNetworkRequest;
+class QDataStream;
 class QUrl;
 
 class AdBlockSubscription;
@@ -112,6 +113,8 @@ public:
   bool matchXmlHttpRequest(const QNetworkRequest &request) const;
   bool matchImage(const QString &encodedUrl) const;
 
+  static int pruneInternedDomains();
+
 protected:
   bool isMatchingDomain(const QString &domain, const QString &filter) const;
   bool isMatchingRegExpStrings(const QString &url) const;
@@ -155,6 +158,9 @@ private:
   QString createRegExpFromFilter(const QString &filter) const;
   QList<QStringMatcher> createStringMatchers(const QStringList &filters) const;
 
+  static bool isTokenCharacter(const QChar &c);
+  static void findToken(const QString &filter, bool startBounded, bool endBounded, QString* token);
+
   AdBlockSubscription* m_subscription;
 
   RuleType m_type;
@@ -167,6 +173,8 @@ private:
   QString m_matchString;
   // Case sensitivity for string matching
   Qt::CaseSensitivity m_caseSensitivity;
+  // Lowercase token which is always a whole token of matching url (network rules only)
+  QString m_token;
 
   bool m_isEnabled;
   bool m_isException;
@@ -186,7 +194,14 @@ private:
   friend class AdBlockMatcher;
   friend class AdBlockSearchTree;
   friend class AdBlockSubscription;
+
+  friend QDataStream &operator<<(QDataStream &stream, const AdBlockRule &rule);
+  friend QDataStream &operator>>(QDataStream &stream, AdBlockRule &rule);
 };
 
+// Parsed rule without subscription, used by subscription cache
+QDataStream &operator<<(QDataStream &stream, const AdBlockRule &rule);
+QDataStream &operator>>(QDataStream &stream, AdBlockRule &rule);
+
 #endif // ADBLOCKRULE_H
 
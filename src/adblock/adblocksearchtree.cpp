@@ -37,20 +37,25 @@
 
 #include <QDebug>
 
+#include <algorithm>
+
 AdBlockSearchTree::AdBlockSearchTree()
-  : m_root(new Node)
 {
+  clear();
 }
 
 AdBlockSearchTree::~AdBlockSearchTree()
 {
-  deleteNode(m_root);
 }
 
 void AdBlockSearchTree::clear()
 {
-  deleteNode(m_root);
-  m_root = new Node;
+  m_pendingRules.clear();
+  m_nodes.clear();
+  m_edgeChars.clear();
+  m_edgeTargets.clear();
+
+  m_nodes.append(Node());
 }
 
 bool AdBlockSearchTree::add(const AdBlockRule* rule)
@@ -67,30 +72,80 @@ bool AdBlockSearchTree::add(const AdBlockRule* rule)
     return false;
   }
 
-  Node* node = m_root;
+  PendingRule pendingRule;
+  pendingRule.filter = filter;
+  pendingRule.rule = rule;
+  m_pendingRules.append(pendingRule);
 
-  for (int i = 0; i < len; ++i) {
-    const QChar c = filter.at(i);
-    if (!node->children.contains(c)) {
-      Node* n = new Node;
-      n->c = c;
+  return true;
+}
+
+bool AdBlockSearchTree::pendingRuleLessThan(const PendingRule &a, const PendingRule &b)
+{
+  return a.filter < b.filter;
+}
+
+// Builds the trie from rules collected by add(). Filters are sorted, so
+// every node owns a contiguous range of them sharing the node's prefix.
+// Nodes are created breadth-first and edges of one node are appended
+// together, already sorted by character.
+void AdBlockSearchTree::build()
+{
+  m_nodes.clear();
+  m_edgeChars.clear();
+  m_edgeTargets.clear();
+  m_nodes.append(Node());
 
-      node->children[c] = n;
+  // Stable sort keeps insertion order of equal filters, the last added rule wins
+  std::stable_sort(m_pendingRules.begin(), m_pendingRules.end(), pendingRuleLessThan);
+
+  QVector<BuildRange> queue;
+  BuildRange rootRange = { 0, 0, m_pendingRules.size(), 0 };
+  queue.append(rootRange);
+
+  for (int q = 0; q < queue.size(); ++q) {
+    const BuildRange range = queue.at(q);
+    int i = range.first;
+
+    while (i < range.last && m_pendingRules.at(i).filter.size() == range.depth) {
+      m_nodes[range.node].rule = m_pendingRules.at(i).rule;
+      ++i;
     }
 
-    node = node->children[c];
-  }
+    m_nodes[range.node].firstEdge = m_edgeChars.size();
 
-  node->rule = rule;
+    while (i < range.last) {
+      const QChar c = m_pendingRules.at(i).filter.at(range.depth);
+      int j = i + 1;
+      while (j < range.last && m_pendingRules.at(j).filter.at(range.depth) == c) {
+        ++j;
+      }
 
-  return true;
+      m_edgeChars.append(c);
+      m_edgeTargets.append(m_nodes.size());
+
+      BuildRange childRange = { m_nodes.size(), i, j, range.depth + 1 };
+      queue.append(childRange);
+      m_nodes.append(Node());
+
+      i = j;
+    }
+
+    m_nodes[range.node].edgeCount = m_edgeChars.size() - m_nodes.at(range.node).firstEdge;
+  }
+
+  m_pendingRules.clear();
+  m_pendingRules.squeeze();
+  m_nodes.squeeze();
+  m_edgeChars.squeeze();
+  m_edgeTargets.squeeze();
 }
 
 const AdBlockRule* AdBlockSearchTree::find(const QNetworkRequest &request, const QString &domain, const QString &urlString) const
 {
   int len = urlString.size();
 
-  if (len <= 0) {
+  if (len <= 0 || m_nodes.at(0).edgeCount == 0) {
     return 0;
   }
 
@@ -106,52 +161,51 @@ const AdBlockRule* AdBlockSearchTree::find(const QNetworkRequest &request, const
   return 0;
 }
 
+int AdBlockSearchTree::child(int node, const QChar &c) const
+{
+  const Node &n = m_nodes.at(node);
+  const QChar* first = m_edgeChars.constData() + n.firstEdge;
+  const QChar* last = first + n.edgeCount;
+  const QChar* edge = std::lower_bound(first, last, c);
+
+  if (edge == last || *edge != c) {
+    return -1;
+  }
+
+  return m_edgeTargets.at(edge - m_edgeChars.constData());
+}
+
 const AdBlockRule* AdBlockSearchTree::prefixSearch(const QNetworkRequest &request, const QString &domain, const QString &urlString, const QChar* string, int len) const
 {
   if (len <= 0) {
     return 0;
   }
 
-  QChar c = string[0];
+  int node = child(0, string[0]);
 
-  if (!m_root->children.contains(c)) {
+  if (node < 0) {
     return 0;
   }
 
-  Node* node = m_root->children[c];
-
   for (int i = 1; i < len; ++i) {
     const QChar c = (++string)[0];
 
-    if (node->rule && node->rule->networkMatch(request, domain, urlString)) {
-      return node->rule;
+    const AdBlockRule* rule = m_nodes.at(node).rule;
+    if (rule && rule->networkMatch(request, domain, urlString)) {
+      return rule;
     }
 
-    if (!node->children.contains(c)) {
+    node = child(node, c);
+
+    if (node < 0) {
       return 0;
     }
-
-    node = node->children[c];
   }
 
-  if (node->rule && node->rule->networkMatch(request, domain, urlString)) {
-    return node->rule;
+  const AdBlockRule* rule = m_nodes.at(node).rule;
+  if (rule && rule->networkMatch(request, domain, urlString)) {
+    return rule;
   }
 
   return 0;
 }
-
-void AdBlockSearchTree::deleteNode(AdBlockSearchTree::Node* node)
-{
-  if (!node) {
-    return;
-  }
-
-  QHashIterator<QChar, Node*> i(node->children);
-  while (i.hasNext()) {
-    i.next();
-    deleteNode(i.value());
-  }
-
-  delete node;
-}
@@ -36,12 +36,16 @@
 #define ADBLOCKSEARCHTREE_H
 
 #include <QChar>
-#include <QHash>
+#include <QString>
+#include <QVector>
 
 class QNetworkRequest;
 
 class AdBlockRule;
 
+// Trie of StringContainsMatchRule filters stored in flat arrays.
+// Rules are collected by add() and the trie is built once by build(),
+// children of every node are sorted by character and stored contiguously.
 class AdBlockSearchTree
 {
 public:
@@ -51,23 +55,44 @@ public:
   void clear();
 
   bool add(const AdBlockRule* rule);
+  void build();
+
   const AdBlockRule* find(const QNetworkRequest &request, const QString &domain, const QString &urlString) const;
 
 private:
   struct Node {
-    QChar c;
     const AdBlockRule* rule;
-    QHash<QChar, Node*> children;
+    int firstEdge;
+    int edgeCount;
+
+    Node() : rule(0), firstEdge(0), edgeCount(0) { }
+  };
+
+  struct PendingRule {
+    QString filter;
+    const AdBlockRule* rule;
+  };
 
-    Node() : c(0) , rule(0) { }
+  // Filters in [first, last) of sorted pending rules sharing prefix of node
+  struct BuildRange {
+    int node;
+    int first;
+    int last;
+    int depth;
   };
 
+  static bool pendingRuleLessThan(const PendingRule &a, const PendingRule &b);
+
+  int child(int node, const QChar &c) const;
+
   const AdBlockRule* prefixSearch(const QNetworkRequest &request, const QString &domain,
                                   const QString &urlString, const QChar* string, int len) const;
 
-  void deleteNode(Node* node);
+  QVector<PendingRule> m_pendingRules;
 
-  Node* m_root;
+  QVector<Node> m_nodes;
+  QVector<QChar> m_edgeChars;
+  QVector<int> m_edgeTargets;
 };
 
 #endif // ADBLOCKSEARCHTREE_H
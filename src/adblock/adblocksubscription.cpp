@@ -68,6 +68,8 @@
 #include "common.h"
 
 #include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
 #include <QTimer>
 #include <QNetworkReply>
 #include <QDebug>
@@ -101,6 +103,12 @@ void AdBlockSubscription::setFilePath(const QString &path)
   m_filePath = path;
 }
 
+// Parsed rules of subscription file, see saveCache()
+QString AdBlockSubscription::cacheFilePath() const
+{
+  return m_filePath + QLatin1String(".cache");
+}
+
 QUrl AdBlockSubscription::url() const
 {
   return m_url;
@@ -111,7 +119,7 @@ void AdBlockSubscription::setUrl(const QUrl &url)
   m_url = url;
 }
 
-void AdBlockSubscription::loadSubscription(const QStringList &disabledRules)
+void AdBlockSubscription::loadSubscription(const QSet<QString> &disabledRules)
 {
   QFile file(m_filePath);
 
@@ -139,16 +147,35 @@ void AdBlockSubscription::loadSubscription(const QStringList &disabledRules)
     return;
   }
 
-  m_rules.clear();
+  // Cache is used only for file with valid header
+  if (loadCache(disabledRules)) {
+    return;
+  }
 
+  QStringList filters;
   while (!textStream.atEnd()) {
-    AdBlockRule* rule = new AdBlockRule(textStream.readLine(), this);
+    filters.append(textStream.readLine());
+  }
+
+  AdBlockRule* rules = allocateRules(filters.count());
+  m_rules.clear();
+  m_rules.reserve(filters.count());
 
+  for (int i = 0; i < filters.count(); ++i) {
+    AdBlockRule* rule = &rules[i];
+    rule->setFilter(filters.at(i));
+    m_rules.append(rule);
+  }
+
+  // Cache keeps rules as parsed, rules disabled by user are applied on load
+  if (!m_rules.isEmpty()) {
+    saveCache();
+  }
+
+  foreach (AdBlockRule* rule, m_rules) {
     if (disabledRules.contains(rule->filter())) {
       rule->setEnabled(false);
     }
-
-    m_rules.append(rule);
   }
 
   // Initial update
@@ -161,6 +188,137 @@ void AdBlockSubscription::saveSubscription()
 {
 }
 
+// Rules of subscription file are allocated in one block, so loading and
+// freeing them does not allocate each rule separately. Block of previous
+// load is still used by matcher until it is updated, so it is only moved
+// aside here and freed by releaseSupersededRules().
+AdBlockRule* AdBlockSubscription::allocateRules(int count)
+{
+  if (m_rulesBlock.rules) {
+    m_supersededBlocks.append(m_rulesBlock);
+  }
+
+  m_rulesBlock.rules = new AdBlockRule[count];
+  m_rulesBlock.count = count;
+
+  for (int i = 0; i < count; ++i) {
+    m_rulesBlock.rules[i].setSubscription(this);
+  }
+
+#ifdef ADBLOCK_DEBUG
+  qDebug() << "AdBlockSubscription:" << m_title << "allocated" << count << "rules,"
+           << count * int(sizeof(AdBlockRule)) << "bytes in one block";
+#endif
+
+  return m_rulesBlock.rules;
+}
+
+// Called by matcher once it was rebuilt, nothing references old rules then
+void AdBlockSubscription::releaseSupersededRules()
+{
+  foreach (const RulesBlock &block, m_supersededBlocks) {
+    delete[] block.rules;
+  }
+  m_supersededBlocks.clear();
+}
+
+bool AdBlockSubscription::isBlockRule(const AdBlockRule* rule) const
+{
+  if (rule >= m_rulesBlock.rules && rule < m_rulesBlock.rules + m_rulesBlock.count) {
+    return true;
+  }
+
+  foreach (const RulesBlock &block, m_supersededBlocks) {
+    if (rule >= block.rules && rule < block.rules + block.count) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Cache is valid only for the same size and modification time of subscription
+// file. Format version has to be increased with every change of AdBlockRule
+// serialization. Rules are stored as parsed, without rules disabled by user.
+static const quint32 ADBLOCK_CACHE_MAGIC = 0x41424331; // ABC1
+static const qint32 ADBLOCK_CACHE_VERSION = 2;
+
+bool AdBlockSubscription::loadCache(const QSet<QString> &disabledRules)
+{
+  QFile file(cacheFilePath());
+  if (!file.open(QFile::ReadOnly)) {
+    return false;
+  }
+
+  const QFileInfo info(m_filePath);
+  const QByteArray data = file.readAll();
+  file.close();
+
+  QDataStream stream(data);
+  stream.setVersion(QDataStream::Qt_4_6);
+
+  quint32 magic;
+  qint32 version;
+  qint64 size;
+  qint64 lastModified;
+  qint32 count;
+  stream >> magic >> version >> size >> lastModified >> count;
+
+  if (stream.status() != QDataStream::Ok || magic != ADBLOCK_CACHE_MAGIC ||
+      version != ADBLOCK_CACHE_VERSION || size != info.size() ||
+      lastModified != info.lastModified().toMSecsSinceEpoch() ||
+      count <= 0 || count > data.size()) {
+    return false;
+  }
+
+  AdBlockRule* rulesBlock = allocateRules(count);
+  QVector<AdBlockRule*> rules;
+  rules.reserve(count);
+
+  for (int i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+    AdBlockRule* rule = &rulesBlock[i];
+    stream >> *rule;
+
+    if (disabledRules.contains(rule->filter())) {
+      rule->setEnabled(false);
+    }
+
+    rules.append(rule);
+  }
+
+  if (stream.status() != QDataStream::Ok) {
+    qWarning() << "AdBlockSubscription::" << __FUNCTION__ << "invalid adblock cache file" << cacheFilePath();
+    delete[] rulesBlock;
+    m_rulesBlock = m_supersededBlocks.isEmpty() ? RulesBlock() : m_supersededBlocks.takeLast();
+    return false;
+  }
+
+  m_rules = rules;
+  return true;
+}
+
+void AdBlockSubscription::saveCache() const
+{
+  QFile file(cacheFilePath());
+  if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+    qWarning() << "AdBlockSubscription::" << __FUNCTION__ << "Unable to open adblock cache file for writing:" << cacheFilePath();
+    return;
+  }
+
+  const QFileInfo info(m_filePath);
+
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_4_6);
+  stream << ADBLOCK_CACHE_MAGIC << ADBLOCK_CACHE_VERSION << qint64(info.size())
+         << qint64(info.lastModified().toMSecsSinceEpoch()) << qint32(m_rules.count());
+
+  foreach (const AdBlockRule* rule, m_rules) {
+    stream << *rule;
+  }
+
+  file.close();
+}
+
 void AdBlockSubscription::updateSubscription()
 {
   if (m_reply || !m_url.isValid()) {
@@ -314,7 +472,14 @@ const AdBlockRule* AdBlockSubscription::replaceRule(AdBlockRule* rule, int offse
 
 AdBlockSubscription::~AdBlockSubscription()
 {
-  qDeleteAll(m_rules);
+  foreach (AdBlockRule* rule, m_rules) {
+    if (!isBlockRule(rule)) {
+      delete rule;
+    }
+  }
+
+  releaseSupersededRules();
+  delete[] m_rulesBlock.rules;
 }
 
 // AdBlockCustomList
@@ -330,7 +495,7 @@ void AdBlockCustomList::retranslateStrings()
   setTitle(tr("Custom Rules"));
 }
 
-void AdBlockCustomList::loadSubscription(const QStringList &disabledRules)
+void AdBlockCustomList::loadSubscription(const QSet<QString> &disabledRules)
 {
   // DuckDuckGo ad whitelist rules
   // They cannot be removed, but can be disabled.
@@ -443,7 +608,9 @@ bool AdBlockCustomList::removeRule(int offset)
 
   AdBlockManager::instance()->removeDisabledRule(filter);
 
-  delete rule;
+  if (!isBlockRule(rule)) {
+    delete rule;
+  }
   return true;
 }
 
@@ -461,6 +628,8 @@ const AdBlockRule* AdBlockCustomList::replaceRule(AdBlockRule* rule, int offset)
   if (rule->isCssRule() || oldRule->isCssRule())
     mainApp->reloadUserStyleBrowser();
 
-  delete oldRule;
+  if (!isBlockRule(oldRule)) {
+    delete oldRule;
+  }
   return m_rules[offset];
 }
@@ -65,6 +65,7 @@
 
 #include <QVector>
 #include <QUrl>
+#include <QSet>
 
 #include "adblockrule.h"
 #include "adblocksearchtree.h"
@@ -87,11 +88,12 @@ public:
 
   QString filePath() const;
   void setFilePath(const QString &path);
+  QString cacheFilePath() const;
 
   QUrl url() const;
   void setUrl(const QUrl &url);
 
-  virtual void loadSubscription(const QStringList &disabledRules);
+  virtual void loadSubscription(const QSet<QString> &disabledRules);
   virtual void saveSubscription();
 
   const AdBlockRule* rule(int offset) const;
@@ -107,6 +109,8 @@ public:
   virtual bool removeRule(int offset);
   virtual const AdBlockRule* replaceRule(AdBlockRule* rule, int offset);
 
+  void releaseSupersededRules();
+
 public slots:
   void updateSubscription();
 
@@ -121,11 +125,27 @@ protected slots:
 protected:
   virtual bool saveDownloadedData(const QByteArray &data);
 
+  bool loadCache(const QSet<QString> &disabledRules);
+  void saveCache() const;
+
+  AdBlockRule* allocateRules(int count);
+  bool isBlockRule(const AdBlockRule* rule) const;
+
   FollowRedirectReply* m_reply;
 
   QVector<AdBlockRule*> m_rules;
 
 private:
+  struct RulesBlock {
+    RulesBlock() : rules(0), count(0) {}
+
+    AdBlockRule* rules;
+    int count;
+  };
+
+  RulesBlock m_rulesBlock;
+  QVector<RulesBlock> m_supersededBlocks;
+
   QString m_title;
   QString m_filePath;
 
@@ -141,7 +161,7 @@ public:
 
   void retranslateStrings();
 
-  void loadSubscription(const QStringList &disabledRules);
+  void loadSubscription(const QSet<QString> &disabledRules);
   void saveSubscription();
 
   bool canEditRules() const;
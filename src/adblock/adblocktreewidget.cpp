@@ -64,10 +64,10 @@ AdBlockSubscription* AdBlockTreeWidget::subscription() const
   return m_subscription;
 }
 
-void AdBlockTreeWidget::showRule(const AdBlockRule* rule)
+void AdBlockTreeWidget::showRule(const QString &filter)
 {
-  if (!m_topItem && rule) {
-    m_ruleToBeSelected = rule->filter();
+  if (!m_topItem && !filter.isEmpty()) {
+    m_ruleToBeSelected = filter;
   }
   else if (!m_ruleToBeSelected.isEmpty()) {
     QList<QTreeWidgetItem*> items = findItems(m_ruleToBeSelected, Qt::MatchRecursive);
@@ -284,7 +284,7 @@ void AdBlockTreeWidget::refresh()
     ++index;
   }
 
-  showRule(0);
+  showRule(QString());
   m_itemChangingBlock = false;
 }
 
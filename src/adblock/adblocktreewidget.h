@@ -48,7 +48,7 @@ public:
 
   AdBlockSubscription* subscription() const;
 
-  void showRule(const AdBlockRule* rule);
+  void showRule(const QString &filter);
   void refresh();
 
 public slots:
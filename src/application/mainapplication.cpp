@@ -39,6 +39,7 @@ MainApplication::MainApplication(int &argc, char **argv)
   , networkManager_(0)
   , cookieJar_(0)
   , diskCache_(0)
+  , updateFeeds_(0)
   , downloadManager_(0)
   , analytics_(0)
 {
@@ -461,7 +462,7 @@ void MainApplication::setDiskCache()
   bool useDiskCache = settings.value("useDiskCache", true).toBool();
   if (useDiskCache) {
     if (!diskCache_) {
-      diskCache_ = new QNetworkDiskCache(this);
+      diskCache_ = new NetworkDiskCache(this);
     }
 
     QString diskCacheDirPath = settings.value("dirDiskCache", cacheDefaultDir()).toString();
@@ -475,13 +476,22 @@ void MainApplication::setDiskCache()
     }
 
     diskCache_->setCacheDirectory(diskCacheDirPath);
+    // Former total size is shared between caches as before
     int maxDiskCache = settings.value("maxDiskCache", 50).toInt();
-    diskCache_->setMaximumCacheSize(maxDiskCache*1024*1024);
+    int maxDiskCachePages = settings.value("maxDiskCachePages", maxDiskCache*3/10).toInt();
+    int maxDiskCacheImages = settings.value("maxDiskCacheImages", maxDiskCache*5/10).toInt();
+    int maxDiskCacheMedia = settings.value("maxDiskCacheMedia", maxDiskCache*2/10).toInt();
+    diskCache_->setMaximumCacheSize(NetworkDiskCache::CachePages, maxDiskCachePages*1024*1024);
+    diskCache_->setMaximumCacheSize(NetworkDiskCache::CacheImages, maxDiskCacheImages*1024*1024);
+    diskCache_->setMaximumCacheSize(NetworkDiskCache::CacheMedia, maxDiskCacheMedia*1024*1024);
+    diskCache_->setOfflineFirst(settings.value("offlineFirstCache", false).toBool());
 
     networkManager()->setCache(diskCache_);
   } else {
     if (diskCache_) {
-      diskCache_->setMaximumCacheSize(0);
+      for (int i = 0; i < NetworkDiskCache::CacheTypeCount; ++i)
+        diskCache_->setMaximumCacheSize(NetworkDiskCache::CacheType(i), 0);
+      diskCache_->setOfflineFirst(false);
       diskCache_->clear();
     }
   }
@@ -527,6 +537,13 @@ void MainApplication::runUserFilter(int feedId, int filterId)
   emit signalRunUserFilter(feedId, filterId);
 }
 
+/** @brief Compile user filters again before next feed is parsed
+ *----------------------------------------------------------------------------*/
+void MainApplication::reloadUserFilters()
+{
+  emit signalReloadUserFilters();
+}
+
 void MainApplication::sqlQueryExec(const QString &query)
 {
   emit signalSqlQueryExec(query);
@@ -26,12 +26,12 @@
 #include <QtGui>
 #endif
 #include <qtsingleapplication.h>
-#include <QNetworkDiskCache>
 #include <QLocale>
 #include <QLibraryInfo>
 #include <QNetworkProxy>
 
 #include "cookiejar.h"
+#include "networkdiskcache.h"
 #include "downloadmanager.h"
 #include "mainwindow.h"
 #include "ganalytics.h"
@@ -74,8 +74,10 @@ public:
   NetworkManager *networkManager();
   CookieJar *cookieJar();
   void setDiskCache();
+  NetworkDiskCache *diskCache() const { return diskCache_; }
   UpdateFeeds *updateFeeds();
   void runUserFilter(int feedId, int filterId);
+  void reloadUserFilters();
   DownloadManager *downloadManager();
 
   void c2fLoadSettings();
@@ -103,6 +105,7 @@ public slots:
 
 signals:
   void signalRunUserFilter(int feedId, int filterId);
+  void signalReloadUserFilters();
   void signalSqlQueryExec(const QString &query);
 
 private slots:
@@ -139,7 +142,7 @@ private:
   MainWindow *mainWindow_;
   NetworkManager *networkManager_;
   CookieJar *cookieJar_;
-  QNetworkDiskCache *diskCache_;
+  NetworkDiskCache *diskCache_;
   UpdateFeeds *updateFeeds_;
   DownloadManager *downloadManager_;
   QWidget *closingWidget_;
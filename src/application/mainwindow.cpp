@@ -2960,49 +2960,18 @@ void MainWindow::recountCategoryCounts()
 
 /** @brief Process recalculating categories counters
  *----------------------------------------------------------------------------*/
-void MainWindow::slotRecountCategoryCounts(QList<int> deletedList, QList<int> starredList,
-                                           QList<int> readList, QStringList labelList)
-{
-  int allStarredCount = 0;
-  int unreadStarredCount = 0;
-  int deletedCount = 0;
-  QMap<int,int> allCountList;
-  QMap<int,int> unreadCountList;
+void MainWindow::slotRecountCategoryCounts(CategoryCountStruct counts)
+{
+  int allStarredCount = counts.allStarredCount;
+  int unreadStarredCount = counts.unreadStarredCount;
+  int deletedCount = counts.deletedCount;
+  const QMap<int,int> &allCountList = counts.allLabelCount;
+  const QMap<int,int> &unreadCountList = counts.unreadLabelCount;
   int allLabelCount = 0;
   int unreadLabelCount = 0;
   QFont font;
 
   QTreeWidgetItem *labelTreeItem = categoriesTree_->topLevelItem(CategoriesTreeWidget::LabelsItem);
-  for (int i = 0; i < labelTreeItem->childCount(); i++) {
-    int id = labelTreeItem->child(i)->text(2).toInt();
-    allCountList.insert(id, 0);
-    unreadCountList.insert(id, 0);
-  }
-
-  for (int i = 0; i < deletedList.count(); ++i) {
-    if (deletedList.at(i) == 0) {
-      if (starredList.at(i) == 1) {
-        allStarredCount++;
-        if (readList.at(i) == 0)
-          unreadStarredCount++;
-      }
-      QString idString = labelList.at(i);
-      if (!idString.isEmpty() && idString != ",") {
-        QStringList idList = idString.split(",", QString::SkipEmptyParts);
-        foreach (QString idStr, idList) {
-          int id = idStr.toInt();
-          if (allCountList.contains(id)) {
-            allCountList[id]++;
-            if (readList.at(i) == 0)
-              unreadCountList[id]++;
-          }
-        }
-      }
-    } else if (deletedList.at(i) == 1) {
-      deletedCount++;
-    }
-  }
-
   for (int i = 0; i < labelTreeItem->childCount(); i++) {
     int id = labelTreeItem->child(i)->text(2).toInt();
     QString countStr;
@@ -3378,6 +3347,14 @@ void MainWindow::showOptionDlg(int index)
   optionsDialog_->timeoutRequest_->setValue(timeoutRequest);
   optionsDialog_->numberRequests_->setValue(numberRequests);
   optionsDialog_->numberRepeats_->setValue(numberRepeats);
+  optionsDialog_->streamParsing_->setChecked(
+        settings.value("Settings/streamParsing", false).toBool());
+  optionsDialog_->websubEnable_->setChecked(
+        settings.value("Settings/websubEnable", false).toBool());
+  optionsDialog_->websubCallbackUrl_->setText(
+        settings.value("Settings/websubCallbackUrl").toString());
+  optionsDialog_->websubPort_->setValue(
+        settings.value("Settings/websubPort", 8090).toInt());
 
   optionsDialog_->embeddedBrowserOn_->setChecked(externalBrowserOn_ <= 0);
   optionsDialog_->externalBrowserOn_->setChecked(externalBrowserOn_ >= 1);
@@ -3405,7 +3382,29 @@ void MainWindow::showOptionDlg(int index)
   if (diskCacheDir.isEmpty()) diskCacheDir = mainApp->cacheDefaultDir();
   optionsDialog_->dirDiskCacheEdit_->setText(diskCacheDir);
   int maxDiskCache = settings.value("maxDiskCache", 50).toInt();
-  optionsDialog_->maxDiskCache_->setValue(maxDiskCache);
+  optionsDialog_->maxDiskCachePages_->setValue(
+        settings.value("maxDiskCachePages", maxDiskCache*3/10).toInt());
+  optionsDialog_->maxDiskCacheImages_->setValue(
+        settings.value("maxDiskCacheImages", maxDiskCache*5/10).toInt());
+  optionsDialog_->maxDiskCacheMedia_->setValue(
+        settings.value("maxDiskCacheMedia", maxDiskCache*2/10).toInt());
+  optionsDialog_->offlineFirstCache_->setChecked(
+        settings.value("offlineFirstCache", false).toBool());
+  NetworkDiskCache *diskCache = mainApp->diskCache();
+  if (diskCache) {
+    int requestsCount = diskCache->hitCount() + diskCache->storeCount();
+    int hitRatio = requestsCount ? (diskCache->hitCount() * 100 / requestsCount) : 0;
+    optionsDialog_->diskCacheStats_->setText(
+          tr("Cache size: %1 MB, hits: %2%, saved in this session: %3 MB").
+          arg(diskCache->cacheSize() / (1024*1024)).arg(hitRatio).
+          arg(diskCache->bytesSaved() / (1024*1024)));
+  }
+  optionsDialog_->prefetchImagesMaxSize_->setValue(
+        settings.value("prefetchImagesMaxSize", 100).toInt());
+  optionsDialog_->downloadSegments_->setValue(
+        settings.value("downloadSegments", 1).toInt());
+  optionsDialog_->downloadSpeedLimit_->setValue(
+        settings.value("downloadSpeedLimit", 0).toInt());
 
   settings.endGroup();
 
@@ -3692,6 +3691,11 @@ void MainWindow::showOptionDlg(int index)
   }
 
   if (optionsDialog_->idLabels_.count()) {
+    for (int i = 0; i < stackedWidget_->count(); i++) {
+      NewsTabWidget *widget = (NewsTabWidget*)stackedWidget_->widget(i);
+      widget->removeCachedLabels(optionsDialog_->idLabels_);
+    }
+
     QTreeWidgetItem *labelTreeItem = categoriesTree_->topLevelItem(CategoriesTreeWidget::LabelsItem);
     while (labelTreeItem->childCount()) {
       labelTreeItem->removeChild(labelTreeItem->child(0));
@@ -3798,6 +3802,10 @@ void MainWindow::showOptionDlg(int index)
   settings.setValue("Settings/timeoutRequest", timeoutRequest);
   settings.setValue("Settings/numberRequest", numberRequests);
   settings.setValue("Settings/numberRepeats", numberRepeats);
+  settings.setValue("Settings/streamParsing", optionsDialog_->streamParsing_->isChecked());
+  settings.setValue("Settings/websubEnable", optionsDialog_->websubEnable_->isChecked());
+  settings.setValue("Settings/websubCallbackUrl", optionsDialog_->websubCallbackUrl_->text().trimmed());
+  settings.setValue("Settings/websubPort", optionsDialog_->websubPort_->value());
 
   if (optionsDialog_->embeddedBrowserOn_->isChecked()) {
     if (optionsDialog_->defaultExternalBrowserOn_->isChecked())
@@ -3833,8 +3841,13 @@ void MainWindow::showOptionDlg(int index)
 
   useDiskCache = optionsDialog_->diskCacheOn_->isChecked();
   settings.setValue("useDiskCache", useDiskCache);
-  maxDiskCache = optionsDialog_->maxDiskCache_->value();
-  settings.setValue("maxDiskCache", maxDiskCache);
+  settings.setValue("maxDiskCachePages", optionsDialog_->maxDiskCachePages_->value());
+  settings.setValue("maxDiskCacheImages", optionsDialog_->maxDiskCacheImages_->value());
+  settings.setValue("maxDiskCacheMedia", optionsDialog_->maxDiskCacheMedia_->value());
+  settings.setValue("offlineFirstCache", optionsDialog_->offlineFirstCache_->isChecked());
+  settings.setValue("prefetchImagesMaxSize", optionsDialog_->prefetchImagesMaxSize_->value());
+  settings.setValue("downloadSegments", optionsDialog_->downloadSegments_->value());
+  settings.setValue("downloadSpeedLimit", optionsDialog_->downloadSpeedLimit_->value());
 
   if (diskCacheDir != optionsDialog_->dirDiskCacheEdit_->text()) {
     Common::removePath(diskCacheDir);
@@ -3846,6 +3859,7 @@ void MainWindow::showOptionDlg(int index)
   settings.endGroup();
 
   mainApp->setDiskCache();
+  mainApp->downloadManager()->loadSettings();
 
   useCookies = SaveCookies;
   if (optionsDialog_->deleteCookiesOnClose_->isChecked())
@@ -4260,6 +4274,14 @@ void MainWindow::slotUpdateStatus(int feedId, bool changed)
   emit signalUpdateStatus(feedId, changed);
 }
 
+/** @brief Recount and update status of several feeds changed at once
+ *---------------------------------------------------------------------------*/
+void MainWindow::slotUpdateStatus(const QList<int> &feedIds)
+{
+  if (feedIds.isEmpty()) return;
+  emit signalUpdateFeedsStatus(feedIds);
+}
+
 /** @brief Set filter for viewing feeds and categories
  * @param pAct Filter mode
  * @param clicked Flag to call function after user click or from programm code
@@ -4268,7 +4290,7 @@ void MainWindow::slotUpdateStatus(int feedId, bool changed)
  *----------------------------------------------------------------------------*/
 void MainWindow::setFeedsFilter(bool clicked)
 {
-  QList<int> idList;
+  QSet<int> idList;
   static bool setFilter = false;
 
   if (setFilter) return;
@@ -4294,38 +4316,22 @@ void MainWindow::setFeedsFilter(bool clicked)
         index = index.parent();
       }
     }
-  } else if (filterAct->objectName() == "filterFeedsStarred_") {
+  } else if ((filterAct->objectName() == "filterFeedsStarred_") ||
+             (filterAct->objectName() == "filterFeedsError_")) {
     QSqlQuery q;
-    q.exec(QString("SELECT id, parentId FROM feeds WHERE label LIKE '%starred%'"));
-    while (q.next()) {
-      idList.append(q.value(0).toInt());
-      int parentId = q.value(1).toInt();
-      if (!idList.contains(parentId)) {
-        while (parentId) {
-          if (!idList.contains(parentId))
-            idList.append(parentId);
-          else break;
-          QSqlQuery q1;
-          q1.exec(QString("SELECT parentId FROM feeds WHERE id==%1").arg(parentId));
-          if (q1.next()) parentId = q1.value(0).toInt();
-        }
-      }
-    }
-  } else if (filterAct->objectName() == "filterFeedsError_") {
-    QSqlQuery q;
-    q.exec(QString("SELECT id, parentId FROM feeds WHERE status!=0 AND status!=''"));
+    if (filterAct->objectName() == "filterFeedsStarred_")
+      q.exec("SELECT id FROM feeds WHERE label LIKE '%starred%'");
+    else
+      q.exec("SELECT id FROM feeds WHERE status!=0 AND status!=''");
     while (q.next()) {
-      idList.append(q.value(0).toInt());
-      int parentId = q.value(1).toInt();
-      if (!idList.contains(parentId)) {
-        while (parentId) {
-          if (!idList.contains(parentId))
-            idList.append(parentId);
-          else break;
-          QSqlQuery q1;
-          q1.exec(QString("SELECT parentId FROM feeds WHERE id==%1").arg(parentId));
-          if (q1.next()) parentId = q1.value(0).toInt();
-        }
+      // Parents are taken from feeds model instead of query per level
+      QModelIndex index = feedsModel_->indexById(q.value(0).toInt());
+      while (index.isValid()) {
+        int id = feedsModel_->idByIndex(index);
+        if (idList.contains(id))
+          break;
+        idList.insert(id);
+        index = index.parent();
       }
     }
   }
@@ -4336,12 +4342,13 @@ void MainWindow::setFeedsFilter(bool clicked)
       if ((i == 0) && clicked && (stackedWidget_->currentIndex() == 0)) continue;
       NewsTabWidget *widget = (NewsTabWidget*)stackedWidget_->widget(i);
       if (!idList.contains(widget->feedId_)) {
-        idList.append(widget->feedId_);
+        idList.insert(widget->feedId_);
         QModelIndex index = feedsModel_->indexById(widget->feedId_).parent();
         while (index.isValid()) {
           int id = feedsModel_->idByIndex(index);
-          if (!idList.contains(id))
-            idList.append(id);
+          if (idList.contains(id))
+            break;
+          idList.insert(id);
           index = index.parent();
         }
       }
@@ -5396,6 +5403,12 @@ void MainWindow::showFeedPropertiesDlg()
     properties.authentication.pass = QString::fromUtf8(QByteArray::fromBase64(q.value(1).toByteArray()));
   }
 
+  properties.display.prefetchImages = false;
+  q.exec(QString("SELECT value FROM feeds_ex WHERE feedId='%1' AND name='prefetchImages'").
+         arg(feedId));
+  if (q.first())
+    properties.display.prefetchImages = q.value(0).toBool();
+
   properties.status.feedStatus = feedsModel_->dataField(index, "status").toString();
 
   QDateTime dtLocalTime = QDateTime::currentDateTime();
@@ -5481,6 +5494,15 @@ void MainWindow::showFeedPropertiesDlg()
   q.addBindValue(feedId);
   q.exec();
 
+  if (properties.display.prefetchImages != properties_tmp.display.prefetchImages) {
+    q.exec(QString("DELETE FROM feeds_ex WHERE feedId='%1' AND name='prefetchImages'").
+           arg(feedId));
+    if (properties.display.prefetchImages) {
+      q.exec(QString("INSERT INTO feeds_ex(feedId, name, value) VALUES ('%1', 'prefetchImages', '1')").
+             arg(feedId));
+    }
+  }
+
 
   indexColumnsStr = "";
   if ((properties.column.columns != properties.columnDefault.columns) ||
@@ -5851,33 +5873,6 @@ void MainWindow::slotRefreshInfoTray(int newCount, int unreadCount)
   }
 }
 
-/** @brief Prepare feed icon for storing in DB
- *---------------------------------------------------------------------------*/
-void MainWindow::slotIconFeedPreparing(QString feedUrl, QByteArray byteArray,
-                                       QString format)
-{
-  QPixmap icon;
-  if (icon.loadFromData(byteArray)) {
-    icon = icon.scaled(16, 16, Qt::IgnoreAspectRatio,
-                       Qt::SmoothTransformation);
-    QByteArray faviconData;
-    QBuffer    buffer(&faviconData);
-    buffer.open(QIODevice::WriteOnly);
-    if (icon.save(&buffer, "ICO")) {
-      emit signalIconFeedReady(feedUrl, faviconData);
-    }
-  } else if (icon.loadFromData(byteArray, format.toUtf8().data())) {
-    icon = icon.scaled(16, 16, Qt::IgnoreAspectRatio,
-                       Qt::SmoothTransformation);
-    QByteArray faviconData;
-    QBuffer    buffer(&faviconData);
-    buffer.open(QIODevice::WriteOnly);
-    if (icon.save(&buffer, "ICO")) {
-      emit signalIconFeedReady(feedUrl, faviconData);
-    }
-  }
-}
-
 /** @brief Update feed icon in model and view
  *---------------------------------------------------------------------------*/
 void MainWindow::slotIconFeedUpdate(int feedId, QByteArray faviconData)
@@ -6025,6 +6020,8 @@ void MainWindow::showNewsFiltersDlg(bool newFilter)
   newsFiltersDialog->exec();
 
   delete newsFiltersDialog;
+
+  mainApp->reloadUserFilters();
 }
 // ----------------------------------------------------------------------------
 void MainWindow::showFilterRulesDlg()
@@ -6856,7 +6853,7 @@ void MainWindow::showNotification(bool bShowRecentNews/*=false*/)
   }
 
   notificationWidget = new NotificationWidget(curNews.idFeedList_, curNews.cntNewsList_,
-                                              idColorList_, colorList_, this);
+                                              newsColors_, this);
 
   if (!bShowRecentNews)
   {
@@ -6898,17 +6895,15 @@ void MainWindow::clearNotification(bool bClearRecentNews/*=false*/)
     recentNews.idFeedList_.clear();
     recentNews.cntNewsList_.clear();
 
-    idColorList_.clear();
-    colorList_.clear();
+    newsColors_.clear();
   }
 }
 
-void MainWindow::slotAddColorList(int id, const QString &color)
+void MainWindow::slotAddColorList(const QList<int> &idList, const QString &color)
 {
-  if (idColorList_.indexOf(id) == -1)
-  {
-    idColorList_.append(id);
-    colorList_.append(color);
+  foreach (int id, idList) {
+    if (!newsColors_.contains(id))
+      newsColors_.insert(id, color);
   }
 }
 
@@ -295,7 +295,7 @@ public slots:
   void showMessageStatusBar(QString message, int timeout = 0);
   void slotCountsStatusBar(int unreadCount, int allCount);
   void slotPlaySound(const QString &path);
-  void slotAddColorList(int id, const QString &color);
+  void slotAddColorList(const QList<int> &idList, const QString &color);
   void showOptionDlg(int index = -1);
   void slotPlaceToTray();
   void slotActivationTray(QSystemTrayIcon::ActivationReason reason);
@@ -307,6 +307,7 @@ public slots:
   void slotFeedCountsUpdate(FeedCountStruct counts);
   void slotUpdateNews(int refresh);
   void slotUpdateStatus(int feedId, bool changed = true);
+  void slotUpdateStatus(const QList<int> &feedIds);
   void setNewsFilter(QAction*, bool clicked = true);
   void slotCloseTab(int index);
   QWebPage *createWebTab(QUrl url = QUrl());
@@ -338,6 +339,7 @@ signals:
   void signalSetFeedRead(int readType, int feedId, int idException, QList<int> idNewsList);
   void signalPlaySoundNewNews();
   void signalUpdateStatus(int feedId, bool changed);
+  void signalUpdateFeedsStatus(QList<int> feedIds);
   void signalMarkAllFeedsRead();
   void signalMarkFeedRead(int id, bool isFolder, bool openFeed);
   void signalRefreshNewsView(int nextUnread);
@@ -353,8 +355,7 @@ private slots:
   void setFeedRead(int type, int feedId, FeedReedType feedReadType,
                    NewsTabWidget *widgetTab = 0, int idException = -1);
   void markFeedRead();
-  void slotRecountCategoryCounts(QList<int> deletedList, QList<int> starredList,
-                                 QList<int> readList, QStringList labelList);
+  void slotRecountCategoryCounts(CategoryCountStruct counts);
   void slotFeedsViewportUpdate();
   void slotPlaySoundNewNews();
 
@@ -377,7 +378,6 @@ private slots:
   void showFeedPropertiesDlg();
   void slotFeedMenuShow();
   void slotRefreshNewsView(int nextUnread = -1);
-  void slotIconFeedPreparing(QString feedUrl, QByteArray byteArray, QString format);
   void slotIconFeedUpdate(int feedId, QByteArray faviconData);
   void showNewsFiltersDlg(bool newFilter = false);
   void showFilterRulesDlg();
@@ -746,8 +746,7 @@ private:
   NewNewsData newNews;
   NewNewsData recentNews;
 
-  QList<int> idColorList_;
-  QStringList colorList_;
+  QHash<int, QString> newsColors_;
 
   QTimer timerTrayOpenNotify;
 
@@ -61,7 +61,7 @@ bool Common::matchDomain(const QString &pattern, const QString &domain)
     return false;
   }
 
-  int index = domain.indexOf(pattern);
+  int index = domain.size() - pattern.size();
 
   return index > 0 && domain[index - 1] == QLatin1Char('.');
 }
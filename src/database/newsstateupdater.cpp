@@ -0,0 +1,357 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include "newsstateupdater.h"
+
+NewsStateUpdater::NewsStateUpdater(const QSqlDatabase &db)
+  : db_(db)
+  , idsLoaded_(false)
+{
+}
+
+NewsStateUpdater::~NewsStateUpdater()
+{
+  if (!newsIdTable_.isEmpty())
+    dropIdTable(db_, newsIdTable_);
+  if (!feedIdTable_.isEmpty())
+    dropIdTable(db_, feedIdTable_);
+}
+
+/** @brief Set read state, news stops to be new
+ *----------------------------------------------------------------------------*/
+bool NewsStateUpdater::setRead(const QList<int> &newsIds, int read,
+                               const QString &condition)
+{
+  return update(newsIds, QString("new=0, read=%1").arg(read), condition);
+}
+
+bool NewsStateUpdater::setNew(const QList<int> &newsIds, int newState,
+                              const QString &condition)
+{
+  return update(newsIds, QString("new=%1").arg(newState), condition);
+}
+
+bool NewsStateUpdater::setStarred(const QList<int> &newsIds, int starred)
+{
+  return update(newsIds, QString("starred=%1").arg(starred));
+}
+
+/** @brief Add or remove label \a labelId in ",1,3," label string
+ *----------------------------------------------------------------------------*/
+bool NewsStateUpdater::setLabel(const QList<int> &newsIds, int labelId, bool set)
+{
+  QString labelStr = QString(",%1,").arg(labelId);
+  if (set) {
+    return update(newsIds,
+                  QString("label=CASE WHEN label IS NULL OR label=='' THEN '%1' "
+                          "ELSE label || '%2,' END").arg(labelStr).arg(labelId),
+                  QString("label IS NULL OR label NOT LIKE '%%1%'").arg(labelStr));
+  } else {
+    return update(newsIds,
+                  QString("label=replace(label, '%1', ',')").arg(labelStr),
+                  QString("label LIKE '%%1%'").arg(labelStr));
+  }
+}
+
+/** @brief Move news to the recycle bin
+ *----------------------------------------------------------------------------*/
+bool NewsStateUpdater::setDeleted(const QList<int> &newsIds)
+{
+  return update(newsIds,
+                QString("new=0, read=2, deleted=1, deleteDate='%1'").
+                arg(QDateTime::currentDateTime().toString(Qt::ISODate)));
+}
+
+bool NewsStateUpdater::restore(const QList<int> &newsIds)
+{
+  return update(newsIds, "deleted=0, deleteDate=''");
+}
+
+/** @brief Remove news from the recycle bin keeping only its identity
+ *----------------------------------------------------------------------------*/
+bool NewsStateUpdater::purge(const QList<int> &newsIds)
+{
+  return update(newsIds,
+                "description='', content='', received='', "
+                "author_name='', author_uri='', author_email='', "
+                "category='', new='', read='', starred='', label='', "
+                "deleteDate='', feedParentId='', deleted=2");
+}
+
+/** @brief Apply \a assignments to all news of \a newsIds with one statement
+ * @param condition Additional filter of the news to change
+ *----------------------------------------------------------------------------*/
+bool NewsStateUpdater::update(const QList<int> &newsIds, const QString &assignments,
+                              const QString &condition)
+{
+  if (newsIds.isEmpty()) return true;
+
+  if (newsIdTable_.isEmpty())
+    newsIdTable_ = uniqueTableName("newsIdSet");
+
+  if (!idsLoaded_ || (loadedIds_ != newsIds)) {
+    fillIdTable(db_, newsIdTable_, newsIds);
+    loadedIds_ = newsIds;
+    idsLoaded_ = true;
+
+    QSqlQuery q(db_);
+    q.exec(QString("SELECT DISTINCT feedId FROM news "
+                   "WHERE id IN (SELECT id FROM temp.%1)").arg(newsIdTable_));
+    while (q.next()) {
+      feedIds_.insert(q.value(0).toInt());
+    }
+  }
+
+  QString qStr = QString("id IN (SELECT id FROM temp.%1)").arg(newsIdTable_);
+  if (!condition.isEmpty())
+    qStr.append(QString(" AND (%1)").arg(condition));
+  return exec(assignments, qStr);
+}
+
+/** @brief Apply \a assignments to all news of feeds \a feedIds
+ * @details Folders are not expanded, pass their feeds.
+ *----------------------------------------------------------------------------*/
+bool NewsStateUpdater::updateFeeds(const QList<int> &feedIds, const QString &assignments,
+                                   const QString &condition)
+{
+  if (feedIds.isEmpty()) return true;
+
+  if (feedIdTable_.isEmpty())
+    feedIdTable_ = uniqueTableName("feedIdSet");
+
+  fillIdTable(db_, feedIdTable_, feedIds);
+  foreach (int feedId, feedIds) {
+    feedIds_.insert(feedId);
+  }
+
+  QString qStr = QString("feedId IN (SELECT id FROM temp.%1)").arg(feedIdTable_);
+  if (!condition.isEmpty())
+    qStr.append(QString(" AND (%1)").arg(condition));
+  return exec(assignments, qStr);
+}
+
+/** @brief Apply \a assignments to all news matching \a condition
+ * @details Used for categories and all news, feeds of matching news are
+ *   collected before the change.
+ *----------------------------------------------------------------------------*/
+bool NewsStateUpdater::updateWhere(const QString &assignments, const QString &condition)
+{
+  QSqlQuery q(db_);
+  q.exec(QString("SELECT DISTINCT feedId FROM news WHERE %1").arg(condition));
+  while (q.next()) {
+    feedIds_.insert(q.value(0).toInt());
+  }
+
+  return exec(assignments, condition);
+}
+
+bool NewsStateUpdater::exec(const QString &assignments, const QString &condition)
+{
+  // Fails if the caller has already opened transaction
+  bool transaction = db_.transaction();
+
+  QSqlQuery q(db_);
+  bool ok = q.exec(QString("UPDATE news SET %1 WHERE %2").arg(assignments, condition));
+  if (!ok) {
+    qCritical() << __PRETTY_FUNCTION__ << __LINE__
+                << "q.lastError(): " << q.lastError().text();
+  }
+
+  if (transaction) db_.commit();
+  return ok;
+}
+
+/** @brief Name of temporary table not used by any other updater
+ *----------------------------------------------------------------------------*/
+QString NewsStateUpdater::uniqueTableName(const QString &name)
+{
+  static QAtomicInt counter;
+  return QString("%1_%2").arg(name).arg(counter.fetchAndAddOrdered(1));
+}
+
+void NewsStateUpdater::dropIdTable(QSqlDatabase &db, const QString &table)
+{
+  QSqlQuery q(db);
+  q.exec(QString("DROP TABLE IF EXISTS temp.%1").arg(table));
+}
+
+void NewsStateUpdater::fillIdTable(QSqlDatabase &db, const QString &table,
+                                   const QList<int> &ids)
+{
+  bool transaction = db.transaction();
+
+  QSqlQuery q(db);
+  q.exec(QString("CREATE TEMP TABLE IF NOT EXISTS %1(id integer primary key)").arg(table));
+  q.exec(QString("DELETE FROM temp.%1").arg(table));
+
+  QVariantList values;
+  foreach (int id, ids) {
+    values << id;
+  }
+  q.prepare(QString("INSERT OR IGNORE INTO temp.%1(id) VALUES (?)").arg(table));
+  q.addBindValue(values);
+  if (!q.execBatch()) {
+    qCritical() << __PRETTY_FUNCTION__ << __LINE__
+                << "q.lastError(): " << q.lastError().text();
+  }
+
+  if (transaction) db.commit();
+}
+
+/** @brief Recount counters of feeds \a feedIds and of all their parents
+ * @details Folders in \a feedIds are expanded to their feeds. News are counted
+ *   with one grouped query, parents are summed up from the feeds table loaded
+ *   in memory.
+ * @return Counters of feeds and folders that have changed
+ *----------------------------------------------------------------------------*/
+QList<FeedCountStruct> NewsStateUpdater::recountFeeds(QSqlDatabase &db,
+                                                      const QList<int> &feedIds)
+{
+  QList<FeedCountStruct> countsList;
+  if (feedIds.isEmpty()) return countsList;
+
+  bool transaction = db.transaction();
+  QSqlQuery q(db);
+
+  QHash<int, FeedCountStruct> counts;
+  QHash<int, int> parentIds;
+  QMultiHash<int, int> childIds;
+  QSet<int> folderIds;
+  q.exec("SELECT id, parentId, unread, newCount, undeleteCount, updated, xmlUrl FROM feeds");
+  while (q.next()) {
+    FeedCountStruct feedCounts;
+    feedCounts.feedId = q.value(0).toInt();
+    feedCounts.unreadCount = q.value(2).toInt();
+    feedCounts.newCount = q.value(3).toInt();
+    feedCounts.undeleteCount = q.value(4).toInt();
+    feedCounts.updated = q.value(5).toString();
+    counts.insert(feedCounts.feedId, feedCounts);
+
+    int parentId = q.value(1).toInt();
+    parentIds.insert(feedCounts.feedId, parentId);
+    childIds.insert(parentId, feedCounts.feedId);
+    if (q.value(6).toString().isEmpty())
+      folderIds.insert(feedCounts.feedId);
+  }
+
+  QSet<int> recountIds;
+  QList<int> queue = feedIds;
+  while (!queue.isEmpty()) {
+    int id = queue.takeFirst();
+    if (!counts.contains(id)) continue;
+    if (folderIds.contains(id))
+      queue.append(childIds.values(id));
+    else
+      recountIds.insert(id);
+  }
+
+  QHash<int, FeedCountStruct> recounted;
+  foreach (int id, recountIds) {
+    FeedCountStruct feedCounts = counts.value(id);
+    feedCounts.unreadCount = 0;
+    feedCounts.newCount = 0;
+    feedCounts.undeleteCount = 0;
+    recounted.insert(id, feedCounts);
+  }
+
+  QString feedIdTable = uniqueTableName("feedIdSet");
+  fillIdTable(db, feedIdTable, recountIds.values());
+  q.exec(QString("SELECT feedId, sum(deleted==0), sum(read==0 AND deleted==0), "
+                 "sum(new==1 AND deleted==0) FROM news "
+                 "WHERE feedId IN (SELECT id FROM temp.%1) GROUP BY feedId").
+         arg(feedIdTable));
+  while (q.next()) {
+    int id = q.value(0).toInt();
+    if (!recounted.contains(id)) continue;
+    recounted[id].undeleteCount = q.value(1).toInt();
+    recounted[id].unreadCount = q.value(2).toInt();
+    recounted[id].newCount = q.value(3).toInt();
+  }
+
+  // Save changed feeds, remember their parents
+  QMultiMap<int, int> parentsByDepth;
+  QSet<int> changedParentIds;
+  q.prepare("UPDATE feeds SET unread=?, newCount=?, undeleteCount=? WHERE id=?");
+  foreach (const FeedCountStruct &feedCounts, recounted) {
+    const FeedCountStruct &oldCounts = counts[feedCounts.feedId];
+    if ((feedCounts.unreadCount == oldCounts.unreadCount) &&
+        (feedCounts.newCount == oldCounts.newCount) &&
+        (feedCounts.undeleteCount == oldCounts.undeleteCount)) {
+      continue;
+    }
+
+    q.addBindValue(feedCounts.unreadCount);
+    q.addBindValue(feedCounts.newCount);
+    q.addBindValue(feedCounts.undeleteCount);
+    q.addBindValue(feedCounts.feedId);
+    q.exec();
+
+    counts.insert(feedCounts.feedId, feedCounts);
+    FeedCountStruct changedCounts = feedCounts;
+    changedCounts.updated.clear();
+    countsList.append(changedCounts);
+
+    int parentId = parentIds.value(feedCounts.feedId);
+    while (parentId && !changedParentIds.contains(parentId)) {
+      changedParentIds.insert(parentId);
+      int depth = 0;
+      int id = parentId;
+      while (id && (depth < 1000)) {
+        id = parentIds.value(id);
+        ++depth;
+      }
+      parentsByDepth.insert(depth, parentId);
+      parentId = parentIds.value(parentId);
+    }
+  }
+
+  // Sum up parents from the deepest level, so subfolders are ready first
+  q.prepare("UPDATE feeds SET unread=?, newCount=?, undeleteCount=?, updated=? WHERE id=?");
+  QMapIterator<int, int> iter(parentsByDepth);
+  iter.toBack();
+  while (iter.hasPrevious()) {
+    int parentId = iter.previous().value();
+
+    FeedCountStruct parentCounts = counts.value(parentId);
+    parentCounts.unreadCount = 0;
+    parentCounts.newCount = 0;
+    parentCounts.undeleteCount = 0;
+    parentCounts.updated.clear();
+    foreach (int id, childIds.values(parentId)) {
+      const FeedCountStruct &childCounts = counts[id];
+      parentCounts.unreadCount += childCounts.unreadCount;
+      parentCounts.newCount += childCounts.newCount;
+      parentCounts.undeleteCount += childCounts.undeleteCount;
+      if (childCounts.updated > parentCounts.updated)
+        parentCounts.updated = childCounts.updated;
+    }
+
+    q.addBindValue(parentCounts.unreadCount);
+    q.addBindValue(parentCounts.newCount);
+    q.addBindValue(parentCounts.undeleteCount);
+    q.addBindValue(parentCounts.updated);
+    q.addBindValue(parentId);
+    q.exec();
+
+    counts.insert(parentId, parentCounts);
+    countsList.append(parentCounts);
+  }
+
+  dropIdTable(db, feedIdTable);
+  if (transaction) db.commit();
+  return countsList;
+}
@@ -0,0 +1,74 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#ifndef NEWSSTATEUPDATER_H
+#define NEWSSTATEUPDATER_H
+
+#include <QtSql>
+
+#include "parseobject.h"
+
+/*! \brief Bulk changes of news state addressed by id sets.
+ *
+ * News ids are loaded into a temporary table of the connection, so every
+ * change is one "UPDATE ... WHERE id IN (SELECT id FROM temp.newsIdSet_N)"
+ * statement whatever the number of news. Whole feeds are addressed the same
+ * way by a table of feed ids, categories by a condition. Feeds owning the changed news are
+ * collected and can be recounted at once with recountFeeds().
+ *
+ * Each updater has its own tables, as the same connection may be used by
+ * GUI and update threads at once.
+ */
+class NewsStateUpdater
+{
+public:
+  explicit NewsStateUpdater(const QSqlDatabase &db);
+  ~NewsStateUpdater();
+
+  bool setRead(const QList<int> &newsIds, int read, const QString &condition = QString());
+  bool setNew(const QList<int> &newsIds, int newState, const QString &condition = QString());
+  bool setStarred(const QList<int> &newsIds, int starred);
+  bool setLabel(const QList<int> &newsIds, int labelId, bool set);
+  bool setDeleted(const QList<int> &newsIds);
+  bool restore(const QList<int> &newsIds);
+  bool purge(const QList<int> &newsIds);
+  bool update(const QList<int> &newsIds, const QString &assignments,
+              const QString &condition = QString());
+  bool updateFeeds(const QList<int> &feedIds, const QString &assignments,
+                   const QString &condition = QString());
+  bool updateWhere(const QString &assignments, const QString &condition);
+
+  QList<int> feedIds() const { return feedIds_.values(); }
+
+  static QList<FeedCountStruct> recountFeeds(QSqlDatabase &db, const QList<int> &feedIds);
+
+private:
+  static QString uniqueTableName(const QString &name);
+  static void fillIdTable(QSqlDatabase &db, const QString &table, const QList<int> &ids);
+  static void dropIdTable(QSqlDatabase &db, const QString &table);
+  bool exec(const QString &assignments, const QString &condition);
+
+  QSqlDatabase db_;
+  QString newsIdTable_;
+  QString feedIdTable_;
+  QList<int> loadedIds_;
+  bool idsLoaded_;
+  QSet<int> feedIds_;
+
+};
+
+#endif // NEWSSTATEUPDATER_H
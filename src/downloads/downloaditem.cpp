@@ -36,12 +36,20 @@
 
 #include "mainapplication.h"
 #include "networkmanager.h"
+#include "downloadmanager.h"
+#include "downloadrange.h"
 #include "webpage.h"
+#include "globals.h"
 
 #if defined(Q_OS_WIN)
 #include <qt_windows.h>
 #endif
 
+#define RETRY_MAX_COUNT 5
+#define RETRY_DELAY 5000
+#define SEGMENT_MIN_SIZE (4 * 1024 * 1024)
+#define READ_BUFFER_SIZE (256 * 1024)
+
 DownloadItem::DownloadItem(QListWidgetItem *item,
                            QNetworkReply *reply,
                            const QString &fileName,
@@ -52,6 +60,9 @@ DownloadItem::DownloadItem(QListWidgetItem *item,
   , ftpDownloader_(0)
   , fileName_(fileName)
   , downloadUrl_(reply->url())
+  , acceptRanges_(false)
+  , retryCount_(0)
+  , sessionStart_(0)
   , downloading_(false)
   , openAfterFinish_(openAfterDownload)
   , downloadStopped_(false)
@@ -63,16 +74,70 @@ DownloadItem::DownloadItem(QListWidgetItem *item,
   if (QFile::exists(fileName)) {
     QFile::remove(fileName);
   }
+  if (QFile::exists(fileName + ".part")) {
+    QFile::remove(fileName + ".part");
+  }
   qApp->processEvents();
 
-  outputFile_.setFileName(fileName);
+  outputFile_.setFileName(fileName + ".part");
 
   qint64 total = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
   if (total > 0) total_ = total;
 
+  createWidgets();
+}
+
+/** @brief Create stopped download restored after restart of application
+ *----------------------------------------------------------------------------*/
+DownloadItem::DownloadItem(QListWidgetItem *item, const DownloadResumeData &resumeData)
+  : QWidget()
+  , item_(item)
+  , reply_(0)
+  , ftpDownloader_(0)
+  , fileName_(resumeData.fileName)
+  , downloadUrl_(resumeData.url)
+  , etag_(resumeData.etag)
+  , lastModified_(resumeData.lastModified)
+  , acceptRanges_(true)
+  , retryCount_(0)
+  , sessionStart_(0)
+  , downloading_(false)
+  , openAfterFinish_(false)
+  , downloadStopped_(true)
+  , received_(0)
+  , total_(qMax(resumeData.total, qint64(0)))
+{
+  downloadTimer_.start();
+
+  outputFile_.setFileName(fileName_ + ".part");
+
+  foreach (const DownloadRange::Range &range, resumeData.segments) {
+    Segment segment;
+    segment.reply = 0;
+    segment.pos = range.first;
+    segment.end = range.second;
+    segments_.append(segment);
+  }
+  qint64 remaining = DownloadRange::remaining(resumeData.segments, total_);
+  received_ = (total_ > 0) ? (total_ - remaining) : segments_.value(0).pos;
+  sessionStart_ = received_;
+
+  createWidgets();
+
+  downloadProgress(received_, total_);
+  downloadInfo_->setText(tr("Cancelled - %1").arg(downloadUrl_.host()));
+}
+
+DownloadItem::~DownloadItem()
+{
+  delete item_;
+}
+
+void DownloadItem::createWidgets()
+{
   fileNameLabel_ = new QLabel();
   fileNameLabel_->setStyleSheet("background: none;");
-  QFileInfo info(fileName);
+  QFileInfo info(fileName_);
   fileNameLabel_->setText(info.fileName());
   QFont font = fileNameLabel_->font();
   font.setBold(true);
@@ -113,11 +178,6 @@ DownloadItem::DownloadItem(QListWidgetItem *item,
   connect(&updateInfoTimer_, SIGNAL(timeout()), this, SLOT(updateInfo()));
 }
 
-DownloadItem::~DownloadItem()
-{
-  delete item_;
-}
-
 void DownloadItem::startDownloading()
 {
   QUrl locationHeader = reply_->header(QNetworkRequest::LocationHeader).toUrl();
@@ -135,32 +195,40 @@ void DownloadItem::startDownloading()
     reply_->abort();
     reply_->deleteLater();
 
-    reply_ = mainApp->networkManager()->get(QNetworkRequest(locationHeader));
+    downloadUrl_ = reply_->url().resolved(locationHeader);
+    reply_ = mainApp->networkManager()->get(QNetworkRequest(downloadUrl_));
   }
 
-  reply_->setParent(this);
-  connect(reply_, SIGNAL(readyRead()), this, SLOT(readyRead()));
-  connect(reply_, SIGNAL(downloadProgress(qint64,qint64)), this, SLOT(downloadProgress(qint64,qint64)));
-  connect(reply_, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(error()));
-  connect(reply_, SIGNAL(metaDataChanged()), this, SLOT(metaDataChanged()));
-  connect(reply_, SIGNAL(finished()), this, SLOT(finished()));
+  QNetworkReply *reply = reply_;
+  reply_ = 0;
+  reply->setParent(this);
+
+  // Initial reply downloads the whole file until its size is known
+  Segment segment;
+  segment.reply = reply;
+  segment.pos = 0;
+  segment.end = -1;
+  segments_.append(segment);
+  connectReply(reply);
 
   downloading_ = true;
   updateInfoTimer_.start(1000);
-  readyRead();
-  QTimer::singleShot(200, this, SLOT(updateDownload()));
 
-  if (reply_->error() != QNetworkReply::NoError) {
+  if (reply->error() != QNetworkReply::NoError) {
+    QString errorString = reply->errorString();
     stop(false);
-    error();
+    downloadInfo_->setText(tr("Error: ") + errorString);
+    return;
   }
+
+  processMetaData(reply);
+  readSegments();
+  QTimer::singleShot(200, this, SLOT(updateDownload()));
 }
 
 void DownloadItem::startDownloadingFromFtp(const QUrl &url)
 {
-  if (!outputFile_.isOpen() && !outputFile_.open(QIODevice::WriteOnly)) {
-    stop(false);
-    downloadInfo_->setText(tr("Error: Cannot write to file!"));
+  if (!openOutputFile()) {
     return;
   }
 
@@ -183,14 +251,341 @@ void DownloadItem::startDownloadingFromFtp(const QUrl &url)
   }
 }
 
-void DownloadItem::readyRead()
+/** @brief Open partial file without truncating it
+ *----------------------------------------------------------------------------*/
+bool DownloadItem::openOutputFile()
+{
+  if (outputFile_.isOpen() || outputFile_.open(QIODevice::ReadWrite)) {
+    return true;
+  }
+
+  stop(false);
+  downloadInfo_->setText(tr("Error: Cannot write to file!"));
+  return false;
+}
+
+void DownloadItem::connectReply(QNetworkReply *reply)
+{
+  // Small buffer lets TCP slow down server when download speed is limited
+  if (mainApp->downloadManager()->bandwidthLimit() > 0) {
+    reply->setReadBufferSize(READ_BUFFER_SIZE);
+  }
+
+  connect(reply, SIGNAL(readyRead()), this, SLOT(readSegments()));
+  connect(reply, SIGNAL(metaDataChanged()), this, SLOT(metaDataChanged()));
+  connect(reply, SIGNAL(finished()), this, SLOT(readSegments()));
+}
+
+/** @brief Request rest of segment \a index
+ * @details If-Range makes server send whole file if it has changed.
+ *----------------------------------------------------------------------------*/
+void DownloadItem::startSegment(int index)
+{
+  QNetworkRequest request(downloadUrl_);
+  request.setRawHeader("User-Agent", globals.userAgent().toUtf8());
+  request.setRawHeader("Range", DownloadRange::rangeHeader(segments_.at(index).pos,
+                                                           segments_.at(index).end));
+  QByteArray ifRange = DownloadRange::ifRangeHeader(etag_, lastModified_);
+  if (!ifRange.isEmpty()) {
+    request.setRawHeader("If-Range", ifRange);
+  }
+
+  QNetworkReply *reply = mainApp->networkManager()->get(request);
+  reply->setParent(this);
+  reply->setProperty("downloadReply", QVariant(true));
+  segments_[index].reply = reply;
+  connectReply(reply);
+}
+
+/** @brief Download rest of large file by several requests
+ *----------------------------------------------------------------------------*/
+void DownloadItem::splitSegments()
+{
+  int count = mainApp->downloadManager()->segmentsCount();
+  if ((count < 2) || !acceptRanges_ || (total_ < 2 * SEGMENT_MIN_SIZE) ||
+      (segments_.count() != 1) || (segments_.first().end != -1)) {
+    return;
+  }
+
+  QList<DownloadRange::Range> ranges = DownloadRange::split(total_, count, SEGMENT_MIN_SIZE);
+  segments_[0].end = ranges.first().second;
+  for (int i = 1; i < ranges.count(); ++i) {
+    Segment segment;
+    segment.reply = 0;
+    segment.pos = ranges.at(i).first;
+    segment.end = ranges.at(i).second;
+    segments_.append(segment);
+    startSegment(segments_.count() - 1);
+  }
+}
+
+/** @brief Server sent whole file instead of range, download it again
+ *----------------------------------------------------------------------------*/
+void DownloadItem::restartFromBeginning(QNetworkReply *reply)
+{
+  foreach (const Segment &segment, segments_) {
+    if (segment.reply && (segment.reply != reply)) {
+      segment.reply->disconnect(this);
+      segment.reply->abort();
+      segment.reply->deleteLater();
+    }
+  }
+
+  segments_.clear();
+  Segment segment;
+  segment.reply = reply;
+  segment.pos = 0;
+  segment.end = -1;
+  segments_.append(segment);
+
+  if (outputFile_.isOpen()) {
+    outputFile_.resize(0);
+  }
+  received_ = 0;
+  sessionStart_ = 0;
+}
+
+int DownloadItem::segmentIndex(QNetworkReply *reply) const
+{
+  for (int i = 0; i < segments_.count(); ++i) {
+    if (segments_.at(i).reply == reply) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void DownloadItem::metaDataChanged()
+{
+  processMetaData(qobject_cast<QNetworkReply*>(sender()));
+}
+
+/** @brief Follow redirect, learn size and range support of file
+ *----------------------------------------------------------------------------*/
+void DownloadItem::processMetaData(QNetworkReply *reply)
+{
+  int index = segmentIndex(reply);
+  if ((index < 0) || reply->property("metaDataProcessed").toBool()) {
+    return;
+  }
+
+  QUrl locationHeader = reply->header(QNetworkRequest::LocationHeader).toUrl();
+  if (locationHeader.isValid()) {
+    reply->disconnect(this);
+    reply->abort();
+    reply->deleteLater();
+
+    downloadUrl_ = reply->url().resolved(locationHeader);
+    startSegment(index);
+    return;
+  }
+
+  int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  if ((statusCode != 200) && (statusCode != 206)) {
+    return;
+  }
+  reply->setProperty("metaDataProcessed", QVariant(true));
+
+  if (statusCode == 206) {
+    qint64 first = -1;
+    qint64 last = -1;
+    qint64 total = -1;
+    if (!DownloadRange::parseContentRange(reply->rawHeader("Content-Range"),
+                                          &first, &last, &total) ||
+        (first != segments_.at(index).pos)) {
+      // Data of other range can't be written at position of segment
+      segments_[index].reply = 0;
+      reply->disconnect(this);
+      reply->abort();
+      reply->deleteLater();
+      segmentFailed(reply);
+      return;
+    }
+    acceptRanges_ = true;
+    if (total > 0) total_ = total;
+    if (etag_.isEmpty() && lastModified_.isEmpty()) {
+      etag_ = reply->rawHeader("ETag");
+      lastModified_ = reply->rawHeader("Last-Modified");
+    }
+    splitSegments();
+    emit resumeDataChanged();
+    return;
+  }
+
+  if ((segments_.count() > 1) || (segments_.at(index).pos > 0)) {
+    restartFromBeginning(reply);
+  }
+
+  acceptRanges_ = (reply->rawHeader("Accept-Ranges").toLower() == "bytes");
+  etag_ = reply->rawHeader("ETag");
+  lastModified_ = reply->rawHeader("Last-Modified");
+  qint64 total = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+  if (total > 0) total_ = total;
+
+  splitSegments();
+  emit resumeDataChanged();
+}
+
+/** @brief Write received data of segments into file at their positions
+ * @details Speed limit of DownloadManager can leave data in replies, they are
+ *   read again when it allows.
+ *----------------------------------------------------------------------------*/
+void DownloadItem::readSegments()
 {
-  if (!outputFile_.isOpen() && !outputFile_.open(QIODevice::WriteOnly)) {
+  if (!downloading_ || segments_.isEmpty()) {
+    return;
+  }
+  if (!openOutputFile()) {
+    return;
+  }
+
+  bool done = true;
+  for (int i = 0; i < segments_.count(); ++i) {
+    QNetworkReply *reply = segments_.at(i).reply;
+    if (reply) {
+      int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+      qint64 size = reply->bytesAvailable();
+      if ((statusCode != 200) && (statusCode != 206)) {
+        size = 0;
+      }
+      if (segments_.at(i).end >= 0) {
+        size = qMin(size, segments_.at(i).end - segments_.at(i).pos + 1);
+      }
+      size = mainApp->downloadManager()->takeBandwidth(this, size);
+
+      if (size > 0) {
+        QByteArray data = reply->read(size);
+        if (!outputFile_.seek(segments_.at(i).pos) ||
+            (outputFile_.write(data) != data.size())) {
+          stop(false);
+          downloadInfo_->setText(tr("Error: Cannot write to file!"));
+          return;
+        }
+        segments_[i].pos += data.size();
+        received_ += data.size();
+        retryCount_ = 0;
+      }
+
+      bool complete = (segments_.at(i).end >= 0) && (segments_.at(i).pos > segments_.at(i).end);
+      if (complete || (reply->isFinished() && !reply->bytesAvailable()) ||
+          (reply->isFinished() && !size && (statusCode != 200) && (statusCode != 206))) {
+        segments_[i].reply = 0;
+        reply->disconnect(this);
+        reply->deleteLater();
+
+        if (!complete) {
+          if ((reply->error() == QNetworkReply::NoError) && (segments_.at(i).end < 0)) {
+            // Size of file was unknown, it ends here
+            segments_[i].end = segments_.at(i).pos - 1;
+            if (total_ <= 0) total_ = segments_.at(i).pos;
+          } else {
+            segmentFailed(reply);
+            if (!downloading_) {
+              return;
+            }
+          }
+        } else if (!reply->isFinished()) {
+          reply->abort();
+        }
+      }
+    }
+
+    if ((segments_.at(i).end < 0) || (segments_.at(i).pos <= segments_.at(i).end)) {
+      done = false;
+    }
+  }
+
+  downloadProgress(received_, total_);
+
+  if (done) {
+    finished();
+  }
+}
+
+/** @brief Retry failed segment later or stop download on fatal error
+ *----------------------------------------------------------------------------*/
+void DownloadItem::segmentFailed(QNetworkReply *reply)
+{
+  int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  bool temporary = (statusCode < 400) || (statusCode == 408) ||
+      (statusCode == 429) || (statusCode >= 500);
+  if (!temporary || (retryCount_ >= RETRY_MAX_COUNT)) {
+    QString errorString = reply->errorString();
     stop(false);
+    downloadInfo_->setText(tr("Error: ") + errorString);
+    return;
+  }
+
+  retryCount_++;
+  qDebug() << "Download interrupted:" << downloadUrl_.toString() << reply->errorString()
+           << "retry" << retryCount_;
+  QTimer::singleShot(RETRY_DELAY * retryCount_, this, SLOT(retrySegments()));
+}
+
+void DownloadItem::retrySegments()
+{
+  if (!downloading_) {
+    return;
+  }
+
+  for (int i = 0; i < segments_.count(); ++i) {
+    if (!segments_.at(i).reply &&
+        ((segments_.at(i).end < 0) || (segments_.at(i).pos <= segments_.at(i).end))) {
+      startSegment(i);
+    }
+  }
+}
+
+/** @brief Continue stopped download from received data
+ *----------------------------------------------------------------------------*/
+void DownloadItem::resume()
+{
+  if (downloading_ || segments_.isEmpty()) {
+    return;
+  }
+
+  if (!QFile::exists(outputFile_.fileName())) {
+    restartFromBeginning(0);
+  }
+  if (!outputFile_.isOpen() && !outputFile_.open(QIODevice::ReadWrite)) {
     downloadInfo_->setText(tr("Error: Cannot write to file!"));
     return;
   }
-  outputFile_.write(reply_->readAll());
+
+  downloadStopped_ = false;
+  downloading_ = true;
+  retryCount_ = 0;
+  sessionStart_ = received_;
+  downloadTimer_.restart();
+
+  downloadInfo_->setText(tr("Remaining time unavailable"));
+  progressFrame_->show();
+  item_->setSizeHint(sizeHint());
+  updateInfoTimer_.start(1000);
+
+  retrySegments();
+  emit resumeDataChanged();
+}
+
+bool DownloadItem::canResume() const
+{
+  return acceptRanges_ && !segments_.isEmpty() && QFile::exists(outputFile_.fileName());
+}
+
+DownloadResumeData DownloadItem::resumeData() const
+{
+  DownloadResumeData resumeData;
+  resumeData.url = downloadUrl_;
+  resumeData.fileName = fileName_;
+  resumeData.etag = etag_;
+  resumeData.lastModified = lastModified_;
+  resumeData.total = (total_ > 0) ? total_ : -1;
+  foreach (const Segment &segment, segments_) {
+    if ((segment.end < 0) || (segment.pos <= segment.end)) {
+      resumeData.segments.append(qMakePair(segment.pos, segment.end));
+    }
+  }
+  return resumeData;
 }
 
 void DownloadItem::downloadProgress(qint64 received, qint64 total)
@@ -204,30 +599,16 @@ void DownloadItem::downloadProgress(qint64 received, qint64 total)
   }
   progressBar_->setValue(currentValue);
   progressBar_->setMaximum(totalValue);
-  curSpeed_ = received * 1000.0 / downloadTimer_.elapsed();
+  curSpeed_ = (received - sessionStart_) * 1000.0 / qMax(qint64(1), downloadTimer_.elapsed());
   received_ = received;
-
-  if (reply_->isFinished())
-    finished();
-}
-
-void DownloadItem::metaDataChanged()
-{
-  QUrl locationHeader = reply_->header(QNetworkRequest::LocationHeader).toUrl();
-  if (locationHeader.isValid()) {
-    reply_->close();
-    reply_->deleteLater();
-
-    reply_ = mainApp->networkManager()->get(QNetworkRequest(locationHeader));
-    startDownloading();
-  }
 }
 
 void DownloadItem::error()
 {
-  if (reply_ && reply_->error() != QNetworkReply::NoError) {
+  if (ftpDownloader_ && ftpDownloader_->error() != QFtp::NoError) {
+    QString errorString = ftpDownloader_->errorString();
     stop(false);
-    downloadInfo_->setText(tr("Error: ") + reply_->errorString());
+    downloadInfo_->setText(tr("Error: ") + errorString);
   }
 }
 
@@ -247,7 +628,9 @@ void DownloadItem::finished()
   item_->setSizeHint(sizeHint());
   outputFile_.close();
 
-  reply_->deleteLater();
+  QFile::remove(fileName_);
+  QFile::rename(outputFile_.fileName(), fileName_);
+  segments_.clear();
 
   downloading_ = false;
 
@@ -335,8 +718,19 @@ void DownloadItem::stop(bool askForDeleteFile)
 
   openAfterFinish_ = false;
   updateInfoTimer_.stop();
-  reply_->abort();
-  reply_->deleteLater();
+  if (reply_) {
+    reply_->abort();
+    reply_->deleteLater();
+    reply_ = 0;
+  }
+  for (int i = 0; i < segments_.count(); ++i) {
+    if (segments_.at(i).reply) {
+      segments_.at(i).reply->disconnect(this);
+      segments_.at(i).reply->abort();
+      segments_.at(i).reply->deleteLater();
+      segments_[i].reply = 0;
+    }
+  }
 
   outputFile_.close();
   QString outputfile = QFileInfo(outputFile_).absoluteFilePath();
@@ -356,6 +750,7 @@ void DownloadItem::stop(bool askForDeleteFile)
                               QMessageBox::Yes | QMessageBox::No);
     if (button == QMessageBox::Yes) {
       QFile::remove(outputfile);
+      segments_.clear();
     }
   }
 }
@@ -376,6 +771,7 @@ void DownloadItem::customContextMenuRequested(const QPoint &pos)
   menu.addAction(tr("Copy Download Link"), this, SLOT(copyDownloadLink()));
   menu.addSeparator();
   menu.addAction(tr("Cancel Downloading"), this, SLOT(stop()))->setEnabled(downloading_);
+  menu.addAction(tr("Resume Downloading"), this, SLOT(resume()))->setEnabled(!downloading_ && !segments_.isEmpty());
   menu.addAction(tr("Remove"), this, SLOT(clear()))->setEnabled(!downloading_);
 
   if (downloading_ || downloadInfo_->text().startsWith(tr("Cancelled")) || downloadInfo_->text().startsWith(tr("Error"))) {
@@ -424,11 +820,8 @@ void DownloadItem::openFolder()
 
 void DownloadItem::updateDownload()
 {
-  if ((progressBar_->maximum() == 0) && outputFile_.isOpen() &&
-      (reply_ && reply_->isFinished())) {
-    downloadProgress(0, 0);
-    finished();
-  }
+  // Reply could finish before it was connected
+  readSegments();
 }
 
 QHash<QString, QAuthenticator*> FtpDownloader::ftpAuthenticatorsCache_ = QHash<QString, QAuthenticator*>();
@@ -49,17 +49,36 @@
 class QListWidgetItem;
 class FtpDownloader;
 
+/*! \brief State of partially downloaded file to resume its download.
+ *
+ * Data is written into "<file name>.part". Every segment is a byte range of
+ * file downloaded by own request, end -1 means up to the end of file.
+ */
+struct DownloadResumeData {
+  DownloadResumeData() : total(-1) {}
+
+  QUrl url;
+  QString fileName;
+  QByteArray etag;
+  QByteArray lastModified;
+  qint64 total;
+  QList<QPair<qint64, qint64> > segments;  // position of next byte -> end
+};
+
 class DownloadItem : public QWidget
 {
   Q_OBJECT
 public:
   explicit DownloadItem(QListWidgetItem *item, QNetworkReply *reply,
                         const QString &fileName, bool openAfterDownload);
+  explicit DownloadItem(QListWidgetItem *item, const DownloadResumeData &resumeData);
   ~DownloadItem();
 
   void startDownloading();
   void startDownloadingFromFtp(const QUrl &url);
   bool isDownloading() { return downloading_; }
+  bool canResume() const;
+  DownloadResumeData resumeData() const;
   QTime remainingTime() { return remTime_; }
   static QString remaingTimeToString(QTime time);
   static QString currentSpeedToString(double speed);
@@ -67,6 +86,7 @@ public:
 signals:
   void deleteItem(DownloadItem*);
   void downloadFinished(bool success);
+  void resumeDataChanged();
 
 protected:
   virtual void mouseDoubleClickEvent(QMouseEvent*);
@@ -79,16 +99,33 @@ private slots:
   void stop(bool askForDeleteFile = true);
   void openFile();
   void openFolder();
-  void readyRead();
   void error();
   void updateDownload();
   void customContextMenuRequested(const QPoint &pos);
   void clear();
+  void resume();
+  void readSegments();
+  void retrySegments();
 
   void copyDownloadLink();
 
 private:
+  struct Segment {
+    QNetworkReply *reply;
+    qint64 pos;
+    qint64 end;
+  };
+
+  void createWidgets();
   QString fileSizeToString(qint64 size);
+  bool openOutputFile();
+  void connectReply(QNetworkReply *reply);
+  void startSegment(int index);
+  void splitSegments();
+  void restartFromBeginning(QNetworkReply *reply);
+  void processMetaData(QNetworkReply *reply);
+  void segmentFailed(QNetworkReply *reply);
+  int segmentIndex(QNetworkReply *reply) const;
 
   QListWidgetItem *item_;
   QNetworkReply *reply_;
@@ -100,6 +137,13 @@ private:
   QFile outputFile_;
   QUrl downloadUrl_;
 
+  QList<Segment> segments_;
+  QByteArray etag_;
+  QByteArray lastModified_;
+  bool acceptRanges_;
+  int retryCount_;
+  qint64 sessionStart_;
+
   bool downloading_;
   bool openAfterFinish_;
   bool downloadStopped_;
@@ -26,8 +26,15 @@
 
 #include <qzregexp.h>
 
+#define DOWNLOADS_MAGIC 0x444C5331
+#define DOWNLOADS_VERSION 1
+
 DownloadManager::DownloadManager(QWidget *parent)
   : QWidget(parent)
+  , segmentsCount_(1)
+  , bandwidthLimit_(0)
+  , bandwidthAvailable_(0)
+  , bandwidthShare_(0)
 {
   listWidget_ = new QListWidget();
   listWidget_->setFrameStyle(QFrame::NoFrame);
@@ -63,15 +70,74 @@ DownloadManager::DownloadManager(QWidget *parent)
   connect(this, SIGNAL(signalItemCreated(QListWidgetItem*,DownloadItem*)),
           this, SLOT(itemCreated(QListWidgetItem*,DownloadItem*)));
   connect(&updateInfoTimer_, SIGNAL(timeout()), this, SLOT(updateInfo()));
+  connect(&bandwidthTimer_, SIGNAL(timeout()), this, SLOT(refillBandwidth()));
 
   updateInfoTimer_.start(2000);
+  bandwidthTimer_.setInterval(100);
+
+  loadSettings();
+  loadDownloads();
 
   hide();
 }
 
 DownloadManager::~DownloadManager()
 {
+  saveDownloads();
+}
 
+void DownloadManager::loadSettings()
+{
+  Settings settings;
+  segmentsCount_ = settings.value("Settings/downloadSegments", 1).toInt();
+  bandwidthLimit_ = settings.value("Settings/downloadSpeedLimit", 0).toInt()*1024;
+
+  if (bandwidthLimit_ > 0) {
+    bandwidthTimer_.start();
+  } else {
+    bandwidthTimer_.stop();
+    emit signalBandwidthAvailable();
+  }
+}
+
+/** @brief Take part of download speed limit for \a size bytes of \a item
+ * @return Number of bytes allowed to read now
+ *----------------------------------------------------------------------------*/
+qint64 DownloadManager::takeBandwidth(const DownloadItem *item, qint64 size)
+{
+  if (bandwidthLimit_ <= 0)
+    return size;
+
+  qint64 &taken = bandwidthTaken_[item];
+  size = qMin(size, qMin(bandwidthAvailable_, bandwidthShare_ - taken));
+  if (size < 0)
+    size = 0;
+  taken += size;
+  bandwidthAvailable_ -= size;
+  return size;
+}
+
+/** @brief Add tenth of speed limit, downloads read data kept by limit
+ * @details Available bandwidth is split evenly among active downloads, so
+ *   downloads notified first don't take all of it. Part left unused by some
+ *   download stays available for the next refill.
+ *----------------------------------------------------------------------------*/
+void DownloadManager::refillBandwidth()
+{
+  bandwidthAvailable_ = qMin(bandwidthAvailable_ + bandwidthLimit_ / 10,
+                             qint64(bandwidthLimit_) / 5);
+
+  int activeCount = 0;
+  for (int i = 0; i < listWidget_->count(); i++) {
+    DownloadItem* downItem = qobject_cast<DownloadItem*>(listWidget_->itemWidget(listWidget_->item(i)));
+    if (downItem && downItem->isDownloading()) {
+      activeCount++;
+    }
+  }
+  bandwidthShare_ = bandwidthAvailable_ / qMax(activeCount, 1);
+  bandwidthTaken_.clear();
+
+  emit signalBandwidthAvailable();
 }
 
 void DownloadManager::download(const QNetworkRequest &request)
@@ -180,13 +246,21 @@ void DownloadManager::startExternalApp(const QString &executable, const QUrl &ur
   }
 }
 
-void DownloadManager::itemCreated(QListWidgetItem* item, DownloadItem* downItem)
+void DownloadManager::connectItem(QListWidgetItem* item, DownloadItem* downItem)
 {
   connect(downItem, SIGNAL(deleteItem(DownloadItem*)), this, SLOT(deleteItem(DownloadItem*)));
+  connect(downItem, SIGNAL(downloadFinished(bool)), this, SLOT(saveDownloads()));
+  connect(downItem, SIGNAL(resumeDataChanged()), this, SLOT(saveDownloads()));
+  connect(this, SIGNAL(signalBandwidthAvailable()), downItem, SLOT(readSegments()));
 
   listWidget_->setItemWidget(item, downItem);
   item->setSizeHint(downItem->sizeHint());
   downItem->show();
+}
+
+void DownloadManager::itemCreated(QListWidgetItem* item, DownloadItem* downItem)
+{
+  connectItem(item, downItem);
 
   emit signalShowDownloads(false);
   downItem->startDownloading();
@@ -197,6 +271,7 @@ void DownloadManager::deleteItem(DownloadItem* item)
 {
   if (item && !item->isDownloading()) {
     delete item;
+    saveDownloads();
   }
 }
 
@@ -214,6 +289,7 @@ void DownloadManager::clearList()
     items.append(downItem);
   }
   qDeleteAll(items);
+  saveDownloads();
 }
 
 void DownloadManager::updateInfo()
@@ -234,8 +310,9 @@ void DownloadManager::updateInfo()
   }
 
   QString info;
-  if (remTimes.count())
+  if (remTimes.count()) {
     info = QString("%1 (%2)").arg(remaining.toString("mm:ss")).arg(remTimes.count());
+  }
 
   emit signalUpdateInfo(info);
 }
@@ -255,3 +332,65 @@ void DownloadManager::retranslateStrings()
 {
   listClaerAct_->setText(tr("Clear"));
 }
+
+/** @brief Save state of unfinished downloads to resume them after restart
+ *----------------------------------------------------------------------------*/
+void DownloadManager::saveDownloads()
+{
+  QList<DownloadResumeData> downloads;
+  for (int i = 0; i < listWidget_->count(); i++) {
+    DownloadItem* downItem = qobject_cast<DownloadItem*>(listWidget_->itemWidget(listWidget_->item(i)));
+    if (downItem && downItem->canResume()) {
+      downloads.append(downItem->resumeData());
+    }
+  }
+
+  QFile file(mainApp->dataDir() + "/downloads.dat");
+  if (downloads.isEmpty()) {
+    file.remove();
+    return;
+  }
+  if (!file.open(QIODevice::WriteOnly)) {
+    qWarning() << "Unable to save downloads:" << file.fileName();
+    return;
+  }
+
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_4_6);
+  out << quint32(DOWNLOADS_MAGIC) << qint32(DOWNLOADS_VERSION) << qint32(downloads.count());
+  foreach (const DownloadResumeData &resumeData, downloads) {
+    out << resumeData.url << resumeData.fileName << resumeData.etag
+        << resumeData.lastModified << resumeData.total << resumeData.segments;
+  }
+}
+
+/** @brief Show unfinished downloads of previous session as stopped
+ *----------------------------------------------------------------------------*/
+void DownloadManager::loadDownloads()
+{
+  QFile file(mainApp->dataDir() + "/downloads.dat");
+  if (!file.open(QIODevice::ReadOnly))
+    return;
+
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_4_6);
+
+  quint32 magic;
+  qint32 version;
+  qint32 count;
+  in >> magic >> version >> count;
+  if ((magic != DOWNLOADS_MAGIC) || (version != DOWNLOADS_VERSION))
+    return;
+
+  for (int i = 0; (i < count) && (in.status() == QDataStream::Ok); ++i) {
+    DownloadResumeData resumeData;
+    in >> resumeData.url >> resumeData.fileName >> resumeData.etag
+       >> resumeData.lastModified >> resumeData.total >> resumeData.segments;
+    if ((in.status() != QDataStream::Ok) || !QFile::exists(resumeData.fileName + ".part"))
+      continue;
+
+    QListWidgetItem *item = new QListWidgetItem(listWidget_);
+    DownloadItem *downItem = new DownloadItem(item, resumeData);
+    connectItem(item, downItem);
+  }
+}
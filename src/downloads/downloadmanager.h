@@ -39,14 +39,21 @@ public:
   void handleUnsupportedContent(QNetworkReply *reply, bool askDownloadLocation);
   void startExternalApp(const QString &executable, const QUrl &url);
   void retranslateStrings();
+  void loadSettings();
+
+  int segmentsCount() const { return segmentsCount_; }
+  int bandwidthLimit() const { return bandwidthLimit_; }
+  qint64 takeBandwidth(const DownloadItem *item, qint64 size);
 
 public slots:
   void ftpAuthentication(const QUrl &url, QAuthenticator *auth);
+  void saveDownloads();
 
 signals:
   void signalItemCreated(QListWidgetItem* item, DownloadItem* downItem);
   void signalShowDownloads(bool activate);
   void signalUpdateInfo(const QString &text);
+  void signalBandwidthAvailable();
 
 private slots:
   QString getFileName(QNetworkReply* reply);
@@ -54,12 +61,23 @@ private slots:
   void clearList();
   void deleteItem(DownloadItem* item);
   void updateInfo();
+  void refillBandwidth();
 
 private:
+  void connectItem(QListWidgetItem* item, DownloadItem* downItem);
+  void loadDownloads();
+
   QListWidget *listWidget_;
   QAction *listClaerAct_;
   QTimer updateInfoTimer_;
 
+  int segmentsCount_;
+  int bandwidthLimit_;  // bytes per second, 0 - unlimited
+  qint64 bandwidthAvailable_;
+  qint64 bandwidthShare_;  // bytes for each active download till next refill
+  QHash<const DownloadItem*, qint64> bandwidthTaken_;
+  QTimer bandwidthTimer_;
+
 };
 
 #endif // DOWNLOADMANAGER_H
@@ -0,0 +1,106 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include "downloadrange.h"
+
+/** @brief Value of Range header requesting bytes \a first to \a last
+ *----------------------------------------------------------------------------*/
+QByteArray DownloadRange::rangeHeader(qint64 first, qint64 last)
+{
+  QByteArray range = "bytes=" + QByteArray::number(first) + "-";
+  if (last >= 0)
+    range += QByteArray::number(last);
+  return range;
+}
+
+/** @brief Value of If-Range header, server sends whole file if it has changed
+ * @details Weak ETag can't be used for ranges, Last-Modified is used then.
+ *----------------------------------------------------------------------------*/
+QByteArray DownloadRange::ifRangeHeader(const QByteArray &etag,
+                                        const QByteArray &lastModified)
+{
+  if (!etag.isEmpty() && !etag.startsWith("W/"))
+    return etag;
+  return lastModified;
+}
+
+/** @brief Parse Content-Range "bytes <first>-<last>/<total>"
+ * @details Total is -1 if server doesn't know it ("*").
+ * @return false if header is not valid range of bytes
+ *----------------------------------------------------------------------------*/
+bool DownloadRange::parseContentRange(const QByteArray &contentRange,
+                                      qint64 *first, qint64 *last, qint64 *total)
+{
+  QByteArray value = contentRange.trimmed();
+  if (!value.toLower().startsWith("bytes "))
+    return false;
+  value = value.mid(6).trimmed();
+
+  int dash = value.indexOf('-');
+  int slash = value.indexOf('/');
+  if ((dash < 1) || (slash < dash + 2))
+    return false;
+
+  bool firstOk = false;
+  bool lastOk = false;
+  *first = value.left(dash).toLongLong(&firstOk);
+  *last = value.mid(dash + 1, slash - dash - 1).toLongLong(&lastOk);
+  if (!firstOk || !lastOk || (*first < 0) || (*last < *first))
+    return false;
+
+  QByteArray totalValue = value.mid(slash + 1);
+  if (totalValue == "*") {
+    *total = -1;
+    return true;
+  }
+  bool totalOk = false;
+  *total = totalValue.toLongLong(&totalOk);
+  return totalOk && (*total > *last);
+}
+
+/** @brief Split file of \a total bytes into at most \a count ranges
+ * @details Ranges are not smaller than \a minSize, the last one takes the
+ *   rest of division.
+ *----------------------------------------------------------------------------*/
+QList<DownloadRange::Range> DownloadRange::split(qint64 total, int count, qint64 minSize)
+{
+  QList<Range> ranges;
+  if (total <= 0)
+    return ranges;
+
+  count = int(qMax(qint64(1), qMin(qint64(count), total / qMax(qint64(1), minSize))));
+  qint64 size = total / count;
+  for (int i = 0; i < count; ++i) {
+    qint64 last = (i == count - 1) ? (total - 1) : ((i + 1) * size - 1);
+    ranges.append(qMakePair(i * size, last));
+  }
+  return ranges;
+}
+
+/** @brief Number of bytes in \a ranges of file of \a total bytes
+ *----------------------------------------------------------------------------*/
+qint64 DownloadRange::remaining(const QList<Range> &ranges, qint64 total)
+{
+  qint64 remaining = 0;
+  foreach (const Range &range, ranges) {
+    if (range.second >= 0)
+      remaining += range.second - range.first + 1;
+    else
+      remaining += qMax(qint64(0), total - range.first);
+  }
+  return remaining;
+}
@@ -0,0 +1,44 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#ifndef DOWNLOADRANGE_H
+#define DOWNLOADRANGE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+
+/*! \brief HTTP byte ranges used to resume and split downloads.
+ *
+ * Range is a pair of position of its first byte and position of its last
+ * byte, last -1 means up to the end of file.
+ */
+class DownloadRange
+{
+public:
+  typedef QPair<qint64, qint64> Range;
+
+  static QByteArray rangeHeader(qint64 first, qint64 last);
+  static QByteArray ifRangeHeader(const QByteArray &etag, const QByteArray &lastModified);
+  static bool parseContentRange(const QByteArray &contentRange,
+                                qint64 *first, qint64 *last, qint64 *total);
+  static QList<Range> split(qint64 total, int count, qint64 minSize);
+  static qint64 remaining(const QList<Range> &ranges, qint64 total);
+
+};
+
+#endif // DOWNLOADRANGE_H
@@ -16,17 +16,25 @@
 * along with this program.  If not, see <https://www.gnu.org/licenses/>.
 * ============================================================ */
 #include "faviconobject.h"
-#include "VersionNo.h"
 #include "mainapplication.h"
 #include "globals.h"
 
 #include <QDebug>
-#include <QtSql>
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFileInfo>
+#include <QImage>
 #include <qzregexp.h>
 
 #define REPLY_MAX_COUNT 4
 #define REQUEST_TIMEOUT 30
 
+#define ICON_TTL (30 * 24 * 3600 * qint64(1000))
+#define NO_ICON_TTL (24 * 3600 * qint64(1000))
+#define ICONS_MAGIC 0x46415631
+#define ICONS_VERSION 1
+
 FaviconObject::FaviconObject(QObject *parent)
   : QObject(parent)
   , networkManager_(NULL)
@@ -34,7 +42,7 @@ FaviconObject::FaviconObject(QObject *parent)
   setObjectName("faviconObject_");
 
   timeout_ = new QTimer(this);
-  timeout_->setInterval(1000);
+  timeout_->setSingleShot(true);
   connect(timeout_, SIGNAL(timeout()), this, SLOT(slotRequestTimeout()));
 
   getUrlTimer_ = new QTimer(this);
@@ -42,10 +50,21 @@ FaviconObject::FaviconObject(QObject *parent)
   getUrlTimer_->setInterval(20);
   connect(getUrlTimer_, SIGNAL(timeout()), this, SLOT(getQueuedUrl()));
 
+  saveTimer_ = new QTimer(this);
+  saveTimer_->setSingleShot(true);
+  saveTimer_->setInterval(10000);
+  connect(saveTimer_, SIGNAL(timeout()), this, SLOT(saveIcons()));
+
   connect(this, SIGNAL(signalGet(QUrl,QString,int)),
           SLOT(slotGet(QUrl,QString,int)));
 }
 
+FaviconObject::~FaviconObject()
+{
+  if (saveTimer_->isActive())
+    saveIcons();
+}
+
 void FaviconObject::disconnectObjects()
 {
   disconnect(this);
@@ -53,7 +72,9 @@ void FaviconObject::disconnectObjects()
     networkManager_->disconnect(networkManager_);
 }
 
-/** @brief Put requested URL in request queue
+/** @brief Request icon of feed site
+ * @details Icon is resolved once per site for all its feeds. Found icons are
+ *   kept for ICON_TTL, then revalidated by ETag if the server has sent it.
  *----------------------------------------------------------------------------*/
 void FaviconObject::requestUrl(QString urlString, QString feedUrl)
 {
@@ -61,13 +82,34 @@ void FaviconObject::requestUrl(QString urlString, QString feedUrl)
     networkManager_ = new NetworkManager(true, this);
     connect(networkManager_, SIGNAL(finished(QNetworkReply*)),
             this, SLOT(finished(QNetworkReply*)));
+    loadIcons();
+  }
+
+  QUrl url = QUrl::fromEncoded(urlString.toUtf8());
+  url.setUrl(QString("%1://%2").arg(url.scheme()).arg(url.host()));
+  if (!url.isValid()) {
+    url = QUrl::fromEncoded(feedUrl.toUtf8());
+    url.setUrl(QString("%1://%2").arg(url.scheme()).arg(url.host()));
   }
+  QString siteUrl = url.toString();
+
+  // Icon of site is resolving already
+  bool resolving = pendingFeeds_.contains(siteUrl);
+  pendingFeeds_[siteUrl].append(feedUrl);
+  if (resolving) return;
 
-  if (!timeout_->isActive())
-    timeout_->start();
+  QHash<QString, SiteIcon>::const_iterator it = siteIcons_.constFind(siteUrl);
+  if (it != siteIcons_.constEnd()) {
+    qint64 age = QDateTime::currentDateTime().toMSecsSinceEpoch() - it.value().checked;
+    if (age < (it.value().hash.isEmpty() ? NO_ICON_TTL : ICON_TTL)) {
+      deliverIcon(siteUrl);
+      return;
+    }
+  }
 
-  urlsQueue_.enqueue(urlString);
-  feedsQueue_.enqueue(feedUrl);
+  // Site may be queued already for repeat of revalidation
+  if (!urlsQueue_.contains(siteUrl))
+    urlsQueue_.enqueue(siteUrl);
 
   if (!getUrlTimer_->isActive())
     getUrlTimer_->start();
@@ -77,7 +119,7 @@ void FaviconObject::requestUrl(QString urlString, QString feedUrl)
  *----------------------------------------------------------------------------*/
 void FaviconObject::getQueuedUrl()
 {
-  if (currentFeeds_.count() >= REPLY_MAX_COUNT) {
+  if (currentRequests_.count() >= REPLY_MAX_COUNT) {
     getUrlTimer_->start();
     return;
   }
@@ -85,62 +127,135 @@ void FaviconObject::getQueuedUrl()
   if (!urlsQueue_.isEmpty()) {
     getUrlTimer_->start();
 
-    QString feedUrl = feedsQueue_.head();
-
-    if (hostList_.contains(QUrl(feedUrl).host())) {
-      foreach (QString url, currentFeeds_) {
-        if (QUrl(url).host() == QUrl(feedUrl).host()) {
-          return;
-        }
+    // Sites of throttled hosts keep their place in queue, sites of other
+    // hosts go ahead of them
+    int index = -1;
+    for (int i = 0; i < urlsQueue_.count(); ++i) {
+      if (!isHostWaiting(QUrl(urlsQueue_.at(i)).host())) {
+        index = i;
+        break;
       }
     }
+    if (index == -1)
+      return;
 
-    QString urlString = urlsQueue_.dequeue();
-    feedUrl = feedsQueue_.dequeue();
+    QString siteUrl = urlsQueue_.takeAt(index);
 
-    QUrl url = QUrl::fromEncoded(urlString.toUtf8());
-    url.setUrl(QString("%1://%2").arg(url.scheme()).arg(url.host()));
-    if (!url.isValid()) {
-      url = QUrl::fromEncoded(feedUrl.toUtf8());
-      url.setUrl(QString("%1://%2").arg(url.scheme()).arg(url.host()));
-    }
-    emit signalGet(url, feedUrl, 0);
+    SiteIcon siteIcon = siteIcons_.value(siteUrl);
+    if (!siteIcon.hash.isEmpty() && !siteIcon.etag.isEmpty())
+      startRequest(QUrl(siteIcon.iconUrl), siteUrl, 0, siteIcon.etag);
+    else
+      emit signalGet(QUrl(siteUrl), siteUrl, 0);
+  }
+}
+
+/** @brief Check throttled \a host has to wait for its ready time or for its
+ *   request in progress
+ *----------------------------------------------------------------------------*/
+bool FaviconObject::isHostWaiting(const QString &host) const
+{
+  if (!hostThrottle_.isThrottled(host))
+    return false;
+  if (hostThrottle_.readyTime(host) > QDateTime::currentDateTime().toMSecsSinceEpoch())
+    return true;
+
+  foreach (const CurrentRequest &request, currentRequests_) {
+    if (QUrl(request.siteUrl).host() == host)
+      return true;
   }
+  return false;
 }
 
 /** @brief Prepare and send network request to receive all data
  *----------------------------------------------------------------------------*/
-void FaviconObject::slotGet(const QUrl &getUrl, const QString &feedUrl, const int &count)
+void FaviconObject::slotGet(const QUrl &getUrl, const QString &siteUrl, const int &count)
 {
-  if (count)
-    Common::sleep(30);
+  startRequest(getUrl, siteUrl, count, QString());
+}
 
+/** @brief Send network request
+ * @param etag ETag of known icon, request only revalidates it
+ *----------------------------------------------------------------------------*/
+void FaviconObject::startRequest(const QUrl &getUrl, const QString &siteUrl,
+                                 int count, const QString &etag)
+{
   QNetworkRequest request(getUrl);
   request.setRawHeader("User-Agent", globals.userAgent().toUtf8());
-
-  currentUrls_.append(getUrl);
-  currentFeeds_.append(feedUrl);
-  currentCntRequests_.append(count);
-  currentTime_.append(REQUEST_TIMEOUT);
+  if (!etag.isEmpty())
+    request.setRawHeader("If-None-Match", etag.toLatin1());
 
   QNetworkReply *reply = networkManager_->get(request);
   reply->setProperty("feedReply", QVariant(true));
-  requestUrl_.append(reply->url());
-  networkReply_.append(reply);
+
+  CurrentRequest currentRequest;
+  currentRequest.url = getUrl;
+  currentRequest.siteUrl = siteUrl;
+  currentRequest.cntRequests = count;
+  currentRequest.revalidate = !etag.isEmpty();
+  currentRequest.deadline = QDateTime::currentDateTime().toMSecsSinceEpoch() +
+      REQUEST_TIMEOUT * 1000;
+  currentRequests_.insert(reply, currentRequest);
+  deadlines_.insert(currentRequest.deadline, reply);
+
+  startTimeoutTimer();
+}
+
+void FaviconObject::startTimeoutTimer()
+{
+  if (deadlines_.isEmpty()) {
+    timeout_->stop();
+    return;
+  }
+
+  qint64 delay = deadlines_.begin().key() - QDateTime::currentDateTime().toMSecsSinceEpoch();
+  timeout_->start(int(qMax(qint64(0), delay)));
 }
 
 /** @brief Finish network request processing
  *----------------------------------------------------------------------------*/
 void FaviconObject::finished(QNetworkReply *reply)
 {
-  int currentReplyIndex = currentUrls_.indexOf(reply->url());
-  if (currentReplyIndex >= 0) {
-    currentTime_.removeAt(currentReplyIndex);
-    QUrl url = currentUrls_.takeAt(currentReplyIndex);
-    QString feedUrl = currentFeeds_.takeAt(currentReplyIndex);
-    int cntRequests = currentCntRequests_.takeAt(currentReplyIndex);
-
-    if ((reply->error() == QNetworkReply::NoError) || (reply->error() == QNetworkReply::UnknownContentError)) {
+  if (currentRequests_.contains(reply)) {
+    CurrentRequest currentRequest = currentRequests_.take(reply);
+    deadlines_.remove(currentRequest.deadline, reply);
+    startTimeoutTimer();
+
+    QUrl url = currentRequest.url;
+    QString siteUrl = currentRequest.siteUrl;
+    int cntRequests = currentRequest.cntRequests;
+    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    if (currentRequest.revalidate) {
+      QByteArray iconData;
+      if ((reply->error() == QNetworkReply::NoError) && (statusCode != 304))
+        iconData = scaleIcon(reply->readAll(), QFileInfo(url.path()).suffix());
+
+      if (statusCode == 304) {
+        hostThrottle_.success(url.host());
+        siteIcons_[siteUrl].checked = QDateTime::currentDateTime().toMSecsSinceEpoch();
+        saveTimer_->start();
+        deliverIcon(siteUrl);
+      } else if (!iconData.isEmpty()) {
+        setSiteIcon(siteUrl, url.toString(),
+                    QString::fromLatin1(reply->rawHeader("ETag")), iconData);
+      } else if (HostThrottle::isThrottleReply(reply)) {
+        // Server is busy, keep known icon and revalidate it when host is ready
+        hostThrottle_.throttle(url.host(), HostThrottle::retryAfter(reply));
+        deliverIcon(siteUrl);
+        if (!urlsQueue_.contains(siteUrl))
+          urlsQueue_.enqueue(siteUrl);
+        if (!getUrlTimer_->isActive())
+          getUrlTimer_->start();
+      } else if (!statusCode) {
+        // Server isn't available, keep known icon
+        deliverIcon(siteUrl);
+      } else {
+        // Icon is removed, search it again
+        emit signalGet(QUrl(siteUrl), siteUrl, 0);
+      }
+    } else if ((reply->error() == QNetworkReply::NoError) || (reply->error() == QNetworkReply::UnknownContentError)) {
+      hostThrottle_.success(url.host());
+
       QUrl redirectionTarget = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
       if (redirectionTarget.isValid()) {
         if ((cntRequests == 0) || (cntRequests == 1) || (cntRequests == 3)) {
@@ -150,7 +265,7 @@ void FaviconObject::finished(QNetworkReply *reply)
             else
               redirectionTarget.setUrl(url.scheme()+"://"+url.host()+"/"+redirectionTarget.toString());
           }
-          emit signalGet(redirectionTarget, feedUrl, cntRequests+2);
+          emit signalGet(redirectionTarget, siteUrl, cntRequests+2);
         }
       } else {
         QByteArray data = reply->readAll();
@@ -186,78 +301,199 @@ void FaviconObject::finished(QNetworkReply *reply)
                   }
                   linkFavicon = urlFavicon.toString().simplified();
                   qDebug() << "Favicon URL:" << linkFavicon;
-                  emit signalGet(linkFavicon, feedUrl, cntRequests+1);
+                  emit signalGet(linkFavicon, siteUrl, cntRequests+1);
                 }
               }
             }
             if (linkFavicon.isEmpty()) {
               if ((cntRequests == 0) || (cntRequests == 2)) {
                 QString link = QString("%1://%2/favicon.ico").arg(url.scheme()).arg(url.host());
-                emit signalGet(link, feedUrl, cntRequests+1);
+                emit signalGet(link, siteUrl, cntRequests+1);
               }
             }
           } else {
-            // Emit receiced data in main thread
             QFileInfo info(url.path());
-            emit signalIconRecived(feedUrl, data, info.suffix());
+            QByteArray iconData = scaleIcon(data, info.suffix());
+            if (!iconData.isEmpty()) {
+              setSiteIcon(siteUrl, url.toString(),
+                          QString::fromLatin1(reply->rawHeader("ETag")), iconData);
+            }
           }
         } else {
           if ((cntRequests == 0) || (cntRequests == 2)) {
             QString link = QString("%1://%2/favicon.ico").arg(url.scheme()).arg(url.host());
-            emit signalGet(link, feedUrl, cntRequests+1);
+            emit signalGet(link, siteUrl, cntRequests+1);
           }
         }
       }
     } else {
-      if (reply->errorString().contains("Service Temporarily Unavailable")) {
-        if (!hostList_.contains(QUrl(feedUrl).host())) {
-          hostList_.append(QUrl(feedUrl).host());
-        }
+      if (HostThrottle::isThrottleReply(reply)) {
+        hostThrottle_.throttle(url.host(), HostThrottle::retryAfter(reply));
       }
 
       if ((cntRequests == 0) || (cntRequests == 1)) {
         QString link = QString("%1://%2").arg(url.scheme()).arg(url.host());
-        emit signalGet(link, feedUrl, 2);
+        emit signalGet(link, siteUrl, 2);
         qDebug() << "Request Url error: " << reply->url().toString() << reply->errorString();
       }
     }
+
+    checkResolved(siteUrl);
   } else {
     qCritical() << "Request Url error: " << reply->url().toString() << reply->errorString();
   }
 
-  int replyIndex = requestUrl_.indexOf(reply->url());
-  if (replyIndex >= 0) {
-    requestUrl_.removeAt(replyIndex);
-    networkReply_.removeAt(replyIndex);
-  }
   reply->abort();
   reply->deleteLater();
 }
 
-/** @brief Timeout to delete requests without answer from server
+/** @brief Delete requests without answer from server till their deadline
  *----------------------------------------------------------------------------*/
 void FaviconObject::slotRequestTimeout()
 {
-  for (int i = currentTime_.count() - 1; i >= 0; i--) {
-    int time = currentTime_.at(i) - 1;
-    if (time <= 0) {
-      QUrl url = currentUrls_.takeAt(i);
-      QString feedUrl = currentFeeds_.takeAt(i);
-      int cntRequests = currentCntRequests_.takeAt(i);
-      currentTime_.removeAt(i);
-
-      int replyIndex = requestUrl_.indexOf(url);
-      if (replyIndex >= 0) {
-        requestUrl_.removeAt(replyIndex);
-        QNetworkReply *reply = networkReply_.takeAt(replyIndex);
-        reply->deleteLater();
-
-        if (cntRequests == 0) {
-          emit signalGet(url, feedUrl, 2);
-        }
-      }
-    } else {
-      currentTime_.replace(i, time);
+  qint64 currentTime = QDateTime::currentDateTime().toMSecsSinceEpoch();
+
+  while (!deadlines_.isEmpty() && (deadlines_.begin().key() <= currentTime)) {
+    QNetworkReply *reply = deadlines_.begin().value();
+    deadlines_.erase(deadlines_.begin());
+
+    CurrentRequest currentRequest = currentRequests_.take(reply);
+    reply->deleteLater();
+
+    if (currentRequest.revalidate) {
+      deliverIcon(currentRequest.siteUrl);
+    } else if (currentRequest.cntRequests == 0) {
+      emit signalGet(currentRequest.url, currentRequest.siteUrl, 2);
     }
+    checkResolved(currentRequest.siteUrl);
+  }
+
+  startTimeoutTimer();
+}
+
+/** @brief Finish site resolving without icon if no request is left for it
+ *----------------------------------------------------------------------------*/
+void FaviconObject::checkResolved(const QString &siteUrl)
+{
+  if (!pendingFeeds_.contains(siteUrl)) return;
+
+  foreach (const CurrentRequest &request, currentRequests_) {
+    if (request.siteUrl == siteUrl)
+      return;
+  }
+
+  qDebug() << "Favicon not found:" << siteUrl;
+  setSiteIcon(siteUrl, QString(), QString(), QByteArray());
+}
+
+/** @brief Remember icon of site and send it to waiting feeds
+ * @details Equal icons of different sites are stored once by content hash.
+ *----------------------------------------------------------------------------*/
+void FaviconObject::setSiteIcon(const QString &siteUrl, const QString &iconUrl,
+                                const QString &etag, const QByteArray &iconData)
+{
+  SiteIcon siteIcon;
+  if (!iconData.isEmpty()) {
+    siteIcon.hash = QCryptographicHash::hash(iconData, QCryptographicHash::Sha1);
+    icons_.insert(siteIcon.hash, iconData);
+  }
+  siteIcon.iconUrl = iconUrl;
+  siteIcon.etag = etag;
+  siteIcon.checked = QDateTime::currentDateTime().toMSecsSinceEpoch();
+  siteIcons_.insert(siteUrl, siteIcon);
+  saveTimer_->start();
+
+  deliverIcon(siteUrl);
+}
+
+void FaviconObject::deliverIcon(const QString &siteUrl)
+{
+  QStringList feedUrls = pendingFeeds_.take(siteUrl);
+  QByteArray iconData = icons_.value(siteIcons_.value(siteUrl).hash);
+  if (iconData.isEmpty()) return;
+
+  foreach (const QString &feedUrl, feedUrls) {
+    emit signalIconRecived(feedUrl, iconData);
+  }
+}
+
+/** @brief Decode and scale icon in this thread, not in main one
+ * @return Icon in ICO format or empty array if data isn't image
+ *----------------------------------------------------------------------------*/
+QByteArray FaviconObject::scaleIcon(const QByteArray &data, const QString &format)
+{
+  QImage image;
+  if (!image.loadFromData(data) &&
+      !image.loadFromData(data, format.toUtf8().data())) {
+    return QByteArray();
+  }
+
+  image = image.scaled(16, 16, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+  QByteArray iconData;
+  QBuffer buffer(&iconData);
+  buffer.open(QIODevice::WriteOnly);
+  if (!image.save(&buffer, "ICO"))
+    return QByteArray();
+  return iconData;
+}
+
+void FaviconObject::loadIcons()
+{
+  QFile file(mainApp->dataDir() + "/favicons.dat");
+  if (!file.open(QIODevice::ReadOnly))
+    return;
+
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_4_6);
+
+  quint32 magic;
+  qint32 version;
+  qint32 count;
+  in >> magic >> version >> count;
+  if ((magic != ICONS_MAGIC) || (version != ICONS_VERSION))
+    return;
+
+  for (int i = 0; (i < count) && (in.status() == QDataStream::Ok); ++i) {
+    QString siteUrl;
+    SiteIcon siteIcon;
+    in >> siteUrl >> siteIcon.hash >> siteIcon.iconUrl >> siteIcon.etag >> siteIcon.checked;
+    siteIcons_.insert(siteUrl, siteIcon);
+  }
+  in >> icons_;
+
+  if (in.status() != QDataStream::Ok) {
+    qWarning() << "Favicons cache is broken:" << file.fileName();
+    siteIcons_.clear();
+    icons_.clear();
+  }
+}
+
+/** @brief Save found icons, icons no site refers to are dropped
+ *----------------------------------------------------------------------------*/
+void FaviconObject::saveIcons()
+{
+  saveTimer_->stop();
+
+  QHash<QByteArray, QByteArray> icons;
+  foreach (const SiteIcon &siteIcon, siteIcons_) {
+    if (!siteIcon.hash.isEmpty() && icons_.contains(siteIcon.hash))
+      icons.insert(siteIcon.hash, icons_.value(siteIcon.hash));
+  }
+  icons_ = icons;
+
+  QFile file(mainApp->dataDir() + "/favicons.dat");
+  if (!file.open(QIODevice::WriteOnly)) {
+    qWarning() << "Unable to save favicons cache:" << file.fileName();
+    return;
+  }
+
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_4_6);
+  out << quint32(ICONS_MAGIC) << qint32(ICONS_VERSION) << qint32(siteIcons_.count());
+  QHash<QString, SiteIcon>::const_iterator it = siteIcons_.constBegin();
+  for (; it != siteIcons_.constEnd(); ++it) {
+    out << it.key() << it.value().hash << it.value().iconUrl
+        << it.value().etag << it.value().checked;
   }
+  out << icons_;
 }
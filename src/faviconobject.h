@@ -23,8 +23,12 @@
 #include <QQueue>
 #include <QNetworkReply>
 #include <QTimer>
+#include <QHash>
+#include <QMultiMap>
+#include <QStringList>
 
 #include "networkmanager.h"
+#include "hostthrottle.h"
 
 class FaviconObject : public QObject
 {
@@ -32,38 +36,69 @@ class FaviconObject : public QObject
 
 public:
   explicit FaviconObject(QObject *parent = 0);
+  ~FaviconObject();
 
   void disconnectObjects();
 
 public slots:
   void requestUrl(QString urlString, QString feedUrl);
-  void slotGet(const QUrl &getUrl, const QString &feedUrl, const int &count);
+  void slotGet(const QUrl &getUrl, const QString &siteUrl, const int &count);
 
 signals:
   void startTimer();
-  void signalGet(const QUrl &getUrl, const QString &feedUrl, const int &count);
-  void signalIconRecived(QString feedUrl, QByteArray byteArray, QString format);
+  void signalGet(const QUrl &getUrl, const QString &siteUrl, const int &count);
+  void signalIconRecived(QString feedUrl, QByteArray faviconData);
 
 private slots:
   void getQueuedUrl();
   void finished(QNetworkReply *reply);
   void slotRequestTimeout();
+  void saveIcons();
 
 private:
   NetworkManager *networkManager_;
 
   QQueue<QString> urlsQueue_;
-  QQueue<QString> feedsQueue_;
+
+  struct CurrentRequest {
+    QUrl url;
+    QString siteUrl;
+    int cntRequests;
+    bool revalidate;
+    qint64 deadline;
+  };
+
+  /*! \brief Icon found for site, shared by all its feeds */
+  struct SiteIcon {
+    SiteIcon() : checked(0) {}
+
+    QByteArray hash;     // empty if site has no icon
+    QString iconUrl;
+    QString etag;
+    qint64 checked;
+  };
+
+  void startRequest(const QUrl &getUrl, const QString &siteUrl, int count,
+                    const QString &etag);
+  void startTimeoutTimer();
+  bool isHostWaiting(const QString &host) const;
+  void checkResolved(const QString &siteUrl);
+  void setSiteIcon(const QString &siteUrl, const QString &iconUrl,
+                   const QString &etag, const QByteArray &iconData);
+  void deliverIcon(const QString &siteUrl);
+  void loadIcons();
+  static QByteArray scaleIcon(const QByteArray &data, const QString &format);
 
   QTimer *timeout_;
   QTimer *getUrlTimer_;
-  QList<QUrl> currentUrls_;
-  QList<QString> currentFeeds_;
-  QList<int> currentCntRequests_;
-  QList<int> currentTime_;
-  QList<QUrl> requestUrl_;
-  QList<QNetworkReply*> networkReply_;
-  QList<QString> hostList_;
+  QTimer *saveTimer_;
+  QHash<QNetworkReply*, CurrentRequest> currentRequests_;
+  QMultiMap<qint64, QNetworkReply*> deadlines_;
+  HostThrottle hostThrottle_;
+
+  QHash<QString, QStringList> pendingFeeds_;  // site -> feeds waiting for icon
+  QHash<QString, SiteIcon> siteIcons_;
+  QHash<QByteArray, QByteArray> icons_;       // content hash -> icon data
 
 };
 
@@ -209,6 +209,8 @@ QWidget *FeedPropertiesDialog::createDisplayTab()
 
   layoutDirection_ = new QCheckBox(tr("Right-to-left layout"));
 
+  prefetchImages_ = new QCheckBox(tr("Download images of new news for offline reading"));
+
   QVBoxLayout *tabLayout = new QVBoxLayout(tab);
   tabLayout->setMargin(10);
   tabLayout->setSpacing(5);
@@ -216,9 +218,13 @@ QWidget *FeedPropertiesDialog::createDisplayTab()
   tabLayout->addWidget(javaScriptEnable_);
   tabLayout->addWidget(showDescriptionNews_);
   tabLayout->addWidget(layoutDirection_);
+  tabLayout->addWidget(prefetchImages_);
 
   tabLayout->addStretch();
 
+  if (!isFeed_)
+    prefetchImages_->hide();
+
   return tab;
 }
 //------------------------------------------------------------------------------
@@ -415,6 +421,7 @@ QWidget *FeedPropertiesDialog::createStatusTab()
   javaScriptEnable_->setCheckState((Qt::CheckState)feedProperties.display.javaScriptEnable);
   showDescriptionNews_->setChecked(!feedProperties.display.displayNews);
   layoutDirection_->setChecked(feedProperties.display.layoutDirection);
+  prefetchImages_->setChecked(feedProperties.display.prefetchImages);
 
   for (int i = 0; i < feedProperties.column.columns.count(); ++i) {
     int index = feedProperties.column.indexList.indexOf(feedProperties.column.columns.at(i));
@@ -550,6 +557,7 @@ FEED_PROPERTIES FeedPropertiesDialog::getFeedProperties()
   feedProperties.display.displayNews = !showDescriptionNews_->isChecked();
   feedProperties.general.duplicateNewsMode = duplicateNewsMode_->isChecked();
   feedProperties.display.layoutDirection = layoutDirection_->isChecked();
+  feedProperties.display.prefetchImages = prefetchImages_->isChecked();
   feedProperties.general.addSingleNewsAnyDateOn = addSingleNewsAnyDateOn_->isChecked();
   feedProperties.general.avoidedOldSingleNewsDateOn = avoidedOldSingleNewsDateOn_->isChecked();
   if (!avoidedOldSingleNewsDate_->selectedDate().isNull() && avoidedOldSingleNewsDate_->selectedDate().isValid()) {
@@ -72,6 +72,7 @@ typedef struct {
     bool openLink; //!< Flag to open news link
     int layoutDirection; //!< LTR or RTL layout
     int javaScriptEnable;
+    bool prefetchImages; //!< Download images of new news for offline reading
   } display;
 
   //! Columns properties
@@ -175,6 +176,7 @@ private:
   QCheckBox *loadImagesOn_;
   QCheckBox *javaScriptEnable_;
   QCheckBox *layoutDirection_;
+  QCheckBox *prefetchImages_;
 
   QWidget *createDisplayTab();
 
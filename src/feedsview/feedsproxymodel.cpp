@@ -4,6 +4,12 @@
 FeedsProxyModel::FeedsProxyModel(QObject *parent)
   : QSortFilterProxyModel(parent)
   , filterAct_("filterFeedsAll_")
+  , findFoldersValid_(false)
+  , idColumn_(-1)
+  , textColumn_(-1)
+  , xmlUrlColumn_(-1)
+  , newCountColumn_(-1)
+  , unreadColumn_(-1)
 {
   setObjectName("FeedsProxyModel");
 }
@@ -23,11 +29,40 @@ void FeedsProxyModel::reset()
 #endif
 }
 
-void FeedsProxyModel::setFilter(const QString &filterAct, const QList<int> &idList,
+void FeedsProxyModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+  if (this->sourceModel()) {
+    disconnect(this->sourceModel(), 0, this, SLOT(slotSourceReset()));
+    disconnect(this->sourceModel(), 0, this, SLOT(slotSourceDataChanged(QModelIndex,QModelIndex)));
+  }
+
+  QSortFilterProxyModel::setSourceModel(sourceModel);
+
+  // Columns layout of feeds table doesn't change after model refresh
+  FeedsModel *feedsModel = (FeedsModel*)sourceModel;
+  idColumn_ = feedsModel->indexColumnOf("id");
+  textColumn_ = feedsModel->indexColumnOf("text");
+  xmlUrlColumn_ = feedsModel->indexColumnOf("xmlUrl");
+  newCountColumn_ = feedsModel->indexColumnOf("newCount");
+  unreadColumn_ = feedsModel->indexColumnOf("unread");
+  findFoldersValid_ = false;
+
+  connect(sourceModel, SIGNAL(modelReset()), this, SLOT(slotSourceReset()));
+  connect(sourceModel, SIGNAL(layoutChanged()), this, SLOT(slotSourceReset()));
+  connect(sourceModel, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(slotSourceReset()));
+  connect(sourceModel, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(slotSourceReset()));
+  connect(sourceModel, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+          this, SLOT(slotSourceDataChanged(QModelIndex,QModelIndex)));
+}
+
+void FeedsProxyModel::setFilter(const QString &filterAct, const QSet<int> &idList,
                                 const QString &findAct, const QString &findText)
 {
   if ((filterAct_ != filterAct) || (filterAct != "filterFeedsAll_") ||
       (findAct_ != findAct) || (findText_ != findText) || (idList_ != idList)) {
+    if ((findAct_ != findAct) || (findText_ != findText))
+      findFoldersValid_ = false;
+
     filterAct_ = filterAct;
     findAct_ = findAct;
     findText_ = findText;
@@ -37,6 +72,24 @@ void FeedsProxyModel::setFilter(const QString &filterAct, const QList<int> &idLi
   }
 }
 
+void FeedsProxyModel::slotSourceReset()
+{
+  findFoldersValid_ = false;
+}
+
+/** @brief Drop found folders only if feed title or link is changed
+ *---------------------------------------------------------------------------*/
+void FeedsProxyModel::slotSourceDataChanged(const QModelIndex &topLeft,
+                                            const QModelIndex &bottomRight)
+{
+  for (int column = topLeft.column(); column <= bottomRight.column(); ++column) {
+    if ((column == textColumn_) || (column == xmlUrlColumn_)) {
+      findFoldersValid_ = false;
+      break;
+    }
+  }
+}
+
 bool FeedsProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
 {
   bool accept = false;
@@ -45,38 +98,72 @@ bool FeedsProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceP
   if (filterAct_ == "filterFeedsAll_") {
     accept = true;
   } else if (filterAct_ == "filterFeedsNew_") {
-    index = sourceModel()->index(sourceRow, ((FeedsModel*)sourceModel())->indexColumnOf("newCount"), sourceParent);
+    index = sourceModel()->index(sourceRow, newCountColumn_, sourceParent);
     if (sourceModel()->data(index, Qt::EditRole).toInt() > 0)
       accept = true;
   } else if (filterAct_ == "filterFeedsUnread_") {
-    index = sourceModel()->index(sourceRow, ((FeedsModel*)sourceModel())->indexColumnOf("unread"), sourceParent);
+    index = sourceModel()->index(sourceRow, unreadColumn_, sourceParent);
     if (sourceModel()->data(index, Qt::EditRole).toInt() > 0)
       accept = true;
   }
 
-  if (idList_.count()) {
-    index = sourceModel()->index(sourceRow, ((FeedsModel*)sourceModel())->indexColumnOf("id"), sourceParent);
+  if (!accept && !idList_.isEmpty()) {
+    index = sourceModel()->index(sourceRow, idColumn_, sourceParent);
     if (idList_.contains(sourceModel()->data(index, Qt::EditRole).toInt()))
       accept = true;
   }
 
   if (accept && !findText_.isEmpty()) {
-    index = sourceModel()->index(sourceRow, ((FeedsModel*)sourceModel())->indexColumnOf("xmlUrl"), sourceParent);
+    index = sourceModel()->index(sourceRow, xmlUrlColumn_, sourceParent);
     if (!sourceModel()->data(index, Qt::EditRole).toString().isEmpty()) {
-      if (findAct_ == "findLinkAct") {
-        accept = sourceModel()->data(index, Qt::EditRole).toString().contains(findText_, Qt::CaseInsensitive);
-      } else {
-        index = sourceModel()->index(sourceRow, ((FeedsModel*)sourceModel())->indexColumnOf("text"), sourceParent);
-        accept = sourceModel()->data(index, Qt::EditRole).toString().contains(findText_, Qt::CaseInsensitive);
-      }
+      accept = acceptFeed(sourceRow, sourceParent);
     } else {
-      accept = acceptFolder(index);
+      if (!findFoldersValid_) {
+        findFolders_.clear();
+        findFoldersInSubtree(QModelIndex());
+        findFoldersValid_ = true;
+      }
+      index = sourceModel()->index(sourceRow, idColumn_, sourceParent);
+      accept = findFolders_.contains(sourceModel()->data(index, Qt::EditRole).toInt());
     }
   }
 
   return accept;
 }
 
+/** @brief Check feed title or link against find text
+ *---------------------------------------------------------------------------*/
+bool FeedsProxyModel::acceptFeed(int sourceRow, const QModelIndex &sourceParent) const
+{
+  int column = (findAct_ == "findLinkAct") ? xmlUrlColumn_ : textColumn_;
+  QModelIndex index = sourceModel()->index(sourceRow, column, sourceParent);
+  return sourceModel()->data(index, Qt::EditRole).toString().contains(findText_, Qt::CaseInsensitive);
+}
+
+/** @brief Collect folders with matching feeds in one bottom-up pass
+ * @return true if subtree of \a parent contains matching feed
+ *---------------------------------------------------------------------------*/
+bool FeedsProxyModel::findFoldersInSubtree(const QModelIndex &parent) const
+{
+  bool found = false;
+
+  for (int i = 0; i < sourceModel()->rowCount(parent); ++i) {
+    QModelIndex index = sourceModel()->index(i, xmlUrlColumn_, parent);
+    if (!sourceModel()->data(index, Qt::EditRole).toString().isEmpty()) {
+      if (acceptFeed(i, parent))
+        found = true;
+    } else {
+      index = sourceModel()->index(i, idColumn_, parent);
+      if (findFoldersInSubtree(index)) {
+        findFolders_.insert(sourceModel()->data(index, Qt::EditRole).toInt());
+        found = true;
+      }
+    }
+  }
+
+  return found;
+}
+
 QModelIndex FeedsProxyModel::mapFromSource(const QModelIndex & sourceIndex) const
 {
   return QSortFilterProxyModel::mapFromSource(sourceIndex);
@@ -97,23 +184,3 @@ QModelIndex FeedsProxyModel::index(int row, const QString& fieldName, const QMod
   int column = ((FeedsModel*)sourceModel())->indexColumnOf(fieldName);
   return QSortFilterProxyModel::index(row, column, parent);
 }
-
-bool FeedsProxyModel::acceptFolder(const QModelIndex &indexFolder) const
-{
-  QModelIndex index;
-  bool accept = false;
-
-  for (int i = 0; i < sourceModel()->rowCount(indexFolder); ++i) {
-    index = sourceModel()->index(i, ((FeedsModel*)sourceModel())->indexColumnOf("xmlUrl"), indexFolder);
-    if (!sourceModel()->data(index, Qt::EditRole).toString().isEmpty()) {
-      index = sourceModel()->index(i, ((FeedsModel*)sourceModel())->indexColumnOf("text"), indexFolder);
-      accept = sourceModel()->data(index, Qt::EditRole).toString().contains(findText_, Qt::CaseInsensitive);
-    } else {
-      accept = acceptFolder(index);
-    }
-    if (accept)
-      break;
-  }
-
-  return accept;
-}
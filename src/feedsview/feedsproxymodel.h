@@ -2,6 +2,7 @@
 #define FEEDSPROXYMODEL_H
 
 #include <QSortFilterProxyModel>
+#include <QSet>
 
 class FeedsProxyModel : public QSortFilterProxyModel
 {
@@ -11,21 +12,35 @@ public:
   ~FeedsProxyModel();
 
   void reset();
-  void setFilter(const QString &filterAct, const QList<int> &idList,
+  void setSourceModel(QAbstractItemModel *sourceModel);
+  void setFilter(const QString &filterAct, const QSet<int> &idList,
                  const QString &findAct, const QString &findText);
   QModelIndex mapFromSource(const QModelIndex & sourceIndex) const;
   QModelIndex mapFromSource(int id) const;
   QModelIndex index(int row, int column, const QModelIndex & parent = QModelIndex()) const;
   QModelIndex index(int row, const QString &fieldName, const QModelIndex & parent = QModelIndex()) const;
 
+private slots:
+  void slotSourceReset();
+  void slotSourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+
 private:
   bool filterAcceptsRow(int source_row, const QModelIndex &sourceParent) const;
-  bool acceptFolder(const QModelIndex &indexFolder) const;
+  bool acceptFeed(int sourceRow, const QModelIndex &sourceParent) const;
+  bool findFoldersInSubtree(const QModelIndex &parent) const;
   QString filterAct_;
-  QList<int> idList_;
+  QSet<int> idList_;
   QString findAct_;
   QString findText_;
 
+  mutable QSet<int> findFolders_;  // Folders containing feeds that match findText_
+  mutable bool findFoldersValid_;
+  int idColumn_;
+  int textColumn_;
+  int xmlUrlColumn_;
+  int newCountColumn_;
+  int unreadColumn_;
+
 };
 
 #endif // FEEDSPROXYMODEL_H
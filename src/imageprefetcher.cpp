@@ -0,0 +1,457 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include "imageprefetcher.h"
+#include "mainapplication.h"
+#include "globals.h"
+#include "settings.h"
+
+#include <QDebug>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QMultiMap>
+#include <QMutexLocker>
+#include <qzregexp.h>
+
+#define REPLY_MAX_COUNT 4
+#define HOST_REPLY_MAX_COUNT 2
+#define REDIRECT_MAX_COUNT 3
+#define REQUEST_TIMEOUT 60
+#define IMAGE_MAX_SIZE (5 * 1024 * 1024)
+#define INDEX_MAGIC 0x50524631
+#define INDEX_VERSION 1
+
+ImagePrefetcher::ImagePrefetcher(QObject *parent)
+  : QObject(parent)
+  , networkManager_(NULL)
+  , totalSize_(0)
+  , indexChanged_(false)
+{
+  setObjectName("imagePrefetcher_");
+
+  Settings settings;
+  maxSize_ = settings.value("Settings/prefetchImagesMaxSize", 100).toLongLong()*1024*1024;
+  storeDir_ = mainApp->cacheDefaultDir() + "/prefetch";
+  QDir().mkpath(storeDir_);
+
+  getUrlTimer_ = new QTimer(this);
+  getUrlTimer_->setSingleShot(true);
+  getUrlTimer_->setInterval(20);
+  connect(getUrlTimer_, SIGNAL(timeout()), this, SLOT(getQueuedUrl()));
+
+  timeout_ = new QTimer(this);
+  timeout_->setInterval(5000);
+  connect(timeout_, SIGNAL(timeout()), this, SLOT(slotRequestTimeout()));
+
+  saveTimer_ = new QTimer(this);
+  saveTimer_->setInterval(60000);
+  connect(saveTimer_, SIGNAL(timeout()), this, SLOT(saveIndex()));
+  saveTimer_->start();
+
+  loadIndex();
+}
+
+ImagePrefetcher::~ImagePrefetcher()
+{
+  saveIndex();
+}
+
+void ImagePrefetcher::disconnectObjects()
+{
+  disconnect(this);
+  if (networkManager_)
+    networkManager_->disconnect(networkManager_);
+}
+
+/** @brief Find http(s) images of \a html
+ * @return Encoded absolute urls
+ *----------------------------------------------------------------------------*/
+QStringList ImagePrefetcher::imageUrls(const QString &html, const QString &baseUrl)
+{
+  QStringList urls;
+  QUrl base(baseUrl);
+  QzRegExp rx("<img[^>]+src\\s*=\\s*[\"']([^\"']+)[\"']", Qt::CaseInsensitive);
+  int pos = 0;
+  while ((pos = rx.indexIn(html, pos)) != -1) {
+    pos += rx.matchedLength();
+
+    QString src = rx.cap(1).trimmed();
+    src.replace("&amp;", "&");
+    QUrl url = base.resolved(QUrl(src));
+    if ((url.scheme() != "http") && (url.scheme() != "https"))
+      continue;
+
+    QString urlString = QString::fromLatin1(url.toEncoded());
+    if (!urls.contains(urlString))
+      urls.append(urlString);
+  }
+  return urls;
+}
+
+/** @brief Queue images of news not stored yet
+ *----------------------------------------------------------------------------*/
+void ImagePrefetcher::prefetchImages(QString html, QString baseUrl)
+{
+  foreach (const QString &url, imageUrls(html, baseUrl)) {
+    if (queuedUrls_.contains(url))
+      continue;
+    mutex_.lock();
+    bool stored = urlHashes_.contains(url);
+    mutex_.unlock();
+    if (stored)
+      continue;
+
+    queuedUrls_.insert(url);
+    urlsQueue_.enqueue(url);
+  }
+
+  if (!urlsQueue_.isEmpty() && !getUrlTimer_->isActive())
+    getUrlTimer_->start();
+}
+
+/** @brief Start queued requests, hosts get at most HOST_REPLY_MAX_COUNT
+ *----------------------------------------------------------------------------*/
+void ImagePrefetcher::getQueuedUrl()
+{
+  if (!networkManager_) {
+    networkManager_ = new NetworkManager(true, this);
+    connect(networkManager_, SIGNAL(finished(QNetworkReply*)),
+            this, SLOT(finished(QNetworkReply*)));
+  }
+
+  QQueue<QString> waitingQueue;
+  while (!urlsQueue_.isEmpty() && (currentRequests_.count() < REPLY_MAX_COUNT)) {
+    QString url = urlsQueue_.dequeue();
+    QString host = QUrl::fromEncoded(url.toLatin1()).host();
+    if (hostRequests_.value(host) >= HOST_REPLY_MAX_COUNT) {
+      waitingQueue.enqueue(url);
+      continue;
+    }
+
+    QNetworkRequest request(QUrl::fromEncoded(url.toLatin1()));
+    request.setPriority(QNetworkRequest::LowPriority);
+    request.setRawHeader("User-Agent", globals.userAgent().toUtf8());
+
+    QNetworkReply *reply = networkManager_->get(request);
+    reply->setProperty("feedReply", QVariant(true));
+    reply->setProperty("redirects", 0);
+    connect(reply, SIGNAL(downloadProgress(qint64,qint64)),
+            this, SLOT(slotDownloadProgress(qint64,qint64)));
+
+    CurrentRequest currentRequest;
+    currentRequest.url = url;
+    currentRequest.host = host;
+    currentRequest.started = QDateTime::currentDateTime().toMSecsSinceEpoch();
+    currentRequests_.insert(reply, currentRequest);
+    hostRequests_[host]++;
+  }
+
+  waitingQueue.append(urlsQueue_);
+  urlsQueue_ = waitingQueue;
+
+  if (!currentRequests_.isEmpty() && !timeout_->isActive())
+    timeout_->start();
+}
+
+void ImagePrefetcher::finished(QNetworkReply *reply)
+{
+  reply->deleteLater();
+  if (!currentRequests_.contains(reply)) return;
+  CurrentRequest currentRequest = currentRequests_.take(reply);
+
+  QUrl redirectionTarget = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
+  int redirects = reply->property("redirects").toInt();
+  if ((reply->error() == QNetworkReply::NoError) && redirectionTarget.isValid() &&
+      (redirects < REDIRECT_MAX_COUNT)) {
+    // Image is stored by url of news, not by url of redirection
+    QNetworkRequest request(reply->url().resolved(redirectionTarget));
+    request.setPriority(QNetworkRequest::LowPriority);
+    request.setRawHeader("User-Agent", globals.userAgent().toUtf8());
+
+    QNetworkReply *redirectReply = networkManager_->get(request);
+    redirectReply->setProperty("feedReply", QVariant(true));
+    redirectReply->setProperty("redirects", redirects + 1);
+    connect(redirectReply, SIGNAL(downloadProgress(qint64,qint64)),
+            this, SLOT(slotDownloadProgress(qint64,qint64)));
+    currentRequests_.insert(redirectReply, currentRequest);
+    return;
+  }
+
+  hostRequests_[currentRequest.host]--;
+  if (hostRequests_.value(currentRequest.host) <= 0)
+    hostRequests_.remove(currentRequest.host);
+  queuedUrls_.remove(currentRequest.url);
+
+  QByteArray contentType = reply->header(QNetworkRequest::ContentTypeHeader).toByteArray();
+  int httpStatusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  if ((reply->error() == QNetworkReply::NoError) && (httpStatusCode == 200) &&
+      contentType.toLower().startsWith("image/")) {
+    storeImage(currentRequest.url, reply->readAll(), contentType);
+  } else {
+    qDebug() << "Image prefetch failed:" << currentRequest.url << httpStatusCode
+             << reply->errorString();
+  }
+
+  if (currentRequests_.isEmpty())
+    timeout_->stop();
+  if (!urlsQueue_.isEmpty() && !getUrlTimer_->isActive())
+    getUrlTimer_->start();
+}
+
+/** @brief Abort download of too large image
+ *----------------------------------------------------------------------------*/
+void ImagePrefetcher::slotDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
+{
+  if ((bytesReceived > IMAGE_MAX_SIZE) || (bytesTotal > IMAGE_MAX_SIZE)) {
+    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+    if (reply)
+      reply->abort();
+  }
+}
+
+void ImagePrefetcher::slotRequestTimeout()
+{
+  qint64 currentTime = QDateTime::currentDateTime().toMSecsSinceEpoch();
+  QList<QNetworkReply*> replies;
+  QHash<QNetworkReply*, CurrentRequest>::const_iterator it = currentRequests_.constBegin();
+  for (; it != currentRequests_.constEnd(); ++it) {
+    if (currentTime - it.value().started > REQUEST_TIMEOUT * 1000)
+      replies.append(it.key());
+  }
+  foreach (QNetworkReply *reply, replies) {
+    reply->abort();
+  }
+}
+
+/** @brief Save image by hash of its content
+ *----------------------------------------------------------------------------*/
+void ImagePrefetcher::storeImage(const QString &url, const QByteArray &data,
+                                 const QByteArray &contentType)
+{
+  if (data.isEmpty()) return;
+
+  QByteArray hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex();
+
+  mutex_.lock();
+  bool stored = images_.contains(hash);
+  mutex_.unlock();
+
+  if (!stored) {
+    QFile file(filePath(hash));
+    if (!file.open(QIODevice::WriteOnly) || (file.write(data) != data.size())) {
+      qWarning() << "Unable to save image:" << file.fileName();
+      file.remove();
+      return;
+    }
+  }
+
+  QMutexLocker locker(&mutex_);
+  StoredImage &image = images_[hash];
+  if (!stored) {
+    image.contentType = contentType;
+    image.size = data.size();
+    totalSize_ += image.size;
+  }
+  image.accessed = QDateTime::currentDateTime().toMSecsSinceEpoch();
+  urlHashes_.insert(url, hash);
+  indexChanged_ = true;
+
+  if (totalSize_ > maxSize_)
+    evictImages();
+}
+
+/** @brief Remove least recently used images until store takes 90% of its size
+ * @note mutex_ is locked by caller
+ *----------------------------------------------------------------------------*/
+void ImagePrefetcher::evictImages()
+{
+  QMultiMap<qint64, QByteArray> hashes;
+  QHash<QByteArray, StoredImage>::const_iterator it = images_.constBegin();
+  for (; it != images_.constEnd(); ++it) {
+    hashes.insert(it.value().accessed, it.key());
+  }
+
+  QSet<QByteArray> removedHashes;
+  qint64 goal = (maxSize_ * 9) / 10;
+  QMultiMap<qint64, QByteArray>::const_iterator i = hashes.constBegin();
+  for (; (i != hashes.constEnd()) && (totalSize_ > goal); ++i) {
+    QFile::remove(filePath(i.value()));
+    totalSize_ -= images_.take(i.value()).size;
+    removedHashes.insert(i.value());
+  }
+
+  QMutableHashIterator<QString, QByteArray> urlIt(urlHashes_);
+  while (urlIt.hasNext()) {
+    if (removedHashes.contains(urlIt.next().value()))
+      urlIt.remove();
+  }
+}
+
+/** @brief Read stored image of \a url, called from GUI thread
+ *----------------------------------------------------------------------------*/
+bool ImagePrefetcher::localData(const QUrl &url, QByteArray *data, QByteArray *contentType)
+{
+  QString urlString = QString::fromLatin1(url.toEncoded());
+
+  mutex_.lock();
+  QByteArray hash = urlHashes_.value(urlString);
+  QHash<QByteArray, StoredImage>::iterator it = images_.find(hash);
+  if (hash.isEmpty() || (it == images_.end())) {
+    mutex_.unlock();
+    return false;
+  }
+  it.value().accessed = QDateTime::currentDateTime().toMSecsSinceEpoch();
+  *contentType = it.value().contentType;
+  indexChanged_ = true;
+  mutex_.unlock();
+
+  QFile file(filePath(hash));
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+  *data = file.readAll();
+  return true;
+}
+
+/** @brief Answer request of stored image without network, called from GUI thread
+ * @details Stored images are not revalidated, so while network is accessible
+ *   they are used only in offline first mode.
+ * @return NULL if request goes to network
+ *----------------------------------------------------------------------------*/
+QNetworkReply *ImagePrefetcher::localReply(const QNetworkRequest &request,
+                                           bool offlineFirst, bool networkAccessible,
+                                           QObject *parent)
+{
+  if (networkAccessible && !offlineFirst)
+    return NULL;
+
+  QByteArray data;
+  QByteArray contentType;
+  if (!localData(request.url(), &data, &contentType))
+    return NULL;
+  return new PrefetchedImageReply(request, data, contentType, parent);
+}
+
+QString ImagePrefetcher::filePath(const QByteArray &hash) const
+{
+  return storeDir_ + "/" + QString::fromLatin1(hash);
+}
+
+void ImagePrefetcher::loadIndex()
+{
+  QFile file(storeDir_ + "/index.dat");
+  if (!file.open(QIODevice::ReadOnly))
+    return;
+
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_4_6);
+
+  quint32 magic;
+  qint32 version;
+  qint32 count;
+  in >> magic >> version >> count;
+  if ((magic != INDEX_MAGIC) || (version != INDEX_VERSION))
+    return;
+
+  for (int i = 0; (i < count) && (in.status() == QDataStream::Ok); ++i) {
+    QByteArray hash;
+    StoredImage image;
+    in >> hash >> image.contentType >> image.size >> image.accessed;
+    images_.insert(hash, image);
+    totalSize_ += image.size;
+  }
+  in >> urlHashes_;
+
+  if (in.status() != QDataStream::Ok) {
+    qWarning() << "Prefetched images index is broken:" << file.fileName();
+    images_.clear();
+    urlHashes_.clear();
+    totalSize_ = 0;
+  }
+
+  if (totalSize_ > maxSize_)
+    evictImages();
+}
+
+void ImagePrefetcher::saveIndex()
+{
+  QMutexLocker locker(&mutex_);
+  if (!indexChanged_) return;
+  indexChanged_ = false;
+
+  QFile file(storeDir_ + "/index.dat");
+  if (!file.open(QIODevice::WriteOnly)) {
+    qWarning() << "Unable to save prefetched images index:" << file.fileName();
+    return;
+  }
+
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_4_6);
+  out << quint32(INDEX_MAGIC) << qint32(INDEX_VERSION) << qint32(images_.count());
+  QHash<QByteArray, StoredImage>::const_iterator it = images_.constBegin();
+  for (; it != images_.constEnd(); ++it) {
+    out << it.key() << it.value().contentType << it.value().size << it.value().accessed;
+  }
+  out << urlHashes_;
+}
+
+//------------------------------------------------------------------------------
+PrefetchedImageReply::PrefetchedImageReply(const QNetworkRequest &request,
+                                           const QByteArray &data,
+                                           const QByteArray &contentType,
+                                           QObject *parent)
+  : QNetworkReply(parent)
+  , data_(data)
+  , offset_(0)
+{
+  setOperation(QNetworkAccessManager::GetOperation);
+  setRequest(request);
+  setUrl(request.url());
+  setHeader(QNetworkRequest::ContentTypeHeader, contentType);
+  setHeader(QNetworkRequest::ContentLengthHeader, data_.size());
+  setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
+  setAttribute(QNetworkRequest::HttpReasonPhraseAttribute, QByteArray("OK"));
+
+  open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+  QTimer::singleShot(0, this, SLOT(delayedFinished()));
+}
+
+qint64 PrefetchedImageReply::bytesAvailable() const
+{
+  return data_.size() - offset_ + QNetworkReply::bytesAvailable();
+}
+
+qint64 PrefetchedImageReply::readData(char *data, qint64 maxSize)
+{
+  if (offset_ >= data_.size())
+    return -1;
+
+  qint64 size = qMin(maxSize, data_.size() - offset_);
+  memcpy(data, data_.constData() + offset_, size);
+  offset_ += size;
+  return size;
+}
+
+void PrefetchedImageReply::delayedFinished()
+{
+  emit metaDataChanged();
+  emit downloadProgress(data_.size(), data_.size());
+  emit readyRead();
+  emit finished();
+}
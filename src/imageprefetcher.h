@@ -0,0 +1,135 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#ifndef IMAGEPREFETCHER_H
+#define IMAGEPREFETCHER_H
+
+#include <QHash>
+#include <QMutex>
+#include <QNetworkReply>
+#include <QObject>
+#include <QQueue>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+#include "networkmanager.h"
+
+/*! \brief Background download of images of new news for offline reading.
+ *
+ * ParseObject passes HTML of news added to feeds with prefetch enabled.
+ * Images referenced by it are downloaded with low priority, few requests
+ * per host, and stored in directory "prefetch" named by hash of their
+ * content, so equal images are stored once. The least recently used images
+ * are removed when the store exceeds its size.
+ *
+ * NetworkManager of browser is given prefetcher by UpdateFeeds and asks
+ * localReply() from GUI thread. Requests of stored images are answered
+ * without network when it is not accessible or disk cache is in offline
+ * first mode. Stored images are not revalidated.
+ */
+class ImagePrefetcher : public QObject
+{
+  Q_OBJECT
+public:
+  explicit ImagePrefetcher(QObject *parent = 0);
+  ~ImagePrefetcher();
+
+  void disconnectObjects();
+
+  bool localData(const QUrl &url, QByteArray *data, QByteArray *contentType);
+  QNetworkReply *localReply(const QNetworkRequest &request, bool offlineFirst,
+                            bool networkAccessible, QObject *parent);
+
+  static QStringList imageUrls(const QString &html, const QString &baseUrl);
+
+public slots:
+  void prefetchImages(QString html, QString baseUrl);
+
+private slots:
+  void getQueuedUrl();
+  void finished(QNetworkReply *reply);
+  void slotDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
+  void slotRequestTimeout();
+  void saveIndex();
+
+private:
+  struct StoredImage {
+    StoredImage() : size(0), accessed(0) {}
+
+    QByteArray contentType;
+    qint64 size;
+    qint64 accessed;
+  };
+
+  struct CurrentRequest {
+    QString url;
+    QString host;
+    qint64 started;
+  };
+
+  void loadIndex();
+  void storeImage(const QString &url, const QByteArray &data,
+                  const QByteArray &contentType);
+  void evictImages();
+  QString filePath(const QByteArray &hash) const;
+
+  NetworkManager *networkManager_;
+  QTimer *getUrlTimer_;
+  QTimer *timeout_;
+  QTimer *saveTimer_;
+  QString storeDir_;
+  qint64 maxSize_;
+
+  QQueue<QString> urlsQueue_;
+  QSet<QString> queuedUrls_;
+  QHash<QNetworkReply*, CurrentRequest> currentRequests_;
+  QHash<QString, int> hostRequests_;
+
+  // Shared with GUI thread
+  QMutex mutex_;
+  QHash<QString, QByteArray> urlHashes_;     // image url -> content hash
+  QHash<QByteArray, StoredImage> images_;    // content hash -> stored image
+  qint64 totalSize_;
+  bool indexChanged_;
+
+};
+
+/*! \brief Reply with image taken from store of ImagePrefetcher */
+class PrefetchedImageReply : public QNetworkReply
+{
+  Q_OBJECT
+public:
+  PrefetchedImageReply(const QNetworkRequest &request, const QByteArray &data,
+                       const QByteArray &contentType, QObject *parent = 0);
+
+  void abort() {}
+  qint64 bytesAvailable() const;
+
+protected:
+  qint64 readData(char *data, qint64 maxSize);
+
+private slots:
+  void delayedFinished();
+
+private:
+  QByteArray data_;
+  qint64 offset_;
+
+};
+
+#endif // IMAGEPREFETCHER_H
@@ -0,0 +1,218 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include "feedarchive.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QTimer>
+
+#define ARCHIVE_MAGIC 0x46415231
+#define ARCHIVE_VERSION 1
+
+static QDataStream &operator<<(QDataStream &out, const FeedArchive::Response &response)
+{
+  out << qint32(response.error) << response.errorString << qint32(response.statusCode)
+      << response.reasonPhrase << response.rawHeaders << response.body << response.duration;
+  return out;
+}
+
+static QDataStream &operator>>(QDataStream &in, FeedArchive::Response &response)
+{
+  qint32 error;
+  qint32 statusCode;
+  in >> error >> response.errorString >> statusCode
+     >> response.reasonPhrase >> response.rawHeaders >> response.body >> response.duration;
+  response.error = error;
+  response.statusCode = statusCode;
+  return in;
+}
+
+FeedArchive::FeedArchive(Mode mode, const QString &fileName, QObject *parent)
+  : QObject(parent)
+  , mode_(mode)
+  , fileName_(fileName)
+  , realTime_(false)
+  , changed_(false)
+{
+  if (mode_ == ModeReplay)
+    load();
+}
+
+QString FeedArchive::key(QNetworkAccessManager::Operation op, const QUrl &url)
+{
+  return QString("%1 %2").arg(int(op)).arg(QString::fromLatin1(url.toEncoded()));
+}
+
+/** @brief Add finished \a reply to archive
+ * @param body Data of reply, RequestFeed could have read it already
+ * @param duration Time from sending request to its finish in milliseconds
+ *----------------------------------------------------------------------------*/
+void FeedArchive::record(QNetworkReply *reply, const QByteArray &body, qint64 duration)
+{
+  if (mode_ != ModeRecord) return;
+
+  Response response;
+  response.error = reply->error();
+  response.errorString = reply->errorString();
+  response.statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  response.reasonPhrase = reply->attribute(QNetworkRequest::HttpReasonPhraseAttribute).toByteArray();
+  response.rawHeaders = reply->rawHeaderPairs();
+  response.body = body;
+  response.duration = duration;
+
+  responses_[key(reply->operation(), reply->request().url())].append(response);
+  changed_ = true;
+}
+
+/** @brief Write recorded responses, called when update of feeds is finished
+ *----------------------------------------------------------------------------*/
+void FeedArchive::save()
+{
+  if ((mode_ != ModeRecord) || !changed_) return;
+  changed_ = false;
+
+  QFile file(fileName_);
+  if (!file.open(QIODevice::WriteOnly)) {
+    qWarning() << "Unable to save feed archive:" << fileName_;
+    return;
+  }
+
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_4_6);
+  out << quint32(ARCHIVE_MAGIC) << qint32(ARCHIVE_VERSION) << responses_;
+
+  int count = 0;
+  foreach (const QList<Response> &responses, responses_) {
+    count += responses.count();
+  }
+  qDebug() << "Feed archive saved:" << count << "responses";
+}
+
+void FeedArchive::load()
+{
+  QFile file(fileName_);
+  if (!file.open(QIODevice::ReadOnly)) {
+    qWarning() << "Unable to open feed archive:" << fileName_;
+    return;
+  }
+
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_4_6);
+
+  quint32 magic;
+  qint32 version;
+  in >> magic >> version;
+  if ((magic != ARCHIVE_MAGIC) || (version != ARCHIVE_VERSION)) {
+    qWarning() << "Unknown format of feed archive:" << fileName_;
+    return;
+  }
+
+  in >> responses_;
+  if (in.status() != QDataStream::Ok) {
+    qWarning() << "Feed archive is broken:" << fileName_;
+    responses_.clear();
+  }
+}
+
+/** @brief Create reply with archived response to request
+ * @details Reply finishes at once or, in real time mode, after recorded
+ *   duration.
+ *----------------------------------------------------------------------------*/
+QNetworkReply *FeedArchive::replay(QNetworkAccessManager::Operation op,
+                                   const QNetworkRequest &request, QObject *parent)
+{
+  QString requestKey = key(op, request.url());
+  QHash<QString, QList<Response> >::const_iterator it = responses_.constFind(requestKey);
+
+  Response response;
+  if (it == responses_.constEnd() || it.value().isEmpty()) {
+    qDebug() << "Feed archive has no response:" << requestKey;
+    response.error = QNetworkReply::ContentNotFoundError;
+    response.errorString = "Not found in feed archive";
+  } else {
+    int index = replayed_.value(requestKey, 0);
+    response = it.value().at(qMin(index, it.value().count() - 1));
+    replayed_.insert(requestKey, index + 1);
+  }
+
+  int delay = realTime_ ? int(response.duration) : 0;
+  return new FeedArchiveReply(op, request, response, delay, parent);
+}
+
+//------------------------------------------------------------------------------
+FeedArchiveReply::FeedArchiveReply(QNetworkAccessManager::Operation op,
+                                   const QNetworkRequest &request,
+                                   const FeedArchive::Response &response,
+                                   int delay, QObject *parent)
+  : QNetworkReply(parent)
+  , data_(response.body)
+  , offset_(0)
+{
+  setOperation(op);
+  setRequest(request);
+  setUrl(request.url());
+
+  typedef QPair<QByteArray, QByteArray> RawHeader;
+  foreach (const RawHeader &header, response.rawHeaders) {
+    setRawHeader(header.first, header.second);
+  }
+  if (response.statusCode) {
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, response.statusCode);
+    setAttribute(QNetworkRequest::HttpReasonPhraseAttribute, response.reasonPhrase);
+    if ((response.statusCode >= 300) && (response.statusCode < 400) &&
+        hasRawHeader("Location")) {
+      setAttribute(QNetworkRequest::RedirectionTargetAttribute,
+                   QUrl::fromEncoded(rawHeader("Location")));
+    }
+  }
+  if (response.error != QNetworkReply::NoError)
+    setError(QNetworkReply::NetworkError(response.error), response.errorString);
+
+  open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+  QTimer::singleShot(delay, this, SLOT(delayedFinished()));
+}
+
+qint64 FeedArchiveReply::bytesAvailable() const
+{
+  return data_.size() - offset_ + QNetworkReply::bytesAvailable();
+}
+
+qint64 FeedArchiveReply::readData(char *data, qint64 maxSize)
+{
+  if (offset_ >= data_.size())
+    return -1;
+
+  qint64 size = qMin(maxSize, data_.size() - offset_);
+  memcpy(data, data_.constData() + offset_, size);
+  offset_ += size;
+  return size;
+}
+
+void FeedArchiveReply::delayedFinished()
+{
+  emit metaDataChanged();
+  if (error() != QNetworkReply::NoError)
+    emit error(error());
+  if (!data_.isEmpty()) {
+    emit downloadProgress(data_.size(), data_.size());
+    emit readyRead();
+  }
+  emit finished();
+}
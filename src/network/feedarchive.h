@@ -0,0 +1,106 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#ifndef FEEDARCHIVE_H
+#define FEEDARCHIVE_H
+
+#include <QHash>
+#include <QList>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QPair>
+
+/*! \brief Archive of feed responses to repeat update without network.
+ *
+ * In record mode RequestFeed saves every finished reply: status, headers,
+ * body and duration. In replay mode NetworkManager of RequestFeed answers
+ * requests from the archive, so update of feeds runs the same way each time.
+ * Requests missing in archive fail with "Not Found". Responses of the same
+ * request are replayed in recorded order, the last one repeats.
+ *
+ * Mode is set by "Settings/feedArchiveMode" (0 - off, 1 - record,
+ * 2 - replay), archive is "feedarchive.dat" in data directory.
+ */
+class FeedArchive : public QObject
+{
+  Q_OBJECT
+public:
+  enum Mode {
+    ModeOff,
+    ModeRecord,
+    ModeReplay
+  };
+
+  FeedArchive(Mode mode, const QString &fileName, QObject *parent = 0);
+
+  Mode mode() const { return mode_; }
+  void setRealTime(bool realTime) { realTime_ = realTime; }
+
+  void record(QNetworkReply *reply, const QByteArray &body, qint64 duration);
+  void save();
+  QNetworkReply *replay(QNetworkAccessManager::Operation op,
+                        const QNetworkRequest &request, QObject *parent);
+
+  struct Response {
+    Response() : error(0), statusCode(0), duration(0) {}
+
+    int error;
+    QString errorString;
+    int statusCode;
+    QByteArray reasonPhrase;
+    QList<QPair<QByteArray, QByteArray> > rawHeaders;
+    QByteArray body;
+    qint64 duration;
+  };
+
+private:
+  static QString key(QNetworkAccessManager::Operation op, const QUrl &url);
+  void load();
+
+  Mode mode_;
+  QString fileName_;
+  bool realTime_;
+  bool changed_;
+  QHash<QString, QList<Response> > responses_;
+  QHash<QString, int> replayed_;
+
+};
+
+/*! \brief Reply with response taken from FeedArchive */
+class FeedArchiveReply : public QNetworkReply
+{
+  Q_OBJECT
+public:
+  FeedArchiveReply(QNetworkAccessManager::Operation op, const QNetworkRequest &request,
+                   const FeedArchive::Response &response, int delay, QObject *parent = 0);
+
+  void abort() {}
+  qint64 bytesAvailable() const;
+
+protected:
+  qint64 readData(char *data, qint64 maxSize);
+
+private slots:
+  void delayedFinished();
+
+private:
+  QByteArray data_;
+  qint64 offset_;
+
+};
+
+#endif // FEEDARCHIVE_H
@@ -0,0 +1,135 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include "hostthrottle.h"
+
+#include <QDateTime>
+#include <QLocale>
+#include <QNetworkReply>
+
+#define RETRY_DELAY_MIN 500
+#define RETRY_DELAY_MAX 30000
+#define THROTTLE_DELAY_MIN 1000
+#define THROTTLE_DELAY_MAX 300000
+
+HostThrottle::HostThrottle()
+{
+}
+
+/** @brief Delay in milliseconds before repeat number \a count of request
+ *----------------------------------------------------------------------------*/
+int HostThrottle::retryDelay(int count) const
+{
+  int delay = RETRY_DELAY_MIN;
+  for (int i = 1; (i < count) && (delay < RETRY_DELAY_MAX); ++i)
+    delay *= 2;
+
+  return jitter(qMin(delay, RETRY_DELAY_MAX));
+}
+
+/** @brief Throttle \a host after 429 or 503 reply
+ * @param retryAfter Delay in milliseconds from Retry-After header or -1
+ *----------------------------------------------------------------------------*/
+void HostThrottle::throttle(const QString &host, int retryAfter)
+{
+  HostState state = hosts_.value(host);
+  if (!hosts_.contains(host)) {
+    state.level = 0;
+    state.readyTime = 0;
+  }
+
+  int delay = THROTTLE_DELAY_MIN;
+  for (int i = 0; (i < state.level) && (delay < THROTTLE_DELAY_MAX); ++i)
+    delay *= 2;
+  delay = jitter(qMin(delay, THROTTLE_DELAY_MAX));
+
+  if (retryAfter >= 0)
+    delay = qMin(retryAfter, THROTTLE_DELAY_MAX);
+
+  state.level++;
+  state.readyTime = qMax(state.readyTime,
+                         QDateTime::currentDateTime().toMSecsSinceEpoch() + delay);
+  hosts_.insert(host, state);
+}
+
+/** @brief Lower throttle level of \a host after successful reply
+ *----------------------------------------------------------------------------*/
+void HostThrottle::success(const QString &host)
+{
+  QHash<QString, HostState>::iterator it = hosts_.find(host);
+  if (it == hosts_.end()) return;
+
+  it.value().level--;
+  if ((it.value().level <= 0) &&
+      (it.value().readyTime <= QDateTime::currentDateTime().toMSecsSinceEpoch())) {
+    hosts_.erase(it);
+  }
+}
+
+bool HostThrottle::isThrottled(const QString &host) const
+{
+  QHash<QString, HostState>::const_iterator it = hosts_.constFind(host);
+  if (it == hosts_.constEnd()) return false;
+
+  return (it.value().level > 0) ||
+      (it.value().readyTime > QDateTime::currentDateTime().toMSecsSinceEpoch());
+}
+
+/** @brief Time in milliseconds since epoch when \a host can be requested
+ *----------------------------------------------------------------------------*/
+qint64 HostThrottle::readyTime(const QString &host) const
+{
+  return hosts_.value(host).readyTime;
+}
+
+bool HostThrottle::isThrottleReply(QNetworkReply *reply)
+{
+  int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  return (status == 429) || (status == 503) ||
+      reply->errorString().contains("Service Temporarily Unavailable");
+}
+
+/** @brief Parse Retry-After header given in seconds or as HTTP date
+ * @return Delay in milliseconds or -1
+ *----------------------------------------------------------------------------*/
+int HostThrottle::retryAfter(QNetworkReply *reply)
+{
+  QString value = QString::fromLatin1(reply->rawHeader("Retry-After")).trimmed();
+  if (value.isEmpty()) return -1;
+
+  bool ok;
+  int seconds = value.toInt(&ok);
+  if (ok) {
+    return (seconds >= 0) ? qMin(seconds, THROTTLE_DELAY_MAX / 1000) * 1000 : -1;
+  }
+
+  QDateTime date = QLocale(QLocale::C).toDateTime(value, "ddd, dd MMM yyyy hh:mm:ss 'GMT'");
+  if (!date.isValid()) return -1;
+  date.setTimeSpec(Qt::UTC);
+
+  qint64 delay = date.toMSecsSinceEpoch() - QDateTime::currentDateTime().toMSecsSinceEpoch();
+  return int(qBound(qint64(0), delay, qint64(THROTTLE_DELAY_MAX)));
+}
+
+/** @brief Spread delay by +-25% so requests don't come back all at once
+ *----------------------------------------------------------------------------*/
+int HostThrottle::jitter(int delay)
+{
+  int spread = delay / 2;
+  if (spread <= 0) return delay;
+  return delay - spread / 2 + qrand() % spread;
+}
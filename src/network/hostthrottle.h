@@ -0,0 +1,61 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#ifndef HOSTTHROTTLE_H
+#define HOSTTHROTTLE_H
+
+#include <QHash>
+#include <QString>
+
+class QNetworkReply;
+
+/*! \brief Retry delays and throttling of hosts.
+ *
+ * Failed requests are retried after exponentially growing delay with jitter.
+ * Hosts answering 429 or 503 are throttled: they get one request at a time
+ * not earlier than Retry-After or backoff of the host allows. Every
+ * successful reply lowers the throttle level until the host is released.
+ */
+class HostThrottle
+{
+public:
+  HostThrottle();
+
+  int retryDelay(int count) const;
+
+  void throttle(const QString &host, int retryAfter);
+  void success(const QString &host);
+
+  bool isThrottled(const QString &host) const;
+  qint64 readyTime(const QString &host) const;
+
+  static bool isThrottleReply(QNetworkReply *reply);
+  static int retryAfter(QNetworkReply *reply);
+
+private:
+  struct HostState {
+    int level;
+    qint64 readyTime;
+  };
+
+  static int jitter(int delay);
+
+  QHash<QString, HostState> hosts_;
+
+};
+
+#endif // HOSTTHROTTLE_H
@@ -0,0 +1,259 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include "networkdiskcache.h"
+
+#include <QDateTime>
+#include <QDirIterator>
+#include <QMultiMap>
+
+#define CACHE_POSTFIX ".d"
+
+LruDiskCache::LruDiskCache(QObject *parent)
+  : QNetworkDiskCache(parent)
+  , currentSize_(-1)
+{
+}
+
+QIODevice *LruDiskCache::data(const QUrl &url)
+{
+  QIODevice *device = QNetworkDiskCache::data(url);
+  if (device) {
+    accessTimes_.insert(url, QDateTime::currentDateTime().toMSecsSinceEpoch());
+  }
+  return device;
+}
+
+void LruDiskCache::insert(QIODevice *device)
+{
+  // Item header is about 1 KB
+  if (currentSize_ >= 0)
+    currentSize_ += device->size() + 1024;
+  QNetworkDiskCache::insert(device);
+}
+
+bool LruDiskCache::remove(const QUrl &url)
+{
+  accessTimes_.remove(url);
+  return QNetworkDiskCache::remove(url);
+}
+
+void LruDiskCache::clear()
+{
+  accessTimes_.clear();
+  currentSize_ = -1;
+  QNetworkDiskCache::clear();
+}
+
+/** @brief Remove least recently used items if cache is over its size
+ * @details Metadata of files is read only if some items have been read
+ *   since start, otherwise modification times are enough.
+ * @return Size of cache
+ *----------------------------------------------------------------------------*/
+qint64 LruDiskCache::expire()
+{
+  if ((currentSize_ >= 0) && (currentSize_ < maximumCacheSize()))
+    return currentSize_;
+
+  if (cacheDirectory().isEmpty())
+    return 0;
+
+  QMultiMap<qint64, QString> cacheItems;
+  QHash<QString, QUrl> itemUrls;
+  qint64 totalSize = 0;
+  QDirIterator it(cacheDirectory(), QDir::Files | QDir::NoSymLinks,
+                  QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    QString path = QDir::cleanPath(it.next());
+    QFileInfo info = it.fileInfo();
+    if (path.endsWith(CACHE_POSTFIX)) {
+      qint64 accessTime = 0;
+      if (!accessTimes_.isEmpty()) {
+        QUrl url = fileMetaData(path).url();
+        accessTime = accessTimes_.value(url, 0);
+        if (accessTime)
+          itemUrls.insert(path, url);
+      }
+      if (!accessTime)
+        accessTime = info.lastModified().toMSecsSinceEpoch();
+      cacheItems.insert(accessTime, path);
+    }
+    totalSize += info.size();
+  }
+
+  qint64 goal = (maximumCacheSize() * 9) / 10;
+  QMultiMap<qint64, QString>::const_iterator i = cacheItems.constBegin();
+  while ((i != cacheItems.constEnd()) && (totalSize > goal)) {
+    QFile file(i.value());
+    qint64 size = file.size();
+    if (file.remove()) {
+      totalSize -= size;
+      accessTimes_.remove(itemUrls.value(i.value()));
+    }
+    ++i;
+  }
+
+  currentSize_ = totalSize;
+  return currentSize_;
+}
+
+//------------------------------------------------------------------------------
+NetworkDiskCache::NetworkDiskCache(QObject *parent)
+  : QAbstractNetworkCache(parent)
+  , offlineFirst_(false)
+  , hitCount_(0)
+  , storeCount_(0)
+  , bytesSaved_(0)
+{
+  for (int i = 0; i < CacheTypeCount; ++i) {
+    caches_[i] = new LruDiskCache(this);
+  }
+}
+
+void NetworkDiskCache::setCacheDirectory(const QString &cacheDir)
+{
+  caches_[CachePages]->setCacheDirectory(cacheDir + "/pages");
+  caches_[CacheImages]->setCacheDirectory(cacheDir + "/images");
+  caches_[CacheMedia]->setCacheDirectory(cacheDir + "/media");
+}
+
+qint64 NetworkDiskCache::maximumCacheSize(CacheType type) const
+{
+  return caches_[type]->maximumCacheSize();
+}
+
+void NetworkDiskCache::setMaximumCacheSize(CacheType type, qint64 size)
+{
+  caches_[type]->setMaximumCacheSize(size);
+}
+
+QNetworkCacheMetaData NetworkDiskCache::metaData(const QUrl &url)
+{
+  for (int i = 0; i < CacheTypeCount; ++i) {
+    QNetworkCacheMetaData metaData = caches_[i]->metaData(url);
+    if (metaData.isValid())
+      return metaData;
+  }
+  return QNetworkCacheMetaData();
+}
+
+void NetworkDiskCache::updateMetaData(const QNetworkCacheMetaData &metaData)
+{
+  for (int i = 0; i < CacheTypeCount; ++i) {
+    if (caches_[i]->metaData(metaData.url()).isValid()) {
+      caches_[i]->updateMetaData(metaData);
+      return;
+    }
+  }
+}
+
+QIODevice *NetworkDiskCache::data(const QUrl &url)
+{
+  for (int i = 0; i < CacheTypeCount; ++i) {
+    QIODevice *device = caches_[i]->data(url);
+    if (device) {
+      hitCount_++;
+      bytesSaved_ += device->size();
+      return device;
+    }
+  }
+  return 0;
+}
+
+bool NetworkDiskCache::remove(const QUrl &url)
+{
+  bool removed = false;
+  for (int i = 0; i < CacheTypeCount; ++i) {
+    if (caches_[i]->remove(url))
+      removed = true;
+  }
+  return removed;
+}
+
+qint64 NetworkDiskCache::cacheSize() const
+{
+  qint64 size = 0;
+  for (int i = 0; i < CacheTypeCount; ++i) {
+    size += caches_[i]->cacheSize();
+  }
+  return size;
+}
+
+/** @brief Choose cache by content type of response
+ * @details Items larger than quarter of their cache are not saved, they
+ *   would evict most of it.
+ *----------------------------------------------------------------------------*/
+QIODevice *NetworkDiskCache::prepare(const QNetworkCacheMetaData &metaData)
+{
+  QByteArray contentType;
+  qint64 contentLength = -1;
+  foreach (const QNetworkCacheMetaData::RawHeader &header, metaData.rawHeaders()) {
+    QByteArray name = header.first.toLower();
+    if (name == "cache-control") {
+      if (header.second.toLower().contains("no-store"))
+        return 0;
+    } else if (name == "content-type") {
+      contentType = header.second.toLower();
+    } else if (name == "content-length") {
+      contentLength = header.second.toLongLong();
+    }
+  }
+
+  LruDiskCache *cache = caches_[CachePages];
+  if (contentType.startsWith("image/")) {
+    cache = caches_[CacheImages];
+  } else if (contentType.startsWith("audio/") || contentType.startsWith("video/") ||
+             contentType.startsWith("application/octet-stream") ||
+             contentType.startsWith("application/pdf") ||
+             contentType.startsWith("application/zip")) {
+    cache = caches_[CacheMedia];
+  }
+
+  if (contentLength > cache->maximumCacheSize() / 4)
+    return 0;
+
+  QIODevice *device = cache->prepare(metaData);
+  if (device) {
+    preparedDevices_.insert(device, cache);
+    connect(device, SIGNAL(destroyed(QObject*)),
+            this, SLOT(slotDeviceDestroyed(QObject*)));
+    storeCount_++;
+  }
+  return device;
+}
+
+void NetworkDiskCache::insert(QIODevice *device)
+{
+  LruDiskCache *cache = preparedDevices_.take(device);
+  if (cache)
+    cache->insert(device);
+}
+
+/** @brief Forget device of aborted reply
+ *----------------------------------------------------------------------------*/
+void NetworkDiskCache::slotDeviceDestroyed(QObject *device)
+{
+  preparedDevices_.remove(static_cast<QIODevice*>(device));
+}
+
+void NetworkDiskCache::clear()
+{
+  preparedDevices_.clear();
+  for (int i = 0; i < CacheTypeCount; ++i) {
+    caches_[i]->clear();
+  }
+}
@@ -0,0 +1,107 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#ifndef NETWORKDISKCACHE_H
+#define NETWORKDISKCACHE_H
+
+#include <QHash>
+#include <QNetworkDiskCache>
+
+/*! \brief Disk cache removing least recently used items first.
+ *
+ * QNetworkDiskCache expires items in order of their creation. Here reading
+ * an item updates its access time, items not read since start are ordered
+ * by modification time of their files. Access times are kept by URL, file
+ * of item is matched to its URL by metadata stored in the file.
+ */
+class LruDiskCache : public QNetworkDiskCache
+{
+public:
+  explicit LruDiskCache(QObject *parent = 0);
+
+  QIODevice *data(const QUrl &url);
+  void insert(QIODevice *device);
+  bool remove(const QUrl &url);
+  void clear();
+
+protected:
+  qint64 expire();
+
+private:
+  qint64 currentSize_;
+  QHash<QUrl, qint64> accessTimes_;
+
+};
+
+/*! \brief Browser disk cache with separate limits for content types.
+ *
+ * Pages (html, styles, scripts), images and media (enclosures, downloads)
+ * are kept in own LRU caches with own size limits, so large media can't
+ * evict images of read articles. Responses with "Cache-Control: no-store"
+ * are never saved.
+ *
+ * In offline first mode NetworkManager requests cached items without
+ * revalidation, so already viewed articles open without network.
+ */
+class NetworkDiskCache : public QAbstractNetworkCache
+{
+  Q_OBJECT
+public:
+  enum CacheType {
+    CachePages,
+    CacheImages,
+    CacheMedia,
+    CacheTypeCount
+  };
+
+  explicit NetworkDiskCache(QObject *parent = 0);
+
+  void setCacheDirectory(const QString &cacheDir);
+  qint64 maximumCacheSize(CacheType type) const;
+  void setMaximumCacheSize(CacheType type, qint64 size);
+  bool offlineFirst() const { return offlineFirst_; }
+  void setOfflineFirst(bool offlineFirst) { offlineFirst_ = offlineFirst; }
+
+  QNetworkCacheMetaData metaData(const QUrl &url);
+  void updateMetaData(const QNetworkCacheMetaData &metaData);
+  QIODevice *data(const QUrl &url);
+  bool remove(const QUrl &url);
+  qint64 cacheSize() const;
+  QIODevice *prepare(const QNetworkCacheMetaData &metaData);
+  void insert(QIODevice *device);
+
+  int hitCount() const { return hitCount_; }
+  int storeCount() const { return storeCount_; }
+  qint64 bytesSaved() const { return bytesSaved_; }
+
+public slots:
+  void clear();
+
+private slots:
+  void slotDeviceDestroyed(QObject *device);
+
+private:
+  LruDiskCache *caches_[CacheTypeCount];
+  QHash<QIODevice*, LruDiskCache*> preparedDevices_;
+  bool offlineFirst_;
+  int hitCount_;
+  int storeCount_;
+  qint64 bytesSaved_;
+
+};
+
+#endif // NETWORKDISKCACHE_H
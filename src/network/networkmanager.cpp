@@ -25,6 +25,9 @@
 #include "webpage.h"
 #include "sslerrordialog.h"
 #include "cabundleupdater.h"
+#include "networkdiskcache.h"
+#include "feedarchive.h"
+#include "imageprefetcher.h"
 
 #include <QNetworkReply>
 #include <QSslConfiguration>
@@ -49,6 +52,8 @@ NetworkManager::NetworkManager(bool isThread, QObject* parent)
   : QNetworkAccessManager(parent)
   , ignoreAllWarnings_(false)
   , adblockManager_(0)
+  , feedArchive_(0)
+  , imagePrefetcher_(0)
 {
   setCookieJar(mainApp->cookieJar());
   // CookieJar is shared between NetworkManagers
@@ -305,6 +310,11 @@ QNetworkReply *NetworkManager::createRequest(QNetworkAccessManager::Operation op
                                              const QNetworkRequest &request,
                                              QIODevice *outgoingData)
 {
+  // Update of feeds replayed from archive
+  if (feedArchive_ && (feedArchive_->mode() == FeedArchive::ModeReplay)) {
+    return feedArchive_->replay(op, request, this);
+  }
+
   if (mainApp->networkManager() == this) {
     QNetworkReply *reply = 0;
 
@@ -318,6 +328,28 @@ QNetworkReply *NetworkManager::createRequest(QNetworkAccessManager::Operation op
       if (reply) {
         return reply;
       }
+
+      NetworkDiskCache *diskCache = qobject_cast<NetworkDiskCache*>(cache());
+      bool offlineFirst = diskCache && diskCache->offlineFirst();
+
+      // Images prefetched for offline reading
+      if (imagePrefetcher_) {
+        reply = imagePrefetcher_->localReply(
+              request, offlineFirst,
+              networkAccessible() != QNetworkAccessManager::NotAccessible, this);
+        if (reply) {
+          return reply;
+        }
+      }
+
+      // Offline first: viewed pages are taken from cache without revalidation
+      if (offlineFirst &&
+          !request.attribute(QNetworkRequest::CacheLoadControlAttribute).isValid()) {
+        QNetworkRequest cacheRequest(request);
+        cacheRequest.setAttribute(QNetworkRequest::CacheLoadControlAttribute,
+                                  QNetworkRequest::PreferCache);
+        return QNetworkAccessManager::createRequest(op, cacheRequest, outgoingData);
+      }
     }
   }
 
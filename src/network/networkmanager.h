@@ -23,6 +23,8 @@
 #include <QStringList>
 
 class AdBlockManager;
+class FeedArchive;
+class ImagePrefetcher;
 
 class NetworkManager : public QNetworkAccessManager
 {
@@ -37,6 +39,8 @@ public:
 
   void loadSettings();
   void loadCertificates();
+  void setFeedArchive(FeedArchive *feedArchive) { feedArchive_ = feedArchive; }
+  void setImagePrefetcher(ImagePrefetcher *imagePrefetcher) { imagePrefetcher_ = imagePrefetcher; }
 
 private slots:
   void slotAuthentication(QNetworkReply *reply, QAuthenticator *auth);
@@ -57,6 +61,8 @@ private:
   QList<QSslCertificate> rejectedSslCerts_;
 
   AdBlockManager *adblockManager_;
+  FeedArchive *feedArchive_;
+  ImagePrefetcher *imagePrefetcher_;
 
 };
 
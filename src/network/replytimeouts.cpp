@@ -0,0 +1,142 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include "replytimeouts.h"
+
+#include <QDateTime>
+#include <QNetworkReply>
+#include <QTimer>
+
+ReplyTimeouts::ReplyTimeouts(QObject *parent)
+  : QObject(parent)
+  , connectTimeout_(15000)
+  , firstByteTimeout_(15000)
+  , transferTimeout_(15000)
+{
+  timer_ = new QTimer(this);
+  timer_->setSingleShot(true);
+  connect(timer_, SIGNAL(timeout()), this, SLOT(slotTimeout()));
+}
+
+/** @brief Set timeouts of stages in milliseconds
+ *----------------------------------------------------------------------------*/
+void ReplyTimeouts::setTimeouts(int connectTimeout, int firstByteTimeout,
+                                int transferTimeout)
+{
+  connectTimeout_ = connectTimeout;
+  firstByteTimeout_ = firstByteTimeout;
+  transferTimeout_ = transferTimeout;
+}
+
+/** @brief Start connect stage of just sent \a reply
+ *----------------------------------------------------------------------------*/
+void ReplyTimeouts::addReply(QNetworkReply *reply)
+{
+  int timeout = connectTimeout_ + firstByteTimeout_;
+#if QT_VERSION >= 0x050100
+  if (reply->url().scheme() == "https") {
+    timeout = connectTimeout_;
+    connect(reply, SIGNAL(encrypted()), this, SLOT(slotReplyConnected()));
+  }
+#endif
+  connect(reply, SIGNAL(metaDataChanged()), this, SLOT(slotReplyResponded()));
+  connect(reply, SIGNAL(readyRead()), this, SLOT(slotReplyResponded()));
+
+  setDeadline(reply, StageConnect, timeout);
+}
+
+void ReplyTimeouts::removeReply(QNetworkReply *reply)
+{
+  QHash<QNetworkReply*, ReplyState>::iterator it = replies_.find(reply);
+  if (it == replies_.end()) return;
+
+  deadlines_.remove(it.value().deadline, reply);
+  replies_.erase(it);
+  disconnect(reply, 0, this, 0);
+
+  startTimer();
+}
+
+ReplyTimeouts::Stage ReplyTimeouts::stage(QNetworkReply *reply) const
+{
+  QHash<QNetworkReply*, ReplyState>::const_iterator it = replies_.constFind(reply);
+  if (it == replies_.constEnd()) return StageConnect;
+
+  return it.value().stage;
+}
+
+void ReplyTimeouts::slotReplyConnected()
+{
+  QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+  if (replies_.contains(reply) && (stage(reply) < StageFirstByte))
+    setDeadline(reply, StageFirstByte, firstByteTimeout_);
+}
+
+void ReplyTimeouts::slotReplyResponded()
+{
+  QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+  if (replies_.contains(reply) && (stage(reply) < StageTransfer))
+    setDeadline(reply, StageTransfer, transferTimeout_);
+}
+
+/** @brief Move \a reply to \a stage which ends in \a timeout milliseconds
+ *----------------------------------------------------------------------------*/
+void ReplyTimeouts::setDeadline(QNetworkReply *reply, Stage stage, int timeout)
+{
+  QHash<QNetworkReply*, ReplyState>::iterator it = replies_.find(reply);
+  if (it != replies_.end()) {
+    deadlines_.remove(it.value().deadline, reply);
+  } else {
+    it = replies_.insert(reply, ReplyState());
+  }
+
+  it.value().stage = stage;
+  it.value().deadline = QDateTime::currentDateTime().toMSecsSinceEpoch() + timeout;
+  deadlines_.insert(it.value().deadline, reply);
+
+  startTimer();
+}
+
+void ReplyTimeouts::startTimer()
+{
+  if (deadlines_.isEmpty()) {
+    timer_->stop();
+    return;
+  }
+
+  qint64 delay = deadlines_.begin().key() - QDateTime::currentDateTime().toMSecsSinceEpoch();
+  timer_->start(int(qMax(qint64(0), delay)));
+}
+
+/** @brief Report replies which deadlines have passed, they are not watched
+ *   anymore
+ *----------------------------------------------------------------------------*/
+void ReplyTimeouts::slotTimeout()
+{
+  qint64 currentTime = QDateTime::currentDateTime().toMSecsSinceEpoch();
+
+  while (!deadlines_.isEmpty() && (deadlines_.begin().key() <= currentTime)) {
+    QNetworkReply *reply = deadlines_.begin().value();
+    deadlines_.erase(deadlines_.begin());
+
+    Stage stage = replies_.take(reply).stage;
+    disconnect(reply, 0, this, 0);
+    emit timeout(reply, stage);
+  }
+
+  startTimer();
+}
@@ -0,0 +1,82 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#ifndef REPLYTIMEOUTS_H
+#define REPLYTIMEOUTS_H
+
+#include <QHash>
+#include <QMultiMap>
+#include <QObject>
+
+class QNetworkReply;
+class QTimer;
+
+/*! \brief Timeouts of network replies by stages of request.
+ *
+ * Each stage gets its own timeout counted from the moment the stage begins:
+ * connecting ends with TLS handshake, waiting for first byte ends with first
+ * response from server and transfer ends with finished reply. Plain HTTP
+ * and Qt 4 replies don't report end of connecting, so their first stage
+ * gets both connect and first byte timeouts. Deadlines are kept sorted, one
+ * single-shot timer waits for the earliest of them.
+ */
+class ReplyTimeouts : public QObject
+{
+  Q_OBJECT
+public:
+  enum Stage {
+    StageConnect,
+    StageFirstByte,
+    StageTransfer
+  };
+
+  explicit ReplyTimeouts(QObject *parent = 0);
+
+  void setTimeouts(int connectTimeout, int firstByteTimeout, int transferTimeout);
+
+  void addReply(QNetworkReply *reply);
+  void removeReply(QNetworkReply *reply);
+  Stage stage(QNetworkReply *reply) const;
+
+signals:
+  void timeout(QNetworkReply *reply, int stage);
+
+private slots:
+  void slotReplyConnected();
+  void slotReplyResponded();
+  void slotTimeout();
+
+private:
+  struct ReplyState {
+    Stage stage;
+    qint64 deadline;
+  };
+
+  void setDeadline(QNetworkReply *reply, Stage stage, int timeout);
+  void startTimer();
+
+  int connectTimeout_;
+  int firstByteTimeout_;
+  int transferTimeout_;
+  QTimer *timer_;
+
+  QHash<QNetworkReply*, ReplyState> replies_;
+  QMultiMap<qint64, QNetworkReply*> deadlines_;
+
+};
+
+#endif // REPLYTIMEOUTS_H
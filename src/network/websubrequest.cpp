@@ -0,0 +1,192 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include "websubrequest.h"
+
+#include <QUrl>
+
+#define HEADER_MAX_SIZE (64 * 1024)
+#define CONTENT_MAX_SIZE (10 * 1024 * 1024)
+
+WebSubRequest::WebSubRequest()
+  : headerSize_(-1)
+  , contentLength_(0)
+{
+}
+
+/** @brief Add received \a data to request
+ * @return 0 while request is incomplete, 200 when it is complete or
+ *   status code of error response
+ *----------------------------------------------------------------------------*/
+int WebSubRequest::append(const QByteArray &data)
+{
+  data_.append(data);
+
+  if (headerSize_ < 0) {
+    int pos = data_.indexOf("\r\n\r\n");
+    if (pos < 0) {
+      if (data_.size() > HEADER_MAX_SIZE)
+        return 431;
+      return 0;
+    }
+    headerSize_ = pos + 4;
+    if (!parseHeader())
+      return 400;
+    if (contentLength_ > CONTENT_MAX_SIZE)
+      return 413;
+  }
+
+  if (data_.size() - headerSize_ < contentLength_)
+    return 0;
+  return 200;
+}
+
+bool WebSubRequest::parseHeader()
+{
+  QList<QByteArray> lines = data_.left(headerSize_ - 4).split('\n');
+  QList<QByteArray> requestLine = lines.takeFirst().trimmed().split(' ');
+  if ((requestLine.count() != 3) || !requestLine.at(2).startsWith("HTTP/"))
+    return false;
+
+  method_ = QString::fromLatin1(requestLine.at(0));
+  QString target = QString::fromLatin1(requestLine.at(1));
+  int pos = target.indexOf('?');
+  path_ = target.left(pos);
+  if (pos > -1)
+    query_ = target.mid(pos + 1);
+
+  foreach (const QByteArray &line, lines) {
+    int pos = line.indexOf(':');
+    if (pos < 1) return false;
+    headers_.insert(line.left(pos).trimmed().toLower(),
+                    line.mid(pos + 1).trimmed());
+  }
+
+  bool ok = true;
+  if (headers_.contains("content-length"))
+    contentLength_ = headers_.value("content-length").toInt(&ok);
+  return ok && (contentLength_ >= 0);
+}
+
+QByteArray WebSubRequest::content() const
+{
+  return data_.mid(headerSize_, contentLength_);
+}
+
+/** @brief Charset of content taken from its Content-Type
+ *----------------------------------------------------------------------------*/
+QString WebSubRequest::codecName() const
+{
+  QString codecName;
+  QString contentType = QString::fromLatin1(headers_.value("content-type"));
+  int pos = contentType.indexOf("charset=", 0, Qt::CaseInsensitive);
+  if (pos > -1) {
+    codecName = contentType.mid(pos + 8).section(';', 0, 0).trimmed();
+    codecName.remove('"');
+  }
+  return codecName;
+}
+
+/** @brief Check content is signed with \a secret
+ * @details X-Hub-Signature is "<method>=<hex HMAC of content>", SHA-1 and
+ *   with Qt5 also SHA-2 methods are accepted.
+ *----------------------------------------------------------------------------*/
+bool WebSubRequest::verifySignature(const QString &secret) const
+{
+  if (secret.isEmpty()) return false;
+
+  QByteArray signature = headers_.value("x-hub-signature");
+  int pos = signature.indexOf('=');
+  if (pos < 0) return false;
+
+  QByteArray method = signature.left(pos);
+  QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha1;
+  if (method == "sha1") {
+    algorithm = QCryptographicHash::Sha1;
+#ifdef HAVE_QT5
+  } else if (method == "sha256") {
+    algorithm = QCryptographicHash::Sha256;
+  } else if (method == "sha384") {
+    algorithm = QCryptographicHash::Sha384;
+  } else if (method == "sha512") {
+    algorithm = QCryptographicHash::Sha512;
+#endif
+  } else {
+    return false;
+  }
+
+  return isEqual(signature.mid(pos + 1).toLower(),
+                 hmac(algorithm, secret.toUtf8(), content()).toHex());
+}
+
+/** @brief Split query "a=1&b=2" into decoded names and values
+ *----------------------------------------------------------------------------*/
+QHash<QString, QString> WebSubRequest::parseQuery(const QString &query)
+{
+  QHash<QString, QString> params;
+  foreach (QString item, query.split('&', QString::SkipEmptyParts)) {
+    item.replace('+', ' ');
+    int pos = item.indexOf('=');
+    QString name = QUrl::fromPercentEncoding(item.left(pos).toLatin1());
+    QString value;
+    if (pos > -1)
+      value = QUrl::fromPercentEncoding(item.mid(pos + 1).toLatin1());
+    params.insert(name, value);
+  }
+  return params;
+}
+
+/** @brief HMAC of \a message (RFC 2104)
+ *----------------------------------------------------------------------------*/
+QByteArray WebSubRequest::hmac(QCryptographicHash::Algorithm algorithm,
+                               const QByteArray &key, const QByteArray &message)
+{
+  int blockSize = 64;
+#ifdef HAVE_QT5
+  if ((algorithm == QCryptographicHash::Sha384) ||
+      (algorithm == QCryptographicHash::Sha512)) {
+    blockSize = 128;
+  }
+#endif
+
+  QByteArray blockKey = key;
+  if (blockKey.size() > blockSize)
+    blockKey = QCryptographicHash::hash(blockKey, algorithm);
+  blockKey.append(QByteArray(blockSize - blockKey.size(), '\0'));
+
+  QByteArray innerKey(blockSize, '\0');
+  QByteArray outerKey(blockSize, '\0');
+  for (int i = 0; i < blockSize; ++i) {
+    innerKey[i] = blockKey.at(i) ^ 0x36;
+    outerKey[i] = blockKey.at(i) ^ 0x5c;
+  }
+
+  QByteArray innerHash = QCryptographicHash::hash(innerKey + message, algorithm);
+  return QCryptographicHash::hash(outerKey + innerHash, algorithm);
+}
+
+/** @brief Compare signatures in time not depending on their common prefix
+ *----------------------------------------------------------------------------*/
+bool WebSubRequest::isEqual(const QByteArray &first, const QByteArray &second)
+{
+  if (first.size() != second.size()) return false;
+
+  char diff = 0;
+  for (int i = 0; i < first.size(); ++i)
+    diff |= first.at(i) ^ second.at(i);
+  return diff == 0;
+}
@@ -0,0 +1,65 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#ifndef WEBSUBREQUEST_H
+#define WEBSUBREQUEST_H
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QHash>
+#include <QString>
+
+/*! \brief HTTP request received by WebSub callback server.
+ *
+ * Data is appended as it arrives, header is parsed as soon as it is
+ * complete. Content pushed by hub is checked with its X-Hub-Signature.
+ */
+class WebSubRequest
+{
+public:
+  WebSubRequest();
+
+  int append(const QByteArray &data);
+
+  QString method() const { return method_; }
+  QString path() const { return path_; }
+  QString query() const { return query_; }
+  bool hasHeader(const QByteArray &name) const { return headers_.contains(name); }
+  QByteArray header(const QByteArray &name) const { return headers_.value(name); }
+  QByteArray content() const;
+  QString codecName() const;
+  bool verifySignature(const QString &secret) const;
+
+  static QHash<QString, QString> parseQuery(const QString &query);
+  static QByteArray hmac(QCryptographicHash::Algorithm algorithm,
+                         const QByteArray &key, const QByteArray &message);
+  static bool isEqual(const QByteArray &first, const QByteArray &second);
+
+private:
+  bool parseHeader();
+
+  QByteArray data_;
+  int headerSize_;
+  int contentLength_;
+  QString method_;
+  QString path_;
+  QString query_;
+  QHash<QByteArray, QByteArray> headers_;
+
+};
+
+#endif // WEBSUBREQUEST_H
@@ -0,0 +1,505 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include "websubserver.h"
+#include "database.h"
+#include "globals.h"
+
+#include <QDebug>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUuid>
+
+#define LEASE_SECONDS (7 * 24 * 3600)
+#define RENEW_BEFORE (3600 * qint64(1000))
+#define PENDING_TIMEOUT (10 * 60 * qint64(1000))
+#define RETRY_INTERVAL (3600 * qint64(1000))
+#define NOTIFY_INTERVAL (60 * qint64(1000))
+#define SOCKET_TIMEOUT 30000
+
+static QString toDateString(const QDateTime &dateTime)
+{
+  return QLocale::c().toString(dateTime.toUTC(), "yyyy-MM-ddTHH:mm:ss");
+}
+
+WebSubServer::WebSubServer(const QString &address, int port,
+                           const QString &callbackUrl, QObject *parent)
+  : QObject(parent)
+  , address_(QHostAddress::LocalHost)
+  , port_(port)
+  , callbackUrl_(callbackUrl)
+  , server_(NULL)
+  , networkManager_(NULL)
+{
+  setObjectName("webSubServer_");
+
+  while (callbackUrl_.endsWith('/'))
+    callbackUrl_.chop(1);
+  if (!address.isEmpty() && !address_.setAddress(address))
+    qWarning() << "WebSub: invalid listening address" << address;
+
+  db_ = Database::connection("secondConnection");
+
+  leaseTimer_ = new QTimer(this);
+  leaseTimer_->setInterval(60000);
+  connect(leaseTimer_, SIGNAL(timeout()), this, SLOT(slotCheckLeases()));
+}
+
+WebSubServer::~WebSubServer()
+{
+}
+
+void WebSubServer::disconnectObjects()
+{
+  disconnect(this);
+  if (networkManager_)
+    networkManager_->disconnect(networkManager_);
+}
+
+/** @brief Condition of feeds to update by timer
+ * @details Feeds with active lease are polled only if nothing has been
+ *   received for \a pollInterval seconds.
+ *----------------------------------------------------------------------------*/
+QString WebSubServer::pollCondition(int pollInterval)
+{
+  QDateTime now = QDateTime::currentDateTimeUtc();
+  return QString("(id NOT IN (SELECT feedId FROM feeds_ex "
+                 "WHERE name='websubLease' AND value>'%1') "
+                 "OR updated IS NULL OR updated<'%2')").
+      arg(toDateString(now)).arg(toDateString(now.addSecs(-pollInterval)));
+}
+
+/** @brief Start listening in thread of object
+ *----------------------------------------------------------------------------*/
+void WebSubServer::start()
+{
+  networkManager_ = new NetworkManager(true, this);
+  connect(networkManager_, SIGNAL(finished(QNetworkReply*)),
+          this, SLOT(finished(QNetworkReply*)));
+
+  server_ = new QTcpServer(this);
+  connect(server_, SIGNAL(newConnection()), this, SLOT(slotNewConnection()));
+  if (!server_->listen(address_, port_)) {
+    qWarning() << "WebSub: listening on" << address_.toString() << "port" << port_
+               << "failed:" << server_->errorString();
+    return;
+  }
+  qDebug() << "WebSub: listening on" << server_->serverAddress().toString()
+           << "port" << server_->serverPort();
+
+  loadSubscriptions();
+  slotCheckLeases();
+  leaseTimer_->start();
+}
+
+/** @brief Subscribe feed \a feedId to hub found in it
+ * @details Feed is subscribed again only if hub or topic have changed, or
+ *   previous subscription has failed more than RETRY_INTERVAL ago.
+ *----------------------------------------------------------------------------*/
+void WebSubServer::slotHubFound(int feedId, QString hubUrl, QString topicUrl)
+{
+  if (!server_ || !server_->isListening() || callbackUrl_.isEmpty())
+    return;
+
+  qint64 currentTime = QDateTime::currentDateTime().toMSecsSinceEpoch();
+  Subscription &subscription = subscriptions_[feedId];
+  if ((subscription.hub == hubUrl) && (subscription.topic == topicUrl)) {
+    if (subscription.state != StateNone) return;
+    if (currentTime - subscription.requested < RETRY_INTERVAL) return;
+  }
+
+  subscription.hub = hubUrl;
+  subscription.topic = topicUrl;
+  subscription.state = StateNone;
+  subscription.leaseEnd = 0;
+  subscribe(feedId, "subscribe");
+  saveSubscription(feedId);
+}
+
+void WebSubServer::loadSubscriptions()
+{
+  qint64 currentTime = QDateTime::currentDateTime().toMSecsSinceEpoch();
+
+  QSqlQuery q(db_);
+  q.exec("SELECT feedId, name, value FROM feeds_ex WHERE name LIKE 'websub%'");
+  while (q.next()) {
+    Subscription &subscription = subscriptions_[q.value(0).toInt()];
+    QString name = q.value(1).toString();
+    if (name == "websubHub") {
+      subscription.hub = q.value(2).toString();
+    } else if (name == "websubTopic") {
+      subscription.topic = q.value(2).toString();
+    } else if (name == "websubSecret") {
+      subscription.secret = q.value(2).toString();
+    } else if (name == "websubLease") {
+      QDateTime leaseEnd = QDateTime::fromString(q.value(2).toString(), Qt::ISODate);
+      leaseEnd.setTimeSpec(Qt::UTC);
+      subscription.leaseEnd = leaseEnd.toMSecsSinceEpoch();
+      if (subscription.leaseEnd > currentTime)
+        subscription.state = StateActive;
+    }
+  }
+  qDebug() << "WebSub: subscriptions loaded" << subscriptions_.count();
+}
+
+/** @brief Save subscription of feed, lease is saved only while it is active
+ *----------------------------------------------------------------------------*/
+void WebSubServer::saveSubscription(int feedId)
+{
+  QSqlQuery q(db_);
+  q.prepare("DELETE FROM feeds_ex WHERE feedId=? AND name LIKE 'websub%'");
+  q.addBindValue(feedId);
+  q.exec();
+
+  if (!subscriptions_.contains(feedId)) return;
+  const Subscription &subscription = subscriptions_[feedId];
+
+  QVariantList feedIds;
+  QVariantList names;
+  QVariantList values;
+  feedIds << feedId << feedId << feedId;
+  names << "websubHub" << "websubTopic" << "websubSecret";
+  values << subscription.hub << subscription.topic << subscription.secret;
+  if (subscription.state == StateActive) {
+    feedIds << feedId;
+    names << "websubLease";
+    values << toDateString(QDateTime::fromMSecsSinceEpoch(subscription.leaseEnd));
+  }
+
+  q.prepare("INSERT INTO feeds_ex(feedId, name, value) VALUES (?, ?, ?)");
+  q.addBindValue(feedIds);
+  q.addBindValue(names);
+  q.addBindValue(values);
+  if (!q.execBatch()) {
+    qCritical() << __PRETTY_FUNCTION__ << __LINE__
+                << "q.lastError(): " << q.lastError().text();
+  }
+}
+
+/** @brief Send subscription request of \a mode to hub of feed \a feedId
+ * @details Secret for content signature is sent only to hubs over HTTPS.
+ *----------------------------------------------------------------------------*/
+void WebSubServer::subscribe(int feedId, const QString &mode)
+{
+  Subscription &subscription = subscriptions_[feedId];
+  QUrl hubUrl(subscription.hub);
+
+  if (mode == "subscribe") {
+    if (hubUrl.scheme() != "https")
+      subscription.secret.clear();
+    else if (subscription.secret.isEmpty())
+      subscription.secret = QCryptographicHash::hash(QUuid::createUuid().toString().toLatin1(),
+                                                     QCryptographicHash::Sha1).toHex();
+    if (subscription.state == StateNone)
+      subscription.state = StatePending;
+  } else {
+    subscription.state = StateUnsubscribing;
+  }
+  subscription.requested = QDateTime::currentDateTime().toMSecsSinceEpoch();
+
+  QString callbackUrl = QString("%1/websub/%2").arg(callbackUrl_).arg(feedId);
+  QByteArray data;
+  data.append("hub.callback=" + QUrl::toPercentEncoding(callbackUrl));
+  data.append("&hub.mode=" + QUrl::toPercentEncoding(mode));
+  data.append("&hub.topic=" + QUrl::toPercentEncoding(subscription.topic));
+  if (mode == "subscribe") {
+    data.append("&hub.lease_seconds=" + QByteArray::number(LEASE_SECONDS));
+    if (!subscription.secret.isEmpty())
+      data.append("&hub.secret=" + QUrl::toPercentEncoding(subscription.secret));
+  }
+
+  QNetworkRequest request(hubUrl);
+  request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
+  request.setRawHeader("User-Agent", globals.userAgent().toUtf8());
+
+  qDebug() << "WebSub:" << mode << subscription.topic << "at" << subscription.hub;
+  QNetworkReply *reply = networkManager_->post(request, data);
+  replies_.insert(reply, feedId);
+}
+
+/** @brief Process hub reply to subscription request
+ * @details Hub accepts request with 202 and verifies it later.
+ *----------------------------------------------------------------------------*/
+void WebSubServer::finished(QNetworkReply *reply)
+{
+  reply->deleteLater();
+  if (!replies_.contains(reply)) return;
+  int feedId = replies_.take(reply);
+
+  int httpStatusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  if ((reply->error() == QNetworkReply::NoError) &&
+      (httpStatusCode >= 200) && (httpStatusCode < 300)) {
+    return;
+  }
+
+  qWarning() << "WebSub: hub request failed:" << feedId << httpStatusCode
+             << reply->errorString() << reply->readAll().left(200);
+
+  if (!subscriptions_.contains(feedId)) return;
+  Subscription &subscription = subscriptions_[feedId];
+  if (subscription.state == StatePending)
+    subscription.state = StateNone;
+}
+
+/** @brief Renew leases before they end and drop expired ones
+ *----------------------------------------------------------------------------*/
+void WebSubServer::slotCheckLeases()
+{
+  qint64 currentTime = QDateTime::currentDateTime().toMSecsSinceEpoch();
+
+  QSet<int> feedIds;
+  QSqlQuery q(db_);
+  q.exec("SELECT id FROM feeds WHERE xmlUrl!='' AND disableUpdate=0");
+  while (q.next()) {
+    feedIds.insert(q.value(0).toInt());
+  }
+
+  QList<int> removeIds;
+  QHash<int, Subscription>::iterator it = subscriptions_.begin();
+  for (; it != subscriptions_.end(); ++it) {
+    int feedId = it.key();
+    Subscription &subscription = it.value();
+
+    if (!feedIds.contains(feedId)) {
+      // Feed is deleted or its updates are disabled
+      if (subscription.state == StateActive) {
+        subscribe(feedId, "unsubscribe");
+      } else if ((subscription.state != StateUnsubscribing) ||
+                 (currentTime - subscription.requested > PENDING_TIMEOUT)) {
+        removeIds.append(feedId);
+      }
+      continue;
+    }
+
+    switch (subscription.state) {
+    case StatePending:
+      if (currentTime - subscription.requested > PENDING_TIMEOUT) {
+        qWarning() << "WebSub: subscription is not verified:" << subscription.topic;
+        subscription.state = StateNone;
+      }
+      break;
+    case StateActive:
+      if (subscription.leaseEnd <= currentTime) {
+        qDebug() << "WebSub: lease expired:" << subscription.topic;
+        subscription.state = StateNone;
+        saveSubscription(feedId);
+      } else if ((subscription.leaseEnd - currentTime < RENEW_BEFORE) &&
+                 (currentTime - subscription.requested > PENDING_TIMEOUT)) {
+        subscribe(feedId, "subscribe");
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  foreach (int feedId, removeIds) {
+    subscriptions_.remove(feedId);
+    saveSubscription(feedId);
+  }
+}
+
+void WebSubServer::slotNewConnection()
+{
+  while (server_->hasPendingConnections()) {
+    QTcpSocket *socket = server_->nextPendingConnection();
+    connect(socket, SIGNAL(readyRead()), this, SLOT(slotReadyRead()));
+    connect(socket, SIGNAL(disconnected()), this, SLOT(slotDisconnected()));
+
+    QTimer *timer = new QTimer(socket);
+    timer->setSingleShot(true);
+    connect(timer, SIGNAL(timeout()), this, SLOT(slotSocketTimeout()));
+    timer->start(SOCKET_TIMEOUT);
+
+    requests_.insert(socket, WebSubRequest());
+  }
+}
+
+/** @brief Read request, process it as soon as its content is complete
+ *----------------------------------------------------------------------------*/
+void WebSubServer::slotReadyRead()
+{
+  QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+  if (!socket || !requests_.contains(socket)) return;
+
+  int code = requests_[socket].append(socket->readAll());
+  if (code == 0) return;
+  if (code != 200) {
+    sendResponse(socket, code);
+    return;
+  }
+
+  WebSubRequest request = requests_.take(socket);
+  processRequest(socket, request);
+}
+
+void WebSubServer::slotDisconnected()
+{
+  QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+  if (!socket) return;
+
+  requests_.remove(socket);
+  socket->deleteLater();
+}
+
+void WebSubServer::slotSocketTimeout()
+{
+  QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender()->parent());
+  if (socket)
+    socket->abort();
+}
+
+/** @brief Process request to callback "/websub/<feed id>"
+ *----------------------------------------------------------------------------*/
+void WebSubServer::processRequest(QTcpSocket *socket, const WebSubRequest &request)
+{
+  int pos = request.path().lastIndexOf("/websub/");
+  bool ok = false;
+  int feedId = 0;
+  if (pos > -1)
+    feedId = request.path().mid(pos + 8).toInt(&ok);
+  if (!ok) {
+    sendResponse(socket, 404);
+    return;
+  }
+
+  if (request.method() == "GET") {
+    QByteArray challenge;
+    int code = verifyIntent(feedId, request.query(), &challenge);
+    sendResponse(socket, code, challenge);
+  } else if (request.method() == "POST") {
+    if (request.hasHeader("transfer-encoding")) {
+      sendResponse(socket, 411);
+      return;
+    }
+    sendResponse(socket, receiveContent(feedId, request));
+  } else {
+    sendResponse(socket, 405);
+  }
+}
+
+/** @brief Verify intent of hub to (un)subscribe feed \a feedId
+ * @details Only requests sent by us are confirmed by echoing the challenge.
+ *   Denial is accepted only for subscription waiting for verification.
+ * @return HTTP status code of response
+ *----------------------------------------------------------------------------*/
+int WebSubServer::verifyIntent(int feedId, const QString &query, QByteArray *challenge)
+{
+  QHash<QString, QString> params = WebSubRequest::parseQuery(query);
+  QString mode = params.value("hub.mode");
+  QString topic = params.value("hub.topic");
+
+  if (!subscriptions_.contains(feedId)) return 404;
+  Subscription &subscription = subscriptions_[feedId];
+  if (subscription.topic != topic) return 404;
+
+  if (mode == "denied") {
+    // Only answer to our own request, as for verification
+    if (subscription.state != StatePending) return 404;
+    qWarning() << "WebSub: subscription denied:" << topic << params.value("hub.reason");
+    subscription.state = StateNone;
+    saveSubscription(feedId);
+    return 200;
+  }
+
+  *challenge = params.value("hub.challenge").toUtf8();
+  if (challenge->isEmpty()) return 400;
+
+  if ((mode == "subscribe") &&
+      ((subscription.state == StatePending) || (subscription.state == StateActive))) {
+    int leaseSeconds = params.value("hub.lease_seconds").toInt();
+    if (leaseSeconds <= 0) leaseSeconds = LEASE_SECONDS;
+    subscription.state = StateActive;
+    subscription.leaseEnd = QDateTime::currentDateTime().toMSecsSinceEpoch() +
+        leaseSeconds * qint64(1000);
+    saveSubscription(feedId);
+    qDebug() << "WebSub: subscribed" << topic << "for" << leaseSeconds << "s";
+    return 200;
+  }
+
+  if ((mode == "unsubscribe") && (subscription.state == StateUnsubscribing)) {
+    subscriptions_.remove(feedId);
+    saveSubscription(feedId);
+    qDebug() << "WebSub: unsubscribed" << topic;
+    return 200;
+  }
+
+  challenge->clear();
+  return 404;
+}
+
+/** @brief Pass content pushed by hub to parsing
+ * @details Content with wrong signature is acknowledged as required by
+ *   WebSub, but ignored. Subscription without secret takes push only as
+ *   notice of update, not oftener than once per NOTIFY_INTERVAL.
+ * @return HTTP status code of response
+ *----------------------------------------------------------------------------*/
+int WebSubServer::receiveContent(int feedId, const WebSubRequest &request)
+{
+  if (!subscriptions_.contains(feedId) ||
+      (subscriptions_[feedId].state != StateActive)) {
+    return 410;
+  }
+  Subscription &subscription = subscriptions_[feedId];
+
+  if (subscription.secret.isEmpty()) {
+    qint64 currentTime = QDateTime::currentDateTime().toMSecsSinceEpoch();
+    if (currentTime - subscription.notified >= NOTIFY_INTERVAL) {
+      subscription.notified = currentTime;
+      qDebug() << "WebSub: update notified:" << subscription.topic;
+      emit signalPushNotified(feedId);
+    }
+    return 202;
+  }
+
+  if (!request.verifySignature(subscription.secret)) {
+    qWarning() << "WebSub: wrong content signature:" << subscription.topic;
+    return 202;
+  }
+
+  QByteArray content = request.content();
+  qDebug() << "WebSub: content received:" << subscription.topic << content.size();
+  emit signalPushReceived(feedId, content, request.codecName());
+  return 202;
+}
+
+void WebSubServer::sendResponse(QTcpSocket *socket, int code, const QByteArray &body)
+{
+  QByteArray reason;
+  switch (code) {
+  case 200: reason = "OK"; break;
+  case 202: reason = "Accepted"; break;
+  case 400: reason = "Bad Request"; break;
+  case 404: reason = "Not Found"; break;
+  case 405: reason = "Method Not Allowed"; break;
+  case 410: reason = "Gone"; break;
+  case 411: reason = "Length Required"; break;
+  case 413: reason = "Payload Too Large"; break;
+  case 431: reason = "Request Header Fields Too Large"; break;
+  default: reason = "Error"; break;
+  }
+
+  QByteArray response = "HTTP/1.1 " + QByteArray::number(code) + " " + reason + "\r\n";
+  response.append("Content-Type: text/plain\r\n");
+  response.append("Content-Length: " + QByteArray::number(body.size()) + "\r\n");
+  response.append("Connection: close\r\n\r\n");
+  response.append(body);
+
+  requests_.remove(socket);
+  socket->write(response);
+  socket->disconnectFromHost();
+}
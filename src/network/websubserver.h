@@ -0,0 +1,120 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#ifndef WEBSUBSERVER_H
+#define WEBSUBSERVER_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QHostAddress>
+#include <QNetworkReply>
+#include <QObject>
+#include <QTimer>
+#include <QtSql>
+
+#include "networkmanager.h"
+#include "websubrequest.h"
+
+class QTcpServer;
+class QTcpSocket;
+
+/*! \brief WebSub (PubSubHubbub) subscriber.
+ *
+ * Feeds advertising a hub are subscribed with callback
+ * "<callback address>/websub/<feed id>". The embedded HTTP server answers
+ * intent verifications of hubs and passes content they push to parsing.
+ * Content is trusted only if it is signed with secret of subscription, which
+ * is sent to hubs over HTTPS only. Push without signature, e.g. from hub over
+ * HTTP, just makes the feed to be requested from its own address.
+ *
+ * Server listens on localhost unless "Settings/websubAddress" is set, hubs
+ * reach it through callback address, e.g. forwarded by a reverse proxy.
+ *
+ * Subscriptions are kept in table feeds_ex (names websubHub, websubTopic,
+ * websubSecret and websubLease). Leases are renewed before they end, an
+ * expired lease returns the feed to its usual polling.
+ */
+class WebSubServer : public QObject
+{
+  Q_OBJECT
+public:
+  explicit WebSubServer(const QString &address, int port, const QString &callbackUrl,
+                        QObject *parent = 0);
+  ~WebSubServer();
+
+  void disconnectObjects();
+
+  static QString pollCondition(int pollInterval);
+
+public slots:
+  void start();
+  void slotHubFound(int feedId, QString hubUrl, QString topicUrl);
+
+signals:
+  void signalPushReceived(int feedId, QByteArray data, QString codecName);
+  void signalPushNotified(int feedId);
+
+private slots:
+  void slotNewConnection();
+  void slotReadyRead();
+  void slotDisconnected();
+  void slotSocketTimeout();
+  void finished(QNetworkReply *reply);
+  void slotCheckLeases();
+
+private:
+  enum State {
+    StateNone,
+    StatePending,
+    StateActive,
+    StateUnsubscribing
+  };
+
+  struct Subscription {
+    Subscription() : state(StateNone), leaseEnd(0), requested(0), notified(0) {}
+
+    QString hub;
+    QString topic;
+    QString secret;
+    State state;
+    qint64 leaseEnd;
+    qint64 requested;
+    qint64 notified;
+  };
+
+  void loadSubscriptions();
+  void saveSubscription(int feedId);
+  void subscribe(int feedId, const QString &mode);
+  void processRequest(QTcpSocket *socket, const WebSubRequest &request);
+  int verifyIntent(int feedId, const QString &query, QByteArray *challenge);
+  int receiveContent(int feedId, const WebSubRequest &request);
+  void sendResponse(QTcpSocket *socket, int code, const QByteArray &body = QByteArray());
+
+  QHostAddress address_;
+  int port_;
+  QString callbackUrl_;
+  QSqlDatabase db_;
+  QTcpServer *server_;
+  NetworkManager *networkManager_;
+  QTimer *leaseTimer_;
+  QHash<int, Subscription> subscriptions_;
+  QHash<QTcpSocket*, WebSubRequest> requests_;
+  QHash<QNetworkReply*, int> replies_;
+
+};
+
+#endif // WEBSUBSERVER_H
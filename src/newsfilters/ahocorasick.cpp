@@ -0,0 +1,149 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include "ahocorasick.h"
+
+#include <QQueue>
+
+AhoCorasick::AhoCorasick()
+{
+  clear();
+}
+
+/** @brief Fold case of each QChar separately, as match() does with text
+ * @details QString::toCaseFolded() can change length (full folding of
+ *   "\u00df" is "ss"), which would break Prefix and Whole checks.
+ *----------------------------------------------------------------------------*/
+QString AhoCorasick::foldCase(const QString &str)
+{
+  QString folded = str;
+  for (int i = 0; i < folded.length(); ++i)
+    folded[i] = folded.at(i).toCaseFolded();
+  return folded;
+}
+
+void AhoCorasick::clear()
+{
+  nodes_.clear();
+  patternLengths_.clear();
+  patternIds_.clear();
+
+  Node root;
+  root.fail = 0;
+  root.dictLink = 0;
+  nodes_.append(root);
+}
+
+/** @brief Add pattern into trie
+ * @return Pattern id, equal patterns share one id
+ *----------------------------------------------------------------------------*/
+int AhoCorasick::addPattern(const QString &pattern)
+{
+  QString folded = foldCase(pattern);
+  QHash<QString, int>::const_iterator it = patternIds_.constFind(folded);
+  if (it != patternIds_.constEnd())
+    return it.value();
+
+  int state = 0;
+  for (int i = 0; i < folded.length(); ++i) {
+    ushort c = folded.at(i).unicode();
+    int nextState = nodes_.at(state).next.value(c, 0);
+    if (!nextState) {
+      Node node;
+      node.fail = 0;
+      node.dictLink = 0;
+      nodes_.append(node);
+      nextState = nodes_.count() - 1;
+      nodes_[state].next.insert(c, nextState);
+    }
+    state = nextState;
+  }
+
+  int id = patternLengths_.count();
+  patternLengths_.append(folded.length());
+  nodes_[state].patterns.append(id);
+  patternIds_.insert(folded, id);
+  return id;
+}
+
+/** @brief Set failure and dictionary links by breadth-first walk
+ *----------------------------------------------------------------------------*/
+void AhoCorasick::build()
+{
+  QQueue<int> queue;
+  QHash<ushort, int>::const_iterator it = nodes_.at(0).next.constBegin();
+  for (; it != nodes_.at(0).next.constEnd(); ++it) {
+    nodes_[it.value()].fail = 0;
+    nodes_[it.value()].dictLink = 0;
+    queue.enqueue(it.value());
+  }
+
+  while (!queue.isEmpty()) {
+    int state = queue.dequeue();
+    QHash<ushort, int> next = nodes_.at(state).next;
+    for (it = next.constBegin(); it != next.constEnd(); ++it) {
+      ushort c = it.key();
+      int child = it.value();
+
+      int fail = nodes_.at(state).fail;
+      while (fail && !nodes_.at(fail).next.contains(c))
+        fail = nodes_.at(fail).fail;
+      fail = nodes_.at(fail).next.value(c, 0);
+      if (fail == child) fail = 0;
+
+      nodes_[child].fail = fail;
+      nodes_[child].dictLink = nodes_.at(fail).patterns.isEmpty() ?
+            nodes_.at(fail).dictLink : fail;
+      queue.enqueue(child);
+    }
+  }
+}
+
+/** @brief Find all patterns in \a text
+ * @param flags Vector of patternsCount() items, MatchFlag bits are added to it
+ *----------------------------------------------------------------------------*/
+void AhoCorasick::match(const QString &text, QVector<uchar> *flags) const
+{
+  int length = text.length();
+  int state = 0;
+  for (int i = 0; i < length; ++i) {
+    ushort c = text.at(i).toCaseFolded().unicode();
+
+    QHash<ushort, int>::const_iterator it;
+    while (true) {
+      it = nodes_.at(state).next.constFind(c);
+      if ((it != nodes_.at(state).next.constEnd()) || !state) break;
+      state = nodes_.at(state).fail;
+    }
+    state = (it != nodes_.at(state).next.constEnd()) ? it.value() : 0;
+
+    int output = nodes_.at(state).patterns.isEmpty() ?
+          nodes_.at(state).dictLink : state;
+    while (output) {
+      foreach (int id, nodes_.at(output).patterns) {
+        uchar flag = Found;
+        bool prefix = (i + 1 == patternLengths_.at(id));
+        bool suffix = (i + 1 == length);
+        if (prefix) flag |= Prefix;
+        if (suffix) flag |= Suffix;
+        if (prefix && suffix) flag |= Whole;
+        (*flags)[id] |= flag;
+      }
+      output = nodes_.at(output).dictLink;
+    }
+  }
+}
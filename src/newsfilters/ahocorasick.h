@@ -0,0 +1,67 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#ifndef AHOCORASICK_H
+#define AHOCORASICK_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+/*! \brief Case-insensitive Aho-Corasick automaton over literal patterns.
+ *
+ * All patterns are found in one pass over the text. For every pattern
+ * match() reports whether it occurs anywhere, at the beginning, at the end
+ * or as the whole text. Case of patterns and text is folded per QChar, so
+ * lengths are kept.
+ */
+class AhoCorasick
+{
+public:
+  enum MatchFlag {
+    Found  = 0x01,
+    Prefix = 0x02,
+    Suffix = 0x04,
+    Whole  = 0x08
+  };
+
+  AhoCorasick();
+
+  void clear();
+  int addPattern(const QString &pattern);
+  void build();
+
+  int patternsCount() const { return patternLengths_.count(); }
+  void match(const QString &text, QVector<uchar> *flags) const;
+
+private:
+  struct Node {
+    QHash<ushort, int> next;
+    int fail;
+    int dictLink;
+    QVector<int> patterns;
+  };
+
+  static QString foldCase(const QString &str);
+
+  QVector<Node> nodes_;
+  QVector<int> patternLengths_;
+  QHash<QString, int> patternIds_;
+
+};
+
+#endif // AHOCORASICK_H
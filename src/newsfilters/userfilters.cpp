@@ -0,0 +1,406 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include "userfilters.h"
+
+UserFilters::UserFilters()
+  : compiled_(false)
+  , conditionsCount_(0)
+{
+  for (int i = 0; i < FieldsCount; ++i)
+    scanFields_[i] = false;
+}
+
+/** @brief Read filters from DB if they have been changed
+ *----------------------------------------------------------------------------*/
+void UserFilters::compile(QSqlDatabase &db)
+{
+  if (compiled_) return;
+  compiled_ = true;
+  filters_.clear();
+  matcher_.clear();
+  conditionsCount_ = 0;
+  for (int i = 0; i < FieldsCount; ++i)
+    scanFields_[i] = false;
+
+  QSqlQuery q(db);
+  QSqlQuery q1(db);
+  q.exec("SELECT id, enable, type, feeds FROM filters ORDER BY num");
+  while (q.next()) {
+    if (q.value(1).toInt() == 0) continue;
+
+    int filterId = q.value(0).toInt();
+    Filter filter;
+    filter.type = q.value(2).toInt();
+    filter.markRead = false;
+    filter.markStar = false;
+    filter.markDeleted = false;
+
+    QStringList strIdFeeds = q.value(3).toString().split(",", QString::SkipEmptyParts);
+    foreach (const QString &strIdFeed, strIdFeeds) {
+      filter.feedIds.insert(strIdFeed.toInt());
+    }
+    if (filter.feedIds.isEmpty()) continue;
+
+    q1.exec(QString("SELECT action, params FROM filterActions "
+                    "WHERE idFilter=='%1'").arg(filterId));
+    while (q1.next()) {
+      switch (q1.value(0).toInt()) {
+      case 0: // action -> Mark news as read
+        filter.markRead = true;
+        break;
+      case 1: // action -> Add star
+        filter.markStar = true;
+        break;
+      case 2: // action -> Delete
+        filter.markDeleted = true;
+        break;
+      case 3: // action -> Add Label
+        filter.labelIds.append(q1.value(1).toInt());
+        break;
+      case 4: // action -> Play Sound
+        filter.sounds.append(q1.value(1).toString());
+        break;
+      case 5: // action -> Show News in Notifier
+        filter.colors.append(q1.value(1).toString());
+        break;
+      }
+    }
+
+    if ((filter.type == 1) || (filter.type == 2)) {
+      q1.exec(QString("SELECT field, condition, content FROM filterConditions "
+                      "WHERE idFilter=='%1'").arg(filterId));
+      while (q1.next()) {
+        filter.conditions.append(createCondition(q1.value(0).toInt(),
+                                                 q1.value(1).toInt(),
+                                                 q1.value(2).toString()));
+      }
+    }
+
+    filters_.append(filter);
+  }
+
+  matcher_.build();
+}
+
+UserFilters::Condition UserFilters::createCondition(int field, int condition,
+                                                    const QString &content)
+{
+  Condition cond;
+  cond.index = conditionsCount_++;
+  cond.field = field;
+  cond.compare = CompareContains;
+  cond.pattern = -1;
+  cond.upper = (field != 5);
+  cond.content = cond.upper ? content.toUpper() : content;
+  cond.wildcards = content.contains('%') || content.contains('_');
+  cond.status = -1;
+  cond.statusIs = true;
+
+  // Conditions of combobox differ between fields, see ItemCondition
+  switch (field) {
+  case 1: // field -> Description
+  case 6: // field -> News
+    switch (condition) {
+    case 0: cond.compare = CompareContains; break;
+    case 1: cond.compare = CompareNotContains; break;
+    case 2: cond.compare = CompareRegExp; break;
+    default: cond.field = -1;
+    }
+    break;
+  case 2: // field -> Author
+    switch (condition) {
+    case 0: cond.compare = CompareContains; break;
+    case 1: cond.compare = CompareNotContains; break;
+    case 2: cond.compare = CompareIs; break;
+    case 3: cond.compare = CompareIsNot; break;
+    case 4: cond.compare = CompareRegExp; break;
+    default: cond.field = -1;
+    }
+    break;
+  case 4: // field -> Status
+    cond.compare = CompareStatus;
+    cond.statusIs = (condition == 0);
+    cond.status = content.toInt();
+    break;
+  case 0: // field -> Title
+  case 3: // field -> Category
+  case 5: // field -> Link
+    switch (condition) {
+    case 0: cond.compare = CompareContains; break;
+    case 1: cond.compare = CompareNotContains; break;
+    case 2: cond.compare = CompareIs; break;
+    case 3: cond.compare = CompareIsNot; break;
+    case 4: cond.compare = CompareBegins; break;
+    case 5: cond.compare = CompareEnds; break;
+    case 6: cond.compare = CompareRegExp; break;
+    default: cond.field = -1;
+    }
+    break;
+  default:
+    cond.field = -1;
+  }
+
+  if (cond.compare == CompareRegExp) {
+    cond.regExp = QzRegExp(content, Qt::CaseInsensitive);
+  } else if ((cond.field != -1) && (cond.compare != CompareStatus) &&
+             !cond.wildcards && !cond.content.isEmpty()) {
+    // Not upper-cased content: toUpper() can change length ("\u00df" -> "SS")
+    cond.pattern = matcher_.addPattern(content);
+    if (field == 6) {
+      scanFields_[0] = true;
+      scanFields_[1] = true;
+    } else {
+      scanFields_[field] = true;
+    }
+  }
+
+  return cond;
+}
+
+bool UserFilters::hasFilters(int feedId) const
+{
+  foreach (const Filter &filter, filters_) {
+    if (filter.feedIds.contains(feedId)) return true;
+  }
+  return false;
+}
+
+/** @brief Apply filters of feed \a feedId to \a news in their order
+ * @param sounds Sounds of matched filters are added to it
+ * @param colors Notifier colors of matched filters are added to it
+ * @return true if any filter has matched
+ *----------------------------------------------------------------------------*/
+bool UserFilters::apply(int feedId, UserFilterNews *news,
+                        QStringList *sounds, QStringList *colors) const
+{
+  // Text fields are not changed by actions, check them once
+  QBitArray textResults = matchTexts(feedId, *news);
+
+  bool matched = false;
+  foreach (const Filter &filter, filters_) {
+    if (!filter.feedIds.contains(feedId)) continue;
+    // Filters work with not deleted news only
+    if (news->deleted) break;
+    if (!matchFilter(filter, *news, textResults)) continue;
+
+    matched = true;
+    if (filter.markRead || filter.markDeleted) {
+      news->newState = 0;
+      news->read = 2;
+    }
+    if (filter.markStar)
+      news->starred = 1;
+    if (filter.markDeleted)
+      news->deleted = 1;
+
+    foreach (int idLabel, filter.labelIds) {
+      if (news->label.contains(QString(",%1,").arg(idLabel))) continue;
+      if (news->label.isEmpty()) news->label.append(",");
+      news->label.append(QString("%1,").arg(idLabel));
+    }
+
+    if (!filter.sounds.isEmpty())
+      sounds->append(filter.sounds.at(0));
+    if (!filter.colors.isEmpty())
+      colors->append(filter.colors.at(0));
+  }
+  return matched;
+}
+
+bool UserFilters::matchFilter(const Filter &filter, const UserFilterNews &news,
+                              const QBitArray &textResults)
+{
+  switch (filter.type) {
+  case 1: // Match all conditions
+    if (filter.conditions.isEmpty()) return false;
+    foreach (const Condition &condition, filter.conditions) {
+      bool result = (condition.compare == CompareStatus) ?
+            matchStatus(condition, news) : textResults.testBit(condition.index);
+      if (!result) return false;
+    }
+    return true;
+  case 2: // Match any condition
+    foreach (const Condition &condition, filter.conditions) {
+      bool result = (condition.compare == CompareStatus) ?
+            matchStatus(condition, news) : textResults.testBit(condition.index);
+      if (result) return true;
+    }
+    return false;
+  }
+  return true;
+}
+
+/** @brief Check text conditions of feed \a feedId filters
+ * @details Fields having literal patterns are scanned once by automaton
+ * @return Bit per condition index
+ *----------------------------------------------------------------------------*/
+QBitArray UserFilters::matchTexts(int feedId, const UserFilterNews &news) const
+{
+  QBitArray results(conditionsCount_);
+
+  const QString *texts[FieldsCount] = {
+    &news.title, &news.description, &news.authorName, &news.category,
+    0, &news.link, 0
+  };
+  QVector<uchar> flags[FieldsCount];
+  for (int i = 0; i < FieldsCount; ++i) {
+    if (!scanFields_[i] || !texts[i] || texts[i]->isNull()) continue;
+    flags[i].fill(0, matcher_.patternsCount());
+    matcher_.match(*texts[i], &flags[i]);
+  }
+
+  foreach (const Filter &filter, filters_) {
+    if (!filter.feedIds.contains(feedId)) continue;
+    foreach (const Condition &condition, filter.conditions) {
+      bool result = false;
+      switch (condition.field) {
+      case 0: // field -> Title
+      case 1: // field -> Description
+      case 2: // field -> Author
+      case 3: // field -> Category
+      case 5: // field -> Link
+        result = matchField(condition, *texts[condition.field], flags[condition.field]);
+        break;
+      case 6: // field -> News
+        result = (matchField(condition, news.title, flags[0]) ||
+                   matchField(condition, news.description, flags[1]));
+        break;
+      }
+      if (result) results.setBit(condition.index);
+    }
+  }
+  return results;
+}
+
+bool UserFilters::matchStatus(const Condition &condition, const UserFilterNews &news)
+{
+  switch (condition.status) {
+  case 0:
+    return condition.statusIs ? (news.newState == 1) : (news.newState == 0);
+  case 1:
+    return condition.statusIs ? (news.read >= 1) : (news.read == 0);
+  case 2:
+    return condition.statusIs ? (news.starred == 1) : (news.starred == 0);
+  }
+  return false;
+}
+
+/** @brief Match one text field using flags found by automaton
+ *----------------------------------------------------------------------------*/
+bool UserFilters::matchField(const Condition &condition, const QString &text,
+                             const QVector<uchar> &flags)
+{
+  if (text.isNull()) return false;
+  if (condition.pattern == -1)
+    return matchText(condition, text);
+
+  uchar flag = flags.at(condition.pattern);
+  switch (condition.compare) {
+  case CompareContains:
+    return (flag & AhoCorasick::Found);
+  case CompareNotContains:
+    return !(flag & AhoCorasick::Found);
+  case CompareIs:
+    return (flag & AhoCorasick::Whole);
+  case CompareIsNot:
+    return !(flag & AhoCorasick::Whole);
+  case CompareBegins:
+    return (flag & AhoCorasick::Prefix);
+  case CompareEnds:
+    return (flag & AhoCorasick::Suffix);
+  default:
+    return false;
+  }
+}
+
+/** @brief Match one text field
+ * @details NULL value is never matched as in SQL
+ *----------------------------------------------------------------------------*/
+bool UserFilters::matchText(const Condition &condition, const QString &text)
+{
+  if (text.isNull()) return false;
+
+  if (condition.compare == CompareRegExp)
+    return (condition.regExp.indexIn(text) > -1);
+
+  const QString &content = condition.content;
+  if (condition.wildcards) {
+    QString value = condition.upper ? text.toUpper() : text;
+    switch (condition.compare) {
+    case CompareContains:
+      return matchLike(value, "%" + content + "%");
+    case CompareNotContains:
+      return !matchLike(value, "%" + content + "%");
+    case CompareIs:
+      return matchLike(value, content);
+    case CompareIsNot:
+      return !matchLike(value, content);
+    case CompareBegins:
+      return matchLike(value, content + "%");
+    case CompareEnds:
+      return matchLike(value, "%" + content);
+    default:
+      return false;
+    }
+  }
+
+  switch (condition.compare) {
+  case CompareContains:
+    return text.contains(content, Qt::CaseInsensitive);
+  case CompareNotContains:
+    return !text.contains(content, Qt::CaseInsensitive);
+  case CompareIs:
+    return (text.compare(content, Qt::CaseInsensitive) == 0);
+  case CompareIsNot:
+    return (text.compare(content, Qt::CaseInsensitive) != 0);
+  case CompareBegins:
+    return text.startsWith(content, Qt::CaseInsensitive);
+  case CompareEnds:
+    return text.endsWith(content, Qt::CaseInsensitive);
+  default:
+    return false;
+  }
+}
+
+/** @brief SQL LIKE: '%' is any string, '_' is any character
+ *----------------------------------------------------------------------------*/
+bool UserFilters::matchLike(const QString &text, const QString &pattern)
+{
+  int t = 0;
+  int p = 0;
+  int starP = -1;
+  int starT = 0;
+  while (t < text.length()) {
+    if ((p < pattern.length()) && (pattern.at(p) == '%')) {
+      starP = p++;
+      starT = t;
+    } else if ((p < pattern.length()) &&
+               ((pattern.at(p) == '_') ||
+                (pattern.at(p).toCaseFolded() == text.at(t).toCaseFolded()))) {
+      ++p;
+      ++t;
+    } else if (starP != -1) {
+      p = starP + 1;
+      t = ++starT;
+    } else {
+      return false;
+    }
+  }
+  while ((p < pattern.length()) && (pattern.at(p) == '%')) ++p;
+  return (p == pattern.length());
+}
@@ -0,0 +1,122 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#ifndef USERFILTERS_H
+#define USERFILTERS_H
+
+#include <QtSql>
+#include <qzregexp.h>
+
+#include "ahocorasick.h"
+
+/*! \brief News fields user filters are checking and changing */
+struct UserFilterNews {
+  QString title;
+  QString description;
+  QString authorName;
+  QString category;
+  QString link;
+  QString label;
+  int newState;
+  int read;
+  int starred;
+  int deleted;
+};
+
+/*! \brief User filters compiled in memory.
+ *
+ * Tables filters, filterConditions and filterActions are read once and kept
+ * as lists of conditions, recompiled after invalidate(). Conditions follow
+ * the SQL that runUserFilter generates: LIKE on upper-cased text with '%'
+ * and '_' wildcards, REGEXP case insensitive, NULL fields never match.
+ * UPPER of the application connection is QString::toUpper(), so case of
+ * all letters is ignored either way. tests/userfilters compares both ways.
+ *
+ * Literal "contains", "is", "begins with" and "ends with" patterns of all
+ * filters are put into one Aho-Corasick automaton, so each text field of
+ * news is scanned once whatever the number of such conditions.
+ */
+class UserFilters
+{
+public:
+  UserFilters();
+
+  void invalidate() { compiled_ = false; }
+  void compile(QSqlDatabase &db);
+
+  bool hasFilters(int feedId) const;
+  bool apply(int feedId, UserFilterNews *news,
+             QStringList *sounds, QStringList *colors) const;
+
+private:
+  enum Compare {
+    CompareContains,
+    CompareNotContains,
+    CompareIs,
+    CompareIsNot,
+    CompareBegins,
+    CompareEnds,
+    CompareRegExp,
+    CompareStatus
+  };
+
+  struct Condition {
+    int index;
+    int field;
+    Compare compare;
+    int pattern;
+    bool upper;
+    bool wildcards;
+    QString content;
+    QzRegExp regExp;
+    int status;
+    bool statusIs;
+  };
+
+  struct Filter {
+    int type;
+    QSet<int> feedIds;
+    QList<Condition> conditions;
+    bool markRead;
+    bool markStar;
+    bool markDeleted;
+    QList<int> labelIds;
+    QStringList sounds;
+    QStringList colors;
+  };
+
+  enum { FieldsCount = 7 };
+
+  Condition createCondition(int field, int condition, const QString &content);
+  QBitArray matchTexts(int feedId, const UserFilterNews &news) const;
+  static bool matchField(const Condition &condition, const QString &text,
+                         const QVector<uchar> &flags);
+  static bool matchText(const Condition &condition, const QString &text);
+  static bool matchLike(const QString &text, const QString &pattern);
+  static bool matchStatus(const Condition &condition, const UserFilterNews &news);
+  static bool matchFilter(const Filter &filter, const UserFilterNews &news,
+                          const QBitArray &textResults);
+
+  bool compiled_;
+  QList<Filter> filters_;
+  AhoCorasick matcher_;
+  int conditionsCount_;
+  bool scanFields_[FieldsCount];
+
+};
+
+#endif // USERFILTERS_H
@@ -19,6 +19,7 @@
 
 #include "mainapplication.h"
 #include "adblockicon.h"
+#include "newsstateupdater.h"
 #include "settings.h"
 #include "webpage.h"
 
@@ -34,6 +35,16 @@ NewsTabWidget::NewsTabWidget(QWidget *parent, TabType type, int feedId, int feed
   , feedParId_(feedParId)
   , currentNewsIdOld(-1)
   , autoLoadImages_(true)
+  , newspaperThread_(NULL)
+  , newspaperRenderer_(NULL)
+  , newspaperScrollTimer_(NULL)
+  , newspaperGeneration_(0)
+  , newspaperRows_(0)
+  , newspaperPending_(0)
+  , newspaperScrollValue_(-1)
+  , newspaperComplete_(false)
+  , newsHtmlVersion_(0)
+  , prerenderTimer_(NULL)
 {
   mainWindow_ = mainApp->mainWindow();
   db_ = QSqlDatabase::database();
@@ -143,6 +154,13 @@ NewsTabWidget::NewsTabWidget(QWidget *parent, TabType type, int feedId, int feed
 
 NewsTabWidget::~NewsTabWidget()
 {
+  if (newspaperThread_) {
+    newspaperThread_->quit();
+    newspaperThread_->wait();
+    delete newspaperRenderer_;
+    delete newspaperThread_;
+  }
+
   if (type_ == TabTypeDownloads) {
     mainApp->downloadManager()->hide();
     mainApp->downloadManager()->setParent(mainWindow_);
@@ -237,6 +255,13 @@ void NewsTabWidget::createNewsList()
 
   markNewsReadTimer_ = new QTimer(this);
 
+  // Preview HTML cache cost is counted in KB of rendered text
+  newsHtmlCache_.setMaxCost(4096);
+  prerenderTimer_ = new QTimer(this);
+  prerenderTimer_->setSingleShot(true);
+  prerenderTimer_->setInterval(100);
+  connect(prerenderTimer_, SIGNAL(timeout()), this, SLOT(slotPrerenderNews()));
+
   QFile htmlFile;
   htmlFile.setFileName(":/html/newspaper_head");
   htmlFile.open(QFile::ReadOnly);
@@ -470,6 +495,8 @@ void NewsTabWidget::setSettings(bool init, bool newTab)
 
   if (type_ == TabTypeDownloads) return;
 
+  newsHtmlVersion_++;
+
   QString style = settings.value("Settings/styleApplication", "defaultStyle_").toString();
   if (style == "darkStyle_")
     newsIconMovie_->setFileName(":/images/loading_dark");
@@ -957,8 +984,6 @@ void NewsTabWidget::markNewsRead()
       slotSetItemRead(curIndex, 0);
     }
   } else {
-    QStringList feedIdList;
-
     bool markRead = false;
     for (int i = cnt-1; i >= 0; --i) {
       curIndex = indexes.at(i);
@@ -968,8 +993,7 @@ void NewsTabWidget::markNewsRead()
       }
     }
 
-    db_.transaction();
-    QSqlQuery q;
+    QList<int> idList;
     for (int i = cnt-1; i >= 0; --i) {
       curIndex = indexes.at(i);
       newsModel_->setData(
@@ -979,17 +1003,13 @@ void NewsTabWidget::markNewsRead()
             newsModel_->index(curIndex.row(), newsModel_->fieldIndex("read")),
             markRead);
 
-      int newsId = newsModel_->dataField(curIndex.row(), "id").toInt();
-      q.exec(QString("UPDATE news SET new=0, read='%1' WHERE id=='%2'").
-             arg(markRead).arg(newsId));
-      QString feedId = newsModel_->dataField(curIndex.row(), "feedId").toString();
-      if (!feedIdList.contains(feedId)) feedIdList.append(feedId);
+      idList.append(newsModel_->dataField(curIndex.row(), "id").toInt());
     }
-    db_.commit();
 
-    foreach (QString feedId, feedIdList) {
-      mainWindow_->slotUpdateStatus(feedId.toInt());
-    }
+    NewsStateUpdater updater(db_);
+    updater.setRead(idList, markRead);
+
+    mainWindow_->slotUpdateStatus(updater.feedIds());
     mainWindow_->recountCategoryCounts();
     newsView_->viewport()->update();
   }
@@ -1005,18 +1025,15 @@ void NewsTabWidget::markAllNewsRead()
   int cnt = newsModel_->rowCount();
   if (cnt == 0) return;
 
-  QStringList feedIdList;
-
-  db_.transaction();
-  QSqlQuery q;
+  QList<int> idList;
   for (int i = cnt-1; i >= 0; --i) {
-    int newsId = newsModel_->dataField(i, "id").toInt();
-    q.exec(QString("UPDATE news SET read=1 WHERE id=='%1' AND read=0").arg(newsId));
-    q.exec(QString("UPDATE news SET new=0 WHERE id=='%1' AND new=1").arg(newsId));
-
-    QString feedId = newsModel_->dataField(i, "feedId").toString();
-    if (!feedIdList.contains(feedId)) feedIdList.append(feedId);
+    idList.append(newsModel_->dataField(i, "id").toInt());
   }
+
+  NewsStateUpdater updater(db_);
+  db_.transaction();
+  updater.update(idList, "read=1", "read==0");
+  updater.setNew(idList, 0, "new==1");
   db_.commit();
 
   int currentRow = newsView_->currentIndex().row();
@@ -1030,9 +1047,7 @@ void NewsTabWidget::markAllNewsRead()
 
   newsView_->setCurrentIndex(newsModel_->index(currentRow, newsModel_->fieldIndex("title")));
 
-  foreach (QString feedId, feedIdList) {
-    mainWindow_->slotUpdateStatus(feedId.toInt());
-  }
+  mainWindow_->slotUpdateStatus(updater.feedIds());
   mainWindow_->recountCategoryCounts();
 }
 
@@ -1066,17 +1081,16 @@ void NewsTabWidget::markNewsStar()
       }
     }
 
-    db_.transaction();
+    QList<int> idList;
     for (int i = cnt-1; i >= 0; --i) {
       curIndex = indexes.at(i);
       newsModel_->setData(curIndex, markStar);
 
-      int newsId = newsModel_->dataField(curIndex.row(), "id").toInt();
-      QSqlQuery q;
-      q.exec(QString("UPDATE news SET starred='%1' WHERE id=='%2'").
-             arg(markStar).arg(newsId));
+      idList.append(newsModel_->dataField(curIndex.row(), "id").toInt());
     }
-    db_.commit();
+
+    NewsStateUpdater updater(db_);
+    updater.setStarred(idList, markStar);
 
     mainWindow_->recountCategoryCounts();
   }
@@ -1094,7 +1108,7 @@ void NewsTabWidget::deleteNews()
   int cnt = indexes.count();
   if (cnt == 0) return;
 
-  QStringList feedIdList;
+  QList<int> feedIdList;
 
   if (type_ != TabTypeDel) {
     if (cnt == 1) {
@@ -1112,13 +1126,11 @@ void NewsTabWidget::deleteNews()
       newsModel_->setData(newsModel_->index(curIndex.row(), newsModel_->fieldIndex("deleteDate")),
                           QDateTime::currentDateTime().toString(Qt::ISODate));
 
-      QString feedId = newsModel_->dataField(curIndex.row(), "feedId").toString();
-      if (!feedIdList.contains(feedId)) feedIdList.append(feedId);
+      feedIdList.append(newsModel_->dataField(curIndex.row(), "feedId").toInt());
 
       newsModel_->submitAll();
     } else {
-      db_.transaction();
-      QSqlQuery q;
+      QList<int> idList;
       for (int i = cnt-1; i >= 0; --i) {
         curIndex = indexes.at(i);
         if (newsModel_->dataField(curIndex.row(), "starred").toInt() &&
@@ -1128,36 +1140,26 @@ void NewsTabWidget::deleteNews()
         if (!(labelStr.isEmpty() || (labelStr == ",")) && mainWindow_->notDeleteLabeled_)
           continue;
 
-        int newsId = newsModel_->dataField(curIndex.row(), "id").toInt();
-        q.exec(QString("UPDATE news SET new=0, read=2, deleted=1, deleteDate='%1' WHERE id=='%2'").
-               arg(QDateTime::currentDateTime().toString(Qt::ISODate)).
-               arg(newsId));
-
-        QString feedId = newsModel_->dataField(curIndex.row(), "feedId").toString();
-        if (!feedIdList.contains(feedId)) feedIdList.append(feedId);
+        idList.append(newsModel_->dataField(curIndex.row(), "id").toInt());
       }
-      db_.commit();
+
+      NewsStateUpdater updater(db_);
+      updater.setDeleted(idList);
+      feedIdList = updater.feedIds();
 
       newsModel_->select();
     }
   }
   else {
-    db_.transaction();
-    QSqlQuery q;
+    QList<int> idList;
     for (int i = cnt-1; i >= 0; --i) {
       curIndex = indexes.at(i);
-
-      int newsId = newsModel_->dataField(curIndex.row(), "id").toInt();
-      q.exec(QString("UPDATE news SET description='', content='', received='', "
-                     "author_name='', author_uri='', author_email='', "
-                     "category='', new='', read='', starred='', label='', "
-                     "deleteDate='', feedParentId='', deleted=2 WHERE id=='%1'").
-             arg(newsId));
-
-      QString feedId = newsModel_->dataField(curIndex.row(), "feedId").toString();
-      if (!feedIdList.contains(feedId)) feedIdList.append(feedId);
+      idList.append(newsModel_->dataField(curIndex.row(), "id").toInt());
     }
-    db_.commit();
+
+    NewsStateUpdater updater(db_);
+    updater.purge(idList);
+    feedIdList = updater.feedIds();
 
     newsModel_->select();
   }
@@ -1174,9 +1176,7 @@ void NewsTabWidget::deleteNews()
   newsView_->setCurrentIndex(curIndex);
   slotNewsViewSelected(curIndex);
 
-  foreach (QString feedId, feedIdList) {
-    mainWindow_->slotUpdateStatus(feedId.toInt());
-  }
+  mainWindow_->slotUpdateStatus(feedIdList);
   mainWindow_->recountCategoryCounts();
 }
 
@@ -1189,13 +1189,8 @@ void NewsTabWidget::deleteAllNewsList()
   int cnt = newsModel_->rowCount();
   if (cnt == 0) return;
 
-  QStringList feedIdList;
-
-  db_.transaction();
-  QSqlQuery q;
+  QList<int> idList;
   for (int i = cnt-1; i >= 0; --i) {
-    int newsId = newsModel_->dataField(i, "id").toInt();
-
     if (type_ != TabTypeDel) {
       if (newsModel_->dataField(i, "starred").toInt() &&
           mainWindow_->notDeleteStarred_)
@@ -1203,31 +1198,21 @@ void NewsTabWidget::deleteAllNewsList()
       QString labelStr = newsModel_->dataField(i, "label").toString();
       if (!(labelStr.isEmpty() || (labelStr == ",")) && mainWindow_->notDeleteLabeled_)
         continue;
-
-      q.exec(QString("UPDATE news SET new=0, read=2, deleted=1, deleteDate='%1' WHERE id=='%2'").
-             arg(QDateTime::currentDateTime().toString(Qt::ISODate)).
-             arg(newsId));
     }
-    else {
-      q.exec(QString("UPDATE news SET description='', content='', received='', "
-                     "author_name='', author_uri='', author_email='', "
-                     "category='', new='', read='', starred='', label='', "
-                     "deleteDate='', feedParentId='', deleted=2 WHERE id=='%1'").
-             arg(newsId));
-    }
-
-    QString feedId = newsModel_->dataField(i, "feedId").toString();
-    if (!feedIdList.contains(feedId)) feedIdList.append(feedId);
+    idList.append(newsModel_->dataField(i, "id").toInt());
   }
-  db_.commit();
+
+  NewsStateUpdater updater(db_);
+  if (type_ != TabTypeDel)
+    updater.setDeleted(idList);
+  else
+    updater.purge(idList);
 
   newsModel_->select();
 
   slotNewsViewSelected(QModelIndex());
 
-  foreach (QString feedId, feedIdList) {
-    mainWindow_->slotUpdateStatus(feedId.toInt());
-  }
+  mainWindow_->slotUpdateStatus(updater.feedIds());
   mainWindow_->recountCategoryCounts();
 }
 
@@ -1243,7 +1228,7 @@ void NewsTabWidget::restoreNews()
   int cnt = indexes.count();
   if (cnt == 0) return;
 
-  QStringList feedIdList;
+  QList<int> feedIdList;
 
   if (cnt == 1) {
     curIndex = indexes.at(0);
@@ -1251,21 +1236,17 @@ void NewsTabWidget::restoreNews()
     newsModel_->setData(newsModel_->index(curIndex.row(), newsModel_->fieldIndex("deleteDate")), "");
     newsModel_->submitAll();
 
-    QString feedId = newsModel_->dataField(curIndex.row(), "feedId").toString();
-    if (!feedIdList.contains(feedId)) feedIdList.append(feedId);
+    feedIdList.append(newsModel_->dataField(curIndex.row(), "feedId").toInt());
   } else {
-    db_.transaction();
-    QSqlQuery q;
+    QList<int> idList;
     for (int i = cnt-1; i >= 0; --i) {
       curIndex = indexes.at(i);
-      int newsId = newsModel_->dataField(curIndex.row(), "id").toInt();
-      q.exec(QString("UPDATE news SET deleted=0, deleteDate='' WHERE id=='%1'").
-             arg(newsId));
-
-      QString feedId = newsModel_->dataField(curIndex.row(), "feedId").toString();
-      if (!feedIdList.contains(feedId)) feedIdList.append(feedId);
+      idList.append(newsModel_->dataField(curIndex.row(), "id").toInt());
     }
-    db_.commit();
+
+    NewsStateUpdater updater(db_);
+    updater.restore(idList);
+    feedIdList = updater.feedIds();
 
     newsModel_->select();
   }
@@ -1283,12 +1264,9 @@ void NewsTabWidget::restoreNews()
     curIndex = newsModel_->index(curIndex.row(), newsModel_->fieldIndex("title"));
   newsView_->setCurrentIndex(curIndex);
   slotNewsViewSelected(curIndex);
-  mainWindow_->slotUpdateStatus(feedId_);
-  mainWindow_->recountCategoryCounts();
 
-  foreach (QString feedId, feedIdList) {
-    mainWindow_->slotUpdateStatus(feedId.toInt());
-  }
+  mainWindow_->slotUpdateStatus(feedId_);
+  mainWindow_->slotUpdateStatus(feedIdList);
   mainWindow_->recountCategoryCounts();
 }
 
@@ -1348,16 +1326,12 @@ void NewsTabWidget::updateWebView(QModelIndex index)
     return;
   }
 
-  QString newsId = newsModel_->dataField(index.row(), "id").toString();
   linkNewsString_ = getLinkNews(index.row());
-  QString linkString = linkNewsString_;
-  QUrl newsUrl = QUrl::fromEncoded(linkString.toUtf8());
+  QUrl newsUrl = QUrl::fromEncoded(linkNewsString_.toUtf8());
 
   bool showDescriptionNews_ = mainWindow_->showDescriptionNews_;
   QModelIndex currentIndex = feedsProxyModel_->mapToSource(feedsView_->currentIndex());
   QVariant displayNews = feedsModel_->dataField(currentIndex, "displayNews");
-  QString feedId = newsModel_->dataField(index.row(), "feedId").toString();
-  QModelIndex feedIndex = feedsModel_->indexById(feedId.toInt());
 
   if (!displayNews.toString().isEmpty())
     showDescriptionNews_ = !displayNews.toInt();
@@ -1376,215 +1350,254 @@ void NewsTabWidget::updateWebView(QModelIndex index)
   } else {
     setWebToolbarVisible(false, false);
 
-    QString htmlStr;
-    QString content = newsModel_->dataField(index.row(), "content").toString();
-    if (!content.contains(QzRegExp("<html(.*)</html>", Qt::CaseInsensitive))) {
-      QString description = newsModel_->dataField(index.row(), "description").toString();
-      if (content.isEmpty() || (description.length() > content.length())) {
-        content = description;
-      }
-
-      QString titleString = newsModel_->dataField(index.row(), "title").toString();
-      if (!linkString.isEmpty()) {
-        titleString = QString("<a href='%1' class='unread'>%2</a>").
-            arg(linkString, titleString);
-      }
-
-      QDateTime dtLocal;
-      QString dateString = newsModel_->dataField(index.row(), "published").toString();
-      if (!dateString.isNull()) {
-        QDateTime dtLocalTime = QDateTime::currentDateTime();
-        QDateTime dtUTC = QDateTime(dtLocalTime.date(), dtLocalTime.time(), Qt::UTC);
-        int nTimeShift = dtLocalTime.secsTo(dtUTC);
-
-        QDateTime dt = QDateTime::fromString(dateString, Qt::ISODate);
-        dtLocal = dt.addSecs(nTimeShift);
-      } else {
-        dtLocal = QDateTime::fromString(
-              newsModel_->dataField(index.row(), "received").toString(),
-              Qt::ISODate);
-      }
-      if (QDateTime::currentDateTime().date() <= dtLocal.date())
-        dateString = dtLocal.toString(mainWindow_->formatTime_);
-      else
-        dateString = dtLocal.toString(mainWindow_->formatDate_ + " " + mainWindow_->formatTime_);
-
-      // Create author panel from news author
-      QString authorString;
-      QString authorName = newsModel_->dataField(index.row(), "author_name").toString();
-      QString authorEmail = newsModel_->dataField(index.row(), "author_email").toString();
-      QString authorUri = newsModel_->dataField(index.row(), "author_uri").toString();
-
-      QzRegExp reg("(^\\S+@\\S+\\.\\S+)", Qt::CaseInsensitive);
-      int pos = reg.indexIn(authorName);
-      if (pos > -1) {
-        authorName.replace(reg.cap(1), QString(" <a href='mailto:%1'>%1</a>").arg(reg.cap(1)));
-      }
+    emit signalSetHtmlWebView(cachedNewsHtml(index.row()));
+    prerenderTimer_->start();
+  }
+}
 
-      authorString = authorName;
+/** @brief Get news HTML for preview from cache, render it on cache miss
+ *----------------------------------------------------------------------------*/
+QString NewsTabWidget::cachedNewsHtml(int row)
+{
+  int newsId = newsModel_->dataField(row, "id").toInt();
+  qint64 key = (qint64(newsHtmlVersion_) << 33) | (qint64(autoLoadImages_) << 32) |
+      quint32(newsId);
 
-      if (!authorEmail.isEmpty())
-        authorString.append(QString(" <a href='mailto:%1'>e-mail</a>").arg(authorEmail));
-      if (!authorUri.isEmpty())
-        authorString.append(QString(" <a href='%1'>page</a>"). arg(authorUri));
+  QString labels = newsModel_->dataField(row, "label").toString();
+  int feedId = newsModel_->dataField(row, "feedId").toInt();
+  int layoutDirection = feedsModel_->dataField(feedsModel_->indexById(feedId),
+                                               "layoutDirection").toInt();
 
-      // If news author is absent, create author panel from feed author
-      // @note(arhohryakov:2012.01.03) Author is got from current feed, because
-      //   news is belong to it
-      if (authorString.isEmpty()) {
-        authorName  = feedsModel_->dataField(feedIndex, "author_name").toString();
-        authorEmail = feedsModel_->dataField(feedIndex, "author_email").toString();
-        authorUri   = feedsModel_->dataField(feedIndex, "author_uri").toString();
+  // Date is formatted relative to today, labels may change without reloading
+  NewsHtmlCacheItem *item = newsHtmlCache_.object(key);
+  if (item && (item->labels == labels) && (item->layoutDirection == layoutDirection) &&
+      (item->date == QDate::currentDate())) {
+    return item->html;
+  }
 
-        authorString = authorName;
+  item = new NewsHtmlCacheItem;
+  item->html = newsHtml(row);
+  item->labels = labels;
+  item->layoutDirection = layoutDirection;
+  item->date = QDate::currentDate();
+  QString html = item->html;
+  newsHtmlCache_.insert(key, item, html.size() / 1024 + 1);
+  return html;
+}
 
-        if (!authorEmail.isEmpty())
-          authorString.append(QString(" <a href='mailto:%1'>e-mail</a>").arg(authorEmail));
-        if (!authorUri.isEmpty())
-          authorString.append(QString(" <a href='%1'>page</a>").arg(authorUri));
+/** @brief Drop cached previews of news marked with edited labels
+ * @param idLabels ids of labels whose name, color or image was changed
+ *----------------------------------------------------------------------------*/
+void NewsTabWidget::removeCachedLabels(const QStringList &idLabels)
+{
+  foreach (qint64 key, newsHtmlCache_.keys()) {
+    NewsHtmlCacheItem *item = newsHtmlCache_.object(key);
+    foreach (const QString &idLabel, idLabels) {
+      if (item->labels.contains(QString(",%1,").arg(idLabel))) {
+        newsHtmlCache_.remove(key);
+        break;
       }
+    }
+  }
+}
 
-      QString commentsStr;
-      QString commentsUrl = newsModel_->dataField(index.row(), "comments").toString();
+/** @brief Render neighbours of current news while user reads it
+ *----------------------------------------------------------------------------*/
+void NewsTabWidget::slotPrerenderNews()
+{
+  if ((type_ >= TabTypeWeb) || (mainWindow_->newsLayout_ == 1)) return;
 
-      if (!commentsUrl.isEmpty())
-      {
-        commentsStr = QString("<a href=\"%1\"> %2</a>").arg(commentsUrl, tr("Comments"));
-      }
+  QModelIndex index = newsView_->currentIndex();
+  if (!index.isValid()) return;
 
-      QString category = newsModel_->dataField(index.row(), "category").toString();
+  bool showDescriptionNews = mainWindow_->showDescriptionNews_;
+  QModelIndex feedIndex = feedsProxyModel_->mapToSource(feedsView_->currentIndex());
+  QVariant displayNews = feedsModel_->dataField(feedIndex, "displayNews");
+  if (!displayNews.toString().isEmpty())
+    showDescriptionNews = !displayNews.toInt();
+  if (!showDescriptionNews) return;
 
-      if (!authorString.isEmpty())
-      {
-        authorString = QString(tr("Author: %1")).arg(authorString);
+  if (index.row() + 1 < newsModel_->rowCount())
+    cachedNewsHtml(index.row() + 1);
+  if (index.row() > 0)
+    cachedNewsHtml(index.row() - 1);
+}
 
-        if (!commentsStr.isEmpty())
-        {
-          authorString.append(QString(" | %1").arg(commentsStr));
-        }
-        if (!category.isEmpty())
-        {
-          authorString.append(QString(" | %1").arg(category));
-        }
-      }
-      else
-      {
-        if (!commentsStr.isEmpty())
-        {
-          authorString.append(commentsStr);
-        }
+/** @brief Render news HTML for preview
+ *----------------------------------------------------------------------------*/
+QString NewsTabWidget::newsHtml(int row)
+{
+  NewspaperItem item = newspaperItem(row);
+  QModelIndex feedIndex = feedsModel_->indexById(newsModel_->dataField(row, "feedId").toInt());
+  bool ltr = !feedsModel_->dataField(feedIndex, "layoutDirection").toInt();
+  NewspaperOptions options = renderOptions(ltr);
 
-        if (!category.isEmpty())
-        {
-          if (!commentsStr.isEmpty())
-          {
-            authorString.append(QString(" | %1").arg(category));
-          }
-          else
-          {
-            authorString.append(category);
-          }
-        }
-      }
+  QString htmlStr;
+  QString content = NewspaperRenderer::contentHtml(item, options);
+  if (!NewspaperRenderer::isHtmlDocument(item.content)) {
+    QString titleString = item.title;
+    if (!item.link.isEmpty()) {
+      titleString = QString("<a href='%1' class='unread'>%2</a>").
+          arg(item.link, titleString);
+    }
 
-      QString labelsString = getHtmlLabels(index.row());
+    QString dateString = NewspaperRenderer::dateHtml(item, options);
+    QString authorString = NewspaperRenderer::authorHtml(item);
 
-      authorString.append(QString("<table class=\"labels\" id=\"labels%1\"><tr>%2</tr></table>").
-                          arg(newsId).arg(labelsString));
+    QString cssStr = cssString_.
+        arg(ltr ? "left" : "right").  // text-align
+        arg(ltr ? "ltr" : "rtl").    // direction
+        arg(ltr ? "right" : "left");  // "Date" text-align
 
-      QString enclosureStr;
-      QString enclosureUrl = newsModel_->dataField(index.row(), "enclosure_url").toString();
+    QUrl newsUrl = QUrl::fromEncoded(item.link.toUtf8());
+    QUrl url;
+    url.setScheme(newsUrl.scheme());
+    url.setHost(newsUrl.host());
+    if (url.host().indexOf('.') == -1) {
+      QUrl hostUrl = feedsModel_->dataField(feedIndex, "htmlUrl").toString();
+      url.setHost(hostUrl.host());
+    }
 
-      if (!enclosureUrl.isEmpty())
-      {
-        QString type = newsModel_->dataField(index.row(), "enclosure_type").toString();
+    if (ltr)
+      htmlStr = htmlString_.arg(cssStr, titleString, dateString, authorString, content, url.toString());
+    else
+      htmlStr = htmlRtlString_.arg(cssStr, titleString, dateString, authorString, content, url.toString());
+  } else {
+    htmlStr = content;
+  }
 
-        if (type.contains("image"))
-        {
-          if (!content.contains(enclosureUrl) && autoLoadImages_)
-          {
-            enclosureStr = QString("<IMG SRC=\"%1\" class=\"enclosureImg\"><p>").arg(enclosureUrl);
-          }
-        }
-        else
-        {
-          if (type.contains("audio"))
-          {
-            type = tr("audio");
-            enclosureStr = audioPlayerHtml_.arg(enclosureUrl);
-            enclosureStr.append("<p>");
-          }
-          else if (type.contains("video"))
-          {
-            type = tr("video");
-            enclosureStr = videoPlayerHtml_.arg(enclosureUrl);
-            enclosureStr.append("<p>");
-          }
-          else
-          {
-            type = tr("media");
-          }
+  return htmlStr.replace("src=\"//", "src=\"http://");
+}
 
-          enclosureStr.append(QString("<a href=\"%1\" class=\"enclosure\"> %2 %3 </a><p>").
-                              arg(enclosureUrl, tr("Link to"), type));
-        }
-      }
+/** @brief Options of news template for current settings
+ *----------------------------------------------------------------------------*/
+NewspaperOptions NewsTabWidget::renderOptions(bool ltr)
+{
+  NewspaperOptions options;
+  options.ltr = ltr;
+  options.autoLoadImages = autoLoadImages_;
+  options.formatDate = mainWindow_->formatDate_;
+  options.formatTime = mainWindow_->formatTime_;
+  options.itemHtml = newspaperHtml_;
+  options.itemHtmlRtl = newspaperHtmlRtl_;
+  options.audioPlayerHtml = audioPlayerHtml_;
+  options.videoPlayerHtml = videoPlayerHtml_;
+  return options;
+}
 
-      content = enclosureStr + content;
+/** @brief Create thread preparing newspaper layout HTML
+ *----------------------------------------------------------------------------*/
+void NewsTabWidget::createNewspaperRenderer()
+{
+  qRegisterMetaType<QList<NewspaperItem> >("QList<NewspaperItem>");
+  qRegisterMetaType<NewspaperOptions>("NewspaperOptions");
 
-      bool ltr = !feedsModel_->dataField(feedIndex, "layoutDirection").toInt();
-      QString cssStr = cssString_.
-          arg(ltr ? "left" : "right").  // text-align
-          arg(ltr ? "ltr" : "rtl").    // direction
-          arg(ltr ? "right" : "left");  // "Date" text-align
+  newspaperThread_ = new QThread();
+  newspaperThread_->setObjectName("newspaperThread_");
+  newspaperRenderer_ = new NewspaperRenderer();
+  newspaperRenderer_->moveToThread(newspaperThread_);
 
-      if (!autoLoadImages_) {
-        QzRegExp reg("<img[^>]+>", Qt::CaseInsensitive);
-        content = content.remove(reg);
-      }
+  connect(this, SIGNAL(signalRenderNewspaper(int,bool,QList<NewspaperItem>,NewspaperOptions)),
+          newspaperRenderer_, SLOT(renderItems(int,bool,QList<NewspaperItem>,NewspaperOptions)),
+          Qt::QueuedConnection);
+  connect(newspaperRenderer_, SIGNAL(itemsRendered(int,bool,QString)),
+          this, SLOT(slotNewspaperRendered(int,bool,QString)),
+          Qt::QueuedConnection);
 
-      QUrl url;
-      url.setScheme(newsUrl.scheme());
-      url.setHost(newsUrl.host());
-      if (url.host().indexOf('.') == -1) {
-        QUrl hostUrl = feedsModel_->dataField(feedIndex, "htmlUrl").toString();
-        url.setHost(hostUrl.host());
-      }
+  // QWebPage::scrollRequested() is not emitted when page has a view, so
+  // scroll position is polled while newspaper is not loaded completely
+  newspaperScrollTimer_ = new QTimer(this);
+  newspaperScrollTimer_->setInterval(250);
+  connect(newspaperScrollTimer_, SIGNAL(timeout()),
+          this, SLOT(slotNewspaperScrolled()));
+  connect(webView_->page()->mainFrame(), SIGNAL(contentsSizeChanged(QSize)),
+          this, SLOT(slotNewspaperScrolled()));
 
-      if (ltr)
-        htmlStr = htmlString_.arg(cssStr, titleString, dateString, authorString, content, url.toString());
-      else
-        htmlStr = htmlRtlString_.arg(cssStr, titleString, dateString, authorString, content, url.toString());
-    } else {
-      if (!autoLoadImages_) {
-        content = content.remove(QzRegExp("<img[^>]+>", Qt::CaseInsensitive));
-      }
+  newspaperThread_->start(QThread::LowPriority);
+}
 
-      htmlStr = content;
+/** @brief Take snapshot of news row for newspaper renderer
+ *----------------------------------------------------------------------------*/
+NewspaperItem NewsTabWidget::newspaperItem(int row)
+{
+  NewspaperItem item;
+  item.id = newsModel_->dataField(row, "id").toInt();
+  item.newState = newsModel_->dataField(row, "new").toInt();
+  item.readState = newsModel_->dataField(row, "read").toInt();
+  item.starred = newsModel_->dataField(row, "starred").toInt();
+  item.last = (row + 1 == newsModel_->rowCount()) && !newsModel_->canFetchMore();
+  item.title = newsModel_->dataField(row, "title").toString();
+  item.link = getLinkNews(row);
+  item.content = newsModel_->dataField(row, "content").toString();
+  item.description = newsModel_->dataField(row, "description").toString();
+  item.published = newsModel_->dataField(row, "published").toString();
+  item.received = newsModel_->dataField(row, "received").toString();
+  item.authorName = newsModel_->dataField(row, "author_name").toString();
+  item.authorEmail = newsModel_->dataField(row, "author_email").toString();
+  item.authorUri = newsModel_->dataField(row, "author_uri").toString();
+  item.comments = newsModel_->dataField(row, "comments").toString();
+  item.category = newsModel_->dataField(row, "category").toString();
+  item.labelsHtml = getHtmlLabels(row);
+  item.enclosureUrl = newsModel_->dataField(row, "enclosure_url").toString();
+  item.enclosureType = newsModel_->dataField(row, "enclosure_type").toString();
+
+  // @note(arhohryakov:2012.01.03) Author is got from current feed, because
+  //   news is belong to it
+  QModelIndex feedIndex = feedsModel_->indexById(newsModel_->dataField(row, "feedId").toInt());
+  item.feedImage = feedsModel_->dataField(feedIndex, "image").toByteArray();
+  item.feedAuthorName = feedsModel_->dataField(feedIndex, "author_name").toString();
+  item.feedAuthorEmail = feedsModel_->dataField(feedIndex, "author_email").toString();
+  item.feedAuthorUri = feedsModel_->dataField(feedIndex, "author_uri").toString();
+  return item;
+}
+
+/** @brief Send next \a count news not yet present in newspaper to renderer
+ *----------------------------------------------------------------------------*/
+void NewsTabWidget::fetchNewspaperItems(int count)
+{
+  QList<NewspaperItem> items;
+  while (items.count() < count) {
+    if (newspaperRows_ >= newsModel_->rowCount()) {
+      if (!newsModel_->canFetchMore())
+        break;
+      int rowCount = newsModel_->rowCount();
+      newsModel_->fetchMore();
+      if (rowCount == newsModel_->rowCount())
+        break;
+      continue;
     }
 
-    htmlStr = htmlStr.replace("src=\"//", "src=\"http://");
-
-    emit signalSetHtmlWebView(htmlStr);
+    int row = newspaperRows_++;
+    int newsId = newsModel_->dataField(row, "id").toInt();
+    if (newspaperIds_.contains(newsId))
+      continue;
+    newspaperIds_.insert(newsId);
+    items.append(newspaperItem(row));
   }
+
+  newspaperComplete_ = (newspaperRows_ >= newsModel_->rowCount()) &&
+      !newsModel_->canFetchMore();
+  if (items.isEmpty())
+    return;
+
+  newspaperPending_++;
+  emit signalRenderNewspaper(newspaperGeneration_, false, items, newspaperOptions_);
 }
 
+/** @brief Load news in newspaper layout
+ * @details News HTML is prepared in separate thread and appended in batches.
+ *   Only first batch is rendered at once, the rest is loaded on scrolling.
+ *----------------------------------------------------------------------------*/
 void NewsTabWidget::loadNewspaper(int refresh)
 {
   if (mainWindow_->newsLayout_ != 1) return;
   setWebToolbarVisible(false, false);
-  webView_->setUpdatesEnabled(false);
+
+  if (!newspaperRenderer_)
+    createNewspaperRenderer();
 
   int sortOrder = newsHeader_->sortIndicatorOrder();
-  int scrollBarValue = 0;
-  int height = 0;
-  if (refresh != RefreshAll) {
-    scrollBarValue = webView_->page()->mainFrame()->scrollBarValue(Qt::Vertical);
-    height = webView_->page()->mainFrame()->contentsSize().height();
-  }
-  webView_->settings()->setAttribute(QWebSettings::AutoLoadImages, true);
 
-  QString htmlStr;
   QUrl hostUrl;
   bool ltr = true;
 
@@ -1594,262 +1607,128 @@ void NewsTabWidget::loadNewspaper(int refresh)
     ltr = !feedsModel_->dataField(feedIndex, "layoutDirection").toInt();
   }
 
-  if ((refresh == RefreshAll) || (refresh == RefreshWithPos)) {
-    QString cssStr = cssString_.
-        arg(ltr ? "left" : "right"). // text-align
-        arg(ltr ? "ltr" : "rtl"). // direction
-        arg(ltr ? "right" : "left"); // "Date" text-align
-    htmlStr = newspaperHeadHtml_.arg(cssStr, hostUrl.toString());
+  newspaperOptions_ = renderOptions(ltr);
 
-    webView_->setHtml(htmlStr);
-  }
+  if (refresh == RefreshInsert) {
+    if (webView_->title() != "news_descriptions")
+      return;
 
-  int idx = -1;
-  if ((refresh == RefreshInsert) && (sortOrder == Qt::DescendingOrder))
-    idx = newsModel_->rowCount();
-  while (1) {
-    if ((refresh == RefreshInsert) && (sortOrder == Qt::DescendingOrder)) {
-      idx--;
-      if (idx < 0)
+    // Look for new news inside already loaded part of list: it ends after
+    // the last of news loaded before
+    QList<NewspaperItem> items;
+    int loadedRows = newspaperRows_;
+    int knownRows = 0;
+    for (int row = 0; row < newsModel_->rowCount(); ++row) {
+      if (!newspaperComplete_ && (knownRows >= loadedRows))
         break;
-    } else {
-      idx++;
-      if (idx >= newsModel_->rowCount())
-        break;
-    }
-
-    QModelIndex index = newsModel_->index(idx, newsModel_->fieldIndex("id"));
-    QString newsId = newsModel_->dataField(index.row(), "id").toString();
-
-    if (refresh == RefreshInsert) {
-      QWebElement document = webView_->page()->mainFrame()->documentElement();
-      QWebElement element = document.findFirst(QString("div[id=newsItem%1]").arg(newsId));
-      if (!element.isNull()) {
+      int newsId = newsModel_->dataField(row, "id").toInt();
+      if (newspaperIds_.contains(newsId)) {
+        knownRows++;
         continue;
       }
+      newspaperIds_.insert(newsId);
+      items.append(newspaperItem(row));
     }
+    if (items.isEmpty())
+      return;
+    newspaperRows_ += items.count();
 
-    linkNewsString_ = getLinkNews(index.row());
-    QString linkString = linkNewsString_;
-
-    QString content = newsModel_->dataField(index.row(), "content").toString();
-    if (!content.contains(QzRegExp("<html(.*)</html>", Qt::CaseInsensitive))) {
-      QString description = newsModel_->dataField(index.row(), "description").toString();
-      if (content.isEmpty() || (description.length() > content.length())) {
-        content = description;
-      }
-
-      //      QTextDocumentFragment textDocument = QTextDocumentFragment::fromHtml(content);
-      //      content = textDocument.toPlainText();
-      //      content = webView_->fontMetrics().elidedText(
-      //            content, Qt::ElideRight, 1500);
-
-      QString feedId = newsModel_->dataField(index.row(), "feedId").toString();
-      QModelIndex feedIndex = feedsModel_->indexById(feedId.toInt());
-
-      QString iconStr = "qrc:/images/bulletRead";
-      QString titleStyle = "read";
-      if (newsModel_->dataField(index.row(), "new").toInt() == 1) {
-        iconStr = "qrc:/images/bulletNew";
-        titleStyle = "unread";
-      } else if (newsModel_->dataField(index.row(), "read").toInt() == 0) {
-        iconStr = "qrc:/images/bulletUnread";
-        titleStyle = "unread";
-      }
-      QString readImg = QString("<a href=\"quiterss://read.action.ui?#%1\" title='%3'>"
-                                "<img class='quiterss-img' id=\"readAction%1\" src=\"%2\"/></a>").
-          arg(newsId).arg(iconStr).arg(tr("Mark Read/Unread"));
-
-      QString feedImg;
-      QByteArray byteArray = feedsModel_->dataField(feedIndex, "image").toByteArray();
-      if (!byteArray.isEmpty())
-        feedImg = QString("<img class='quiterss-img' src=\"data:image/png;base64,") % byteArray % "\"/>";
-      else
-        feedImg = QString("<img class='quiterss-img' src=\"qrc:/images/feed\"/>");
-
-      QString titleString = newsModel_->dataField(index.row(), "title").toString();
-      if (!linkString.isEmpty()) {
-        titleString = QString("<a href='%1' class='%2' id='title%3'>%4</a>").
-            arg(linkString, titleStyle, newsId, titleString);
-      }
-
-      QDateTime dtLocal;
-      QString dateString = newsModel_->dataField(index.row(), "published").toString();
-      if (!dateString.isNull()) {
-        QDateTime dtLocalTime = QDateTime::currentDateTime();
-        QDateTime dtUTC = QDateTime(dtLocalTime.date(), dtLocalTime.time(), Qt::UTC);
-        int nTimeShift = dtLocalTime.secsTo(dtUTC);
+    bool prepend = (sortOrder == Qt::DescendingOrder);
+    newspaperPending_++;
+    emit signalRenderNewspaper(newspaperGeneration_, prepend, items, newspaperOptions_);
+    return;
+  }
 
-        QDateTime dt = QDateTime::fromString(dateString, Qt::ISODate);
-        dtLocal = dt.addSecs(nTimeShift);
-      } else {
-        dtLocal = QDateTime::fromString(
-              newsModel_->dataField(index.row(), "received").toString(),
-              Qt::ISODate);
-      }
-      if (QDateTime::currentDateTime().date() <= dtLocal.date())
-        dateString = dtLocal.toString(mainWindow_->formatTime_);
-      else
-        dateString = dtLocal.toString(mainWindow_->formatDate_ + " " + mainWindow_->formatTime_);
-
-      // Create author panel from news author
-      QString authorString;
-      QString authorName = newsModel_->dataField(index.row(), "author_name").toString();
-      QString authorEmail = newsModel_->dataField(index.row(), "author_email").toString();
-      QString authorUri = newsModel_->dataField(index.row(), "author_uri").toString();
-
-      QzRegExp reg("(^\\S+@\\S+\\.\\S+)", Qt::CaseInsensitive);
-      int pos = reg.indexIn(authorName);
-      if (pos > -1) {
-        authorName.replace(reg.cap(1), QString(" <a href='mailto:%1'>%1</a>").arg(reg.cap(1)));
-      }
-      authorString = authorName;
-
-      if (!authorEmail.isEmpty())
-        authorString.append(QString(" <a href='mailto:%1'>e-mail</a>").arg(authorEmail));
-      if (!authorUri.isEmpty())
-        authorString.append(QString(" <a href='%1'>page</a>"). arg(authorUri));
-
-      // If news author is absent, create author panel from feed author
-      // @note(arhohryakov:2012.01.03) Author is got from current feed, because
-      //   news is belong to it
-      if (authorString.isEmpty()) {
-        authorName  = feedsModel_->dataField(feedIndex, "author_name").toString();
-        authorEmail = feedsModel_->dataField(feedIndex, "author_email").toString();
-        authorUri   = feedsModel_->dataField(feedIndex, "author_uri").toString();
-
-        authorString = authorName;
-        if (!authorEmail.isEmpty())
-          authorString.append(QString(" <a href='mailto:%1'>e-mail</a>").arg(authorEmail));
-        if (!authorUri.isEmpty())
-          authorString.append(QString(" <a href='%1'>page</a>").arg(authorUri));
-      }
+  int count = NEWSPAPER_BATCH;
+  if (refresh == RefreshWithPos) {
+    newspaperScrollValue_ = webView_->page()->mainFrame()->scrollBarValue(Qt::Vertical);
+    count = qMax(count, newspaperRows_);
+  } else {
+    newspaperScrollValue_ = -1;
+  }
 
-      QString commentsStr;
-      QString commentsUrl = newsModel_->dataField(index.row(), "comments").toString();
-      if (!commentsUrl.isEmpty()) {
-        commentsStr = QString("<a href=\"%1\"> %2</a>").arg(commentsUrl, tr("Comments"));
-      }
+  newspaperGeneration_++;
+  newspaperIds_.clear();
+  newspaperRows_ = 0;
+  newspaperPending_ = 0;
+  newspaperComplete_ = false;
 
-      QString category = newsModel_->dataField(index.row(), "category").toString();
+  webView_->setUpdatesEnabled(false);
 
-      if (!authorString.isEmpty()) {
-        authorString = QString(tr("Author: %1")).arg(authorString);
-        if (!commentsStr.isEmpty())
-          authorString.append(QString(" | %1").arg(commentsStr));
-        if (!category.isEmpty())
-          authorString.append(QString(" | %1").arg(category));
-      } else {
-        if (!commentsStr.isEmpty())
-          authorString.append(commentsStr);
-        if (!category.isEmpty()) {
-          if (!commentsStr.isEmpty())
-            authorString.append(QString(" | %1").arg(category));
-          else
-            authorString.append(category);
-        }
-      }
+  QString cssStr = cssString_.
+      arg(ltr ? "left" : "right"). // text-align
+      arg(ltr ? "ltr" : "rtl"). // direction
+      arg(ltr ? "right" : "left"); // "Date" text-align
+  QString htmlStr = newspaperHeadHtml_.arg(cssStr, hostUrl.toString());
 
-      QString labelsString = getHtmlLabels(index.row());
-      authorString.append(QString("<table class=\"labels\" id=\"labels%1\"><tr>%2</tr></table>").
-                          arg(newsId).arg(labelsString));
-
-      QString enclosureStr;
-      QString enclosureUrl = newsModel_->dataField(index.row(), "enclosure_url").toString();
-      if (!enclosureUrl.isEmpty()) {
-        QString type = newsModel_->dataField(index.row(), "enclosure_type").toString();
-        if (type.contains("image")) {
-          if (!content.contains(enclosureUrl) && autoLoadImages_) {
-            enclosureStr = QString("<IMG SRC=\"%1\" class=\"enclosureImg\"><p>").
-                arg(enclosureUrl);
-          }
-        } else {
-          if (type.contains("audio")) {
-            type = tr("audio");
-            enclosureStr = audioPlayerHtml_.arg(enclosureUrl);
-            enclosureStr.append("<p>");
-          }
-          else if (type.contains("video")) {
-            type = tr("video");
-            enclosureStr = videoPlayerHtml_.arg(enclosureUrl);
-            enclosureStr.append("<p>");
-          }
-          else type = tr("media");
+  webView_->setHtml(htmlStr);
 
-          enclosureStr.append(QString("<a href=\"%1\" class=\"enclosure\"> %2 %3 </a><p>").
-                              arg(enclosureUrl, tr("Link to"), type));
-        }
-      }
+  fetchNewspaperItems(count);
+  if (!newspaperPending_)
+    webView_->setUpdatesEnabled(true);
+  if (!newspaperComplete_)
+    newspaperScrollTimer_->start();
+}
 
-      content = enclosureStr + content;
+/** @brief Insert batch of news prepared by renderer into newspaper
+ *----------------------------------------------------------------------------*/
+void NewsTabWidget::slotNewspaperRendered(int generation, bool prepend, const QString &html)
+{
+  if (generation != newspaperGeneration_) return;
+  newspaperPending_--;
 
-      if (!autoLoadImages_) {
-        QzRegExp reg("<img[^>]+>", Qt::CaseInsensitive);
-        content = content.remove(reg);
-      }
+  if ((mainWindow_->newsLayout_ == 1) && (webView_->title() == "news_descriptions")) {
+    QWebFrame *frame = webView_->page()->mainFrame();
+    int scrollBarValue = frame->scrollBarValue(Qt::Vertical);
+    int height = frame->contentsSize().height();
 
-      iconStr = "qrc:/images/starOff";
-      if (newsModel_->dataField(index.row(), "starred").toInt() == 1) {
-        iconStr = "qrc:/images/starOn";
-      }
-      QString starAction = QString("<div class=\"star-action\">"
-                                   "<a href=\"quiterss://star.action.ui?#%1\" title='%3'>"
-                                   "<img class='quiterss-img' id=\"starAction%1\" src=\"%2\"/></a></div>").
-          arg(newsId).arg(iconStr).arg(tr("Mark News Star"));
-      QString labelsMenu = QString("<div class=\"labels-menu\">"
-                                   "<a href=\"quiterss://labels.menu.ui?#%1\" title='%2'>"
-                                   "<img class='quiterss-img' id=\"labelsMenu%1\" src=\"qrc:/images/label_5\"/></a></div>").
-          arg(newsId).arg(tr("Label"));
-      QString shareMenu = QString("<div class=\"share-menu\">"
-                                  "<a href=\"quiterss://share.menu.ui?#%1\" title='%2'>"
-                                  "<img class='quiterss-img' id=\"shareMenu%1\" src=\"qrc:/images/images/share.png\"/></a></div>").
-          arg(newsId).arg(tr("Share"));
-      QString openBrowserAction = QString("<div class=\"open-browser\">"
-                                          "<a href=\"quiterss://open.browser.ui?#%1\" title='%2'>"
-                                          "<img class='quiterss-img' id=\"openBrowser%1\" src=\"qrc:/images/openBrowser\"'/></a></div>").
-          arg(newsId).arg(tr("Open News in External Browser"));
-      QString deleteAction = QString("<div class=\"delete-action\">"
-                                     "<a href=\"quiterss://delete.action.ui?#%1\" title='%2'>"
-                                     "<img class='quiterss-img' id=\"deleteAction%1\" src=\"qrc:/images/delete\"/></a></div>").
-          arg(newsId).arg(tr("Delete"));
-      QString actionNews = starAction % labelsMenu % shareMenu % openBrowserAction %
-          deleteAction;
-
-      QString border = "1";
-      if (idx + 1 == newsModel_->rowCount())
-        border = "0";
-      if (ltr) {
-        htmlStr = newspaperHtml_.arg(newsId, border, readImg, feedImg, titleString,
-                                     dateString, authorString, content, actionNews);
-      } else {
-        htmlStr = newspaperHtmlRtl_.arg(newsId, border, readImg, feedImg, titleString,
-                                        dateString, authorString, content, actionNews);
-      }
+    webView_->settings()->setAttribute(QWebSettings::AutoLoadImages, true);
+    QWebElement element = frame->documentElement().findFirst("body");
+    if (prepend) {
+      element.prependInside(html);
     } else {
-      if (!autoLoadImages_) {
-        content = content.remove(QzRegExp("<img[^>]+>", Qt::CaseInsensitive));
-      }
-      htmlStr = content;
+      // Former last item is followed by new ones now, restore its border
+      QWebElementCollection tables = element.findAll("div[id^=newsItem] > table.newsTable");
+      if (tables.count())
+        tables.last().setStyleProperty("border-bottom-width", "1px");
+      element.appendInside(html);
     }
+    webView_->settings()->setAttribute(QWebSettings::AutoLoadImages, autoLoadImages_);
 
-    htmlStr = htmlStr.replace("src=\"//", "src=\"http://");
+    if (prepend) {
+      scrollBarValue += frame->contentsSize().height() - height;
+      frame->setScrollBarValue(Qt::Vertical, scrollBarValue);
+    } else if (newspaperScrollValue_ != -1) {
+      frame->setScrollBarValue(Qt::Vertical, newspaperScrollValue_);
+      newspaperScrollValue_ = -1;
+    }
+  }
 
-    QWebElement document = webView_->page()->mainFrame()->documentElement();
-    QWebElement element = document.findFirst("body");
-    if ((refresh == RefreshInsert) && (sortOrder == Qt::DescendingOrder))
-      element.prependInside(htmlStr);
-    else
-      element.appendInside(htmlStr);
-    qApp->processEvents();
+  if (newspaperPending_ <= 0) {
+    newspaperPending_ = 0;
+    webView_->setUpdatesEnabled(true);
+    // Fill viewport if loaded news are not enough for it
+    slotNewspaperScrolled();
   }
+}
 
-  webView_->settings()->setAttribute(QWebSettings::AutoLoadImages, autoLoadImages_);
-  if ((refresh == RefreshInsert) && (sortOrder == Qt::DescendingOrder))
-    scrollBarValue += webView_->page()->mainFrame()->contentsSize().height() - height;
-  if (refresh != RefreshAll)
-    webView_->page()->mainFrame()->setScrollBarValue(Qt::Vertical, scrollBarValue);
+/** @brief Load next batch of news when newspaper is scrolled near the end
+ *----------------------------------------------------------------------------*/
+void NewsTabWidget::slotNewspaperScrolled()
+{
+  if ((mainWindow_->newsLayout_ != 1) || newspaperComplete_) {
+    if (newspaperScrollTimer_)
+      newspaperScrollTimer_->stop();
+    return;
+  }
+  if ((webView_->title() != "news_descriptions") || newspaperPending_)
+    return;
 
-  webView_->setUpdatesEnabled(true);
+  QWebFrame *frame = webView_->page()->mainFrame();
+  int remaining = frame->scrollBarMaximum(Qt::Vertical) -
+      frame->scrollBarValue(Qt::Vertical);
+  if (remaining < 2 * webView_->height())
+    fetchNewspaperItems(NEWSPAPER_BATCH);
 }
 
 /** @brief Asynchorous update web view
@@ -2455,7 +2334,7 @@ void NewsTabWidget::setLabelNews(int labelId)
       }
     }
 
-    db_.transaction();
+    QList<int> idList;
     for (int i = cnt-1; i >= 0; --i) {
       QModelIndex index = indexes.at(i);
       QString strIdLabels = index.data(Qt::EditRole).toString();
@@ -2470,6 +2349,7 @@ void NewsTabWidget::setLabelNews(int labelId)
       newsModel_->setData(index, strIdLabels);
 
       int newsId = newsModel_->dataField(index.row(), "id").toInt();
+      idList.append(newsId);
 
       if ((newsId == currentNewsIdOld) &&
           (webView_->title() == "news_descriptions")) {
@@ -2483,15 +2363,14 @@ void NewsTabWidget::setLabelNews(int labelId)
         }
       }
 
-      QSqlQuery q;
-      q.exec(QString("UPDATE news SET label='%1' WHERE id=='%2'").
-             arg(strIdLabels).arg(newsId));
       if (newsId != currentNewsIdOld) {
         newsView_->selectionModel()->select(
               index, QItemSelectionModel::Deselect|QItemSelectionModel::Rows);
       }
     }
-    db_.commit();
+
+    NewsStateUpdater updater(db_);
+    updater.setLabel(idList, labelId, setLabel);
   }
   newsView_->viewport()->update();
   mainWindow_->recountCategoryCounts();
@@ -2846,6 +2725,7 @@ void NewsTabWidget::savePageAsDescript()
   if (!curIndex.isValid()) return;
 
   QString html = webView_->page()->currentFrame()->toHtml().replace("'", "''");
+  newsHtmlVersion_++;
   newsModel_->setData(
         newsModel_->index(curIndex.row(), newsModel_->fieldIndex("content")),
         html);
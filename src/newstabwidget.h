@@ -34,6 +34,7 @@
 #include "locationbar.h"
 #include "newsheader.h"
 #include "newsmodel.h"
+#include "newspaperrenderer.h"
 #include "newsview.h"
 #include "webview.h"
 
@@ -46,6 +47,8 @@ class MainWindow;
 
 #define RESIZESTEP 25   // News list/browser size step
 
+#define NEWSPAPER_BATCH 30  // News rendered per newspaper batch
+
 class NewsTabWidget : public QWidget
 {
   Q_OBJECT
@@ -95,6 +98,7 @@ public:
   void loadNewspaper(int refresh = RefreshAll);
   void hideWebContent();
   QString getLinkNews(int row);
+  void removeCachedLabels(const QStringList &idLabels);
 
   void reduceNewsList();
   void increaseNewsList();
@@ -157,6 +161,8 @@ public slots:
 
 signals:
   void signalSetHtmlWebView(const QString &html = "", const QUrl &baseUrl = QUrl());
+  void signalRenderNewspaper(int generation, bool prepend,
+                             QList<NewspaperItem> items, NewspaperOptions options);
   void signalSetTextTab(const QString &text, NewsTabWidget *widget);
   void loadProgress(int);
 
@@ -192,11 +198,21 @@ private slots:
 
   void slotNewslLabelClicked(QModelIndex index);
 
+  void slotNewspaperRendered(int generation, bool prepend, const QString &html);
+  void slotNewspaperScrolled();
+  void slotPrerenderNews();
+
 private:
   void createNewsList();
   void createWebWidget();
   QString getHtmlLabels(int row);
   void actionNewspaper(QUrl url);
+  void createNewspaperRenderer();
+  NewspaperItem newspaperItem(int row);
+  NewspaperOptions renderOptions(bool ltr);
+  void fetchNewspaperItems(int count);
+  QString newsHtml(int row);
+  QString cachedNewsHtml(int row);
 
   MainWindow *mainWindow_;
   QSqlDatabase db_;
@@ -234,6 +250,27 @@ private:
   QString audioPlayerHtml_;
   QString videoPlayerHtml_;
 
+  QThread *newspaperThread_;
+  NewspaperRenderer *newspaperRenderer_;
+  QTimer *newspaperScrollTimer_;
+  NewspaperOptions newspaperOptions_;
+  QSet<int> newspaperIds_;
+  int newspaperGeneration_;
+  int newspaperRows_;
+  int newspaperPending_;
+  int newspaperScrollValue_;
+  bool newspaperComplete_;
+
+  struct NewsHtmlCacheItem {
+    QString html;
+    QString labels;
+    int layoutDirection;
+    QDate date;
+  };
+  QCache<qint64, NewsHtmlCacheItem> newsHtmlCache_;
+  int newsHtmlVersion_;
+  QTimer *prerenderTimer_;
+
 };
 
 #endif // NEWSTABWIDGET_H
@@ -0,0 +1,261 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include "newspaperrenderer.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QStringBuilder>
+#include <qzregexp.h>
+
+// Strings are kept in the NewsTabWidget context to reuse existing translations
+#define NTR(x) QCoreApplication::translate("NewsTabWidget", x)
+
+NewspaperRenderer::NewspaperRenderer(QObject *parent)
+  : QObject(parent)
+{
+}
+
+/** @brief Render batch of items and return it as one HTML fragment
+ *----------------------------------------------------------------------------*/
+void NewspaperRenderer::renderItems(int generation, bool prepend,
+                                    QList<NewspaperItem> items, NewspaperOptions options)
+{
+  QString html;
+  foreach (const NewspaperItem &item, items) {
+    html.append(renderItem(item, options));
+  }
+  emit itemsRendered(generation, prepend, html);
+}
+
+/** @brief Check that content is a complete HTML document
+ * @details Equivalent of matching "<html(.*)</html>" without regexp
+ *----------------------------------------------------------------------------*/
+bool NewspaperRenderer::isHtmlDocument(const QString &content)
+{
+  int pos = content.indexOf("<html", 0, Qt::CaseInsensitive);
+  if (pos < 0)
+    return false;
+  return (content.indexOf("</html>", pos + 5, Qt::CaseInsensitive) >= 0);
+}
+
+/** @brief Item body: content or description with enclosure prepended
+ * @details Complete HTML documents are returned as is. Images are removed
+ *   when auto loading of images is switched off.
+ *----------------------------------------------------------------------------*/
+QString NewspaperRenderer::contentHtml(const NewspaperItem &item, const NewspaperOptions &options)
+{
+  QString content = item.content;
+
+  if (!isHtmlDocument(content)) {
+    if (content.isEmpty() || (item.description.length() > content.length())) {
+      content = item.description;
+    }
+
+    QString enclosureStr;
+    if (!item.enclosureUrl.isEmpty()) {
+      QString type = item.enclosureType;
+      if (type.contains("image")) {
+        if (!content.contains(item.enclosureUrl) && options.autoLoadImages) {
+          enclosureStr = QString("<IMG SRC=\"%1\" class=\"enclosureImg\"><p>").
+              arg(item.enclosureUrl);
+        }
+      } else {
+        if (type.contains("audio")) {
+          type = NTR("audio");
+          enclosureStr = options.audioPlayerHtml.arg(item.enclosureUrl);
+          enclosureStr.append("<p>");
+        }
+        else if (type.contains("video")) {
+          type = NTR("video");
+          enclosureStr = options.videoPlayerHtml.arg(item.enclosureUrl);
+          enclosureStr.append("<p>");
+        }
+        else type = NTR("media");
+
+        enclosureStr.append(QString("<a href=\"%1\" class=\"enclosure\"> %2 %3 </a><p>").
+                            arg(item.enclosureUrl, NTR("Link to"), type));
+      }
+    }
+
+    content = enclosureStr + content;
+  }
+
+  if (!options.autoLoadImages) {
+    content = content.remove(QzRegExp("<img[^>]+>", Qt::CaseInsensitive));
+  }
+
+  return content;
+}
+
+/** @brief Item date in local time: only time for today's news
+ *----------------------------------------------------------------------------*/
+QString NewspaperRenderer::dateHtml(const NewspaperItem &item, const NewspaperOptions &options)
+{
+  QDateTime dtLocal;
+  if (!item.published.isNull()) {
+    QDateTime dtLocalTime = QDateTime::currentDateTime();
+    QDateTime dtUTC = QDateTime(dtLocalTime.date(), dtLocalTime.time(), Qt::UTC);
+    int nTimeShift = dtLocalTime.secsTo(dtUTC);
+
+    QDateTime dt = QDateTime::fromString(item.published, Qt::ISODate);
+    dtLocal = dt.addSecs(nTimeShift);
+  } else {
+    dtLocal = QDateTime::fromString(item.received, Qt::ISODate);
+  }
+  if (QDateTime::currentDateTime().date() <= dtLocal.date())
+    return dtLocal.toString(options.formatTime);
+  else
+    return dtLocal.toString(options.formatDate + " " + options.formatTime);
+}
+
+/** @brief Author panel: author, comments, category and labels of item
+ *----------------------------------------------------------------------------*/
+QString NewspaperRenderer::authorHtml(const NewspaperItem &item)
+{
+  // Create author panel from news author
+  QString authorString;
+  QString authorName = item.authorName;
+
+  if (authorName.contains('@')) {
+    QzRegExp reg("(^\\S+@\\S+\\.\\S+)", Qt::CaseInsensitive);
+    int pos = reg.indexIn(authorName);
+    if (pos > -1) {
+      authorName.replace(reg.cap(1), QString(" <a href='mailto:%1'>%1</a>").arg(reg.cap(1)));
+    }
+  }
+  authorString = authorName;
+
+  if (!item.authorEmail.isEmpty())
+    authorString.append(QString(" <a href='mailto:%1'>e-mail</a>").arg(item.authorEmail));
+  if (!item.authorUri.isEmpty())
+    authorString.append(QString(" <a href='%1'>page</a>"). arg(item.authorUri));
+
+  // If news author is absent, create author panel from feed author
+  if (authorString.isEmpty()) {
+    authorString = item.feedAuthorName;
+    if (!item.feedAuthorEmail.isEmpty())
+      authorString.append(QString(" <a href='mailto:%1'>e-mail</a>").arg(item.feedAuthorEmail));
+    if (!item.feedAuthorUri.isEmpty())
+      authorString.append(QString(" <a href='%1'>page</a>").arg(item.feedAuthorUri));
+  }
+
+  QString commentsStr;
+  if (!item.comments.isEmpty()) {
+    commentsStr = QString("<a href=\"%1\"> %2</a>").arg(item.comments, NTR("Comments"));
+  }
+
+  const QString &category = item.category;
+
+  if (!authorString.isEmpty()) {
+    authorString = QString(NTR("Author: %1")).arg(authorString);
+    if (!commentsStr.isEmpty())
+      authorString.append(QString(" | %1").arg(commentsStr));
+    if (!category.isEmpty())
+      authorString.append(QString(" | %1").arg(category));
+  } else {
+    if (!commentsStr.isEmpty())
+      authorString.append(commentsStr);
+    if (!category.isEmpty()) {
+      if (!commentsStr.isEmpty())
+        authorString.append(QString(" | %1").arg(category));
+      else
+        authorString.append(category);
+    }
+  }
+
+  authorString.append(QString("<table class=\"labels\" id=\"labels%1\"><tr>%2</tr></table>").
+                      arg(item.id).arg(item.labelsHtml));
+  return authorString;
+}
+
+QString NewspaperRenderer::renderItem(const NewspaperItem &item, const NewspaperOptions &options)
+{
+  QString htmlStr;
+  QString newsId = QString::number(item.id);
+  QString content = contentHtml(item, options);
+
+  if (!isHtmlDocument(item.content)) {
+    QString iconStr = "qrc:/images/bulletRead";
+    QString titleStyle = "read";
+    if (item.newState == 1) {
+      iconStr = "qrc:/images/bulletNew";
+      titleStyle = "unread";
+    } else if (item.readState == 0) {
+      iconStr = "qrc:/images/bulletUnread";
+      titleStyle = "unread";
+    }
+    QString readImg = QString("<a href=\"quiterss://read.action.ui?#%1\" title='%3'>"
+                              "<img class='quiterss-img' id=\"readAction%1\" src=\"%2\"/></a>").
+        arg(newsId).arg(iconStr).arg(NTR("Mark Read/Unread"));
+
+    QString feedImg;
+    if (!item.feedImage.isEmpty())
+      feedImg = QString("<img class='quiterss-img' src=\"data:image/png;base64,") % item.feedImage % "\"/>";
+    else
+      feedImg = QString("<img class='quiterss-img' src=\"qrc:/images/feed\"/>");
+
+    QString titleString = item.title;
+    if (!item.link.isEmpty()) {
+      titleString = QString("<a href='%1' class='%2' id='title%3'>%4</a>").
+          arg(item.link, titleStyle, newsId, titleString);
+    }
+
+    QString dateString = dateHtml(item, options);
+    QString authorString = authorHtml(item);
+
+    iconStr = "qrc:/images/starOff";
+    if (item.starred == 1) {
+      iconStr = "qrc:/images/starOn";
+    }
+    QString starAction = QString("<div class=\"star-action\">"
+                                 "<a href=\"quiterss://star.action.ui?#%1\" title='%3'>"
+                                 "<img class='quiterss-img' id=\"starAction%1\" src=\"%2\"/></a></div>").
+        arg(newsId).arg(iconStr).arg(NTR("Mark News Star"));
+    QString labelsMenu = QString("<div class=\"labels-menu\">"
+                                 "<a href=\"quiterss://labels.menu.ui?#%1\" title='%2'>"
+                                 "<img class='quiterss-img' id=\"labelsMenu%1\" src=\"qrc:/images/label_5\"/></a></div>").
+        arg(newsId).arg(NTR("Label"));
+    QString shareMenu = QString("<div class=\"share-menu\">"
+                                "<a href=\"quiterss://share.menu.ui?#%1\" title='%2'>"
+                                "<img class='quiterss-img' id=\"shareMenu%1\" src=\"qrc:/images/images/share.png\"/></a></div>").
+        arg(newsId).arg(NTR("Share"));
+    QString openBrowserAction = QString("<div class=\"open-browser\">"
+                                        "<a href=\"quiterss://open.browser.ui?#%1\" title='%2'>"
+                                        "<img class='quiterss-img' id=\"openBrowser%1\" src=\"qrc:/images/openBrowser\"'/></a></div>").
+        arg(newsId).arg(NTR("Open News in External Browser"));
+    QString deleteAction = QString("<div class=\"delete-action\">"
+                                   "<a href=\"quiterss://delete.action.ui?#%1\" title='%2'>"
+                                   "<img class='quiterss-img' id=\"deleteAction%1\" src=\"qrc:/images/delete\"/></a></div>").
+        arg(newsId).arg(NTR("Delete"));
+    QString actionNews = starAction % labelsMenu % shareMenu % openBrowserAction %
+        deleteAction;
+
+    QString border = item.last ? "0" : "1";
+    if (options.ltr) {
+      htmlStr = options.itemHtml.arg(newsId, border, readImg, feedImg, titleString,
+                                     dateString, authorString, content, actionNews);
+    } else {
+      htmlStr = options.itemHtmlRtl.arg(newsId, border, readImg, feedImg, titleString,
+                                        dateString, authorString, content, actionNews);
+    }
+  } else {
+    htmlStr = content;
+  }
+
+  return htmlStr.replace("src=\"//", "src=\"http://");
+}
@@ -0,0 +1,98 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#ifndef NEWSPAPERRENDERER_H
+#define NEWSPAPERRENDERER_H
+
+#include <QObject>
+#include <QMetaType>
+#include <QStringList>
+
+/*! \brief Snapshot of one news row taken on the GUI thread.
+ *
+ * Everything the newspaper template needs is copied here, so the renderer
+ * never touches NewsModel/FeedsModel from its own thread.
+ */
+struct NewspaperItem {
+  int id;
+  int newState;
+  int readState;
+  int starred;
+  bool last;
+  QString title;
+  QString link;
+  QString content;
+  QString description;
+  QString published;
+  QString received;
+  QString authorName;
+  QString authorEmail;
+  QString authorUri;
+  QString feedAuthorName;
+  QString feedAuthorEmail;
+  QString feedAuthorUri;
+  QByteArray feedImage;
+  QString comments;
+  QString category;
+  QString labelsHtml;
+  QString enclosureUrl;
+  QString enclosureType;
+};
+
+/*! \brief Layout settings shared by all items of one render batch */
+struct NewspaperOptions {
+  bool ltr;
+  bool autoLoadImages;
+  QString formatDate;
+  QString formatTime;
+  QString itemHtml;
+  QString itemHtmlRtl;
+  QString audioPlayerHtml;
+  QString videoPlayerHtml;
+};
+
+Q_DECLARE_METATYPE(NewspaperItem)
+Q_DECLARE_METATYPE(NewspaperOptions)
+
+/*! \brief Builds newspaper layout HTML fragments off the GUI thread.
+ *
+ * Lives in its own thread. Each batch is tagged with the generation number
+ * of the page it was requested for; NewsTabWidget drops batches whose page
+ * has been reloaded in the meantime.
+ */
+class NewspaperRenderer : public QObject
+{
+  Q_OBJECT
+public:
+  explicit NewspaperRenderer(QObject *parent = 0);
+
+  static QString renderItem(const NewspaperItem &item, const NewspaperOptions &options);
+  static bool isHtmlDocument(const QString &content);
+  static QString contentHtml(const NewspaperItem &item, const NewspaperOptions &options);
+  static QString dateHtml(const NewspaperItem &item, const NewspaperOptions &options);
+  static QString authorHtml(const NewspaperItem &item);
+
+public slots:
+  void renderItems(int generation, bool prepend,
+                   QList<NewspaperItem> items, NewspaperOptions options);
+
+signals:
+  void itemsRendered(int generation, bool prepend, const QString &html);
+
+};
+
+#endif // NEWSPAPERRENDERER_H
@@ -24,8 +24,7 @@
 
 NotificationWidget::NotificationWidget(QList<int> idFeedList,
                                        QList<int> cntNewNewsList,
-                                       QList<int> idColorList,
-                                       QStringList colorList,
+                                       const QHash<int, QString> &newsColors,
                                        QWidget *parentWidget,
                                        QWidget *parent)
   : QWidget(parent)
@@ -290,9 +289,9 @@ NotificationWidget::NotificationWidget(QList<int> idFeedList,
         NewsItem *newsItem = new NewsItem(idFeed, idNews, widthList, this);
         newsItem->setFontText(QFont(fontFamily, fontSize, QFont::Bold));
         newsItem->setText(q.value(1).toString());
-        int index = idColorList.indexOf(idNews);
-        if (index != -1)
-          newsItem->setColorText(colorList.at(index), linkColor);
+        QHash<int, QString>::const_iterator colorIt = newsColors.constFind(idNews);
+        if (colorIt != newsColors.constEnd())
+          newsItem->setColorText(colorIt.value(), linkColor);
         else
           newsItem->setColorText(textColor, linkColor);
         newsItem->iconLabel_->setPixmap(icon);
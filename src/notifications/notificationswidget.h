@@ -33,8 +33,7 @@ class NotificationWidget : public QWidget
 public:
   NotificationWidget(QList<int> idFeedList,
                      QList<int> cntNewNewsList,
-                     QList<int> idColorList,
-                     QStringList colorList,
+                     const QHash<int, QString> &newsColors,
                      QWidget *parentWidget,
                      QWidget *parent = 0);
   ~NotificationWidget();
@@ -479,6 +479,13 @@ void OptionsDialog::createNetworkConnectionsWidget()
   numberRequests_->setRange(1, 10);
   numberRepeats_ = new QSpinBox();
   numberRepeats_->setRange(1, 10);
+  streamParsing_ = new QCheckBox(tr("Parse feeds while downloading"));
+  websubEnable_ = new QCheckBox(tr("Receive updates pushed by hubs (WebSub)"));
+  websubCallbackUrl_ = new LineEdit();
+  websubCallbackUrl_->setPlaceholderText("http://example.com:8090");
+  websubCallbackUrl_->setToolTip(tr("Address at which hubs reach this computer"));
+  websubPort_ = new QSpinBox();
+  websubPort_->setRange(1, 65535);
 
   QGridLayout *requestLayout = new QGridLayout();
   requestLayout->setColumnStretch(1, 1);
@@ -489,6 +496,12 @@ void OptionsDialog::createNetworkConnectionsWidget()
   requestLayout->addWidget(numberRequests_, 1, 1, 1, 1, Qt::AlignLeft);
   requestLayout->addWidget(new QLabel(tr("Number of retries:")), 2, 0);
   requestLayout->addWidget(numberRepeats_, 2, 1, 1, 1, Qt::AlignLeft);
+  requestLayout->addWidget(streamParsing_, 3, 0, 1, 2);
+  requestLayout->addWidget(websubEnable_, 4, 0, 1, 2);
+  requestLayout->addWidget(new QLabel(tr("Callback address:")), 5, 0);
+  requestLayout->addWidget(websubCallbackUrl_, 5, 1);
+  requestLayout->addWidget(new QLabel(tr("Listening port:")), 6, 0);
+  requestLayout->addWidget(websubPort_, 6, 1, 1, 1, Qt::AlignLeft);
 
   networkConnectionsLayout->addWidget(new QLabel(tr("Options network requests when updating feeds (requires program restart):")));
   networkConnectionsLayout->addLayout(requestLayout);
@@ -618,23 +631,48 @@ void OptionsDialog::createBrowserWidget()
   historyLayout2->addWidget(dirDiskCacheEdit_, 1);
   historyLayout2->addWidget(dirDiskCacheButton_);
 
-  maxDiskCache_ = new QSpinBox();
-  maxDiskCache_->setRange(10, 300);
-
-  QHBoxLayout *historyLayout3 = new QHBoxLayout();
-  historyLayout3->addWidget(new QLabel(tr("Maximum size of disk cache")));
-  historyLayout3->addWidget(maxDiskCache_);
-  historyLayout3->addWidget(new QLabel(tr("MB")), 1);
+  maxDiskCachePages_ = new QSpinBox();
+  maxDiskCachePages_->setRange(1, 1000);
+  maxDiskCacheImages_ = new QSpinBox();
+  maxDiskCacheImages_->setRange(1, 1000);
+  maxDiskCacheMedia_ = new QSpinBox();
+  maxDiskCacheMedia_->setRange(1, 1000);
+
+  QGridLayout *historyLayout3 = new QGridLayout();
+  historyLayout3->setColumnStretch(3, 1);
+  historyLayout3->addWidget(new QLabel(tr("Maximum size of disk cache:")), 0, 0, 1, 4);
+  historyLayout3->addWidget(new QLabel(tr("pages, styles, scripts")), 1, 0);
+  historyLayout3->addWidget(maxDiskCachePages_, 1, 1);
+  historyLayout3->addWidget(new QLabel(tr("MB")), 1, 2);
+  historyLayout3->addWidget(new QLabel(tr("images")), 2, 0);
+  historyLayout3->addWidget(maxDiskCacheImages_, 2, 1);
+  historyLayout3->addWidget(new QLabel(tr("MB")), 2, 2);
+  historyLayout3->addWidget(new QLabel(tr("audio, video, documents")), 3, 0);
+  historyLayout3->addWidget(maxDiskCacheMedia_, 3, 1);
+  historyLayout3->addWidget(new QLabel(tr("MB")), 3, 2);
+
+  offlineFirstCache_ = new QCheckBox(tr("Open viewed pages from cache without checking for changes"));
+  diskCacheStats_ = new QLabel();
 
   QVBoxLayout *historyLayout4 = new QVBoxLayout();
   historyLayout4->addLayout(historyLayout2);
   historyLayout4->addLayout(historyLayout3);
+  historyLayout4->addWidget(offlineFirstCache_);
+  historyLayout4->addWidget(diskCacheStats_);
 
   diskCacheOn_ = new QGroupBox(tr("Use disk cache"));
   diskCacheOn_->setCheckable(true);
   diskCacheOn_->setChecked(false);
   diskCacheOn_->setLayout(historyLayout4);
 
+  prefetchImagesMaxSize_ = new QSpinBox();
+  prefetchImagesMaxSize_->setRange(10, 2000);
+
+  QHBoxLayout *historyLayout5 = new QHBoxLayout();
+  historyLayout5->addWidget(new QLabel(tr("Maximum size of images downloaded for offline reading")));
+  historyLayout5->addWidget(prefetchImagesMaxSize_);
+  historyLayout5->addWidget(new QLabel(tr("MB")), 1);
+
   saveCookies_ = new QRadioButton(tr("Allow local data to be set"));
   deleteCookiesOnClose_ = new QRadioButton(tr("Keep local data only until quit application"));
   blockCookies_ = new QRadioButton(tr("Block sites from setting any data"));
@@ -656,6 +694,7 @@ void OptionsDialog::createBrowserWidget()
   historyMainLayout->setMargin(10);
   historyMainLayout->addLayout(historyLayout1);
   historyMainLayout->addWidget(diskCacheOn_);
+  historyMainLayout->addLayout(historyLayout5);
   historyMainLayout->addSpacing(10);
   historyMainLayout->addWidget(new QLabel(tr("Cookies:")));
   historyMainLayout->addLayout(cookiesLayout);
@@ -734,10 +773,26 @@ void OptionsDialog::createBrowserWidget()
   downLocationLayout->addWidget(downloadLocationButton, 0, 1, Qt::AlignRight);
   downLocationLayout->addWidget(askDownloadLocation_, 1, 0);
 
+  downloadSegments_ = new QSpinBox();
+  downloadSegments_->setRange(1, 8);
+  downloadSpeedLimit_ = new QSpinBox();
+  downloadSpeedLimit_->setRange(0, 100000);
+
+  QGridLayout *downSpeedLayout = new QGridLayout();
+  downSpeedLayout->setContentsMargins(15, 0, 5, 10);
+  downSpeedLayout->addWidget(new QLabel(tr("Connections per download:")), 0, 0);
+  downSpeedLayout->addWidget(downloadSegments_, 0, 1);
+  downSpeedLayout->addWidget(new QLabel(tr("Download speed limit:")), 1, 0);
+  downSpeedLayout->addWidget(downloadSpeedLimit_, 1, 1);
+  downSpeedLayout->addWidget(new QLabel(tr("KB/s (0 - unlimited)")), 1, 2);
+  downSpeedLayout->setColumnStretch(3, 1);
+
   QVBoxLayout *downloadsLayout = new QVBoxLayout();
   downloadsLayout->setMargin(10);
   downloadsLayout->addWidget(new QLabel(tr("Download location:")));
   downloadsLayout->addLayout(downLocationLayout);
+  downloadsLayout->addWidget(new QLabel(tr("Connections:")));
+  downloadsLayout->addLayout(downSpeedLayout);
   downloadsLayout->addStretch();
 
   QWidget *downloadsWidget = new QWidget(this);
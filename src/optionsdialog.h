@@ -75,6 +75,10 @@ public:
   QSpinBox *timeoutRequest_;
   QSpinBox *numberRequests_;
   QSpinBox *numberRepeats_;
+  QCheckBox *streamParsing_;
+  QCheckBox *websubEnable_;
+  LineEdit *websubCallbackUrl_;
+  QSpinBox *websubPort_;
 
   // browser
   QRadioButton *embeddedBrowserOn_;
@@ -93,9 +97,14 @@ public:
 
   QSpinBox *maxPagesInCache_;
   QGroupBox *diskCacheOn_;
-  QSpinBox *maxDiskCache_;
+  QSpinBox *maxDiskCachePages_;
+  QSpinBox *maxDiskCacheImages_;
+  QSpinBox *maxDiskCacheMedia_;
   QLineEdit *dirDiskCacheEdit_;
   QPushButton *dirDiskCacheButton_;
+  QCheckBox *offlineFirstCache_;
+  QLabel *diskCacheStats_;
+  QSpinBox *prefetchImagesMaxSize_;
 
   QRadioButton *saveCookies_;
   QRadioButton *deleteCookiesOnClose_;
@@ -104,6 +113,8 @@ public:
 
   LineEdit *downloadLocationEdit_;
   QCheckBox *askDownloadLocation_;
+  QSpinBox *downloadSegments_;
+  QSpinBox *downloadSpeedLimit_;
 
   // feeds
   void setOpeningFeed(int action);
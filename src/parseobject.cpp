@@ -19,7 +19,7 @@
 
 #include "mainapplication.h"
 #include "database.h"
-#include "VersionNo.h"
+#include "newsstateupdater.h"
 #include "common.h"
 
 #include <QDebug>
@@ -49,7 +49,7 @@ ParseObject::ParseObject(QObject *parent)
 
 ParseObject::~ParseObject()
 {
-
+  qDeleteAll(feedStreams_);
 }
 
 void ParseObject::disconnectObjects()
@@ -96,6 +96,8 @@ void ParseObject::getQueuedXml()
 }
 
 /** @brief Parse xml-data
+ * @details Time of parsing and of database commit is sent by
+ *   signalStageTimes() before update of feed is finished.
  *----------------------------------------------------------------------------*/
 void ParseObject::slotParse(const QByteArray &xmlData, const int &feedId,
                             const QDateTime &dtReply, const QString &codecName)
@@ -109,41 +111,18 @@ void ParseObject::slotParse(const QByteArray &xmlData, const int &feedId,
 
   qDebug() << "=================== parseXml:start ============================";
 
+  QElapsedTimer stageTimer;
+  stageTimer.start();
+
   db_.transaction();
 
-  // extract feed id, duplicate news mode and date to avoid from feed table
-  parseFeedId_ = feedId;
   QString feedUrl;
-  duplicateNewsMode_ = false;
-  addSingleNewsAnyDate_ = false;
-  avoidedOldSingleNews_ = false;
-  avoidedOldSingleNewsDate_ = QDate::currentDate();
-  QSqlQuery q(db_);
-  q.setForwardOnly(true);
-  q.exec(QString("SELECT duplicateNewsMode, xmlUrl, addSingleNewsAnyDateOn, avoidedOldSingleNewsDateOn, avoidedOldSingleNewsDate"
-                 " FROM feeds WHERE id=='%1'").arg(parseFeedId_));
-  if (q.first()) {
-    duplicateNewsMode_ = q.value(0).toBool();
-    feedUrl = q.value(1).toString();
-    addSingleNewsAnyDate_ = q.value(2).toBool();
-    avoidedOldSingleNews_ = q.value(3).toBool();
-    avoidedOldSingleNewsDate_ = q.value(4).toDate();
-  }
-
-  // id not found (ex. feed deleted while updating)
-  if (feedUrl.isEmpty()) {
-    qWarning() << QString("Feed with id = '%1' not found").arg(parseFeedId_);
+  if (!startParse(feedId, dtReply, &feedUrl)) {
     emit signalFinishUpdate(parseFeedId_, false, 0, "0");
     db_.commit();
     return;
   }
 
-  qDebug() << QString("Feed '%1' found with id = %2").arg(feedUrl).arg(parseFeedId_);
-
-  // actually parsing
-  feedChanged_ = false;
-  lastBuildDate_ = dtReply;
-
   bool codecOk = false;
   QString convertData(xmlData);
   QString feedType;
@@ -211,28 +190,9 @@ void ParseObject::slotParse(const QByteArray &xmlData, const int &feedId,
     feedType = rootElem.tagName();
     qDebug() << "Feed type: " << feedType;
 
-    q.exec(QString("SELECT id, guid, title, published, link_href FROM news WHERE feedId='%1'").
-           arg(parseFeedId_));
-    if (q.lastError().isValid()) {
-      qWarning() << __PRETTY_FUNCTION__ << __LINE__
-                 << "q.lastError(): " << q.lastError().text();
-    }
-    else {
-      while (q.next()) {
-        QString str = q.value(2).toString();
-        titleList_.append(str);
-
-        str = q.value(1).toString();
-        guidList_.append(str);
-
-        str = q.value(3).toString();
-        publishedList_.append(str);
-        str = q.value(4).toString();
-        linkList_.append(str);
-      }
-    }
-    q.finish();
+    loadFeedNews();
 
+    // actually parsing
     if (feedType == "feed") {
       parseAtom(feedUrl, doc);
     } else if ((feedType == "rss") || (feedType == "rdf:RDF")) {
@@ -245,10 +205,101 @@ void ParseObject::slotParse(const QByteArray &xmlData, const int &feedId,
     linkList_.clear();
   }
 
+  int newCount = finishParse(feedUrl);
+  int parseTime = stageTimer.restart();
+  db_.commit();
+  emit signalStageTimes(parseFeedId_, parseTime, stageTimer.elapsed());
+
+  emit signalFinishUpdate(parseFeedId_, feedChanged_, newCount, "0");
+  qDebug() << "=================== parseXml:finish ===========================";
+}
+
+/** @brief Read feed settings and prepare parsing of feed \a feedId
+ * @return false if feed is not found
+ *----------------------------------------------------------------------------*/
+bool ParseObject::startParse(int feedId, const QDateTime &dtReply, QString *feedUrl)
+{
+  // extract feed id, duplicate news mode and date to avoid from feed table
+  parseFeedId_ = feedId;
+  duplicateNewsMode_ = false;
+  addSingleNewsAnyDate_ = false;
+  avoidedOldSingleNews_ = false;
+  avoidedOldSingleNewsDate_ = QDate::currentDate();
+  QSqlQuery q(db_);
+  q.setForwardOnly(true);
+  q.exec(QString("SELECT duplicateNewsMode, xmlUrl, addSingleNewsAnyDateOn, avoidedOldSingleNewsDateOn, avoidedOldSingleNewsDate"
+                 " FROM feeds WHERE id=='%1'").arg(parseFeedId_));
+  if (q.first()) {
+    duplicateNewsMode_ = q.value(0).toBool();
+    *feedUrl = q.value(1).toString();
+    addSingleNewsAnyDate_ = q.value(2).toBool();
+    avoidedOldSingleNews_ = q.value(3).toBool();
+    avoidedOldSingleNewsDate_ = q.value(4).toDate();
+  }
+
+  prefetchImages_ = false;
+  q.exec(QString("SELECT value FROM feeds_ex WHERE feedId='%1' AND name='prefetchImages'").
+         arg(parseFeedId_));
+  if (q.first())
+    prefetchImages_ = q.value(0).toBool();
+
+  // id not found (ex. feed deleted while updating)
+  if (feedUrl->isEmpty()) {
+    qWarning() << QString("Feed with id = '%1' not found").arg(parseFeedId_);
+    return false;
+  }
+
+  qDebug() << QString("Feed '%1' found with id = %2").arg(*feedUrl).arg(parseFeedId_);
+
+  userFilters_.compile(db_);
+  filterSounds_.clear();
+  filterColors_.clear();
+
+  feedChanged_ = false;
+  lastBuildDate_ = dtReply;
+
+  return true;
+}
+
+/** @brief Load news of current feed to search duplicates
+ *----------------------------------------------------------------------------*/
+void ParseObject::loadFeedNews()
+{
+  QSqlQuery q(db_);
+  q.setForwardOnly(true);
+  q.exec(QString("SELECT id, guid, title, published, link_href FROM news WHERE feedId='%1'").
+         arg(parseFeedId_));
+  if (q.lastError().isValid()) {
+    qWarning() << __PRETTY_FUNCTION__ << __LINE__
+               << "q.lastError(): " << q.lastError().text();
+  }
+  else {
+    while (q.next()) {
+      QString str = q.value(2).toString();
+      titleList_.append(str);
+
+      str = q.value(1).toString();
+      guidList_.append(str);
+
+      str = q.value(3).toString();
+      publishedList_.append(str);
+      str = q.value(4).toString();
+      linkList_.append(str);
+    }
+  }
+  q.finish();
+}
+
+/** @brief Save feed update time and recount its news
+ * @return Number of new news
+ *----------------------------------------------------------------------------*/
+int ParseObject::finishParse(const QString &feedUrl)
+{
   // Set feed update time and receive data from server time
   QString updated = QLocale::c().toString(QDateTime::currentDateTimeUtc(),
                                           "yyyy-MM-ddTHH:mm:ss");
   QString lastBuildDate = lastBuildDate_.toString(Qt::ISODate);
+  QSqlQuery q(db_);
   q.prepare("UPDATE feeds SET updated=?, lastBuildDate=?, status=0 WHERE id=?");
   q.addBindValue(updated);
   q.addBindValue(lastBuildDate);
@@ -257,20 +308,254 @@ void ParseObject::slotParse(const QByteArray &xmlData, const int &feedId,
 
   int newCount = 0;
   if (feedChanged_) {
-    runUserFilter(parseFeedId_);
     newCount = recountFeedCounts(parseFeedId_, feedUrl, updated, lastBuildDate);
   }
 
-  q.finish();
-  db_.commit();
+  filterSounds_.removeDuplicates();
+  foreach (const QString &sound, filterSounds_) {
+    emit signalPlaySound(sound);
+  }
+  QMap<QString, QList<int> >::const_iterator it = filterColors_.constBegin();
+  for (; it != filterColors_.constEnd(); ++it) {
+    emit signalAddColorList(it.value(), it.key());
+  }
 
-  emit signalFinishUpdate(parseFeedId_, feedChanged_, newCount, "0");
-  qDebug() << "=================== parseXml:finish ===========================";
+  return newCount;
+}
+
+/** @brief Parse part of xml-data received while downloading
+ * @details News are added into base as soon as their elements are complete,
+ *   only the feed header and unfinished news are kept in memory.
+ *----------------------------------------------------------------------------*/
+void ParseObject::parseXmlData(QByteArray data, int feedId,
+                               QDateTime dtReply, bool finished)
+{
+  FeedStream *stream = feedStreams_.value(feedId, NULL);
+  if (!stream) {
+    qDebug() << "=================== parseXmlData:start ========================";
+    stream = new FeedStream;
+    stream->reader.setNamespaceProcessing(false);
+    feedStreams_.insert(feedId, stream);
+
+    db_.transaction();
+    if (startParse(feedId, dtReply, &stream->feedUrl)) {
+      loadFeedNews();
+    } else {
+      stream->skip = true;
+      emit signalFinishUpdate(parseFeedId_, false, 0, "0");
+    }
+    db_.commit();
+    swapStreamState(stream);
+  }
+
+  if (!stream->skip) {
+    QElapsedTimer stageTimer;
+    stageTimer.start();
+    db_.transaction();
+    swapStreamState(stream);
+
+    stream->reader.addData(data);
+    readXmlStream(stream);
+    if (mainApp->isSaveDataLastFeed())
+      stream->xmlData.append(data);
+
+    if (finished || stream->done) {
+      if (!stream->done) {
+        qWarning() << QString("Parse data error (3): url %1, id %2: %3").
+                      arg(stream->feedUrl).arg(parseFeedId_).
+                      arg(stream->reader.errorString());
+      }
+      if (!stream->feedSaved)
+        parseStreamNews(stream, QDomNode());
+
+      int newCount = finishParse(stream->feedUrl);
+      stream->parseTime += stageTimer.restart();
+      db_.commit();
+      stream->commitTime += stageTimer.elapsed();
+
+      if (mainApp->isSaveDataLastFeed()) {
+        QFile file(mainApp->dataDir()  + "/lastfeed.dat");
+        file.open(QIODevice::WriteOnly);
+        file.write(stream->xmlData);
+        file.close();
+        stream->xmlData.clear();
+      }
+
+      emit signalStageTimes(parseFeedId_, stream->parseTime, stream->commitTime);
+      emit signalFinishUpdate(parseFeedId_, feedChanged_, newCount, "0");
+      qDebug() << "=================== parseXmlData:finish =======================";
+      stream->skip = true;
+      stream->doc.clear();
+      stream->current.clear();
+    } else {
+      stream->parseTime += stageTimer.restart();
+      db_.commit();
+      stream->commitTime += stageTimer.elapsed();
+    }
+
+    swapStreamState(stream);
+  }
+
+  if (finished) {
+    feedStreams_.remove(feedId);
+    delete stream;
+  }
+}
+
+/** @brief Drop parse state of feed which download has failed
+ * @details News completed before the failure stay in base and are counted,
+ *   but feed keeps its last update time. Update of feed is finished by
+ *   repeated request or by request error.
+ *----------------------------------------------------------------------------*/
+void ParseObject::abortXmlData(int feedId)
+{
+  FeedStream *stream = feedStreams_.take(feedId);
+  if (!stream) return;
+
+  if (!stream->skip) {
+    swapStreamState(stream);
+    if (feedChanged_) {
+      db_.transaction();
+      QSqlQuery q(db_);
+      q.exec(QString("SELECT updated, lastBuildDate FROM feeds WHERE id=='%1'").
+             arg(parseFeedId_));
+      if (q.first()) {
+        recountFeedCounts(parseFeedId_, stream->feedUrl,
+                          q.value(0).toString(), q.value(1).toString());
+      }
+      db_.commit();
+    }
+    swapStreamState(stream);
+  }
+
+  delete stream;
+}
+
+/** @brief Exchange parse state of feed \a stream and current state
+ *----------------------------------------------------------------------------*/
+void ParseObject::swapStreamState(FeedStream *stream)
+{
+  qSwap(parseFeedId_, stream->parseFeedId);
+  qSwap(duplicateNewsMode_, stream->duplicateNewsMode);
+  qSwap(feedChanged_, stream->feedChanged);
+  qSwap(addSingleNewsAnyDate_, stream->addSingleNewsAnyDate);
+  qSwap(avoidedOldSingleNews_, stream->avoidedOldSingleNews);
+  qSwap(avoidedOldSingleNewsDate_, stream->avoidedOldSingleNewsDate);
+  qSwap(prefetchImages_, stream->prefetchImages);
+  qSwap(guidList_, stream->guidList);
+  qSwap(linkList_, stream->linkList);
+  qSwap(titleList_, stream->titleList);
+  qSwap(publishedList_, stream->publishedList);
+  qSwap(lastBuildDate_, stream->lastBuildDate);
+  qSwap(filterSounds_, stream->filterSounds);
+  qSwap(filterColors_, stream->filterColors);
+}
+
+/** @brief Build elements from received data, parse completed news
+ * @details Elements are built as QDomDocument::setContent() does without
+ *   namespace processing, so news are parsed by the same code.
+ *----------------------------------------------------------------------------*/
+void ParseObject::readXmlStream(FeedStream *stream)
+{
+  QXmlStreamReader &reader = stream->reader;
+  while (!stream->done) {
+    QXmlStreamReader::TokenType token = reader.readNext();
+    if (token == QXmlStreamReader::Invalid) {
+      // Premature end of document means waiting for next part of data
+      if (reader.error() != QXmlStreamReader::PrematureEndOfDocumentError) {
+        qWarning() << QString("Parse data error (3): url %1, id %2, line %3, column %4: %5").
+                      arg(stream->feedUrl).arg(parseFeedId_).
+                      arg(reader.lineNumber()).arg(reader.columnNumber()).
+                      arg(reader.errorString());
+        stream->done = true;
+      }
+      break;
+    }
+
+    if (token == QXmlStreamReader::StartElement) {
+      QDomElement element = stream->doc.createElement(reader.qualifiedName().toString());
+      foreach (const QXmlStreamAttribute &attribute, reader.attributes()) {
+        element.setAttribute(attribute.qualifiedName().toString(),
+                             attribute.value().toString());
+      }
+      if (stream->current.isNull()) {
+        stream->doc.appendChild(element);
+        stream->feedType = element.tagName();
+        qDebug() << "Feed type: " << stream->feedType;
+      } else {
+        stream->current.appendChild(element);
+      }
+      stream->current = element;
+    } else if (token == QXmlStreamReader::EndElement) {
+      QDomNode element = stream->current;
+      stream->current = element.parentNode();
+      if (stream->current.isDocument()) {
+        stream->done = true;
+      } else {
+        QString tagName = element.toElement().tagName();
+        bool isNews;
+        if (stream->feedType == "feed")
+          isNews = (tagName == "entry");
+        else
+          isNews = (tagName == "item") || (tagName == "rss:item");
+        if (isNews) {
+          parseStreamNews(stream, element);
+          stream->current.removeChild(element);
+        }
+      }
+    } else if (token == QXmlStreamReader::Characters) {
+      if (stream->current.isNull() || reader.isWhitespace())
+        continue;
+      if (reader.isCDATA())
+        stream->current.appendChild(stream->doc.createCDATASection(reader.text().toString()));
+      else
+        stream->current.appendChild(stream->doc.createTextNode(reader.text().toString()));
+    }
+  }
+}
+
+/** @brief Parse completed news of stream
+ * @details Feed fields are saved before the first news, as feeds put them
+ *   before news. Null \a newsNode only saves feed fields.
+ *----------------------------------------------------------------------------*/
+void ParseObject::parseStreamNews(FeedStream *stream, const QDomNode &newsNode)
+{
+  bool isAtom = (stream->feedType == "feed");
+  bool isRss = (stream->feedType == "rss") || (stream->feedType == "rdf:RDF");
+
+  if (!stream->feedSaved) {
+    stream->feedSaved = true;
+    if (isAtom)
+      stream->feedItem = parseAtomFeed(stream->feedUrl, stream->doc.documentElement());
+    else if (isRss)
+      parseRssFeed(stream->feedUrl, stream->doc.documentElement());
+  }
+
+  if (newsNode.isNull())
+    return;
+
+  if (isAtom)
+    parseAtomNews(stream->feedUrl, stream->feedItem, newsNode);
+  else if (isRss)
+    parseRssNews(stream->feedUrl, newsNode);
+
+  ++stream->newsCount;
 }
 
 void ParseObject::parseAtom(const QString &feedUrl, const QDomDocument &doc)
 {
-  QDomElement rootElem = doc.documentElement();
+  FeedItemStruct feedItem = parseAtomFeed(feedUrl, doc.documentElement());
+
+  QDomNodeList newsList = doc.elementsByTagName("entry");
+  for (int i = 0; i < newsList.size(); i++) {
+    parseAtomNews(feedUrl, feedItem, newsList.item(i));
+  }
+}
+
+/** @brief Save fields of Atom feed
+ *----------------------------------------------------------------------------*/
+FeedItemStruct ParseObject::parseAtomFeed(const QString &feedUrl, const QDomElement &rootElem)
+{
   FeedItemStruct feedItem;
 
   feedItem.linkBase = rootElem.attribute("xml:base");
@@ -337,113 +622,118 @@ void ParseObject::parseAtom(const QString &feedUrl, const QDomDocument &doc)
   q.addBindValue(parseFeedId_);
   q.exec();
 
-  QDomNodeList newsList = doc.elementsByTagName("entry");
-  for (int i = 0; i < newsList.size(); i++) {
-    NewsItemStruct newsItem;
-    newsItem.id = newsList.item(i).namedItem("id").toElement().text();
-    newsItem.title = toPlainText(newsList.item(i).namedItem("title").toElement().text());
-    newsItem.updated = newsList.item(i).namedItem("published").toElement().text();
-    if (newsItem.updated.isEmpty())
-      newsItem.updated = newsList.item(i).namedItem("updated").toElement().text();
-    newsItem.updated = parseDate(newsItem.updated, feedUrl);
-    QDomElement authorElem = newsList.item(i).namedItem("author").toElement();
-    if (!authorElem.isNull()) {
-      newsItem.author = toPlainText(authorElem.namedItem("name").toElement().text());
-      if (newsItem.author.isEmpty()) newsItem.author = toPlainText(authorElem.text());
-      newsItem.authorUri = authorElem.namedItem("uri").toElement().text();
-      newsItem.authorEmail = authorElem.namedItem("email").toElement().text();
-    }
+  findHub(feedUrl, rootElem);
 
-    newsItem.description = newsList.item(i).namedItem("summary").toElement().text();
-    QDomNode nodeSummary = newsList.item(i).namedItem("summary");
-    if (!nodeSummary.isNull() && newsItem.description.isEmpty()) {
-      QTextStream in(&newsItem.description);
-      nodeSummary.save(in, 0);
-    }
-    QDomNode nodeContent = newsList.item(i).namedItem("content");
-    if (nodeContent.toElement().attribute("type") == "xhtml") {
-      QTextStream in(&newsItem.content);
-      nodeContent.save(in, 0);
-    } else {
-      newsItem.content = nodeContent.toElement().text();
-    }
-    QString imgUrl = newsList.item(i).namedItem("media:thumbnail").toElement().attribute("url");
-    QString community = getCommunity(newsList.item(i).namedItem("media:community"));
-    nodeContent = newsList.item(i).namedItem("media:group");
-    if (!nodeContent.isNull()) {
-      QString description = nodeContent.namedItem("media:description").toElement().text();
-      if (description.length() > newsItem.content.length())
-        newsItem.content = description;
-      newsItem.content = fromPlainText(newsItem.content);
-      if (imgUrl.isEmpty())
-        imgUrl = nodeContent.namedItem("media:thumbnail").toElement().attribute("url");
-      if (community.isEmpty())
-        community = getCommunity(nodeContent.namedItem("media:community"));
-    }
-    if (!(newsItem.content.isEmpty() ||
-          (newsItem.description.length() > newsItem.content.length()))) {
-      newsItem.description = newsItem.content;
-    }
-    newsItem.content.clear();
-    if (!imgUrl.isEmpty()) {
-      newsItem.description = "<p class=\"description\">" + newsItem.description + "</p>";
-      newsItem.description += "<img src=\"" + imgUrl + "\" alt=\"image\"/>";
-    }
-    if (!community.isEmpty())
-      newsItem.description += community;
-
-    QDomNodeList categoryElem = newsList.item(i).toElement().elementsByTagName("category");
-    for (int j = 0; j < categoryElem.size(); j++) {
-      if (!newsItem.category.isEmpty()) newsItem.category.append(", ");
-      QString category = categoryElem.at(j).toElement().attribute("label");
-      if (category.isEmpty())
-        category = categoryElem.at(j).toElement().attribute("term");
-      newsItem.category.append(toPlainText(category));
-    }
-    QDomElement enclosureElem = newsList.item(i).namedItem("enclosure").toElement();
-    newsItem.eUrl = enclosureElem.attribute("url");
-    newsItem.eType = enclosureElem.attribute("type");
-    newsItem.eLength = enclosureElem.attribute("length");
-    QDomNodeList linksList = newsList.item(i).toElement().elementsByTagName("link");
-    for (int j = 0; j < linksList.size(); j++) {
-      if (linksList.at(j).toElement().attribute("type") == "text/html") {
-        if (linksList.at(j).toElement().attribute("rel") == "self")
-          newsItem.link = linksList.at(j).toElement().attribute("href");
-        if (linksList.at(j).toElement().attribute("rel") == "alternate")
-          newsItem.linkAlternate = linksList.at(j).toElement().attribute("href");
-        if (linksList.at(j).toElement().attribute("rel") == "replies")
-          newsItem.comments = linksList.at(j).toElement().attribute("href");
-      } else if (newsItem.linkAlternate.isEmpty()) {
-        if (linksList.at(j).toElement().attribute("rel") == "alternate")
-          newsItem.linkAlternate = linksList.at(j).toElement().attribute("href");
-      }
+  return feedItem;
+}
+
+void ParseObject::parseAtomNews(const QString &feedUrl, const FeedItemStruct &feedItem,
+                                const QDomNode &newsNode)
+{
+  NewsItemStruct newsItem;
+  newsItem.id = newsNode.namedItem("id").toElement().text();
+  newsItem.title = toPlainText(newsNode.namedItem("title").toElement().text());
+  newsItem.updated = newsNode.namedItem("published").toElement().text();
+  if (newsItem.updated.isEmpty())
+    newsItem.updated = newsNode.namedItem("updated").toElement().text();
+  newsItem.updated = parseDate(newsItem.updated, feedUrl);
+  QDomElement authorElem = newsNode.namedItem("author").toElement();
+  if (!authorElem.isNull()) {
+    newsItem.author = toPlainText(authorElem.namedItem("name").toElement().text());
+    if (newsItem.author.isEmpty()) newsItem.author = toPlainText(authorElem.text());
+    newsItem.authorUri = authorElem.namedItem("uri").toElement().text();
+    newsItem.authorEmail = authorElem.namedItem("email").toElement().text();
+  }
+
+  newsItem.description = newsNode.namedItem("summary").toElement().text();
+  QDomNode nodeSummary = newsNode.namedItem("summary");
+  if (!nodeSummary.isNull() && newsItem.description.isEmpty()) {
+    QTextStream in(&newsItem.description);
+    nodeSummary.save(in, 0);
+  }
+  QDomNode nodeContent = newsNode.namedItem("content");
+  if (nodeContent.toElement().attribute("type") == "xhtml") {
+    QTextStream in(&newsItem.content);
+    nodeContent.save(in, 0);
+  } else {
+    newsItem.content = nodeContent.toElement().text();
+  }
+  QString imgUrl = newsNode.namedItem("media:thumbnail").toElement().attribute("url");
+  QString community = getCommunity(newsNode.namedItem("media:community"));
+  nodeContent = newsNode.namedItem("media:group");
+  if (!nodeContent.isNull()) {
+    QString description = nodeContent.namedItem("media:description").toElement().text();
+    if (description.length() > newsItem.content.length())
+      newsItem.content = description;
+    newsItem.content = fromPlainText(newsItem.content);
+    if (imgUrl.isEmpty())
+      imgUrl = nodeContent.namedItem("media:thumbnail").toElement().attribute("url");
+    if (community.isEmpty())
+      community = getCommunity(nodeContent.namedItem("media:community"));
+  }
+  if (!(newsItem.content.isEmpty() ||
+        (newsItem.description.length() > newsItem.content.length()))) {
+    newsItem.description = newsItem.content;
+  }
+  newsItem.content.clear();
+  if (!imgUrl.isEmpty()) {
+    newsItem.description = "<p class=\"description\">" + newsItem.description + "</p>";
+    newsItem.description += "<img src=\"" + imgUrl + "\" alt=\"image\"/>";
+  }
+  if (!community.isEmpty())
+    newsItem.description += community;
+
+  QDomNodeList categoryElem = newsNode.toElement().elementsByTagName("category");
+  for (int j = 0; j < categoryElem.size(); j++) {
+    if (!newsItem.category.isEmpty()) newsItem.category.append(", ");
+    QString category = categoryElem.at(j).toElement().attribute("label");
+    if (category.isEmpty())
+      category = categoryElem.at(j).toElement().attribute("term");
+    newsItem.category.append(toPlainText(category));
+  }
+  QDomElement enclosureElem = newsNode.namedItem("enclosure").toElement();
+  newsItem.eUrl = enclosureElem.attribute("url");
+  newsItem.eType = enclosureElem.attribute("type");
+  newsItem.eLength = enclosureElem.attribute("length");
+  QDomNodeList linksList = newsNode.toElement().elementsByTagName("link");
+  for (int j = 0; j < linksList.size(); j++) {
+    if (linksList.at(j).toElement().attribute("type") == "text/html") {
+      if (linksList.at(j).toElement().attribute("rel") == "self")
+        newsItem.link = linksList.at(j).toElement().attribute("href");
+      if (linksList.at(j).toElement().attribute("rel") == "alternate")
+        newsItem.linkAlternate = linksList.at(j).toElement().attribute("href");
+      if (linksList.at(j).toElement().attribute("rel") == "replies")
+        newsItem.comments = linksList.at(j).toElement().attribute("href");
+    } else if (newsItem.linkAlternate.isEmpty()) {
+      if (linksList.at(j).toElement().attribute("rel") == "alternate")
+        newsItem.linkAlternate = linksList.at(j).toElement().attribute("href");
     }
-    for (int j = 0; j < linksList.size(); j++) {
-      if (newsItem.linkAlternate.isEmpty()) {
-        if (!(linksList.at(j).toElement().attribute("rel") == "self")) {
-          newsItem.linkAlternate = linksList.at(j).toElement().attribute("href");
-          break;
-        }
+  }
+  for (int j = 0; j < linksList.size(); j++) {
+    if (newsItem.linkAlternate.isEmpty()) {
+      if (!(linksList.at(j).toElement().attribute("rel") == "self")) {
+        newsItem.linkAlternate = linksList.at(j).toElement().attribute("href");
+        break;
       }
     }
+  }
 
-    if (!newsItem.link.isEmpty() && QUrl(newsItem.link).host().isEmpty())
-      newsItem.link = feedItem.linkBase + newsItem.link;
-    newsItem.link = toPlainText(newsItem.link);
-    if (!newsItem.linkAlternate.isEmpty() && QUrl(newsItem.linkAlternate).host().isEmpty())
-      newsItem.linkAlternate = feedItem.linkBase + newsItem.linkAlternate;
-    newsItem.linkAlternate = toPlainText(newsItem.linkAlternate);
-    if (newsItem.link.isEmpty()) {
-      newsItem.link = newsItem.linkAlternate;
-      newsItem.linkAlternate.clear();
-    }
-    url = QUrl(newsItem.link);
-    if (url.scheme().isEmpty())
-      url.setScheme(QUrl(feedUrl).scheme());
-    newsItem.link = url.toString();
-
-    addAtomNewsIntoBase(&newsItem);
+  if (!newsItem.link.isEmpty() && QUrl(newsItem.link).host().isEmpty())
+    newsItem.link = feedItem.linkBase + newsItem.link;
+  newsItem.link = toPlainText(newsItem.link);
+  if (!newsItem.linkAlternate.isEmpty() && QUrl(newsItem.linkAlternate).host().isEmpty())
+    newsItem.linkAlternate = feedItem.linkBase + newsItem.linkAlternate;
+  newsItem.linkAlternate = toPlainText(newsItem.linkAlternate);
+  if (newsItem.link.isEmpty()) {
+    newsItem.link = newsItem.linkAlternate;
+    newsItem.linkAlternate.clear();
   }
+  QUrl url = QUrl(newsItem.link);
+  if (url.scheme().isEmpty())
+    url.setScheme(QUrl(feedUrl).scheme());
+  newsItem.link = url.toString();
+
+  addAtomNewsIntoBase(&newsItem);
 }
 
 void ParseObject::addAtomNewsIntoBase(NewsItemStruct *newsItem)
@@ -510,12 +800,17 @@ void ParseObject::addAtomNewsIntoBase(NewsItemStruct *newsItem)
       if (q.first()) read = true;
     }
 
+    UserFilterNews filterNews;
+    QStringList colors;
+    applyUserFilters(newsItem, read, &filterNews, &colors);
+
     qStr = QString("INSERT INTO news("
                    "feedId, description, content, guid, title, author_name, "
                    "author_uri, author_email, published, received, "
                    "link_href, link_alternate, category, comments, "
-                   "enclosure_url, enclosure_type, enclosure_length, new, read) "
-                   "VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+                   "enclosure_url, enclosure_type, enclosure_length, new, read, "
+                   "starred, deleted, deleteDate, label) "
+                   "VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
     q.prepare(qStr);
     q.addBindValue(parseFeedId_);
     q.addBindValue(newsItem->description);
@@ -537,11 +832,27 @@ void ParseObject::addAtomNewsIntoBase(NewsItemStruct *newsItem)
     q.addBindValue(newsItem->eUrl);
     q.addBindValue(newsItem->eType);
     q.addBindValue(newsItem->eLength);
-    q.addBindValue(read ? 0 : 1);
-    q.addBindValue(read ? 2 : 0);
+    q.addBindValue(filterNews.newState);
+    q.addBindValue(filterNews.read);
+    q.addBindValue(filterNews.starred);
+    q.addBindValue(filterNews.deleted);
+    if (filterNews.deleted)
+      q.addBindValue(QDateTime::currentDateTime().toString(Qt::ISODate));
+    else
+      q.addBindValue(QString());
+    q.addBindValue(filterNews.label);
     if (!q.exec()) {
       qWarning() << __PRETTY_FUNCTION__ << __LINE__
                  << "q.lastError(): " << q.lastError().text();
+    } else {
+      if (!colors.isEmpty()) {
+        int newsId = q.lastInsertId().toInt();
+        foreach (const QString &color, colors) {
+          filterColors_[color].append(newsId);
+        }
+      }
+      if (prefetchImages_ && !filterNews.deleted)
+        emit signalPrefetchImages(newsItem->description + newsItem->content, newsItem->link);
     }
     q.finish();
     qDebug() << "q.exec(" << q.lastQuery() << ")";
@@ -571,9 +882,23 @@ void ParseObject::addAtomNewsIntoBase(NewsItemStruct *newsItem)
 
 void ParseObject::parseRss(const QString &feedUrl, const QDomDocument &doc)
 {
-  QDomNode channel = doc.documentElement().namedItem("channel");
+  parseRssFeed(feedUrl, doc.documentElement());
+
+  QDomNodeList newsList = doc.elementsByTagName("item");
+  if (newsList.isEmpty())
+    newsList = doc.elementsByTagName("rss:item");
+  for (int i = 0; i < newsList.size(); i++) {
+    parseRssNews(feedUrl, newsList.item(i));
+  }
+}
+
+/** @brief Save fields of RSS feed channel
+ *----------------------------------------------------------------------------*/
+void ParseObject::parseRssFeed(const QString &feedUrl, const QDomElement &rootElem)
+{
+  QDomNode channel = rootElem.namedItem("channel");
   if (channel.isNull())
-    channel = doc.documentElement().namedItem("rss:channel");
+    channel = rootElem.namedItem("rss:channel");
   FeedItemStruct feedItem;
 
   feedItem.title = toPlainText(channel.namedItem("title").toElement().text());
@@ -617,97 +942,97 @@ void ParseObject::parseRss(const QString &feedUrl, const QDomDocument &doc)
   q.addBindValue(parseFeedId_);
   q.exec();
 
-  QDomNodeList newsList = doc.elementsByTagName("item");
-  if (newsList.isEmpty())
-    newsList = doc.elementsByTagName("rss:item");
-  for (int i = 0; i < newsList.size(); i++) {
-    NewsItemStruct newsItem;
-    newsItem.id = newsList.item(i).namedItem("guid").toElement().text();
-    newsItem.title = toPlainText(newsList.item(i).namedItem("title").toElement().text());
-    if (newsItem.title.isEmpty())
-      newsItem.title = toPlainText(newsList.item(i).namedItem("rss:title").toElement().text());
-    newsItem.updated = newsList.item(i).namedItem("pubDate").toElement().text();
-    if (newsItem.updated.isEmpty())
-      newsItem.updated = newsList.item(i).namedItem("pubdate").toElement().text();
-    if (newsItem.updated.isEmpty())
-      newsItem.updated = newsList.item(i).namedItem("dc:date").toElement().text();
-    newsItem.updated = parseDate(newsItem.updated, feedUrl);
-    newsItem.author = toPlainText(newsList.item(i).namedItem("author").toElement().text());
-    if (newsItem.author.isEmpty())
-      newsItem.author = toPlainText(newsList.item(i).namedItem("dc:creator").toElement().text());
-    newsItem.link = toPlainText(newsList.item(i).namedItem("link").toElement().text());
-    if (newsItem.link.isEmpty()) {
-        newsItem.link = toPlainText(newsList.item(i).namedItem("rss:link").toElement().text());
-        if (newsItem.link.isEmpty()) {
-            if (newsList.item(i).namedItem("guid").toElement().attribute("isPermaLink") == "true")
-                newsItem.link = newsItem.id;
-        }
-    }
-    url = QUrl(newsItem.link);
-    if (url.host().isEmpty())
-      url.setHost(QUrl(feedUrl).host());
-    if (url.scheme().isEmpty())
-      url.setScheme(QUrl(feedUrl).scheme());
-    newsItem.link = url.toString();
-
-    newsItem.description = newsList.item(i).namedItem("description").toElement().text();
-    QDomNode nodeSummary = newsList.item(i).namedItem("description");
-    if (!nodeSummary.isNull() && newsItem.description.isEmpty()) {
-      QTextStream in(&newsItem.description);
-      nodeSummary.save(in, 0);
-    }
-    newsItem.content = newsList.item(i).namedItem("content:encoded").toElement().text();
-    QDomNode nodeContent = newsList.item(i).namedItem("content:encoded");
-    if (!nodeContent.isNull() && newsItem.content.isEmpty()) {
-      QTextStream in(&newsItem.content);
-      nodeContent.save(in, 0);
-    }
-    QString imgUrl = newsList.item(i).namedItem("media:thumbnail").toElement().attribute("url");
-    QString community = getCommunity(newsList.item(i).namedItem("media:community"));
-    nodeContent = newsList.item(i).namedItem("media:group");
-    if (!nodeContent.isNull()) {
-      QString description = nodeContent.namedItem("media:description").toElement().text();
-      if (description.length() > newsItem.content.length())
-        newsItem.content = description;
-      newsItem.content = fromPlainText(newsItem.content);
-      if (imgUrl.isEmpty())
-        imgUrl = nodeContent.namedItem("media:thumbnail").toElement().attribute("url");
-      if (community.isEmpty())
-        community = getCommunity(nodeContent.namedItem("media:community"));
-    }
-    if (!(newsItem.content.isEmpty() ||
-          (newsItem.description.length() > newsItem.content.length()))) {
-      newsItem.description = newsItem.content;
-    }
-    newsItem.content.clear();
-    if (!imgUrl.isEmpty()) {
-      newsItem.description = "<p class=\"description\">" + newsItem.description + "</p>";
-      newsItem.description += "<img src=\"" + imgUrl + "\" alt=\"image\"/>";
-    }
-    if (!community.isEmpty())
-      newsItem.description += community;
+  findHub(feedUrl, channel);
+}
 
-    QDomNodeList categoryElem = newsList.item(i).toElement().elementsByTagName("category");
-    for (int j = 0; j < categoryElem.size(); j++) {
-      if (!newsItem.category.isEmpty()) newsItem.category.append(", ");
-      newsItem.category.append(toPlainText(categoryElem.at(j).toElement().text()));
-    }
-    newsItem.comments = newsList.item(i).namedItem("comments").toElement().text();
-    QDomElement enclosureElem = newsList.item(i).namedItem("enclosure").toElement();
-    newsItem.eUrl = enclosureElem.attribute("url");
-    newsItem.eType = enclosureElem.attribute("type");
-    newsItem.eLength = enclosureElem.attribute("length");
-
-    if (newsItem.title.isEmpty()) {
-      newsItem.title = toPlainText(newsItem.description);
-      if (newsItem.title.size() > 50) {
-        newsItem.title.resize(50);
-        newsItem.title = newsItem.title % "...";
+void ParseObject::parseRssNews(const QString &feedUrl, const QDomNode &newsNode)
+{
+  NewsItemStruct newsItem;
+  newsItem.id = newsNode.namedItem("guid").toElement().text();
+  newsItem.title = toPlainText(newsNode.namedItem("title").toElement().text());
+  if (newsItem.title.isEmpty())
+    newsItem.title = toPlainText(newsNode.namedItem("rss:title").toElement().text());
+  newsItem.updated = newsNode.namedItem("pubDate").toElement().text();
+  if (newsItem.updated.isEmpty())
+    newsItem.updated = newsNode.namedItem("pubdate").toElement().text();
+  if (newsItem.updated.isEmpty())
+    newsItem.updated = newsNode.namedItem("dc:date").toElement().text();
+  newsItem.updated = parseDate(newsItem.updated, feedUrl);
+  newsItem.author = toPlainText(newsNode.namedItem("author").toElement().text());
+  if (newsItem.author.isEmpty())
+    newsItem.author = toPlainText(newsNode.namedItem("dc:creator").toElement().text());
+  newsItem.link = toPlainText(newsNode.namedItem("link").toElement().text());
+  if (newsItem.link.isEmpty()) {
+      newsItem.link = toPlainText(newsNode.namedItem("rss:link").toElement().text());
+      if (newsItem.link.isEmpty()) {
+          if (newsNode.namedItem("guid").toElement().attribute("isPermaLink") == "true")
+              newsItem.link = newsItem.id;
       }
-    }
+  }
+  QUrl url = QUrl(newsItem.link);
+  if (url.host().isEmpty())
+    url.setHost(QUrl(feedUrl).host());
+  if (url.scheme().isEmpty())
+    url.setScheme(QUrl(feedUrl).scheme());
+  newsItem.link = url.toString();
 
-    addRssNewsIntoBase(&newsItem);
+  newsItem.description = newsNode.namedItem("description").toElement().text();
+  QDomNode nodeSummary = newsNode.namedItem("description");
+  if (!nodeSummary.isNull() && newsItem.description.isEmpty()) {
+    QTextStream in(&newsItem.description);
+    nodeSummary.save(in, 0);
+  }
+  newsItem.content = newsNode.namedItem("content:encoded").toElement().text();
+  QDomNode nodeContent = newsNode.namedItem("content:encoded");
+  if (!nodeContent.isNull() && newsItem.content.isEmpty()) {
+    QTextStream in(&newsItem.content);
+    nodeContent.save(in, 0);
+  }
+  QString imgUrl = newsNode.namedItem("media:thumbnail").toElement().attribute("url");
+  QString community = getCommunity(newsNode.namedItem("media:community"));
+  nodeContent = newsNode.namedItem("media:group");
+  if (!nodeContent.isNull()) {
+    QString description = nodeContent.namedItem("media:description").toElement().text();
+    if (description.length() > newsItem.content.length())
+      newsItem.content = description;
+    newsItem.content = fromPlainText(newsItem.content);
+    if (imgUrl.isEmpty())
+      imgUrl = nodeContent.namedItem("media:thumbnail").toElement().attribute("url");
+    if (community.isEmpty())
+      community = getCommunity(nodeContent.namedItem("media:community"));
+  }
+  if (!(newsItem.content.isEmpty() ||
+        (newsItem.description.length() > newsItem.content.length()))) {
+    newsItem.description = newsItem.content;
+  }
+  newsItem.content.clear();
+  if (!imgUrl.isEmpty()) {
+    newsItem.description = "<p class=\"description\">" + newsItem.description + "</p>";
+    newsItem.description += "<img src=\"" + imgUrl + "\" alt=\"image\"/>";
   }
+  if (!community.isEmpty())
+    newsItem.description += community;
+
+  QDomNodeList categoryElem = newsNode.toElement().elementsByTagName("category");
+  for (int j = 0; j < categoryElem.size(); j++) {
+    if (!newsItem.category.isEmpty()) newsItem.category.append(", ");
+    newsItem.category.append(toPlainText(categoryElem.at(j).toElement().text()));
+  }
+  newsItem.comments = newsNode.namedItem("comments").toElement().text();
+  QDomElement enclosureElem = newsNode.namedItem("enclosure").toElement();
+  newsItem.eUrl = enclosureElem.attribute("url");
+  newsItem.eType = enclosureElem.attribute("type");
+  newsItem.eLength = enclosureElem.attribute("length");
+
+  if (newsItem.title.isEmpty()) {
+    newsItem.title = toPlainText(newsItem.description);
+    if (newsItem.title.size() > 50) {
+      newsItem.title.resize(50);
+      newsItem.title = newsItem.title % "...";
+    }
+  }
+
+  addRssNewsIntoBase(&newsItem);
 }
 
 void ParseObject::addRssNewsIntoBase(NewsItemStruct *newsItem)
@@ -822,11 +1147,16 @@ void ParseObject::addRssNewsIntoBase(NewsItemStruct *newsItem)
       if (q.first()) read = true;
     }
 
+    UserFilterNews filterNews;
+    QStringList colors;
+    applyUserFilters(newsItem, read, &filterNews, &colors);
+
     qStr = QString("INSERT INTO news("
                    "feedId, description, content, guid, title, author_name, "
                    "published, received, link_href, category, comments, "
-                   "enclosure_url, enclosure_type, enclosure_length, new, read) "
-                   "VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+                   "enclosure_url, enclosure_type, enclosure_length, new, read, "
+                   "starred, deleted, deleteDate, label) "
+                   "VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
     q.prepare(qStr);
     q.addBindValue(parseFeedId_);
     q.addBindValue(newsItem->description);
@@ -845,11 +1175,27 @@ void ParseObject::addRssNewsIntoBase(NewsItemStruct *newsItem)
     q.addBindValue(newsItem->eUrl);
     q.addBindValue(newsItem->eType);
     q.addBindValue(newsItem->eLength);
-    q.addBindValue(read ? 0 : 1);
-    q.addBindValue(read ? 2 : 0);
+    q.addBindValue(filterNews.newState);
+    q.addBindValue(filterNews.read);
+    q.addBindValue(filterNews.starred);
+    q.addBindValue(filterNews.deleted);
+    if (filterNews.deleted)
+      q.addBindValue(QDateTime::currentDateTime().toString(Qt::ISODate));
+    else
+      q.addBindValue(QString());
+    q.addBindValue(filterNews.label);
     if (!q.exec()) {
       qWarning() << __PRETTY_FUNCTION__ << __LINE__
                  << "q.lastError(): " << q.lastError().text();
+    } else {
+      if (!colors.isEmpty()) {
+        int newsId = q.lastInsertId().toInt();
+        foreach (const QString &color, colors) {
+          filterColors_[color].append(newsId);
+        }
+      }
+      if (prefetchImages_ && !filterNews.deleted)
+        emit signalPrefetchImages(newsItem->description + newsItem->content, newsItem->link);
     }
     q.finish();
     qDebug() << "q.exec(" << q.lastQuery() << ")";
@@ -874,6 +1220,34 @@ void ParseObject::addRssNewsIntoBase(NewsItemStruct *newsItem)
   }
 }
 
+/** @brief Find WebSub hub advertised by feed
+ * @details Hub and topic are taken from links rel="hub" and rel="self" of
+ *   Atom feed or RSS channel, topic defaults to URL of feed.
+ *----------------------------------------------------------------------------*/
+void ParseObject::findHub(const QString &feedUrl, const QDomNode &parentNode)
+{
+  QString hubUrl;
+  QString topicUrl;
+  QDomElement linkElem = parentNode.firstChildElement();
+  for (; !linkElem.isNull(); linkElem = linkElem.nextSiblingElement()) {
+    if ((linkElem.tagName() != "link") && (linkElem.tagName() != "atom:link") &&
+        (linkElem.tagName() != "atom10:link")) {
+      continue;
+    }
+    QString rel = linkElem.attribute("rel");
+    if ((rel == "hub") && hubUrl.isEmpty())
+      hubUrl = linkElem.attribute("href").trimmed();
+    else if ((rel == "self") && topicUrl.isEmpty())
+      topicUrl = linkElem.attribute("href").trimmed();
+  }
+
+  if (QUrl(hubUrl).scheme().startsWith("http")) {
+    if (topicUrl.isEmpty())
+      topicUrl = feedUrl;
+    emit signalHubFound(parseFeedId_, hubUrl, topicUrl);
+  }
+}
+
 QString ParseObject::toPlainText(const QString &text)
 {
   return QTextDocumentFragment::fromHtml(text).toPlainText().simplified();
@@ -1002,6 +1376,29 @@ QString ParseObject::parseDate(const QString &dateString, const QString &urlStri
   return QString();
 }
 
+/** @brief Apply compiled user filters to news before adding it into base
+ *----------------------------------------------------------------------------*/
+void ParseObject::applyUserFilters(const NewsItemStruct *newsItem, bool read,
+                                   UserFilterNews *filterNews, QStringList *colors)
+{
+  filterNews->title = newsItem->title;
+  filterNews->description = newsItem->description;
+  filterNews->authorName = newsItem->author;
+  filterNews->category = newsItem->category;
+  filterNews->link = newsItem->link;
+  filterNews->newState = read ? 0 : 1;
+  filterNews->read = read ? 2 : 0;
+  filterNews->starred = 0;
+  filterNews->deleted = 0;
+
+  userFilters_.apply(parseFeedId_, filterNews, &filterSounds_, colors);
+}
+
+void ParseObject::reloadUserFilters()
+{
+  userFilters_.invalidate();
+}
+
 /** @brief Apply user filters
  * @param feedId - Feed Id
  * @param filterId - Id of particular filter
@@ -1027,7 +1424,7 @@ void ParseObject::runUserFilter(int feedId, int filterId)
       filterId = q.value(2).toInt();
     int filterType = q.value(1).toInt();
 
-    QString qStr("UPDATE news SET");
+    QString actionsStr;
     QString qStr1;
     QString qStr2;
     QString whereStr;
@@ -1066,10 +1463,7 @@ void ParseObject::runUserFilter(int feedId, int filterId)
       }
     }
 
-    if (qStr1.isEmpty())
-      qStr.clear();
-    else
-      qStr.append(qStr1);
+    actionsStr = qStr1;
 
     whereStr = QString(" WHERE feedId='%1' AND deleted=0").arg(feedId);
 
@@ -1245,48 +1639,31 @@ void ParseObject::runUserFilter(int feedId, int filterId)
       whereStr.append(qStr1).append(")");
     }
 
-    if (q1.exec(QString("SELECT id, label FROM news").append(whereStr))) {
-      QSqlQuery q2(db_);
-      bool isPlaySound = false;
-
+    // Materialize matched news once, apply actions to the whole set
+    QList<int> idList;
+    if (q1.exec(QString("SELECT id FROM news").append(whereStr))) {
       while (q1.next()) {
-        if (!qStr.isEmpty()) {
-          qStr1 = qStr % QString(" WHERE id='%1'").arg(q1.value(0).toInt());
-          if (!q2.exec(qStr1)) {
-            qWarning() << __PRETTY_FUNCTION__ << __LINE__
-                       << "q.lastError(): " << q2.lastError().text();
-          }
-        }
-
-        if (!idLabelsList.isEmpty()) {
-          QString idLabelsStr = q1.value(1).toString();
-          foreach (int idLabel, idLabelsList) {
-            if (idLabelsStr.contains(QString(",%1,").arg(idLabel))) continue;
-            if (idLabelsStr.isEmpty()) idLabelsStr.append(",");
-            idLabelsStr.append(QString("%1,").arg(idLabel));
-
-          }
-          qStr1 = QString("UPDATE news SET label='%1' WHERE id='%2'").arg(idLabelsStr).
-              arg(q1.value(0).toInt());
-          if (!q2.exec(qStr1)) {
-            qWarning() << __PRETTY_FUNCTION__ << __LINE__
-                       << "q.lastError(): " << q2.lastError().text();
-          }
-        }
-
-        if (!colorList.isEmpty()) {
-          emit signalAddColorList(q1.value(0).toInt(), colorList.at(0));
-        }
-
-        isPlaySound = true;
+        idList.append(q1.value(0).toInt());
       }
-
-      if (isPlaySound && !soundList.isEmpty())
-        emit signalPlaySound(soundList.at(0));
     } else {
       qWarning() << __PRETTY_FUNCTION__ << __LINE__
                  << "q.lastError(): " << q1.lastError().text();
     }
+    q1.finish();
+
+    if (idList.isEmpty()) continue;
+
+    NewsStateUpdater updater(db_);
+    if (!actionsStr.isEmpty())
+      updater.update(idList, actionsStr);
+    foreach (int idLabel, idLabelsList) {
+      updater.setLabel(idList, idLabel, true);
+    }
+
+    if (!colorList.isEmpty())
+      emit signalAddColorList(idList, colorList.at(0));
+    if (!soundList.isEmpty())
+      emit signalPlaySound(soundList.at(0));
 
   }
 }
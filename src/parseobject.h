@@ -25,6 +25,10 @@
 #include <QObject>
 #include <QUrl>
 #include <QMutex>
+#include <QXmlStreamReader>
+#include <QElapsedTimer>
+
+#include "userfilters.h"
 
 struct FeedItemStruct {
   QString title;
@@ -71,6 +75,16 @@ struct FeedCountStruct{
 
 Q_DECLARE_METATYPE(FeedCountStruct)
 
+struct CategoryCountStruct {
+  int allStarredCount;
+  int unreadStarredCount;
+  int deletedCount;
+  QMap<int,int> allLabelCount;     // label id -> not deleted news count
+  QMap<int,int> unreadLabelCount;  // label id -> unread news count
+};
+
+Q_DECLARE_METATYPE(CategoryCountStruct)
+
 class ParseObject : public QObject
 {
   Q_OBJECT
@@ -83,15 +97,22 @@ public:
 public slots:
   void parseXml(QByteArray data, int feedId,
                 QDateTime dtReply, QString codecName);
+  void parseXmlData(QByteArray data, int feedId,
+                    QDateTime dtReply, bool finished);
+  void abortXmlData(int feedId);
   void runUserFilter(int feedId, int filterId = -1);
+  void reloadUserFilters();
 
 signals:
   void signalReadyParse(const QByteArray &xml, const int &feedId,
                         const QDateTime &dtReply, const QString &codecName);
   void signalFinishUpdate(int feedId, bool changed, int newCount, QString status);
+  void signalStageTimes(int feedId, int parseTime, int commitTime);
   void feedCountsUpdate(FeedCountStruct counts);
   void signalPlaySound(const QString &soundPath);
-  void signalAddColorList(int id, const QString &color);
+  void signalAddColorList(const QList<int> &idList, const QString &color);
+  void signalHubFound(int feedId, QString hubUrl, QString topicUrl);
+  void signalPrefetchImages(QString html, QString baseUrl);
 
 private slots:
   void getQueuedXml();
@@ -101,14 +122,68 @@ private slots:
   void addRssNewsIntoBase(NewsItemStruct *newsItem);
 
 private:
+  /*! \brief Feed parsed while downloading, with parse state between its parts */
+  struct FeedStream {
+    FeedStream()
+      : feedSaved(false), skip(false), done(false), newsCount(0)
+      , parseTime(0), commitTime(0)
+      , parseFeedId(0), duplicateNewsMode(false), feedChanged(false)
+      , addSingleNewsAnyDate(false), avoidedOldSingleNews(false)
+      , prefetchImages(false)
+    {}
+
+    QXmlStreamReader reader;
+    QDomDocument doc;
+    QDomNode current;
+    QString feedUrl;
+    QString feedType;
+    FeedItemStruct feedItem;
+    bool feedSaved;
+    bool skip;
+    bool done;
+    int newsCount;
+    int parseTime;
+    int commitTime;
+    QByteArray xmlData;
+
+    int parseFeedId;
+    bool duplicateNewsMode;
+    bool feedChanged;
+    bool addSingleNewsAnyDate;
+    bool avoidedOldSingleNews;
+    QDate avoidedOldSingleNewsDate;
+    bool prefetchImages;
+    QStringList guidList;
+    QStringList linkList;
+    QStringList titleList;
+    QStringList publishedList;
+    QDateTime lastBuildDate;
+    QStringList filterSounds;
+    QMap<QString, QList<int> > filterColors;
+  };
+
+  bool startParse(int feedId, const QDateTime &dtReply, QString *feedUrl);
+  void loadFeedNews();
+  int finishParse(const QString &feedUrl);
+  void swapStreamState(FeedStream *stream);
+  void readXmlStream(FeedStream *stream);
+  void parseStreamNews(FeedStream *stream, const QDomNode &newsNode);
   void parseAtom(const QString &feedUrl, const QDomDocument &doc);
+  FeedItemStruct parseAtomFeed(const QString &feedUrl, const QDomElement &rootElem);
+  void parseAtomNews(const QString &feedUrl, const FeedItemStruct &feedItem,
+                     const QDomNode &newsNode);
   void parseRss(const QString &feedUrl, const QDomDocument &doc);
+  void parseRssFeed(const QString &feedUrl, const QDomElement &rootElem);
+  void parseRssNews(const QString &feedUrl, const QDomNode &newsNode);
+  void findHub(const QString &feedUrl, const QDomNode &parentNode);
   QString toPlainText(const QString &text);
   QString fromPlainText(QString text);
   QString getCommunity(const QDomNode &nodeContent);
   QString parseDate(const QString &dateString, const QString &urlString);
   int recountFeedCounts(int feedId, const QString &feedUrl,
                         const QString &updated, const QString &lastBuildDate);
+  void applyUserFilters(const NewsItemStruct *newsItem, bool read,
+                        UserFilterNews *filterNews, QStringList *colors);
 
   QSqlDatabase db_;
   QTimer *parseTimer_;
@@ -117,6 +192,7 @@ private:
   QQueue<QByteArray> xmlsQueue_;
   QQueue<QDateTime> dtReadyQueue_;
   QQueue<QString> codecNameQueue_;
+  QHash<int, FeedStream*> feedStreams_;
 
   int parseFeedId_;
   bool duplicateNewsMode_;
@@ -124,6 +200,7 @@ private:
   bool addSingleNewsAnyDate_;
   bool avoidedOldSingleNews_;
   QDate avoidedOldSingleNewsDate_;
+  bool prefetchImages_;
 
   QStringList guidList_;
   QStringList linkList_;
@@ -132,6 +209,10 @@ private:
 
   QDateTime lastBuildDate_;
 
+  UserFilters userFilters_;
+  QStringList filterSounds_;
+  QMap<QString, QList<int> > filterColors_;
+
 };
 
 #endif // PARSEOBJECT_H
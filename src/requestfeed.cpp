@@ -16,35 +16,52 @@
 * along with this program.  If not, see <https://www.gnu.org/licenses/>.
 * ============================================================ */
 #include "requestfeed.h"
-#include "VersionNo.h"
-#include "mainapplication.h"
 #include "globals.h"
 
 #include <QDebug>
 #include <QtSql>
+#include <QTextCodec>
 #include <qzregexp.h>
 
 #define REPLY_MAX_COUNT 10
+#define HTTP2_STREAMS_MAX_COUNT 50
+
+#if QT_VERSION >= 0x050F00
+#define HTTP2_ALLOWED_ATTRIBUTE QNetworkRequest::Http2AllowedAttribute
+#define HTTP2_USED_ATTRIBUTE QNetworkRequest::Http2WasUsedAttribute
+#elif QT_VERSION >= 0x050900
+#define HTTP2_ALLOWED_ATTRIBUTE QNetworkRequest::HTTP2AllowedAttribute
+#define HTTP2_USED_ATTRIBUTE QNetworkRequest::HTTP2WasUsedAttribute
+#endif
 
 RequestFeed::RequestFeed(int timeoutRequest, int numberRequests,
                          int numberRepeats, QObject *parent)
   : QObject(parent)
   , networkManager_(NULL)
+  , feedArchive_(NULL)
   , timeoutRequest_(timeoutRequest)
   , numberRequests_(numberRequests)
   , numberRepeats_(numberRepeats)
+  , streamParsing_(false)
 {
   setObjectName("requestFeed_");
 
-  timeout_ = new QTimer(this);
-  timeout_->setInterval(1000);
-  connect(timeout_, SIGNAL(timeout()), this, SLOT(slotRequestTimeout()));
+  // Every stage of request gets whole request timeout
+  int timeout = qMax(1, timeoutRequest_) * 1000;
+  replyTimeouts_ = new ReplyTimeouts(this);
+  replyTimeouts_->setTimeouts(timeout, timeout, timeout);
+  connect(replyTimeouts_, SIGNAL(timeout(QNetworkReply*,int)),
+          this, SLOT(slotRequestTimeout(QNetworkReply*,int)));
 
   getUrlTimer_ = new QTimer(this);
   getUrlTimer_->setSingleShot(true);
   getUrlTimer_->setInterval(50);
   connect(getUrlTimer_, SIGNAL(timeout()), this, SLOT(getQueuedUrl()));
 
+  retryTimer_ = new QTimer(this);
+  retryTimer_->setSingleShot(true);
+  connect(retryTimer_, SIGNAL(timeout()), this, SLOT(slotRetryRequests()));
+
   connect(this, SIGNAL(signalHead(QUrl,int,QString,QDateTime,int)),
           SLOT(slotHead(QUrl,int,QString,QDateTime,int)),
           Qt::QueuedConnection);
@@ -58,6 +75,21 @@ RequestFeed::~RequestFeed()
 
 }
 
+/** @brief Record feed replies to \a feedArchive or replay them from it
+ *----------------------------------------------------------------------------*/
+void RequestFeed::setFeedArchive(FeedArchive *feedArchive)
+{
+  feedArchive_ = feedArchive;
+  feedArchive_->setParent(this);
+  if (networkManager_)
+    networkManager_->setFeedArchive(feedArchive_);
+}
+
+bool RequestFeed::isRecording() const
+{
+  return feedArchive_ && (feedArchive_->mode() == FeedArchive::ModeRecord);
+}
+
 void RequestFeed::disconnectObjects()
 {
   disconnect(this);
@@ -72,13 +104,11 @@ void RequestFeed::requestUrl(int id, QString urlString,
 {
   if (!networkManager_) {
     networkManager_ = new NetworkManager(true, this);
+    networkManager_->setFeedArchive(feedArchive_);
     connect(networkManager_, SIGNAL(finished(QNetworkReply*)),
             this, SLOT(finished(QNetworkReply*)));
   }
 
-  if (!timeout_->isActive())
-    timeout_->start();
-
   idsQueue_.enqueue(id);
   feedsQueue_.enqueue(urlString);
   dateQueue_.enqueue(date);
@@ -106,37 +136,40 @@ void RequestFeed::stopRequest()
  *----------------------------------------------------------------------------*/
 void RequestFeed::getQueuedUrl()
 {
-  if ((currentFeeds_.count() >= numberRequests_) ||
-      (currentFeeds_.count() >= REPLY_MAX_COUNT)) {
-    getUrlTimer_->start();
-    return;
-  }
-
   if (!feedsQueue_.isEmpty()) {
     getUrlTimer_->start();
-    QString feedUrl = feedsQueue_.head();
 
-    if (hostList_.contains(QUrl(feedUrl).host())) {
-      foreach (QString url, currentFeeds_) {
-        if (QUrl(url).host() == QUrl(feedUrl).host()) {
-          return;
-        }
+    // Feeds of hosts that can't be requested now keep their place in queue,
+    // feeds of other hosts go ahead of them
+    QSet<QString> waitingHosts;
+    int index = -1;
+    for (int i = 0; i < feedsQueue_.count(); ++i) {
+      QString host = QUrl(feedsQueue_.at(i)).host();
+      if (waitingHosts.contains(host))
+        continue;
+      if (canStartRequest(host) && !isHostWaiting(host)) {
+        index = i;
+        break;
       }
+      waitingHosts.insert(host);
     }
-    int feedId = idsQueue_.dequeue();
-    feedUrl = feedsQueue_.dequeue();
+    if (index == -1)
+      return;
+
+    int feedId = idsQueue_.takeAt(index);
+    QString feedUrl = feedsQueue_.takeAt(index);
 
     emit setStatusFeed(feedId, "1 Update");
 
     QUrl getUrl = QUrl::fromEncoded(feedUrl.toUtf8());
-    QString userInfo = userInfo_.dequeue();
+    QString userInfo = userInfo_.takeAt(index);
     if (!userInfo.isEmpty()) {
       getUrl.setUserInfo(userInfo);
 //      getUrl.addQueryItem("auth", getUrl.scheme());
     }
 
     qDebug() << "getQueuedUrl() >>" << feedUrl << "countQueue=" << feedsQueue_.count();
-    QDateTime currentDate = dateQueue_.dequeue();
+    QDateTime currentDate = dateQueue_.takeAt(index);
     if (currentDate.isValid())
       emit signalHead(getUrl, feedId, feedUrl, currentDate);
     else
@@ -144,30 +177,63 @@ void RequestFeed::getQueuedUrl()
   }
 }
 
+/** @brief Check throttled \a host has to wait for its ready time or for its
+ *   request in progress
+ *----------------------------------------------------------------------------*/
+bool RequestFeed::isHostWaiting(const QString &host) const
+{
+  if (!hostThrottle_.isThrottled(host))
+    return false;
+  if (hostThrottle_.readyTime(host) > QDateTime::currentDateTime().toMSecsSinceEpoch())
+    return true;
+
+  foreach (const CurrentRequest &request, currentRequests_) {
+    if (QUrl(request.feedUrl).host() == host)
+      return true;
+  }
+  return false;
+}
+
+/** @brief Check number of connections allows request to \a host
+ * @details Requests to host known to use HTTP/2 share one connection, they are
+ *   not limited by number of requests but by number of streams per host.
+ *----------------------------------------------------------------------------*/
+bool RequestFeed::canStartRequest(const QString &host) const
+{
+  QSet<QString> http2Hosts;
+  int connections = 0;
+  int hostStreams = 0;
+  foreach (const CurrentRequest &request, currentRequests_) {
+    QString requestHost = request.url.host();
+    if (http2Hosts_.contains(requestHost)) {
+      if (requestHost == host)
+        hostStreams++;
+      if (http2Hosts.contains(requestHost))
+        continue;
+      http2Hosts.insert(requestHost);
+    }
+    connections++;
+  }
+
+  if (hostStreams)
+    return (hostStreams < HTTP2_STREAMS_MAX_COUNT);
+  return (connections < numberRequests_) && (connections < REPLY_MAX_COUNT);
+}
+
 /** @brief Prepare and send network request to get head
  *----------------------------------------------------------------------------*/
 void RequestFeed::slotHead(const QUrl &getUrl, const int &id, const QString &feedUrl,
                             const QDateTime &date, const int &count)
 {
-  if (count)
-    Common::sleep(30);
-
   qDebug() << objectName() << "::head:" << getUrl.toEncoded() << "feed:" << feedUrl << "countRepeats:" << count;
   QNetworkRequest request(getUrl);
   request.setRawHeader("User-Agent", globals.userAgent().toUtf8());
-
-  currentUrls_.append(getUrl);
-  currentIds_.append(id);
-  currentFeeds_.append(feedUrl);
-  currentDates_.append(date);
-  currentCount_.append(count);
-  currentHead_.append(true);
-  currentTime_.append(timeoutRequest_);
+#ifdef HTTP2_ALLOWED_ATTRIBUTE
+  request.setAttribute(HTTP2_ALLOWED_ATTRIBUTE, true);
+#endif
 
   QNetworkReply *reply = networkManager_->head(request);
-  reply->setProperty("feedReply", QVariant(true));
-  requestUrl_.append(reply->url());
-  networkReply_.append(reply);
+  startRequest(reply, getUrl, id, feedUrl, date, count, true);
 }
 
 /** @brief Prepare and send network request to get all data
@@ -175,26 +241,200 @@ void RequestFeed::slotHead(const QUrl &getUrl, const int &id, const QString &fee
 void RequestFeed::slotGet(const QUrl &getUrl, const int &id, const QString &feedUrl,
                            const QDateTime &date, const int &count)
 {
-  if (count)
-    Common::sleep(30);
-
   qDebug() << objectName() << "::get:" << getUrl.toEncoded() << "feed:" << feedUrl << "countRepeats:" <<count;
   QNetworkRequest request(getUrl);
   request.setRawHeader("Accept", "application/atom+xml,application/rss+xml;q=0.9,application/xml;q=0.8,text/xml;q=0.7,*/*;q=0.6");
   request.setRawHeader("User-Agent", globals.userAgent().toUtf8());
-
-  currentUrls_.append(getUrl);
-  currentIds_.append(id);
-  currentFeeds_.append(feedUrl);
-  currentDates_.append(date);
-  currentCount_.append(count);
-  currentHead_.append(false);
-  currentTime_.append(timeoutRequest_);
+#ifdef HTTP2_ALLOWED_ATTRIBUTE
+  request.setAttribute(HTTP2_ALLOWED_ATTRIBUTE, true);
+#endif
 
   QNetworkReply *reply = networkManager_->get(request);
+  startRequest(reply, getUrl, id, feedUrl, date, count, false);
+}
+
+/** @brief Remember sent request and set its connect deadline
+ *----------------------------------------------------------------------------*/
+void RequestFeed::startRequest(QNetworkReply *reply, const QUrl &getUrl, int id,
+                               const QString &feedUrl, const QDateTime &date,
+                               int count, bool head)
+{
   reply->setProperty("feedReply", QVariant(true));
-  requestUrl_.append(reply->url());
-  networkReply_.append(reply);
+
+  CurrentRequest request;
+  request.url = getUrl;
+  request.id = id;
+  request.feedUrl = feedUrl;
+  request.date = date;
+  request.count = count;
+  request.head = head;
+  request.stage = ReplyTimeouts::StageConnect;
+  request.startTime = QDateTime::currentDateTime().toMSecsSinceEpoch();
+  request.stream = (streamParsing_ && !head) ? StreamUnknown : StreamBuffered;
+  request.documentEnded = false;
+  request.handshake = false;
+  currentRequests_.insert(reply, request);
+
+  int hostRequests = 0;
+  foreach (const CurrentRequest &currentRequest, currentRequests_) {
+    if (currentRequest.url.host() == getUrl.host())
+      hostRequests++;
+  }
+  connectionStats_.maxHostRequests = qMax(connectionStats_.maxHostRequests, hostRequests);
+
+#if QT_VERSION >= 0x050100
+  connect(reply, SIGNAL(encrypted()), this, SLOT(slotReplyConnected()));
+#endif
+  if (request.stream == StreamUnknown)
+    connect(reply, SIGNAL(readyRead()), this, SLOT(slotReplyReadyRead()));
+
+  replyTimeouts_->addReply(reply);
+}
+
+void RequestFeed::slotReplyConnected()
+{
+  QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+  QHash<QNetworkReply*, CurrentRequest>::iterator it = currentRequests_.find(reply);
+  if (it != currentRequests_.end())
+    it.value().handshake = true;
+}
+
+/** @brief Pass feed data to parser while it is downloading
+ *----------------------------------------------------------------------------*/
+void RequestFeed::slotReplyReadyRead()
+{
+  QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+  QHash<QNetworkReply*, CurrentRequest>::iterator it = currentRequests_.find(reply);
+  if (it == currentRequests_.end()) return;
+
+  CurrentRequest &request = it.value();
+  if (request.stream == StreamUnknown) {
+    // Wait for the beginning of document to know its encoding
+    if (reply->bytesAvailable() < 1024) return;
+
+    if (!isStreamable(reply)) {
+      request.stream = StreamBuffered;
+      return;
+    }
+
+    request.stream = StreamActive;
+    QByteArray data = reply->readAll();
+    if (isRecording())
+      request.archiveData += data;
+    int pos = 0;
+    while ((pos < data.size()) && QChar(data.at(pos)).isSpace())
+      pos++;
+    request.streamTail = data.mid(pos);
+    qDebug() << objectName() << "::stream:" << request.url.toEncoded();
+  }
+
+  if (request.stream == StreamActive)
+    readStreamData(reply, &request, false);
+}
+
+/** @brief Check feed can be parsed while downloading
+ * @details Feeds in unknown encoding or in encoding other than declared one
+ *   are converted by parser after download, so they are not streamed.
+ *----------------------------------------------------------------------------*/
+bool RequestFeed::isStreamable(QNetworkReply *reply)
+{
+  if ((reply->error() != QNetworkReply::NoError) ||
+      reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl().isValid())
+    return false;
+  int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  if (statusCode && ((statusCode < 200) || (statusCode >= 300)))
+    return false;
+
+  QByteArray data = reply->peek(1024).trimmed();
+  QzRegExp rx("encoding=[\"']([^\"']+)", Qt::CaseInsensitive);
+  if (rx.indexIn(QString::fromLatin1(data)) > -1) {
+    return data.startsWith("<?xml") &&
+        QTextCodec::codecForName(rx.cap(1).toLatin1());
+  }
+
+  rx.setPattern("charset=([^\t]+)$");
+  if (rx.indexIn(reply->header(QNetworkRequest::ContentTypeHeader).toString()) > -1) {
+    QTextCodec *codec = QTextCodec::codecForName(rx.cap(1).toLatin1());
+    return codec && (codec->mibEnum() == 106);  // UTF-8
+  }
+  return true;
+}
+
+/** @brief Check data has closing tag of feed document
+ *----------------------------------------------------------------------------*/
+bool RequestFeed::isDocumentEnd(const QByteArray &data)
+{
+  return data.contains("</rss>") || data.contains("</feed>") ||
+      data.contains("</rdf:RDF>");
+}
+
+/** @brief Send received data to parser
+ * @details Data after the last '>' waits for next part, so tags and entities
+ *   are repaired as a whole. Closing tag of document is sent whole too, it
+ *   marks request which feed is completely passed to parser.
+ *----------------------------------------------------------------------------*/
+void RequestFeed::readStreamData(QNetworkReply *reply, CurrentRequest *request,
+                                 bool finished)
+{
+  QByteArray received = reply->readAll();
+  if (isRecording())
+    request->archiveData += received;
+  QByteArray data = request->streamTail + received;
+  if (finished) {
+    request->streamTail.clear();
+  } else {
+    int size = data.lastIndexOf('>') + 1;
+    request->streamTail = data.mid(size);
+    data.truncate(size);
+  }
+
+  repairXml(&data);
+  if (isDocumentEnd(data))
+    request->documentEnded = true;
+
+  if (!data.isEmpty() || finished)
+    emit getUrlData(request->id, data, lastModifiedDate(reply), finished);
+}
+
+/** @brief Stop parsing of feed which download has failed and repeat request
+ * @details Data received before the failure is dropped by parser, feed is
+ *   updated by repeated request or gets error \a result.
+ *----------------------------------------------------------------------------*/
+void RequestFeed::abortStream(const CurrentRequest &request, int count, int delay,
+                              int result, const QString &error)
+{
+  emit getUrlAbort(request.id);
+
+  if (count < numberRepeats_) {
+    scheduleRetry(request.url, request.id, request.feedUrl, request.date, count, delay);
+  } else {
+    emit getUrlDone(result, request.id, request.feedUrl, error);
+  }
+}
+
+/** @brief Last-Modified date of reply in local time
+ *----------------------------------------------------------------------------*/
+QDateTime RequestFeed::lastModifiedDate(QNetworkReply *reply)
+{
+  QDateTime replyDate = reply->header(QNetworkRequest::LastModifiedHeader).toDateTime();
+  return QDateTime(replyDate.date(), replyDate.time());
+}
+
+/** @brief Escape single ampersands and close <br> tags
+ *----------------------------------------------------------------------------*/
+void RequestFeed::repairXml(QByteArray *data)
+{
+  QzRegExp rx("&(?!([a-z0-9#]+;))");
+  QString str = QString::fromLatin1(*data);
+  int pos = 0;
+  int shift = 0;
+  while ((pos = rx.indexIn(str, pos)) != -1) {
+    data->replace(pos + shift, 1, "&amp;");
+    shift += 4;
+    pos += 1;
+  }
+
+  data->replace("<br>", "<br/>");
 }
 
 /** @brief Process network reply
@@ -211,18 +451,35 @@ void RequestFeed::finished(QNetworkReply *reply)
   qDebug() << reply->header(QNetworkRequest::CookieHeader);
   qDebug() << reply->header(QNetworkRequest::SetCookieHeader);
 
-  int currentReplyIndex = currentUrls_.indexOf(replyUrl);
-
-  if (currentReplyIndex >= 0) {
-    currentTime_.removeAt(currentReplyIndex);
-    currentUrls_.removeAt(currentReplyIndex);
-    int feedId    = currentIds_.takeAt(currentReplyIndex);
-    QString feedUrl    = currentFeeds_.takeAt(currentReplyIndex);
-    QDateTime feedDate = currentDates_.takeAt(currentReplyIndex);
-    int count = currentCount_.takeAt(currentReplyIndex) + 1;
-    bool headOk = currentHead_.takeAt(currentReplyIndex);
-
-    if (reply->error() != QNetworkReply::NoError) {
+  if (currentRequests_.contains(reply)) {
+    CurrentRequest request = currentRequests_.take(reply);
+    request.stage = replyTimeouts_->stage(reply);
+    replyTimeouts_->removeReply(reply);
+    addConnectionStats(reply, request);
+    if (isRecording() && (request.stream != StreamActive))
+      request.archiveData = reply->peek(reply->bytesAvailable());
+
+    int feedId = request.id;
+    QString feedUrl = request.feedUrl;
+    QDateTime feedDate = request.date;
+    int count = request.count + 1;
+    bool headOk = request.head;
+
+    if (request.stream == StreamActive) {
+      if (reply->error() == QNetworkReply::NoError) {
+        hostThrottle_.success(QUrl(feedUrl).host());
+        readStreamData(reply, &request, true);
+      } else if (request.documentEnded) {
+        // Whole document is passed to parser, error of connection after it
+        // doesn't spoil feed
+        qDebug() << "  error after end of RSS feed:" << reply->error() << reply->errorString();
+        readStreamData(reply, &request, true);
+      } else {
+        qDebug() << "  error streaming RSS feed:" << reply->error() << reply->errorString();
+        abortStream(request, count, hostThrottle_.retryDelay(count), -1,
+                    QString("%1 (%2)").arg(reply->errorString()).arg(reply->error()));
+      }
+    } else if (reply->error() != QNetworkReply::NoError) {
       qDebug() << "  error retrieving RSS feed:" << reply->error() << reply->errorString();
       if (!headOk) {
         if (reply->error() == QNetworkReply::AuthenticationRequiredError)
@@ -230,15 +487,18 @@ void RequestFeed::finished(QNetworkReply *reply)
         else if (reply->error() == QNetworkReply::ContentNotFoundError)
           emit getUrlDone(-5, feedId, feedUrl, tr("Server replied: Not Found!"));
         else {
-          if (reply->errorString().contains("Service Temporarily Unavailable")) {
-            if (!hostList_.contains(QUrl(feedUrl).host())) {
-              hostList_.append(QUrl(feedUrl).host());
+          int delay = hostThrottle_.retryDelay(count);
+          if (HostThrottle::isThrottleReply(reply)) {
+            // First throttling of host is not counted as repeat
+            QString host = QUrl(feedUrl).host();
+            if (!hostThrottle_.isThrottled(host))
               count--;
-            }
+            hostThrottle_.throttle(host, HostThrottle::retryAfter(reply));
+            delay = 0;
           }
 
           if (count < numberRepeats_) {
-            emit signalGet(replyUrl, feedId, feedUrl, feedDate, count);
+            scheduleRetry(replyUrl, feedId, feedUrl, feedDate, count, delay);
           } else {
             emit getUrlDone(-1, feedId, feedUrl, QString("%1 (%2)").arg(reply->errorString()).arg(reply->error()));
           }
@@ -247,6 +507,8 @@ void RequestFeed::finished(QNetworkReply *reply)
         emit signalGet(replyUrl, feedId, feedUrl, feedDate);
       }
     } else {
+      hostThrottle_.success(QUrl(feedUrl).host());
+
       QUrl redirectionTarget = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
       if (redirectionTarget.isValid()) {
         if (count < (numberRepeats_ + 3)) {
@@ -287,7 +549,7 @@ void RequestFeed::finished(QNetworkReply *reply)
         }
       } else {
         QDateTime replyDate = reply->header(QNetworkRequest::LastModifiedHeader).toDateTime();
-        QDateTime replyLocalDate = QDateTime(replyDate.date(), replyDate.time());
+        QDateTime replyLocalDate = lastModifiedDate(reply);
 
         qDebug() << feedDate << replyDate << replyLocalDate;
         qDebug() << feedDate.toMSecsSinceEpoch() << replyDate.toMSecsSinceEpoch() << replyLocalDate.toMSecsSinceEpoch();
@@ -306,15 +568,7 @@ void RequestFeed::finished(QNetworkReply *reply)
 
           QByteArray data = reply->readAll();
           data = data.trimmed();
-
-          rx.setPattern("&(?!([a-z0-9#]+;))");
-          pos = 0;
-          while ((pos = rx.indexIn(QString::fromLatin1(data), pos)) != -1) {
-            data.replace(pos, 1, "&amp;");
-            pos += 1;
-          }
-
-          data.replace("<br>", "<br/>");
+          repairXml(&data);
 
           if (data.indexOf("</rss>") > 0)
             data.resize(data.indexOf("</rss>") + 6);
@@ -327,49 +581,175 @@ void RequestFeed::finished(QNetworkReply *reply)
         }
       }
     }
+
+    if (isRecording()) {
+      feedArchive_->record(reply, request.archiveData,
+                           QDateTime::currentDateTime().toMSecsSinceEpoch() - request.startTime);
+    }
   } else {
     qCritical() << "Request Url error: " << replyUrl.toString() << reply->errorString();
   }
 
-  int replyIndex = requestUrl_.indexOf(replyUrl);
-  if (replyIndex >= 0) {
-    requestUrl_.removeAt(replyIndex);
-    networkReply_.removeAt(replyIndex);
-  }
-
   reply->abort();
   reply->deleteLater();
+
+  reportConnectionStats();
 }
 
-/** @brief Timeout to delete network requests which has no answer
+/** @brief Delete network request which stage has timed out
  *----------------------------------------------------------------------------*/
-void RequestFeed::slotRequestTimeout()
+void RequestFeed::slotRequestTimeout(QNetworkReply *reply, int stage)
 {
-  for (int i = currentTime_.count() - 1; i >= 0; i--) {
-    int time = currentTime_.at(i) - 1;
-    if (time <= 0) {
-      QUrl url = currentUrls_.takeAt(i);
-      int feedId    = currentIds_.takeAt(i);
-      QString feedUrl = currentFeeds_.takeAt(i);
-      QDateTime feedDate = currentDates_.takeAt(i);
-      int count = currentCount_.takeAt(i) + 1;
-      currentTime_.removeAt(i);
-      currentHead_.removeAt(i);
-
-      int replyIndex = requestUrl_.indexOf(url);
-      if (replyIndex >= 0) {
-        QUrl replyUrl = requestUrl_.takeAt(replyIndex);
-        QNetworkReply *reply = networkReply_.takeAt(replyIndex);
-        reply->deleteLater();
-
-        if (count < numberRepeats_) {
-          emit signalGet(replyUrl, feedId, feedUrl, feedDate, count);
-        } else {
-          emit getUrlDone(-3, feedId, feedUrl, tr("Request timeout!"));
-        }
-      }
-    } else {
-      currentTime_.replace(i, time);
+  if (!currentRequests_.contains(reply)) return;
+
+  CurrentRequest request = currentRequests_.take(reply);
+  request.stage = ReplyTimeouts::Stage(stage);
+  addConnectionStats(reply, request);
+  reply->disconnect(this);
+  reply->deleteLater();
+
+  QString error;
+  if (request.stage == ReplyTimeouts::StageConnect)
+    error = tr("Connection timeout!");
+  else if (request.stage == ReplyTimeouts::StageFirstByte)
+    error = tr("Server response timeout!");
+  else
+    error = tr("Request timeout!");
+  qDebug() << objectName() << "::timeout:" << request.url.toEncoded() << error;
+
+  int count = request.count + 1;
+  if ((request.stream == StreamActive) && request.documentEnded) {
+    emit getUrlData(request.id, QByteArray(), QDateTime(), true);
+  } else if (request.stream == StreamActive) {
+    abortStream(request, count, hostThrottle_.retryDelay(count), -3, error);
+  } else if (count < numberRepeats_) {
+    scheduleRetry(request.url, request.id, request.feedUrl, request.date, count,
+                  hostThrottle_.retryDelay(count));
+  } else {
+    emit getUrlDone(-3, request.id, request.feedUrl, error);
+  }
+
+  reportConnectionStats();
+}
+
+/** @brief Count connection used by finished request
+ * @details New TLS connection is known by its handshake, HTTPS request that
+ *   got response without handshake has reused connection.
+ *----------------------------------------------------------------------------*/
+void RequestFeed::addConnectionStats(QNetworkReply *reply, const CurrentRequest &request)
+{
+  connectionStats_.requests++;
+  connectionStats_.requestsTime +=
+      QDateTime::currentDateTime().toMSecsSinceEpoch() - request.startTime;
+
+  QString host = request.url.host();
+#ifdef HTTP2_USED_ATTRIBUTE
+  if (reply->attribute(HTTP2_USED_ATTRIBUTE).toBool()) {
+    connectionStats_.http2Requests++;
+    http2Hosts_.insert(host);
+  } else if (request.stage == ReplyTimeouts::StageTransfer) {
+    http2Hosts_.remove(host);
+  }
+#else
+  Q_UNUSED(reply)
+  Q_UNUSED(host)
+#endif
+
+  if (request.handshake)
+    connectionStats_.handshakes++;
+  else if ((request.url.scheme() == "https") && (request.stage == ReplyTimeouts::StageTransfer))
+    connectionStats_.reused++;
+}
+
+/** @brief Report connections of update when all its requests are finished
+ * @details Statistics stay available by connectionStats() until the next
+ *   update is finished.
+ *----------------------------------------------------------------------------*/
+void RequestFeed::reportConnectionStats()
+{
+  if (!connectionStats_.requests || !currentRequests_.isEmpty() ||
+      !feedsQueue_.isEmpty() || !retryQueue_.isEmpty())
+    return;
+
+  qDebug() << objectName() << "::connections:" << connectionStats_.requests << "requests,"
+           << connectionStats_.http2Requests << "over HTTP/2,"
+           << connectionStats_.handshakes << "TLS handshakes,"
+           << connectionStats_.reused << "reused TLS connections,"
+           << connectionStats_.maxHostRequests << "requests to one host at most,"
+           << connectionStats_.requestsTime << "ms in requests";
+
+  lastConnectionStats_ = connectionStats_;
+  connectionStats_ = ConnectionStats();
+
+  if (feedArchive_)
+    feedArchive_->save();
+
+  emit connectionStatsReported();
+}
+
+/** @brief Put failed request in retry queue
+ * @param delay Delay in milliseconds, retry also waits for throttled host
+ *----------------------------------------------------------------------------*/
+void RequestFeed::scheduleRetry(const QUrl &getUrl, int id, const QString &feedUrl,
+                                const QDateTime &date, int count, int delay)
+{
+  RetryRequest retryRequest;
+  retryRequest.url = getUrl;
+  retryRequest.id = id;
+  retryRequest.feedUrl = feedUrl;
+  retryRequest.date = date;
+  retryRequest.count = count;
+
+  qint64 retryTime = QDateTime::currentDateTime().toMSecsSinceEpoch() + delay;
+  retryTime = qMax(retryTime, hostThrottle_.readyTime(QUrl(feedUrl).host()));
+  retryQueue_.insert(retryTime, retryRequest);
+
+  qDebug() << objectName() << "::retry:" << getUrl.toEncoded() << "in" <<
+              retryTime - QDateTime::currentDateTime().toMSecsSinceEpoch() << "ms";
+
+  slotRetryRequests();
+}
+
+/** @brief Send requests from retry queue which time has come
+ *----------------------------------------------------------------------------*/
+void RequestFeed::slotRetryRequests()
+{
+  qint64 currentTime = QDateTime::currentDateTime().toMSecsSinceEpoch();
+  qint64 interval = getUrlTimer_->interval();
+  bool sent = false;
+
+  while (!retryQueue_.isEmpty() && (retryQueue_.begin().key() <= currentTime)) {
+    RetryRequest retryRequest = retryQueue_.begin().value();
+    retryQueue_.erase(retryQueue_.begin());
+
+    // Throttling of host could be prolonged in the meantime
+    QString host = QUrl(retryRequest.feedUrl).host();
+    qint64 readyTime = hostThrottle_.readyTime(host);
+    if (readyTime > currentTime) {
+      retryQueue_.insert(readyTime, retryRequest);
+      continue;
+    }
+
+    // Retry keeps limits of queued requests: it waits for free connection
+    // and for request to throttled host in progress
+    if (!canStartRequest(host) || isHostWaiting(host)) {
+      retryQueue_.insert(currentTime + interval, retryRequest);
+      continue;
     }
+
+    // One retry at a time, so the next one sees this one in progress
+    emit signalGet(retryRequest.url, retryRequest.id, retryRequest.feedUrl,
+                   retryRequest.date, retryRequest.count);
+    sent = true;
+    break;
+  }
+
+  if (!retryQueue_.isEmpty()) {
+    qint64 delay = retryQueue_.begin().key() - currentTime;
+    if (sent)
+      delay = qMax(delay, interval);
+    retryTimer_->start(int(qMax(qint64(0), delay)));
+  } else {
+    retryTimer_->stop();
   }
 }
@@ -24,8 +24,14 @@
 #include <QNetworkReply>
 #include <QTimer>
 #include <QElapsedTimer>
+#include <QMultiMap>
+#include <QHash>
+#include <QSet>
 
 #include "networkmanager.h"
+#include "hostthrottle.h"
+#include "replytimeouts.h"
+#include "feedarchive.h"
 
 class RequestFeed : public QObject
 {
@@ -35,7 +41,25 @@ public:
                        int numberRepeats, QObject *parent = 0);
   ~RequestFeed();
 
+  /*! \brief Connections used by requests of one update */
+  struct ConnectionStats {
+    ConnectionStats()
+      : requests(0), http2Requests(0), handshakes(0), reused(0)
+      , requestsTime(0), maxHostRequests(0) {}
+
+    int requests;
+    int http2Requests;
+    int handshakes;
+    int reused;
+    qint64 requestsTime;
+    int maxHostRequests;
+  };
+
   void disconnectObjects();
+  void setStreamParsing(bool streamParsing) { streamParsing_ = streamParsing; }
+  void setFeedArchive(FeedArchive *feedArchive);
+  ConnectionStats connectionStats() const { return lastConnectionStats_; }
+  bool isHttp2Host(const QString &host) const { return http2Hosts_.contains(host); }
 
 public slots:
   void requestUrl(int id, QString urlString, QDateTime date, QString userInfo = "");
@@ -49,41 +73,96 @@ signals:
   void getUrlDone(int result, int feedId, QString feedUrl = "",
                   QString error = "", QByteArray data = NULL,
                   QDateTime dtReply = QDateTime(), QString codecName = "");
+  void getUrlData(int feedId, QByteArray data, QDateTime dtReply, bool finished);
+  void getUrlAbort(int feedId);
   void signalHead(const QUrl &getUrl, const int &id, const QString &feedUrl,
                   const QDateTime &date, const int &count = 0);
   void signalGet(const QUrl &getUrl, const int &id, const QString &feedUrl,
                  const QDateTime &date, const int &count = 0);
   void setStatusFeed(int feedId, QString status);
+  void connectionStatsReported();
 
 private slots:
   void getQueuedUrl();
   void finished(QNetworkReply *reply);
-  void slotRequestTimeout();
+  void slotRequestTimeout(QNetworkReply *reply, int stage);
+  void slotRetryRequests();
+  void slotReplyConnected();
+  void slotReplyReadyRead();
 
 private:
+  enum StreamMode {
+    StreamUnknown,
+    StreamBuffered,
+    StreamActive
+  };
+
+  struct CurrentRequest {
+    QUrl url;
+    int id;
+    QString feedUrl;
+    QDateTime date;
+    int count;
+    bool head;
+    ReplyTimeouts::Stage stage;
+    qint64 startTime;
+    StreamMode stream;
+    QByteArray streamTail;
+    bool documentEnded;
+    bool handshake;
+    QByteArray archiveData;
+  };
+
+  void startRequest(QNetworkReply *reply, const QUrl &getUrl, int id,
+                    const QString &feedUrl, const QDateTime &date,
+                    int count, bool head);
+  bool canStartRequest(const QString &host) const;
+  bool isHostWaiting(const QString &host) const;
+  void addConnectionStats(QNetworkReply *reply, const CurrentRequest &request);
+  void reportConnectionStats();
+  bool isStreamable(QNetworkReply *reply);
+  static bool isDocumentEnd(const QByteArray &data);
+  void readStreamData(QNetworkReply *reply, CurrentRequest *request, bool finished);
+  void abortStream(const CurrentRequest &request, int count, int delay,
+                   int result, const QString &error);
+  bool isRecording() const;
+  static QDateTime lastModifiedDate(QNetworkReply *reply);
+  static void repairXml(QByteArray *data);
+
+  struct RetryRequest {
+    QUrl url;
+    int id;
+    QString feedUrl;
+    QDateTime date;
+    int count;
+  };
+
+  void scheduleRetry(const QUrl &getUrl, int id, const QString &feedUrl,
+                     const QDateTime &date, int count, int delay);
+
   NetworkManager *networkManager_;
+  FeedArchive *feedArchive_;
 
   int timeoutRequest_;
   int numberRequests_;
   int numberRepeats_;
-  QTimer *timeout_;
+  bool streamParsing_;
+  ReplyTimeouts *replyTimeouts_;
   QTimer *getUrlTimer_;
+  QTimer *retryTimer_;
 
   QQueue<int> idsQueue_;
   QQueue<QString> feedsQueue_;
   QQueue<QDateTime> dateQueue_;
   QQueue<QString> userInfo_;
 
-  QList<QUrl> currentUrls_;
-  QList<int> currentIds_;
-  QList<QString> currentFeeds_;
-  QList<QDateTime> currentDates_;
-  QList<int> currentCount_;
-  QList<bool> currentHead_;
-  QList<int> currentTime_;
-  QList<QUrl> requestUrl_;
-  QList<QNetworkReply*> networkReply_;
-  QList<QString> hostList_;
+  QHash<QNetworkReply*, CurrentRequest> currentRequests_;
+  QSet<QString> http2Hosts_;
+  ConnectionStats connectionStats_;
+  ConnectionStats lastConnectionStats_;
+
+  HostThrottle hostThrottle_;
+  QMultiMap<qint64, RetryRequest> retryQueue_;
 
 };
 
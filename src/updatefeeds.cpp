@@ -19,6 +19,7 @@
 
 #include "mainapplication.h"
 #include "database.h"
+#include "newsstateupdater.h"
 #include "settings.h"
 
 #include <QDebug>
@@ -33,6 +34,8 @@ UpdateFeeds::UpdateFeeds(QObject *parent, bool addFeed)
   , requestFeed_(NULL)
   , parseObject_(NULL)
   , faviconObject_(NULL)
+  , imagePrefetcher_(NULL)
+  , webSubServer_(NULL)
   , updateFeedThread_(NULL)
   , getFaviconThread_(NULL)
   , addFeed_(addFeed)
@@ -47,6 +50,9 @@ UpdateFeeds::UpdateFeeds(QObject *parent, bool addFeed)
   int timeoutRequest = settings.value("Settings/timeoutRequest", 15).toInt();
   int numberRequests = settings.value("Settings/numberRequest", 10).toInt();
   int numberRepeats = settings.value("Settings/numberRepeats", 2).toInt();
+  bool streamParsing = settings.value("Settings/streamParsing", false).toBool();
+  bool websubEnable = settings.value("Settings/websubEnable", false).toBool();
+  int feedArchiveMode = settings.value("Settings/feedArchiveMode", 0).toInt();
 
   requestFeed_ = new RequestFeed(timeoutRequest, numberRequests, numberRepeats);
 
@@ -68,11 +74,25 @@ UpdateFeeds::UpdateFeeds(QObject *parent, bool addFeed)
 
     updateObject_ = new UpdateObject();
     faviconObject_ = new FaviconObject();
+    imagePrefetcher_ = new ImagePrefetcher();
+    mainApp->networkManager()->setImagePrefetcher(imagePrefetcher_);
 
     connect(updateObject_, SIGNAL(signalRequestUrl(int,QString,QDateTime,QString)),
             requestFeed_, SLOT(requestUrl(int,QString,QDateTime,QString)));
     connect(requestFeed_, SIGNAL(getUrlDone(int,int,QString,QString,QByteArray,QDateTime,QString)),
             updateObject_, SLOT(getUrlDone(int,int,QString,QString,QByteArray,QDateTime,QString)));
+    requestFeed_->setStreamParsing(streamParsing);
+    if ((feedArchiveMode == FeedArchive::ModeRecord) ||
+        (feedArchiveMode == FeedArchive::ModeReplay)) {
+      FeedArchive *feedArchive = new FeedArchive(FeedArchive::Mode(feedArchiveMode),
+                                                 mainApp->dataDir() + "/feedarchive.dat");
+      feedArchive->setRealTime(settings.value("Settings/feedArchiveRealTime", false).toBool());
+      requestFeed_->setFeedArchive(feedArchive);
+    }
+    connect(requestFeed_, SIGNAL(getUrlData(int,QByteArray,QDateTime,bool)),
+            updateObject_, SLOT(getUrlData(int,QByteArray,QDateTime,bool)));
+    connect(requestFeed_, SIGNAL(getUrlAbort(int)),
+            updateObject_, SLOT(getUrlAbort(int)));
     connect(requestFeed_, SIGNAL(setStatusFeed(int,QString)),
             parent, SLOT(setStatusFeed(int,QString)));
     connect(parent, SIGNAL(signalStopUpdate()),
@@ -103,6 +123,12 @@ UpdateFeeds::UpdateFeeds(QObject *parent, bool addFeed)
     connect(updateObject_, SIGNAL(xmlReadyParse(QByteArray,int,QDateTime,QString)),
             parseObject_, SLOT(parseXml(QByteArray,int,QDateTime,QString)),
             Qt::QueuedConnection);
+    connect(updateObject_, SIGNAL(xmlDataParse(QByteArray,int,QDateTime,bool)),
+            parseObject_, SLOT(parseXmlData(QByteArray,int,QDateTime,bool)),
+            Qt::QueuedConnection);
+    connect(updateObject_, SIGNAL(xmlDataAbort(int)),
+            parseObject_, SLOT(abortXmlData(int)),
+            Qt::QueuedConnection);
     connect(parseObject_, SIGNAL(signalFinishUpdate(int,bool,int,QString)),
             updateObject_, SLOT(finishUpdate(int,bool,int,QString)),
             Qt::QueuedConnection);
@@ -117,8 +143,8 @@ UpdateFeeds::UpdateFeeds(QObject *parent, bool addFeed)
 
     connect(parseObject_, SIGNAL(signalPlaySound(QString)),
             parent, SLOT(slotPlaySound(QString)));
-    connect(parseObject_, SIGNAL(signalAddColorList(int,QString)),
-            parent, SLOT(slotAddColorList(int,QString)));
+    connect(parseObject_, SIGNAL(signalAddColorList(QList<int>,QString)),
+            parent, SLOT(slotAddColorList(QList<int>,QString)));
 
     connect(parent, SIGNAL(signalNextUpdate(bool)),
             updateObject_, SLOT(slotNextUpdateFeed(bool)));
@@ -132,8 +158,9 @@ UpdateFeeds::UpdateFeeds(QObject *parent, bool addFeed)
     connect(parent, SIGNAL(signalRecountCategoryCounts()),
             updateObject_, SLOT(slotRecountCategoryCounts()));
     qRegisterMetaType<QList<int> >("QList<int>");
-    connect(updateObject_, SIGNAL(signalRecountCategoryCounts(QList<int>,QList<int>,QList<int>,QStringList)),
-            parent, SLOT(slotRecountCategoryCounts(QList<int>,QList<int>,QList<int>,QStringList)),
+    qRegisterMetaType<CategoryCountStruct>("CategoryCountStruct");
+    connect(updateObject_, SIGNAL(signalRecountCategoryCounts(CategoryCountStruct)),
+            parent, SLOT(slotRecountCategoryCounts(CategoryCountStruct)),
             Qt::QueuedConnection);
     connect(parent, SIGNAL(signalRecountFeedCounts(int,bool)),
             updateObject_, SLOT(slotRecountFeedCounts(int,bool)));
@@ -152,6 +179,8 @@ UpdateFeeds::UpdateFeeds(QObject *parent, bool addFeed)
             parent, SLOT(slotRefreshInfoTray(int,int)));
     connect(parent, SIGNAL(signalUpdateStatus(int,bool)),
             updateObject_, SLOT(slotUpdateStatus(int,bool)));
+    connect(parent, SIGNAL(signalUpdateFeedsStatus(QList<int>)),
+            updateObject_, SLOT(slotUpdateFeedsStatus(QList<int>)));
     connect(parent, SIGNAL(signalMarkAllFeedsRead()),
             updateObject_, SLOT(slotMarkAllFeedsRead()));
     connect(parent, SIGNAL(signalMarkReadCategory(int,int)),
@@ -172,17 +201,38 @@ UpdateFeeds::UpdateFeeds(QObject *parent, bool addFeed)
             updateObject_, SLOT(slotSqlQueryExec(QString)));
     connect(mainApp, SIGNAL(signalRunUserFilter(int, int)),
             parseObject_, SLOT(runUserFilter(int, int)));
+    connect(mainApp, SIGNAL(signalReloadUserFilters()),
+            parseObject_, SLOT(reloadUserFilters()));
 
     // faviconObject_
     connect(parent, SIGNAL(faviconRequestUrl(QString,QString)),
             faviconObject_, SLOT(requestUrl(QString,QString)));
-    connect(faviconObject_, SIGNAL(signalIconRecived(QString,QByteArray,QString)),
-            parent, SLOT(slotIconFeedPreparing(QString,QByteArray,QString)));
+    connect(faviconObject_, SIGNAL(signalIconRecived(QString,QByteArray)),
+            parent, SIGNAL(signalIconFeedReady(QString,QByteArray)));
     connect(parent, SIGNAL(signalIconFeedReady(QString,QByteArray)),
             updateObject_, SLOT(slotIconSave(QString,QByteArray)));
     connect(updateObject_, SIGNAL(signalIconUpdate(int,QByteArray)),
             parent, SLOT(slotIconFeedUpdate(int,QByteArray)));
 
+    // imagePrefetcher_
+    connect(parseObject_, SIGNAL(signalPrefetchImages(QString,QString)),
+            imagePrefetcher_, SLOT(prefetchImages(QString,QString)));
+
+    // webSubServer_
+    if (websubEnable) {
+      webSubServer_ = new WebSubServer(settings.value("Settings/websubAddress").toString(),
+                                       settings.value("Settings/websubPort", 8090).toInt(),
+                                       settings.value("Settings/websubCallbackUrl").toString());
+      connect(parseObject_, SIGNAL(signalHubFound(int,QString,QString)),
+              webSubServer_, SLOT(slotHubFound(int,QString,QString)));
+      connect(webSubServer_, SIGNAL(signalPushReceived(int,QByteArray,QString)),
+              updateObject_, SLOT(slotPushReceived(int,QByteArray,QString)));
+      connect(webSubServer_, SIGNAL(signalPushNotified(int)),
+              updateObject_, SLOT(slotPushNotified(int)));
+      webSubServer_->moveToThread(updateFeedThread_);
+      QMetaObject::invokeMethod(webSubServer_, "start", Qt::QueuedConnection);
+    }
+
     connect(parent, SIGNAL(signalQuitApp()),
             updateObject_, SLOT(quitApp()));
     connect(this, SIGNAL(signalSaveMemoryDatabase()),
@@ -190,6 +240,7 @@ UpdateFeeds::UpdateFeeds(QObject *parent, bool addFeed)
 
     updateObject_->moveToThread(updateFeedThread_);
     faviconObject_->moveToThread(getFaviconThread_);
+    imagePrefetcher_->moveToThread(getFaviconThread_);
 
     getFaviconThread_->start(QThread::LowPriority);
 
@@ -211,6 +262,10 @@ UpdateFeeds::~UpdateFeeds()
   if (!addFeed_) {
     updateObject_->deleteLater();
     faviconObject_->deleteLater();
+    mainApp->networkManager()->setImagePrefetcher(NULL);
+    imagePrefetcher_->deleteLater();
+    if (webSubServer_)
+      webSubServer_->deleteLater();
 
     getFaviconThread_->exit();
     getFaviconThread_->wait();
@@ -234,6 +289,9 @@ void UpdateFeeds::disconnectObjects()
     updateObject_->disconnect(requestFeed_);
     updateObject_->disconnect(parent());
     faviconObject_->disconnectObjects();
+    imagePrefetcher_->disconnectObjects();
+    if (webSubServer_)
+      webSubServer_->disconnectObjects();
   }
 
   requestFeed_->disconnectObjects();
@@ -275,6 +333,9 @@ UpdateObject::UpdateObject(QObject *parent)
 
   db_ = Database::connection("secondConnection");
 
+  Settings settings;
+  websubPollInterval_ = settings.value("Settings/websubPollInterval", 24).toInt()*60*60;
+
   updateModelTimer_ = new QTimer(this);
   updateModelTimer_->setSingleShot(true);
   connect(updateModelTimer_, SIGNAL(timeout()), this, SIGNAL(signalUpdateModel()));
@@ -293,8 +354,9 @@ UpdateObject::~UpdateObject()
 void UpdateObject::slotGetFeedTimer(int feedId)
 {
   QSqlQuery q(db_);
-  q.exec(QString("SELECT xmlUrl, lastBuildDate, authentication FROM feeds WHERE id=='%1' AND disableUpdate=0")
-         .arg(feedId));
+  q.exec(QString("SELECT xmlUrl, lastBuildDate, authentication FROM feeds "
+                 "WHERE id=='%1' AND disableUpdate=0 AND %2")
+         .arg(feedId).arg(WebSubServer::pollCondition(websubPollInterval_)));
   if (q.next()) {
     addFeedInQueue(feedId, q.value(0).toString(),
                    q.value(1).toDateTime(), q.value(2).toInt());
@@ -307,7 +369,8 @@ void UpdateObject::slotGetAllFeedsTimer()
   QSqlQuery q(db_);
   q.exec("SELECT id, xmlUrl, lastBuildDate, authentication FROM feeds "
          "WHERE xmlUrl!='' AND disableUpdate=0 "
-         "AND (updateIntervalEnable==-1 OR updateIntervalEnable IS NULL)");
+         "AND (updateIntervalEnable==-1 OR updateIntervalEnable IS NULL) AND " +
+         WebSubServer::pollCondition(websubPollInterval_));
   while (q.next()) {
     addFeedInQueue(q.value(0).toInt(), q.value(1).toString(),
                    q.value(2).toDateTime(), q.value(3).toInt());
@@ -504,6 +567,7 @@ void UpdateObject::slotImportFeeds(QByteArray xmlData)
   emit signalUpdateFeedsModel();
 
   for (int i = 0; i < idsList.count(); i++) {
+    feedIdList_.append(idsList.at(i));
     updateFeedsCount_ = updateFeedsCount_ + 2;
     emit signalRequestUrl(idsList.at(i), urlsList.at(i), QDateTime(), "");
   }
@@ -563,8 +627,71 @@ void UpdateObject::getUrlDone(int result, int feedId, QString feedUrlStr,
   }
 }
 
+/** @brief Process feed content pushed by WebSub hub
+ * @details Content is skipped while feed is updated by request, the request
+ *   gets the same news.
+ *---------------------------------------------------------------------------*/
+void UpdateObject::slotPushReceived(int feedId, QByteArray data, QString codecName)
+{
+  if (feedIdList_.contains(feedId)) return;
+
+  feedIdList_.append(feedId);
+  updateFeedsCount_ = updateFeedsCount_ + 1;
+  emit showProgressBar(updateFeedsCount_);
+
+  emit xmlReadyParse(data, feedId, QDateTime(), codecName);
+}
+
+/** @brief Request feed which update is notified by hub without content
+ *---------------------------------------------------------------------------*/
+void UpdateObject::slotPushNotified(int feedId)
+{
+  QSqlQuery q(db_);
+  q.exec(QString("SELECT xmlUrl, lastBuildDate, authentication FROM feeds "
+                 "WHERE id=='%1' AND disableUpdate=0").arg(feedId));
+  if (q.next()) {
+    addFeedInQueue(feedId, q.value(0).toString(),
+                   q.value(1).toDateTime(), q.value(2).toInt());
+  }
+  emit showProgressBar(updateFeedsCount_);
+}
+
+/** @brief Process part of feed data received while downloading
+ *---------------------------------------------------------------------------*/
+void UpdateObject::getUrlData(int feedId, QByteArray data, QDateTime dtReply,
+                              bool finished)
+{
+  if (finished && (updateFeedsCount_ > 0)) {
+    updateFeedsCount_--;
+    emit loadProgress(updateFeedsCount_);
+  }
+
+  emit xmlDataParse(data, feedId, dtReply, finished);
+}
+
+/** @brief Process failure of feed download which data was partly parsed
+ * @details Request is repeated or finished with error by RequestFeed,
+ *   parser only drops its state.
+ *---------------------------------------------------------------------------*/
+void UpdateObject::getUrlAbort(int feedId)
+{
+  emit xmlDataAbort(feedId);
+}
+
+/** @brief Finish update of feed
+ * @details Update is finished once. Feed which download fails after its
+ *   stream was parsed is finished again by request error or by repeated
+ *   request, these are ignored.
+ *---------------------------------------------------------------------------*/
 void UpdateObject::finishUpdate(int feedId, bool changed, int newCount, QString status)
 {
+  int feedIdIndex = feedIdList_.indexOf(feedId);
+  if (feedIdIndex < 0) {
+    qDebug() << "Update of feed is already finished:" << feedId << status;
+    return;
+  }
+  feedIdList_.takeAt(feedIdIndex);
+
   if (updateFeedsCount_ > 0) {
     updateFeedsCount_--;
     emit loadProgress(updateFeedsCount_);
@@ -574,11 +701,6 @@ void UpdateObject::finishUpdate(int feedId, bool changed, int newCount, QString
     finish = true;
   }
 
-  int feedIdIndex = feedIdList_.indexOf(feedId);
-  if (feedIdIndex > -1) {
-    feedIdList_.takeAt(feedIdIndex);
-  }
-
   QSqlQuery q(db_);
   QString qStr = QString("UPDATE feeds SET status='%1' WHERE id=='%2'").
       arg(status).arg(feedId);
@@ -645,20 +767,44 @@ void UpdateObject::slotNextUpdateFeed(bool finish)
 
 void UpdateObject::slotRecountCategoryCounts()
 {
-  QList<int> deletedList;
-  QList<int> starredList;
-  QList<int> readList;
-  QStringList labelList;
+  CategoryCountStruct counts;
+  counts.allStarredCount = 0;
+  counts.unreadStarredCount = 0;
+  counts.deletedCount = 0;
+
   QSqlQuery q(db_);
-  q.exec("SELECT deleted, starred, read, label FROM news WHERE deleted < 2");
+  q.exec("SELECT SUM(deleted=0 AND starred=1), SUM(deleted=0 AND starred=1 AND read=0), "
+         "SUM(deleted=1) FROM news WHERE deleted < 2");
+  if (q.next()) {
+    counts.allStarredCount = q.value(0).toInt();
+    counts.unreadStarredCount = q.value(1).toInt();
+    counts.deletedCount = q.value(2).toInt();
+  }
+
+  q.exec("SELECT id FROM labels");
+  while (q.next()) {
+    int id = q.value(0).toInt();
+    counts.allLabelCount.insert(id, 0);
+    counts.unreadLabelCount.insert(id, 0);
+  }
+
+  // News with same set of labels are counted together
+  q.exec("SELECT label, COUNT(*), SUM(read=0) FROM news "
+         "WHERE deleted=0 AND label!='' AND label!=',' GROUP BY label");
   while (q.next()) {
-    deletedList.append(q.value(0).toInt());
-    starredList.append(q.value(1).toInt());
-    readList.append(q.value(2).toInt());
-    labelList.append(q.value(3).toString());
+    QStringList idList = q.value(0).toString().split(",", QString::SkipEmptyParts);
+    int allCount = q.value(1).toInt();
+    int unreadCount = q.value(2).toInt();
+    foreach (QString idStr, idList) {
+      int id = idStr.toInt();
+      if (counts.allLabelCount.contains(id)) {
+        counts.allLabelCount[id] += allCount;
+        counts.unreadLabelCount[id] += unreadCount;
+      }
+    }
   }
 
-  emit signalRecountCategoryCounts(deletedList, starredList, readList, labelList);
+  emit signalRecountCategoryCounts(counts);
 }
 
 /** @brief Update feed counters and all its parents
@@ -672,242 +818,23 @@ void UpdateObject::slotRecountCategoryCounts()
  *----------------------------------------------------------------------------*/
 void UpdateObject::slotRecountFeedCounts(int feedId, bool updateViewport)
 {
-  QSqlQuery q(db_);
-  QString qStr;
-
-  db_.transaction();
-
-  int feedParId = 0;
-  bool isFolder = false;
-  qStr = QString("SELECT parentId, xmlUrl FROM feeds WHERE id=='%1'").
-      arg(feedId);
-  q.exec(qStr);
-  if (q.next()) {
-    feedParId = q.value(0).toInt();
-    if (q.value(1).toString().isEmpty())
-      isFolder = true;
-  }
-
-  int undeleteCount = 0;
-  int unreadCount = 0;
-  int newCount = 0;
-
-  if (!isFolder) {
-    // Calculate all news (not mark deleted)
-    qStr = QString("SELECT count(id) FROM news WHERE feedId=='%1' AND deleted==0").
-        arg(feedId);
-    q.exec(qStr);
-    if (q.next()) undeleteCount = q.value(0).toInt();
-
-    // Calculate unread news
-    qStr = QString("SELECT count(read) FROM news WHERE feedId=='%1' AND read==0 AND deleted==0").
-        arg(feedId);
-    q.exec(qStr);
-    if (q.next()) unreadCount = q.value(0).toInt();
-
-    // Calculate new news
-    qStr = QString("SELECT count(new) FROM news WHERE feedId=='%1' AND new==1 AND deleted==0").
-        arg(feedId);
-    q.exec(qStr);
-    if (q.next()) newCount = q.value(0).toInt();
-
-    int unreadCountOld = 0;
-    int newCountOld = 0;
-    int undeleteCountOld = 0;
-    qStr = QString("SELECT unread, newCount, undeleteCount FROM feeds WHERE id=='%1'").
-        arg(feedId);
-    q.exec(qStr);
-    if (q.next()) {
-      unreadCountOld = q.value(0).toInt();
-      newCountOld = q.value(1).toInt();
-      undeleteCountOld = q.value(2).toInt();
-    }
-
-    if ((unreadCount == unreadCountOld) && (newCount == newCountOld) &&
-        (undeleteCount == undeleteCountOld)) {
-      db_.commit();
-      return;
-    }
-
-    // Save unread and new news number for feed
-    qStr = QString("UPDATE feeds SET unread='%1', newCount='%2', undeleteCount='%3' "
-                   "WHERE id=='%4'").
-        arg(unreadCount).arg(newCount).arg(undeleteCount).arg(feedId);
-    q.exec(qStr);
-
-    // Update view of the feed
-    FeedCountStruct counts;
-    counts.feedId = feedId;
-    counts.unreadCount = unreadCount;
-    counts.newCount = newCount;
-    counts.undeleteCount = undeleteCount;
-    emit feedCountsUpdate(counts);
-  } else {
-    bool changed = false;
-    QList<int> idParList;
-    QList<int> idList = getIdFeedsInList(db_, feedId);
-    if (idList.count()) {
-      foreach (int id, idList) {
-        int parId = 0;
-        q.exec(QString("SELECT parentId FROM feeds WHERE id=='%1'").arg(id));
-        if (q.next())
-          parId = q.value(0).toInt();
-
-        if (parId) {
-          if (idParList.indexOf(parId) == -1) {
-            idParList.append(parId);
-          }
-        }
-
-        // Calculate all news (not mark deleted)
-        qStr = QString("SELECT count(id) FROM news WHERE feedId=='%1' AND deleted==0").
-            arg(id);
-        q.exec(qStr);
-        if (q.next()) undeleteCount = q.value(0).toInt();
-
-        // Calculate unread news
-        qStr = QString("SELECT count(read) FROM news WHERE feedId=='%1' AND read==0 AND deleted==0").
-            arg(id);
-        q.exec(qStr);
-        if (q.next()) unreadCount = q.value(0).toInt();
-
-        // Calculate new news
-        qStr = QString("SELECT count(new) FROM news WHERE feedId=='%1' AND new==1 AND deleted==0").
-            arg(id);
-        q.exec(qStr);
-        if (q.next()) newCount = q.value(0).toInt();
-
-        int unreadCountOld = 0;
-        int newCountOld = 0;
-        int undeleteCountOld = 0;
-        qStr = QString("SELECT unread, newCount, undeleteCount FROM feeds WHERE id=='%1'").
-            arg(id);
-        q.exec(qStr);
-        if (q.next()) {
-          unreadCountOld = q.value(0).toInt();
-          newCountOld = q.value(1).toInt();
-          undeleteCountOld = q.value(2).toInt();
-        }
-
-        if ((unreadCount == unreadCountOld) && (newCount == newCountOld) &&
-            (undeleteCount == undeleteCountOld)) {
-          continue;
-        }
-        changed = true;
-
-        // Save unread and new news number for parent
-        qStr = QString("UPDATE feeds SET unread='%1', newCount='%2', undeleteCount='%3' "
-                       "WHERE id=='%4'").
-            arg(unreadCount).arg(newCount).arg(undeleteCount).arg(id);
-        q.exec(qStr);
-
-        // Update view of the parent
-        FeedCountStruct counts;
-        counts.feedId = id;
-        counts.unreadCount = unreadCount;
-        counts.newCount = newCount;
-        counts.undeleteCount = undeleteCount;
-        emit feedCountsUpdate(counts);
-      }
-
-      if (!changed) {
-        db_.commit();
-        return;
-      }
-
-      foreach (int l_feedParId, idParList) {
-        while (l_feedParId) {
-          QString updated;
-
-          qStr = QString("SELECT sum(unread), sum(newCount), sum(undeleteCount), "
-                         "max(updated) FROM feeds WHERE parentId=='%1'").
-              arg(l_feedParId);
-          q.exec(qStr);
-          if (q.next()) {
-            unreadCount   = q.value(0).toInt();
-            newCount      = q.value(1).toInt();
-            undeleteCount = q.value(2).toInt();
-            updated       = q.value(3).toString();
-          }
-          qStr = QString("UPDATE feeds SET unread='%1', newCount='%2', undeleteCount='%3', "
-                         "updated='%4' WHERE id=='%5'").
-              arg(unreadCount).arg(newCount).arg(undeleteCount).arg(updated).
-              arg(l_feedParId);
-          q.exec(qStr);
-
-          // Update view
-          FeedCountStruct counts;
-          counts.feedId = l_feedParId;
-          counts.unreadCount = unreadCount;
-          counts.newCount = newCount;
-          counts.undeleteCount = undeleteCount;
-          counts.updated = updated;
-          emit feedCountsUpdate(counts);
-
-          if (feedId == l_feedParId) break;
-          q.exec(QString("SELECT parentId FROM feeds WHERE id==%1").arg(l_feedParId));
-          if (q.next()) l_feedParId = q.value(0).toInt();
-        }
-      }
-    }
-  }
-
-  // Recalculate counters for all parents
-  int l_feedParId = feedParId;
-  while (l_feedParId) {
-    QString updated;
+  recountFeedsCounts(QList<int>() << feedId, updateViewport);
+}
 
-    qStr = QString("SELECT sum(unread), sum(newCount), sum(undeleteCount), "
-                   "max(updated) FROM feeds WHERE parentId=='%1'").
-        arg(l_feedParId);
-    q.exec(qStr);
-    if (q.next()) {
-      unreadCount   = q.value(0).toInt();
-      newCount      = q.value(1).toInt();
-      undeleteCount = q.value(2).toInt();
-      updated       = q.value(3).toString();
-    }
-    qStr = QString("UPDATE feeds SET unread='%1', newCount='%2', undeleteCount='%3', "
-                   "updated='%4' WHERE id=='%5'").
-        arg(unreadCount).arg(newCount).arg(undeleteCount).arg(updated).
-        arg(l_feedParId);
-    q.exec(qStr);
+/** @brief Recount counters of feeds (or folders) \a feedIds and their parents
+ *---------------------------------------------------------------------------*/
+void UpdateObject::recountFeedsCounts(const QList<int> &feedIds, bool updateViewport)
+{
+  QList<FeedCountStruct> countsList = NewsStateUpdater::recountFeeds(db_, feedIds);
+  if (countsList.isEmpty()) return;
 
-    // Update view
-    FeedCountStruct counts;
-    counts.feedId = l_feedParId;
-    counts.unreadCount = unreadCount;
-    counts.newCount = newCount;
-    counts.undeleteCount = undeleteCount;
-    counts.updated = updated;
+  foreach (const FeedCountStruct &counts, countsList) {
     emit feedCountsUpdate(counts);
-
-    q.exec(QString("SELECT parentId FROM feeds WHERE id==%1").arg(l_feedParId));
-    if (q.next()) l_feedParId = q.value(0).toInt();
   }
-  db_.commit();
 
   if (updateViewport) emit signalFeedsViewportUpdate();
 }
 
-/** @brief Get feeds ids list string of folder \a idFolder
- *---------------------------------------------------------------------------*/
-QString UpdateObject::getIdFeedsString(int idFolder, int idException)
-{
-  QList<int> idList = getIdFeedsInList(db_, idFolder);
-  if (idList.count()) {
-    QString str;
-    foreach (int id, idList) {
-      if (id == idException) continue;
-      if (!str.isEmpty()) str.append(" OR ");
-      str.append(QString("feedId=%1").arg(id));
-    }
-    return str;
-  } else {
-    return QString("feedId=-1");
-  }
-}
-
 /** @brief Get feeds ids list of folder \a idFolder
  *---------------------------------------------------------------------------*/
 QList<int> UpdateObject::getIdFeedsInList(QSqlDatabase &db, int idFolder)
@@ -938,55 +865,42 @@ QList<int> UpdateObject::getIdFeedsInList(QSqlDatabase &db, int idFolder)
  *---------------------------------------------------------------------------*/
 void UpdateObject::slotSetFeedRead(int readType, int feedId, int idException, QList<int> idNewsList)
 {
-  QSqlDatabase db = QSqlDatabase::database();
-  QSqlQuery q(db);
-
   if (readType != FeedReadSwitchingTab) {
-    db.transaction();
-    QString idFeedsStr = getIdFeedsString(feedId, idException);
+    QList<int> feedIds = getIdFeedsInList(db_, feedId);
+    feedIds.removeAll(idException);
+    if (feedIds.isEmpty())
+      feedIds.append(feedId);
+
+    NewsStateUpdater updater(db_);
+    db_.transaction();
     if (((readType == FeedReadSwitchingFeed) && mainWindow_->markReadSwitchingFeed_) ||
         ((readType == FeedReadClosingTab) && mainWindow_->markReadClosingTab_) ||
         ((readType == FeedReadPlaceToTray) && mainWindow_->markReadMinimize_)) {
-      if (idFeedsStr == "feedId=-1") {
-        q.exec(QString("UPDATE news SET read=2 WHERE feedId='%1' AND read!=2").arg(feedId));
-      } else {
-        q.exec(QString("UPDATE news SET read=2 WHERE (%1) AND read!=2").arg(idFeedsStr));
-      }
+      updater.updateFeeds(feedIds, "read=2", "read!=2");
     } else {
-      if (idFeedsStr == "feedId=-1") {
-        q.exec(QString("UPDATE news SET read=2 WHERE feedId='%1' AND read=1").arg(feedId));
-      } else {
-        q.exec(QString("UPDATE news SET read=2 WHERE (%1) AND read=1").arg(idFeedsStr));
-      }
+      updater.updateFeeds(feedIds, "read=2", "read=1");
     }
-    if (idFeedsStr == "feedId=-1") {
-      q.exec(QString("UPDATE news SET new=0 WHERE feedId='%1' AND new=1").arg(feedId));
-    } else {
-      q.exec(QString("UPDATE news SET new=0 WHERE (%1) AND new=1").arg(idFeedsStr));
+    updater.updateFeeds(feedIds, "new=0", "new=1");
+    if (mainWindow_->markNewsReadOn_ && mainWindow_->markPrevNewsRead_) {
+      updater.updateWhere("read=2", QString("id IN (SELECT currentNews FROM feeds WHERE id='%1')").
+                          arg(feedId));
     }
-    if (mainWindow_->markNewsReadOn_ && mainWindow_->markPrevNewsRead_)
-      q.exec(QString("UPDATE news SET read=2 WHERE id IN (SELECT currentNews FROM feeds WHERE id='%1')").arg(feedId));
-    db.commit();
+    db_.commit();
 
-    slotRecountFeedCounts(feedId);
+    recountFeedsCounts(updater.feedIds());
     slotRecountCategoryCounts();
 
     if (readType != FeedReadPlaceToTray)
       slotRefreshInfoTray();
   } else {
-    QString idStr;
-    foreach (int newsId, idNewsList) {
-      if (!idStr.isEmpty()) idStr.append(" OR ");
-      idStr.append(QString("id='%1'").arg(newsId));
-    }
-
-    db.transaction();
-    q.exec(QString("UPDATE news SET read=2 WHERE (%1) AND read==1").arg(idStr));
-    q.exec(QString("UPDATE news SET new=0 WHERE (%1) AND new==1").arg(idStr));
-    db.commit();
+    NewsStateUpdater updater(db_);
+    db_.transaction();
+    updater.update(idNewsList, "read=2", "read==1");
+    updater.setNew(idNewsList, 0, "new==1");
+    db_.commit();
 
     if (feedId > -1)
-      slotRecountFeedCounts(feedId, false);
+      recountFeedsCounts(updater.feedIds(), false);
   }
 
   emit signalSetFeedsFilter();
@@ -994,29 +908,19 @@ void UpdateObject::slotSetFeedRead(int readType, int feedId, int idException, QL
 
 void UpdateObject::slotMarkFeedRead(int id, bool isFolder, bool openFeed)
 {
+  NewsStateUpdater updater(db_);
   db_.transaction();
-  QSqlQuery q(db_);
-  QString qStr;
   if (isFolder) {
-    qStr = QString("UPDATE news SET read=2 WHERE read!=2 AND deleted==0 AND (%1)").
-        arg(getIdFeedsString(id));
-    q.exec(qStr);
-    qStr = QString("UPDATE news SET new=0 WHERE new==1 AND (%1)").
-        arg(getIdFeedsString(id));
-    q.exec(qStr);
+    QList<int> feedIds = getIdFeedsInList(db_, id);
+    updater.updateFeeds(feedIds, "read=2", "read!=2 AND deleted==0");
+    updater.updateFeeds(feedIds, "new=0", "new==1");
   } else {
-    if (openFeed) {
-      qStr = QString("UPDATE news SET read=2 WHERE feedId=='%1' AND read!=2 AND deleted==0").
-          arg(id);
-      q.exec(qStr);
-    } else {
-      QString qStr = QString("UPDATE news SET read=1 WHERE feedId=='%1' AND read==0").
-          arg(id);
-      q.exec(qStr);
-    }
-    qStr = QString("UPDATE news SET new=0 WHERE feedId=='%1' AND new==1").
-        arg(id);
-    q.exec(qStr);
+    QList<int> feedIds = QList<int>() << id;
+    if (openFeed)
+      updater.updateFeeds(feedIds, "read=2", "read!=2 AND deleted==0");
+    else
+      updater.updateFeeds(feedIds, "read=1", "read==0");
+    updater.updateFeeds(feedIds, "new=0", "new==1");
   }
   db_.commit();
 
@@ -1066,17 +970,50 @@ void UpdateObject::slotUpdateStatus(int feedId, bool changed)
   }
 }
 
-void UpdateObject::slotMarkAllFeedsRead()
+/** @brief Update status of feeds \a feedIds changed at once
+ *---------------------------------------------------------------------------*/
+void UpdateObject::slotUpdateFeedsStatus(QList<int> feedIds)
 {
-  QSqlQuery q(db_);
+  recountFeedsCounts(feedIds);
+  slotRefreshInfoTray();
 
-  q.exec("UPDATE news SET read=2 WHERE read!=2 AND deleted==0");
-  q.exec("UPDATE news SET new=0 WHERE new==1 AND deleted==0");
+  int currentFeedId = mainWindow_->currentNewsTab->feedId_;
+  if (currentFeedId <= 0) return;
 
-  q.exec("SELECT id FROM feeds WHERE unread!=0");
-  while (q.next()) {
-    slotRecountFeedCounts(q.value(0).toInt());
+  bool update = feedIds.contains(currentFeedId);
+  if (!update) {
+    foreach (int id, getIdFeedsInList(db_, currentFeedId)) {
+      if (feedIds.contains(id)) {
+        update = true;
+        break;
+      }
+    }
   }
+
+  // Click on feed if it is displayed to update view
+  if (update) {
+    int unreadCount = 0;
+    int allCount = 0;
+    QSqlQuery q(db_);
+    q.exec(QString("SELECT unread, undeleteCount FROM feeds WHERE id=='%1'").
+           arg(currentFeedId));
+    if (q.next()) {
+      unreadCount = q.value(0).toInt();
+      allCount    = q.value(1).toInt();
+    }
+    emit signalCountsStatusBar(unreadCount, allCount);
+  }
+}
+
+void UpdateObject::slotMarkAllFeedsRead()
+{
+  NewsStateUpdater updater(db_);
+  db_.transaction();
+  updater.updateWhere("read=2", "read!=2 AND deleted==0");
+  updater.updateWhere("new=0", "new==1 AND deleted==0");
+  db_.commit();
+
+  recountFeedsCounts(updater.feedIds());
   slotRecountCategoryCounts();
 
   slotRefreshInfoTray();
@@ -1104,19 +1041,14 @@ void UpdateObject::slotMarkReadCategory(int type, int idLabel)
     break;
   }
 
-  QSqlQuery q;
-  q.exec(QString("UPDATE news SET read=1 WHERE %1").arg(qStr));
-  q.exec(QString("UPDATE news SET new=0 WHERE %1").arg(qStr));
+  NewsStateUpdater updater(db_);
+  db_.transaction();
+  updater.updateWhere("read=1", qStr);
+  updater.updateWhere("new=0", qStr);
+  db_.commit();
 
-  QList<int> idList;
-  q.exec("SELECT id FROM feeds WHERE unread!=0");
-  while (q.next()) {
-    idList.append(q.value(0).toInt());
-  }
   emit signalMarkAllFeedsRead(0);
-  foreach (int id, idList) {
-    slotUpdateStatus(id, true);
-  }
+  slotUpdateFeedsStatus(updater.feedIds());
 }
 
 /** @brief Save icon in DB and emit signal to update it
@@ -1154,13 +1086,10 @@ void UpdateObject::slotSqlQueryExec(QString query)
  *---------------------------------------------------------------------------*/
 void UpdateObject::slotMarkAllFeedsOld()
 {
-  QSqlQuery q(db_);
-  q.exec("UPDATE news SET new=0 WHERE new==1 AND deleted==0");
+  NewsStateUpdater updater(db_);
+  updater.updateWhere("new=0", "new==1 AND deleted==0");
 
-  q.exec("SELECT id FROM feeds WHERE newCount!=0");
-  while (q.next()) {
-    slotRecountFeedCounts(q.value(0).toInt());
-  }
+  recountFeedsCounts(updater.feedIds());
   slotRecountCategoryCounts();
 
   if ((mainWindow_->currentNewsTab != NULL) && (mainWindow_->currentNewsTab->type_ < NewsTabWidget::TabTypeWeb)) {
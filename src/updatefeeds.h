@@ -25,6 +25,8 @@
 #include "requestfeed.h"
 #include "parseobject.h"
 #include "faviconobject.h"
+#include "imageprefetcher.h"
+#include "websubserver.h"
 #include "newstabwidget.h"
 
 class UpdateObject;
@@ -44,6 +46,8 @@ public:
   RequestFeed *requestFeed_;
   ParseObject *parseObject_;
   FaviconObject *faviconObject_;
+  ImagePrefetcher *imagePrefetcher_;
+  WebSubServer *webSubServer_;
   QThread *getFeedThread_;
   QThread *updateFeedThread_;
   QThread *getFaviconThread_;
@@ -81,6 +85,10 @@ public slots:
   void getUrlDone(int result, int feedId, QString feedUrlStr,
                   QString error, QByteArray data,
                   QDateTime dtReply, QString codecName);
+  void getUrlData(int feedId, QByteArray data, QDateTime dtReply, bool finished);
+  void getUrlAbort(int feedId);
+  void slotPushReceived(int feedId, QByteArray data, QString codecName);
+  void slotPushNotified(int feedId);
   void finishUpdate(int feedId, bool changed, int newCount, QString status);
   void slotNextUpdateFeed(bool finish);
   void slotRecountCategoryCounts();
@@ -88,6 +96,7 @@ public slots:
   void slotSetFeedRead(int readType, int feedId, int idException, QList<int> idNewsList);
   void slotMarkFeedRead(int id, bool isFolder, bool openFeed);
   void slotUpdateStatus(int feedId, bool changed);
+  void slotUpdateFeedsStatus(QList<int> feedIds);
   void slotMarkAllFeedsRead();
   void slotMarkReadCategory(int type, int idLabel);
   void slotIconSave(QString feedUrl, QByteArray faviconData);
@@ -108,13 +117,15 @@ signals:
                         QDateTime date, QString userInfo);
   void xmlReadyParse(QByteArray data, int feedId,
                      QDateTime dtReply, QString codecName);
+  void xmlDataParse(QByteArray data, int feedId,
+                    QDateTime dtReply, bool finished);
+  void xmlDataAbort(int feedId);
   void setStatusFeed(int feedId, QString status);
   void feedUpdated(int feedId, bool changed, int newCount, bool finish);
   void signalUpdateModel(bool checkFilter = true);
   void signalUpdateNews(int refresh = NewsTabWidget::RefreshInsert);
   void signalCountsStatusBar(int unreadCount, int allCount);
-  void signalRecountCategoryCounts(QList<int> deletedList, QList<int> starredList,
-                                   QList<int> readList, QStringList labelList);
+  void signalRecountCategoryCounts(CategoryCountStruct counts);
   void feedCountsUpdate(FeedCountStruct counts);
   void signalFeedsViewportUpdate();
   void signalRefreshInfoTray(int newCount, int unreadCount);
@@ -128,12 +139,13 @@ private slots:
                       const QDateTime &date, int auth);
 
 private:
-  QString getIdFeedsString(int idFolder, int idException = -1);
+  void recountFeedsCounts(const QList<int> &feedIds, bool updateViewport = true);
 
   MainWindow *mainWindow_;
   QSqlDatabase db_;
   QList<int> feedIdList_;
   int updateFeedsCount_;
+  int websubPollInterval_;
   QTimer *updateModelTimer_;
   QTimer *timerUpdateNews_;
 
@@ -22,6 +22,8 @@
 #include "webpluginfactory.h"
 #include "adblockicon.h"
 #include "adblockmanager.h"
+#include "adblockrule.h"
+#include "adblocksubscription.h"
 
 #include <QAction>
 #include <QDesktopServices>
@@ -222,7 +224,8 @@ void WebPage::populateNetworkRequest(QNetworkRequest &request)
 void WebPage::addAdBlockRule(const AdBlockRule* rule, const QUrl &url)
 {
   AdBlockedEntry entry;
-  entry.rule = rule;
+  entry.subscription = rule->subscription() ? rule->subscription()->title() : QString();
+  entry.filter = rule->filter();
   entry.url = url;
 
   if (!adBlockedEntries_.contains(entry)) {
@@ -29,12 +29,16 @@ class WebPage : public QWebPage
 {
   Q_OBJECT
 public:
+  // Rules are freed when their subscription is updated, page keeps only
+  // what is needed to find the rule again
   struct AdBlockedEntry {
-    const AdBlockRule* rule;
+    QString subscription;
+    QString filter;
     QUrl url;
 
     bool operator==(const AdBlockedEntry &other) const {
-      return (this->rule == other.rule && this->url == other.url);
+      return (this->filter == other.filter && this->url == other.url &&
+              this->subscription == other.subscription);
     }
   };
 
@@ -0,0 +1,22 @@
+TARGET = tst_adblockmatcher
+isEqual(QT_MAJOR_VERSION, 5) {
+  QT += widgets webkitwidgets network
+} else {
+  QT += network webkit
+}
+
+include(../tests.pri)
+
+INCLUDEPATH += $$SRC_DIR/adblock $$SRC_DIR/common
+
+HEADERS += \
+    $$SRC_DIR/adblock/adblockmatcher.h \
+    $$SRC_DIR/adblock/adblockrule.h \
+    $$SRC_DIR/adblock/adblocksearchtree.h
+
+SOURCES += \
+    tst_adblockmatcher.cpp \
+    $$SRC_DIR/adblock/adblockmatcher.cpp \
+    $$SRC_DIR/adblock/adblockrule.cpp \
+    $$SRC_DIR/adblock/adblocksearchtree.cpp \
+    $$SRC_DIR/common/common.cpp
@@ -0,0 +1,583 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include <QtTest>
+#include <QNetworkRequest>
+
+#include <algorithm>
+
+#include "adblockmanager.h"
+#include "adblockmatcher.h"
+#include "adblockrule.h"
+#include "adblocksubscription.h"
+
+// Matcher is linked without manager and subscriptions, the test gives
+// rules to it by setRules()
+QList<AdBlockSubscription*> AdBlockManager::subscriptions() const
+{
+  return QList<AdBlockSubscription*>();
+}
+
+QVector<AdBlockRule*> AdBlockSubscription::allRules() const
+{
+  return QVector<AdBlockRule*>();
+}
+
+void AdBlockSubscription::releaseSupersededRules()
+{
+}
+
+struct ReplayRequest {
+  QNetworkRequest request;
+  QString urlDomain;
+  QString urlString;
+};
+
+/*! \brief Offline replay of requests through AdBlockMatcher.
+ *
+ * Subscription files are taken from QUITERSS_ADBLOCK_LISTS (paths separated
+ * by ';'), recorded requests from QUITERSS_ADBLOCK_URLS. Each line of the
+ * requests file is "<url> <type> [<first-party url>]", where type is
+ * "object", "xmlhttprequest" or "other". Without them generated rules and
+ * requests are used.
+ */
+class TestAdBlockMatcher : public QObject
+{
+  Q_OBJECT
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+  void match_data();
+  void match();
+  void overlappingRules_data();
+  void overlappingRules();
+  void statisticsKeepFilters();
+  void elementHiding_data();
+  void elementHiding();
+  void benchmarkReplay_data();
+  void benchmarkReplay();
+  void benchmarkElementHiding();
+  void benchmarkLoadRules_data();
+  void benchmarkLoadRules();
+  void benchmarkAllocateRules_data();
+  void benchmarkAllocateRules();
+
+private:
+  static ReplayRequest createRequest(const QString &url, const QString &type,
+                                     const QString &firstParty);
+  static QVector<const AdBlockRule*> constRules(const QVector<AdBlockRule*> &rules);
+  static QStringList selectors(const QString &styleSheet);
+  void loadRules(const QString &fileName);
+  void loadRequests(const QString &fileName);
+  void createRulesAndRequests();
+
+  QVector<AdBlockRule*> rules_;
+  QVector<ReplayRequest> requests_;
+
+};
+
+void TestAdBlockMatcher::initTestCase()
+{
+  const QString lists = QString::fromLocal8Bit(qgetenv("QUITERSS_ADBLOCK_LISTS"));
+  const QString urls = QString::fromLocal8Bit(qgetenv("QUITERSS_ADBLOCK_URLS"));
+
+  if (lists.isEmpty() || urls.isEmpty()) {
+    createRulesAndRequests();
+  }
+  else {
+    foreach (const QString &fileName, lists.split(QLatin1Char(';'), QString::SkipEmptyParts)) {
+      loadRules(fileName);
+    }
+    loadRequests(urls);
+  }
+
+  QVERIFY(!rules_.isEmpty());
+  QVERIFY(!requests_.isEmpty());
+}
+
+void TestAdBlockMatcher::cleanupTestCase()
+{
+  qDeleteAll(rules_);
+  rules_.clear();
+}
+
+ReplayRequest TestAdBlockMatcher::createRequest(const QString &url, const QString &type,
+                                                const QString &firstParty)
+{
+  ReplayRequest replay;
+  replay.request = QNetworkRequest(QUrl::fromEncoded(url.toUtf8()));
+
+  // Same attributes as set by WebPage and WebPluginFactory
+  if (type == QLatin1String("object")) {
+    replay.request.setAttribute(QNetworkRequest::Attribute(QNetworkRequest::User + 150),
+                                QString("object"));
+  }
+  else if (type == QLatin1String("xmlhttprequest")) {
+    replay.request.setRawHeader("X-Requested-With", "XMLHttpRequest");
+  }
+  if (!firstParty.isEmpty()) {
+    replay.request.setAttribute(QNetworkRequest::Attribute(QNetworkRequest::User + 151),
+                                firstParty);
+  }
+
+  // As in AdBlockManager::block()
+  replay.urlString = QString::fromLatin1(replay.request.url().toEncoded().toLower());
+  replay.urlDomain = replay.request.url().host().toLower();
+  return replay;
+}
+
+QVector<const AdBlockRule*> TestAdBlockMatcher::constRules(const QVector<AdBlockRule*> &rules)
+{
+  QVector<const AdBlockRule*> result;
+  result.reserve(rules.count());
+  foreach (AdBlockRule* rule, rules) {
+    result.append(rule);
+  }
+  return result;
+}
+
+QStringList TestAdBlockMatcher::selectors(const QString &styleSheet)
+{
+  QStringList result;
+  foreach (const QString &block, styleSheet.split(QLatin1Char('\n'), QString::SkipEmptyParts)) {
+    result.append(block.section(QLatin1Char('{'), 0, 0).split(QLatin1Char(',')));
+  }
+  result.sort();
+  return result;
+}
+
+void TestAdBlockMatcher::loadRules(const QString &fileName)
+{
+  QFile file(fileName);
+  QVERIFY2(file.open(QFile::ReadOnly), qPrintable(fileName));
+
+  QTextStream stream(&file);
+  stream.setCodec("UTF-8");
+  while (!stream.atEnd()) {
+    const QString line = stream.readLine();
+    // Header of subscription file
+    if (line.startsWith(QLatin1Char('[')) || line.startsWith(QLatin1String("Title: ")) ||
+        line.startsWith(QLatin1String("Url: "))) {
+      continue;
+    }
+    rules_.append(new AdBlockRule(line, 0));
+  }
+}
+
+void TestAdBlockMatcher::loadRequests(const QString &fileName)
+{
+  QFile file(fileName);
+  QVERIFY2(file.open(QFile::ReadOnly), qPrintable(fileName));
+
+  while (!file.atEnd()) {
+    const QString line = QString::fromUtf8(file.readLine()).trimmed();
+    if (line.isEmpty() || line.startsWith(QLatin1Char('#')))
+      continue;
+
+    const QStringList fields = line.split(QLatin1Char(' '), QString::SkipEmptyParts);
+    requests_.append(createRequest(fields.at(0), fields.value(1), fields.value(2)));
+  }
+}
+
+/** 20,000 rules of the kinds found in EasyList and 50,000 requests, about
+ *  the size of a session with a few busy news sites.
+ */
+void TestAdBlockMatcher::createRulesAndRequests()
+{
+  for (int i = 0; i < 20000; ++i) {
+    QString filter;
+    switch (i % 8) {
+    case 0: filter = QString("||ads%1.example%2.com^").arg(i % 500).arg(i % 7); break;
+    case 1: filter = QString("/banner%1/*").arg(i); break;
+    case 2: filter = QString("@@||cdn%1.example.org/allowed/").arg(i % 300); break;
+    case 3: filter = QString("||track%1.net^$third-party").arg(i % 700); break;
+    case 4: filter = QString("-ad-%1x%2.").arg(i).arg(i % 13); break;
+    case 5: filter = QString("/pixel%1.gif?").arg(i); break;
+    case 6: filter = QString("/ad[0-9]+x%1/").arg(i % 100); break;
+    default: filter = QString("news%1.com##.ad%2").arg(i % 200).arg(i); break;
+    }
+    rules_.append(new AdBlockRule(filter, 0));
+  }
+
+  static const char *types[] = { "other", "other", "other", "object", "xmlhttprequest" };
+  quint32 seed = 12345;
+  for (int i = 0; i < 50000; ++i) {
+    seed = seed * 1103515245 + 12345;
+    int n = (seed >> 8) % 1000;
+    QString url;
+    switch ((seed >> 20) % 5) {
+    case 0: url = QString("http://ads%1.example%2.com/show.js").arg(n % 600).arg(n % 7); break;
+    case 1: url = QString("http://cdn%1.example.org/allowed/banner%2/x.png").arg(n % 400).arg(n * 8 + 1); break;
+    case 2: url = QString("http://track%1.net/p.gif").arg(n); break;
+    case 3: url = QString("http://static.news%1.com/img/-ad-%2x5.png").arg(n % 200).arg(n); break;
+    default: url = QString("http://news%1.com/article/%2.html").arg(n % 200).arg(n); break;
+    }
+    requests_.append(createRequest(url, types[i % 5],
+                                   QString("http://news%1.com/").arg(n % 200)));
+  }
+}
+
+void TestAdBlockMatcher::match_data()
+{
+  QTest::addColumn<QString>("url");
+  QTest::addColumn<QString>("type");
+  QTest::addColumn<QString>("firstParty");
+  QTest::addColumn<QString>("filter");
+
+  QTest::newRow("domain") << "http://ads.example.com/x.js" << "other" << "" << "||ads.example.com^";
+  QTest::newRow("subdomain") << "http://a.ads.example.com/x.js" << "other" << "" << "||ads.example.com^";
+  QTest::newRow("exception") << "http://ads.example.com/allowed/x.js" << "other" << "" << "";
+  QTest::newRow("image") << "http://cdn.com/banner/top.png" << "other" << "" << "/banner/*$image";
+  QTest::newRow("not image") << "http://cdn.com/banner/top.html" << "other" << "" << "";
+  QTest::newRow("third party") << "http://tracker.net/p.gif" << "other" << "http://news.com/"
+                               << "||tracker.net^$third-party";
+  QTest::newRow("first party") << "http://tracker.net/p.gif" << "other" << "http://tracker.net/" << "";
+  QTest::newRow("object") << "http://plugins.com/a.swf" << "object" << "" << "||plugins.com^$object";
+  QTest::newRow("not object") << "http://plugins.com/a.swf" << "other" << "" << "";
+  QTest::newRow("no rule") << "http://example.com/" << "other" << "" << "";
+}
+
+void TestAdBlockMatcher::match()
+{
+  QFETCH(QString, url);
+  QFETCH(QString, type);
+  QFETCH(QString, firstParty);
+  QFETCH(QString, filter);
+
+  QVector<AdBlockRule*> rules;
+  rules.append(new AdBlockRule("||ads.example.com^", 0));
+  rules.append(new AdBlockRule("@@||ads.example.com/allowed/", 0));
+  rules.append(new AdBlockRule("/banner/*$image", 0));
+  rules.append(new AdBlockRule("||tracker.net^$third-party", 0));
+  rules.append(new AdBlockRule("||plugins.com^$object", 0));
+
+  AdBlockMatcher matcher(0);
+  matcher.setRules(constRules(rules));
+
+  const ReplayRequest replay = createRequest(url, type, firstParty);
+  const AdBlockRule* rule = matcher.match(replay.request, replay.urlDomain, replay.urlString);
+  QCOMPARE(rule ? rule->filter() : QString(), filter);
+
+  qDeleteAll(rules);
+}
+
+void TestAdBlockMatcher::overlappingRules_data()
+{
+  QTest::addColumn<int>("first");
+
+  QTest::newRow("domain first") << 0;
+  QTest::newRow("regexp first") << 1;
+  QTest::newRow("ends first") << 2;
+  QTest::newRow("no token first") << 3;
+}
+
+/** All rules match the url, each by other token or without token. The
+ *  first of them in rule list is reported whatever list is rotated.
+ */
+void TestAdBlockMatcher::overlappingRules()
+{
+  QFETCH(int, first);
+
+  const QStringList filters = QStringList() << "||cdn.com^" << "/banner/*/top"
+                                            << "top.png|" << "x*top";
+  QVector<AdBlockRule*> rules;
+  for (int i = 0; i < filters.count(); ++i) {
+    rules.append(new AdBlockRule(filters.at((first + i) % filters.count()), 0));
+  }
+
+  AdBlockMatcher matcher(0);
+  matcher.setRules(constRules(rules));
+
+  const ReplayRequest replay = createRequest("http://cdn.com/banner/x/top.png", "other", "");
+  for (int i = 0; i < 3; ++i) {
+    const AdBlockRule* rule = matcher.match(replay.request, replay.urlDomain, replay.urlString);
+    QVERIFY(rule);
+    QCOMPARE(rule->filter(), filters.at(first));
+    matcher.setRules(constRules(rules));
+  }
+
+  qDeleteAll(rules);
+}
+
+/** Slowest rules are reported by filter text, rules themselves may be
+ *  freed by then.
+ */
+void TestAdBlockMatcher::statisticsKeepFilters()
+{
+  QVector<AdBlockRule*> rules;
+  rules.append(new AdBlockRule("/banner/*$image", 0));
+  rules.append(new AdBlockRule("-ad-", 0));
+
+  AdBlockMatcher matcher(0);
+  matcher.setTimingEnabled(true);
+  matcher.setRules(constRules(rules));
+
+  const ReplayRequest replay = createRequest("http://cdn.com/banner/-ad-.png", "other", "");
+  QVERIFY(matcher.match(replay.request, replay.urlDomain, replay.urlString));
+  matcher.setRules(QVector<const AdBlockRule*>());
+  qDeleteAll(rules);
+
+  const AdBlockMatcher::Statistics statistics = matcher.statistics();
+  QCOMPARE(statistics.checkedRequests, qint64(1));
+  QCOMPARE(statistics.blockedRequests, qint64(1));
+  QVERIFY(!statistics.slowestRules.isEmpty());
+  QVERIFY(statistics.slowestRules.at(0).first == QLatin1String("/banner/*$image") ||
+          statistics.slowestRules.at(0).first == QLatin1String("-ad-"));
+
+  qint64 timed = 0;
+  foreach (qint64 count, statistics.latencyHistogram) {
+    timed += count;
+  }
+  QCOMPARE(timed, qint64(1));
+}
+
+void TestAdBlockMatcher::elementHiding_data()
+{
+  QTest::addColumn<QString>("domain");
+  QTest::addColumn<QString>("hidden");
+
+  QTest::newRow("domain") << "example.com" << ".ad,.banner,.promo";
+  QTest::newRow("parent domain") << "www.example.com" << ".ad,.banner,.promo";
+  QTest::newRow("excluded subdomain") << "sub.example.com" << ".ad,.promo";
+  QTest::newRow("excluded domain") << "example.org" << "";
+  QTest::newRow("similar suffix") << "badexample.com" << ".promo";
+  QTest::newRow("other domain") << "news.other.com" << ".promo,.x";
+}
+
+/** Stylesheet is taken from the cache on the second call and rebuilt after
+ *  rules are replaced.
+ */
+void TestAdBlockMatcher::elementHiding()
+{
+  QFETCH(QString, domain);
+  QFETCH(QString, hidden);
+
+  QVector<AdBlockRule*> rules;
+  rules.append(new AdBlockRule("example.com##.ad", 0));
+  rules.append(new AdBlockRule("example.com,~sub.example.com##.banner", 0));
+  rules.append(new AdBlockRule("~example.org##.promo", 0));
+  rules.append(new AdBlockRule("other.com##.x", 0));
+  rules.append(new AdBlockRule("##.global", 0));
+
+  AdBlockMatcher matcher(0);
+  matcher.setRules(constRules(rules));
+
+  QStringList expected = hidden.split(QLatin1Char(','), QString::SkipEmptyParts);
+  QCOMPARE(selectors(matcher.elementHidingRulesForDomain(domain)), expected);
+  QCOMPARE(selectors(matcher.elementHidingRulesForDomain(domain)), expected);
+  QVERIFY(!matcher.elementHidingRulesForDomain(domain).contains(QLatin1String(".global")));
+
+  matcher.setRules(QVector<const AdBlockRule*>());
+  QVERIFY(matcher.elementHidingRulesForDomain(domain).isEmpty());
+
+  qDeleteAll(rules);
+}
+
+void TestAdBlockMatcher::benchmarkReplay_data()
+{
+  QTest::addColumn<bool>("timing");
+
+  QTest::newRow("timing disabled") << false;
+  QTest::newRow("timing enabled") << true;
+}
+
+void TestAdBlockMatcher::benchmarkReplay()
+{
+  QFETCH(bool, timing);
+
+  AdBlockMatcher matcher(0);
+  matcher.setTimingEnabled(timing);
+
+  QElapsedTimer buildTimer;
+  buildTimer.start();
+  matcher.setRules(constRules(rules_));
+  qint64 buildTime = buildTimer.elapsed();
+
+  QVector<qint64> times;
+  times.reserve(requests_.count());
+  int blocked = 0;
+  qint64 totalTime = 0;
+
+  QBENCHMARK_ONCE {
+    QElapsedTimer timer;
+    foreach (const ReplayRequest &replay, requests_) {
+      timer.start();
+      if (matcher.match(replay.request, replay.urlDomain, replay.urlString))
+        ++blocked;
+      times.append(timer.nsecsElapsed());
+    }
+  }
+
+  foreach (qint64 time, times) {
+    totalTime += time;
+  }
+  std::sort(times.begin(), times.end());
+
+  qDebug() << "rules:" << rules_.count() << "built in" << buildTime << "ms";
+  qDebug() << "requests:" << requests_.count() << "blocked:" << blocked
+           << "average rules evaluated:" << matcher.averageRulesEvaluated();
+  qDebug() << "throughput:" << qint64(requests_.count() * 1e9 / qMax(totalTime, qint64(1)))
+           << "requests/s, p50:" << times.at(times.count() / 2) / 1000.0
+           << "us, p99:" << times.at(times.count() * 99 / 100) / 1000.0 << "us";
+}
+
+/** Stylesheets of first party domains of the requests, first built and then
+ *  taken from the cache as pages of the same sites are opened again.
+ */
+void TestAdBlockMatcher::benchmarkElementHiding()
+{
+  QStringList domains;
+  foreach (const ReplayRequest &replay, requests_) {
+    const QString firstParty = replay.request.attribute(
+          QNetworkRequest::Attribute(QNetworkRequest::User + 151)).toString();
+    const QString domain = QUrl(firstParty).host().toLower();
+    if (!domain.isEmpty() && !domains.contains(domain))
+      domains.append(domain);
+  }
+  QVERIFY(!domains.isEmpty());
+
+  AdBlockMatcher matcher(0);
+  matcher.setRules(constRules(rules_));
+
+  qint64 buildTime = 0;
+  qint64 cachedTime = 0;
+  qint64 styleSheetsSize = 0;
+  int selectorsCount = 0;
+
+  QBENCHMARK_ONCE {
+    QElapsedTimer timer;
+    timer.start();
+    foreach (const QString &domain, domains) {
+      const QString styleSheet = matcher.elementHidingRulesForDomain(domain);
+      styleSheetsSize += styleSheet.size() * sizeof(QChar);
+      selectorsCount += styleSheet.count(QLatin1Char(',')) + styleSheet.count(QLatin1Char('\n'));
+    }
+    buildTime = timer.nsecsElapsed();
+
+    timer.start();
+    foreach (const QString &domain, domains) {
+      matcher.elementHidingRulesForDomain(domain);
+    }
+    cachedTime = timer.nsecsElapsed();
+  }
+
+  qDebug() << "domains:" << domains.count() << "selectors:" << selectorsCount
+           << "stylesheets:" << styleSheetsSize / 1024 << "KB";
+  qDebug() << "per page, built:" << buildTime / domains.count() / 1000.0
+           << "us, cached:" << cachedTime / domains.count() / 1000.0 << "us";
+}
+
+void TestAdBlockMatcher::benchmarkLoadRules_data()
+{
+  QTest::addColumn<bool>("cache");
+
+  QTest::newRow("parse filters") << false;
+  QTest::newRow("binary cache") << true;
+}
+
+/** Rules of subscriptions loaded on start: filters parsed as from text
+ *  file, or rules read back as AdBlockSubscription::loadCache() does.
+ */
+void TestAdBlockMatcher::benchmarkLoadRules()
+{
+  QFETCH(bool, cache);
+
+  QStringList filters;
+  QByteArray data;
+  QDataStream out(&data, QIODevice::WriteOnly);
+  out.setVersion(QDataStream::Qt_4_6);
+  foreach (AdBlockRule* rule, rules_) {
+    filters.append(rule->filter());
+    out << *rule;
+  }
+
+  AdBlockRule* rules = 0;
+  QBENCHMARK_ONCE {
+    rules = new AdBlockRule[filters.count()];
+    if (cache) {
+      QDataStream in(data);
+      in.setVersion(QDataStream::Qt_4_6);
+      for (int i = 0; i < filters.count(); ++i) {
+        in >> rules[i];
+      }
+      QVERIFY(in.status() == QDataStream::Ok);
+    }
+    else {
+      for (int i = 0; i < filters.count(); ++i) {
+        rules[i].setFilter(filters.at(i));
+      }
+    }
+  }
+
+  for (int i = 0; i < filters.count(); ++i) {
+    QCOMPARE(rules[i].filter(), filters.at(i));
+    QCOMPARE(rules[i].isCssRule(), rules_.at(i)->isCssRule());
+    QCOMPARE(rules[i].isException(), rules_.at(i)->isException());
+  }
+  qDebug() << filters.count() << "rules," << data.size() / 1024 << "KiB of cache";
+
+  delete[] rules;
+}
+
+void TestAdBlockMatcher::benchmarkAllocateRules_data()
+{
+  QTest::addColumn<bool>("block");
+
+  QTest::newRow("rule per line") << false;
+  QTest::newRow("one block") << true;
+}
+
+/** Rules of subscription allocated and freed one by one, as before, or in
+ *  one block as AdBlockSubscription::allocateRules() does. Domains of rules
+ *  are interned in both cases, their pool size is printed.
+ */
+void TestAdBlockMatcher::benchmarkAllocateRules()
+{
+  QFETCH(bool, block);
+
+  QStringList filters;
+  foreach (AdBlockRule* rule, rules_) {
+    filters.append(rule->filter());
+  }
+
+  int domainsCount = 0;
+  QBENCHMARK_ONCE {
+    if (block) {
+      AdBlockRule* rules = new AdBlockRule[filters.count()];
+      for (int i = 0; i < filters.count(); ++i) {
+        rules[i].setFilter(filters.at(i));
+      }
+      domainsCount = AdBlockRule::pruneInternedDomains();
+      delete[] rules;
+    }
+    else {
+      QVector<AdBlockRule*> rules;
+      rules.reserve(filters.count());
+      for (int i = 0; i < filters.count(); ++i) {
+        rules.append(new AdBlockRule(filters.at(i), 0));
+      }
+      domainsCount = AdBlockRule::pruneInternedDomains();
+      qDeleteAll(rules);
+    }
+  }
+
+  qDebug() << filters.count() << "rules," << filters.count() * int(sizeof(AdBlockRule))
+           << "bytes of rules," << domainsCount << "interned domains";
+}
+
+QTEST_MAIN(TestAdBlockMatcher)
+#include "tst_adblockmatcher.moc"
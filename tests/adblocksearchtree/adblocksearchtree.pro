@@ -0,0 +1,16 @@
+TARGET = tst_adblocksearchtree
+QT += network
+
+include(../tests.pri)
+
+INCLUDEPATH += $$SRC_DIR/adblock $$SRC_DIR/common
+
+HEADERS += \
+    $$SRC_DIR/adblock/adblockrule.h \
+    $$SRC_DIR/adblock/adblocksearchtree.h
+
+SOURCES += \
+    tst_adblocksearchtree.cpp \
+    $$SRC_DIR/adblock/adblockrule.cpp \
+    $$SRC_DIR/adblock/adblocksearchtree.cpp \
+    $$SRC_DIR/common/common.cpp
@@ -0,0 +1,232 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include <QtTest>
+#include <QNetworkRequest>
+
+#include "adblockrule.h"
+#include "adblocksearchtree.h"
+
+class TestAdBlockSearchTree : public QObject
+{
+  Q_OBJECT
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+  void find_data();
+  void find();
+  void addOnlyContainsRules();
+  void rebuild();
+  void benchmarkTree();
+  void benchmarkLinear();
+
+private:
+  static int findIndex(const QStringList &filters, const QString &url, bool object,
+                       QList<AdBlockRule*> *rules);
+
+  QVector<AdBlockRule*> rules_;
+  QStringList urls_;
+
+};
+
+/** Index of filter of rule found for \a url, -1 if none is found */
+int TestAdBlockSearchTree::findIndex(const QStringList &filters, const QString &url,
+                                     bool object, QList<AdBlockRule*> *rules)
+{
+  AdBlockSearchTree tree;
+  foreach (const QString &filter, filters) {
+    rules->append(new AdBlockRule(filter, 0));
+    tree.add(rules->last());
+  }
+  tree.build();
+
+  QNetworkRequest request(QUrl::fromEncoded(url.toUtf8()));
+  if (object) {
+    request.setAttribute(QNetworkRequest::Attribute(QNetworkRequest::User + 150),
+                         QString("object"));
+  }
+  const AdBlockRule* rule = tree.find(request, request.url().host(), url);
+  for (int i = 0; i < rules->count(); ++i) {
+    if (rules->at(i) == rule)
+      return i;
+  }
+  return -1;
+}
+
+void TestAdBlockSearchTree::find_data()
+{
+  QTest::addColumn<QStringList>("filters");
+  QTest::addColumn<QString>("url");
+  QTest::addColumn<bool>("object");
+  QTest::addColumn<int>("index");
+
+  QTest::newRow("inside") << (QStringList() << "/banner/*" << "-pixel.")
+                          << "http://example.com/img/banner/1.png" << false << 0;
+  QTest::newRow("absent") << (QStringList() << "/banner/*" << "-pixel.")
+                          << "http://example.com/img/news/1.png" << false << -1;
+  QTest::newRow("at end") << (QStringList() << "/banner/*" << ".swf")
+                          << "http://example.com/movie.swf" << false << 1;
+  QTest::newRow("whole url") << (QStringList() << "http://example.com/ad.png")
+                             << "http://example.com/ad.png" << false << 0;
+  QTest::newRow("longer than url") << (QStringList() << "http://example.com/ad.png?")
+                                   << "http://example.com/ad.png" << false << -1;
+  QTest::newRow("shorter prefix first") << (QStringList() << "/ads/*" << "/ad")
+                                        << "http://example.com/ads/1.png" << false << 1;
+  QTest::newRow("options checked") << (QStringList() << "/ad$object" << "/ads/*")
+                                   << "http://example.com/ads/1.png" << false << 1;
+  QTest::newRow("options match") << (QStringList() << "/ad$object" << "/ads/*")
+                                 << "http://example.com/ads/1.png" << true << 0;
+  QTest::newRow("same filter") << (QStringList() << "/ad$object" << "/ad")
+                               << "http://example.com/ad/1.png" << false << 1;
+  QTest::newRow("equal filters") << (QStringList() << "/ad" << "/ad")
+                                 << "http://example.com/ad/1.png" << false << 1;
+  QTest::newRow("earlier position") << (QStringList() << "/1.png" << "example")
+                                    << "http://example.com/ad/1.png" << false << 1;
+  QTest::newRow("non-latin") << (QStringList() << QString::fromUtf8("/\xd1\x80\xd0\xb5\xd0\xba/*"))
+                             << QString::fromUtf8("http://example.com/\xd1\x80\xd0\xb5\xd0\xba/1")
+                             << false << 0;
+}
+
+void TestAdBlockSearchTree::find()
+{
+  QFETCH(QStringList, filters);
+  QFETCH(QString, url);
+  QFETCH(bool, object);
+  QFETCH(int, index);
+
+  QList<AdBlockRule*> rules;
+  int found = findIndex(filters, url, object, &rules);
+  qDeleteAll(rules);
+  QCOMPARE(found, index);
+}
+
+void TestAdBlockSearchTree::addOnlyContainsRules()
+{
+  AdBlockRule contains("/banner/*", 0);
+  AdBlockRule domain("||ads.example.com^", 0);
+  AdBlockRule regExp("/banner[0-9]+/", 0);
+  AdBlockRule ends(".swf|", 0);
+  AdBlockRule css("example.com##.ad", 0);
+
+  AdBlockSearchTree tree;
+  QVERIFY(tree.add(&contains));
+  QVERIFY(!tree.add(&domain));
+  QVERIFY(!tree.add(&regExp));
+  QVERIFY(!tree.add(&ends));
+  QVERIFY(!tree.add(&css));
+}
+
+/** Build replaces rules added before previous build */
+void TestAdBlockSearchTree::rebuild()
+{
+  AdBlockRule first("/first/*", 0);
+  AdBlockRule second("/second/*", 0);
+  QNetworkRequest request(QUrl("http://example.com/first/second/"));
+  const QString url = request.url().toString();
+
+  AdBlockSearchTree tree;
+  QVERIFY(!tree.find(request, "example.com", url));
+
+  tree.add(&first);
+  tree.build();
+  QCOMPARE(tree.find(request, "example.com", url), &first);
+
+  tree.add(&second);
+  tree.build();
+  QCOMPARE(tree.find(request, "example.com", url), &second);
+
+  tree.clear();
+  tree.build();
+  QVERIFY(!tree.find(request, "example.com", url));
+}
+
+/** 20,000 string rules and 20,000 urls, about as many as the string part
+ *  of EasyList meets in a long session.
+ */
+void TestAdBlockSearchTree::initTestCase()
+{
+  for (int i = 0; i < 20000; ++i) {
+    QString filter;
+    switch (i % 4) {
+    case 0: filter = QString("/banner%1/*").arg(i); break;
+    case 1: filter = QString("-ad-%1x%2.").arg(i).arg(i % 13); break;
+    case 2: filter = QString("/pixel%1.gif?").arg(i); break;
+    default: filter = QString(".com/ads/%1/").arg(i); break;
+    }
+    rules_.append(new AdBlockRule(filter, 0));
+  }
+
+  quint32 seed = 12345;
+  for (int i = 0; i < 20000; ++i) {
+    seed = seed * 1103515245 + 12345;
+    int n = (seed >> 8) % 100000;
+    if (i % 10)
+      urls_.append(QString("http://news%1.example.com/article/%2/image-%3.jpg").arg(n % 50).arg(n).arg(i));
+    else
+      urls_.append(QString("http://cdn.example.com/banner%1/top.png").arg(n % 40000));
+  }
+}
+
+void TestAdBlockSearchTree::cleanupTestCase()
+{
+  qDeleteAll(rules_);
+  rules_.clear();
+}
+
+void TestAdBlockSearchTree::benchmarkTree()
+{
+  AdBlockSearchTree tree;
+  QElapsedTimer timer;
+  timer.start();
+  foreach (const AdBlockRule* rule, rules_) {
+    tree.add(rule);
+  }
+  tree.build();
+  qint64 buildTime = timer.elapsed();
+
+  QNetworkRequest request;
+  int found = 0;
+  QBENCHMARK_ONCE {
+    foreach (const QString &url, urls_) {
+      if (tree.find(request, "example.com", url))
+        ++found;
+    }
+  }
+  qDebug() << "rules:" << rules_.count() << "build:" << buildTime << "ms"
+           << "urls:" << urls_.count() << "found:" << found;
+}
+
+/** Baseline: every rule checked for each of first 1,000 urls */
+void TestAdBlockSearchTree::benchmarkLinear()
+{
+  QNetworkRequest request;
+  int found = 0;
+  QBENCHMARK_ONCE {
+    for (int i = 0; i < 1000; ++i) {
+      foreach (const AdBlockRule* rule, rules_) {
+        if (rule->networkMatch(request, "example.com", urls_.at(i))) {
+          ++found;
+          break;
+        }
+      }
+    }
+  }
+  qDebug() << "urls: 1000 found:" << found;
+}
+
+QTEST_MAIN(TestAdBlockSearchTree)
+#include "tst_adblocksearchtree.moc"
@@ -0,0 +1,12 @@
+TARGET = tst_ahocorasick
+
+include(../tests.pri)
+
+INCLUDEPATH += $$SRC_DIR/newsfilters
+
+HEADERS += \
+    $$SRC_DIR/newsfilters/ahocorasick.h
+
+SOURCES += \
+    tst_ahocorasick.cpp \
+    $$SRC_DIR/newsfilters/ahocorasick.cpp
@@ -0,0 +1,189 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include <QtTest>
+
+#include "ahocorasick.h"
+
+class TestAhoCorasick : public QObject
+{
+  Q_OBJECT
+private slots:
+  void initTestCase();
+  void flags_data();
+  void flags();
+  void overlapping();
+  void caseFoldingKeepsLength();
+  void benchmarkAutomaton();
+  void benchmarkContains();
+
+private:
+  static uchar matchOne(const QString &pattern, const QString &text);
+
+  QStringList patterns_;
+  QStringList texts_;
+
+};
+
+uchar TestAhoCorasick::matchOne(const QString &pattern, const QString &text)
+{
+  AhoCorasick matcher;
+  int id = matcher.addPattern(pattern);
+  matcher.build();
+
+  QVector<uchar> flags(matcher.patternsCount(), 0);
+  matcher.match(text, &flags);
+  return flags.at(id);
+}
+
+void TestAhoCorasick::flags_data()
+{
+  QTest::addColumn<QString>("pattern");
+  QTest::addColumn<QString>("text");
+  QTest::addColumn<int>("flags");
+
+  const int found = AhoCorasick::Found;
+  const int prefix = AhoCorasick::Prefix;
+  const int suffix = AhoCorasick::Suffix;
+  const int whole = AhoCorasick::Whole;
+
+  QTest::newRow("absent") << "linux" << "Qt released" << 0;
+  QTest::newRow("inside") << "rel" << "Qt released" << found;
+  QTest::newRow("begins") << "qt" << "Qt released" << (found | prefix);
+  QTest::newRow("ends") << "SED" << "Qt released" << (found | suffix);
+  QTest::newRow("whole") << "qt released" << "QT RELEASED" << (found | prefix | suffix | whole);
+  QTest::newRow("longer than text") << "qt released!" << "Qt released" << 0;
+  QTest::newRow("empty text") << "qt" << "" << 0;
+  QTest::newRow("cyrillic") << QString::fromUtf8("\xd0\x9d\xd0\x9e\xd0\x92\xd0\x9e\xd0\xa1\xd0\xa2\xd0\x98")
+                            << QString::fromUtf8("\xd0\xbd\xd0\xbe\xd0\xb2\xd0\xbe\xd1\x81\xd1\x82\xd0\xb8 "
+                                                 "\xd0\xb4\xd0\xbd\xd1\x8f")
+                            << (found | prefix);
+}
+
+void TestAhoCorasick::flags()
+{
+  QFETCH(QString, pattern);
+  QFETCH(QString, text);
+  QFETCH(int, flags);
+
+  QCOMPARE(int(matchOne(pattern, text)), flags);
+}
+
+void TestAhoCorasick::overlapping()
+{
+  AhoCorasick matcher;
+  int he = matcher.addPattern("he");
+  int she = matcher.addPattern("she");
+  int hers = matcher.addPattern("hers");
+  int his = matcher.addPattern("his");
+  QCOMPARE(matcher.addPattern("HE"), he);
+  matcher.build();
+
+  QVector<uchar> flags(matcher.patternsCount(), 0);
+  matcher.match("ushers", &flags);
+  QCOMPARE(int(flags.at(he)), int(AhoCorasick::Found));
+  QCOMPARE(int(flags.at(she)), int(AhoCorasick::Found));
+  QCOMPARE(int(flags.at(hers)), int(AhoCorasick::Found | AhoCorasick::Suffix));
+  QCOMPARE(int(flags.at(his)), 0);
+}
+
+/** Full case folding turns sharp s into "ss" and would shift the Prefix and
+ *  Whole checks, per-QChar folding keeps one character.
+ */
+void TestAhoCorasick::caseFoldingKeepsLength()
+{
+  QString pattern = QString::fromUtf8("stra\xc3\x9f" "e");
+  QString capital = QString::fromUtf8("STRA\xe1\xba\x9e" "E");
+  QCOMPARE(int(matchOne(pattern, capital)),
+           int(AhoCorasick::Found | AhoCorasick::Prefix |
+               AhoCorasick::Suffix | AhoCorasick::Whole));
+  QCOMPARE(int(matchOne(pattern, pattern + " 1")),
+           int(AhoCorasick::Found | AhoCorasick::Prefix));
+  QCOMPARE(int(matchOne(pattern, "strasse")), 0);
+}
+
+/** 500 patterns against 100,000 titles, as many as literal conditions of a
+ *  large filter set meet on a big update.
+ */
+void TestAhoCorasick::initTestCase()
+{
+  static const char *words[] = {
+    "linux", "release", "kernel", "update", "security", "browser", "video",
+    "market", "football", "weather", "election", "science", "space", "game",
+    "music", "review", "apple", "google", "phone", "energy", "climate",
+    "travel", "health", "startup", "crypto", "movie", "festival", "court"
+  };
+  const int wordsCount = sizeof(words) / sizeof(words[0]);
+
+  quint32 seed = 12345;
+  for (int i = 0; i < 500; ++i) {
+    seed = seed * 1103515245 + 12345;
+    QString first = words[(seed >> 8) % wordsCount];
+    if (i % 5)
+      patterns_.append(first + " " + words[(seed >> 16) % wordsCount]);
+    else
+      patterns_.append(first + " " + QString::number(i));
+  }
+  for (int i = 0; i < 100000; ++i) {
+    QString title;
+    for (int j = 0; j < 8; ++j) {
+      seed = seed * 1103515245 + 12345;
+      title.append(words[(seed >> 8) % wordsCount]);
+      title.append(' ');
+    }
+    texts_.append(title + QString::number(i % 600));
+  }
+}
+
+void TestAhoCorasick::benchmarkAutomaton()
+{
+  AhoCorasick matcher;
+  foreach (const QString &pattern, patterns_) {
+    matcher.addPattern(pattern);
+  }
+  matcher.build();
+
+  int found = 0;
+  QBENCHMARK_ONCE {
+    QVector<uchar> flags(matcher.patternsCount());
+    foreach (const QString &text, texts_) {
+      flags.fill(0);
+      matcher.match(text, &flags);
+      found += flags.count() - flags.count(0);
+    }
+  }
+  qDebug() << "titles:" << texts_.count() << "patterns:" << patterns_.count()
+           << "matches:" << found;
+}
+
+/** Baseline: one case insensitive search per pattern */
+void TestAhoCorasick::benchmarkContains()
+{
+  int found = 0;
+  QBENCHMARK_ONCE {
+    foreach (const QString &text, texts_) {
+      foreach (const QString &pattern, patterns_) {
+        if (text.contains(pattern, Qt::CaseInsensitive))
+          ++found;
+      }
+    }
+  }
+  qDebug() << "found:" << found;
+}
+
+QTEST_MAIN(TestAhoCorasick)
+#include "tst_ahocorasick.moc"
@@ -0,0 +1,6 @@
+TARGET = tst_categorycounts
+QT += sql
+
+include(../tests.pri)
+
+SOURCES += tst_categorycounts.cpp
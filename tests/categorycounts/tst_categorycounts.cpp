@@ -0,0 +1,217 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include <QtTest>
+#include <QtSql>
+
+/*! \brief Counters of categories tree: starred, deleted and labels. */
+struct CategoryCounts {
+  CategoryCounts() : allStarred(0), unreadStarred(0), deleted(0) {}
+
+  bool operator==(const CategoryCounts &other) const
+  {
+    return (allStarred == other.allStarred) && (unreadStarred == other.unreadStarred) &&
+        (deleted == other.deleted) && (allLabel == other.allLabel) &&
+        (unreadLabel == other.unreadLabel);
+  }
+
+  int allStarred;
+  int unreadStarred;
+  int deleted;
+  QMap<int,int> allLabel;
+  QMap<int,int> unreadLabel;
+};
+
+/*! \brief Category counters of 1,000,000 news.
+ *
+ * Counters were counted by GUI thread from all rows of news table, now
+ * UpdateObject::slotRecountCategoryCounts() gets them by aggregate queries.
+ * Both ways are repeated here on the same table.
+ */
+class TestCategoryCounts : public QObject
+{
+  Q_OBJECT
+private slots:
+  void initTestCase();
+  void sameCounts();
+  void benchmarkAggregate();
+  void benchmarkRows();
+
+private:
+  CategoryCounts aggregateCounts();
+  CategoryCounts rowCounts();
+
+  QSqlDatabase db_;
+
+};
+
+/** Same queries as UpdateObject::slotRecountCategoryCounts() */
+CategoryCounts TestCategoryCounts::aggregateCounts()
+{
+  CategoryCounts counts;
+
+  QSqlQuery q(db_);
+  q.exec("SELECT SUM(deleted=0 AND starred=1), SUM(deleted=0 AND starred=1 AND read=0), "
+         "SUM(deleted=1) FROM news WHERE deleted < 2");
+  if (q.next()) {
+    counts.allStarred = q.value(0).toInt();
+    counts.unreadStarred = q.value(1).toInt();
+    counts.deleted = q.value(2).toInt();
+  }
+
+  q.exec("SELECT id FROM labels");
+  while (q.next()) {
+    int id = q.value(0).toInt();
+    counts.allLabel.insert(id, 0);
+    counts.unreadLabel.insert(id, 0);
+  }
+
+  q.exec("SELECT label, COUNT(*), SUM(read=0) FROM news "
+         "WHERE deleted=0 AND label!='' AND label!=',' GROUP BY label");
+  while (q.next()) {
+    QStringList idList = q.value(0).toString().split(",", QString::SkipEmptyParts);
+    int allCount = q.value(1).toInt();
+    int unreadCount = q.value(2).toInt();
+    foreach (QString idStr, idList) {
+      int id = idStr.toInt();
+      if (counts.allLabel.contains(id)) {
+        counts.allLabel[id] += allCount;
+        counts.unreadLabel[id] += unreadCount;
+      }
+    }
+  }
+  return counts;
+}
+
+/** Rows copied to lists and counted one by one, as before aggregate queries */
+CategoryCounts TestCategoryCounts::rowCounts()
+{
+  QList<int> deletedList;
+  QList<int> starredList;
+  QList<int> readList;
+  QStringList labelList;
+  QSqlQuery q(db_);
+  q.exec("SELECT deleted, starred, read, label FROM news WHERE deleted < 2");
+  while (q.next()) {
+    deletedList.append(q.value(0).toInt());
+    starredList.append(q.value(1).toInt());
+    readList.append(q.value(2).toInt());
+    labelList.append(q.value(3).toString());
+  }
+
+  CategoryCounts counts;
+  q.exec("SELECT id FROM labels");
+  while (q.next()) {
+    int id = q.value(0).toInt();
+    counts.allLabel.insert(id, 0);
+    counts.unreadLabel.insert(id, 0);
+  }
+
+  for (int i = 0; i < deletedList.count(); ++i) {
+    if (deletedList.at(i) == 0) {
+      if (starredList.at(i) == 1) {
+        counts.allStarred++;
+        if (readList.at(i) == 0)
+          counts.unreadStarred++;
+      }
+      QString idString = labelList.at(i);
+      if (!idString.isEmpty() && idString != ",") {
+        QStringList idList = idString.split(",", QString::SkipEmptyParts);
+        foreach (QString idStr, idList) {
+          int id = idStr.toInt();
+          if (counts.allLabel.contains(id)) {
+            counts.allLabel[id]++;
+            if (readList.at(i) == 0)
+              counts.unreadLabel[id]++;
+          }
+        }
+      }
+    } else if (deletedList.at(i) == 1) {
+      counts.deleted++;
+    }
+  }
+  return counts;
+}
+
+void TestCategoryCounts::initTestCase()
+{
+  db_ = QSqlDatabase::addDatabase("QSQLITE");
+  db_.setDatabaseName(":memory:");
+  QVERIFY(db_.open());
+
+  QSqlQuery q(db_);
+  QVERIFY(q.exec("CREATE TABLE news(id integer primary key, feedId integer, title varchar, "
+                 "label varchar, new integer default 1, read integer default 0, "
+                 "starred integer default 0, deleted integer default 0)"));
+  QVERIFY(q.exec("CREATE TABLE labels(id integer primary key, name varchar)"));
+  for (int i = 1; i <= 6; ++i)
+    q.exec(QString("INSERT INTO labels(id, name) VALUES (%1, 'Label %1')").arg(i));
+
+  // Label 5 is removed from labels table, label 6 has no news
+  static const char *labels[] = { "", "", "", ",", ",1,", ",2,", ",1,3,", ",4,", ",2,5," };
+  const int labelsCount = sizeof(labels) / sizeof(labels[0]);
+  q.exec("DELETE FROM labels WHERE id=5");
+
+  db_.transaction();
+  q.prepare("INSERT INTO news(feedId, title, label, read, starred, deleted) "
+            "VALUES (?, ?, ?, ?, ?, ?)");
+  for (int i = 0; i < 1000000; ++i) {
+    q.addBindValue(i % 300);
+    q.addBindValue(QString("News %1").arg(i));
+    q.addBindValue(QString(labels[(i / 7) % labelsCount]));
+    q.addBindValue((i % 3) ? 1 : 0);
+    q.addBindValue((i % 20 == 0) ? 1 : 0);
+    q.addBindValue((i % 97 == 0) ? 2 : ((i % 50 == 0) ? 1 : 0));
+    q.exec();
+  }
+  QVERIFY(db_.commit());
+}
+
+void TestCategoryCounts::sameCounts()
+{
+  CategoryCounts counts = aggregateCounts();
+  QVERIFY(counts.allStarred > 0);
+  QVERIFY(counts.unreadStarred > 0);
+  QVERIFY(counts.deleted > 0);
+  QVERIFY(counts.allLabel.value(1) > 0);
+  QVERIFY(counts.unreadLabel.value(3) > 0);
+  QVERIFY(!counts.allLabel.contains(5));
+  QCOMPARE(counts.allLabel.value(6), 0);
+  QVERIFY(counts == rowCounts());
+}
+
+void TestCategoryCounts::benchmarkAggregate()
+{
+  CategoryCounts counts;
+  QBENCHMARK_ONCE {
+    counts = aggregateCounts();
+  }
+  qDebug() << "starred:" << counts.allStarred << "deleted:" << counts.deleted;
+}
+
+/** Baseline: every row of news table read and counted */
+void TestCategoryCounts::benchmarkRows()
+{
+  CategoryCounts counts;
+  QBENCHMARK_ONCE {
+    counts = rowCounts();
+  }
+  qDebug() << "starred:" << counts.allStarred << "deleted:" << counts.deleted;
+}
+
+QTEST_MAIN(TestCategoryCounts)
+#include "tst_categorycounts.moc"
@@ -0,0 +1,6 @@
+# Helpers shared by network tests
+INCLUDEPATH += $$PWD
+
+HEADERS += $$PWD/stubhttpserver.h
+
+SOURCES += $$PWD/stubhttpserver.cpp
@@ -0,0 +1,111 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include "stubhttpserver.h"
+
+#include <QSslSocket>
+
+StubHttpServer::StubHttpServer(QObject *parent)
+  : QTcpServer(parent)
+{
+  connect(this, SIGNAL(newConnection()), this, SLOT(slotNewConnection()));
+}
+
+QUrl StubHttpServer::url(const QString &path) const
+{
+  QString scheme = certificate_.isNull() ? "http" : "https";
+  return QUrl(QString("%1://127.0.0.1:%2%3").arg(scheme).arg(serverPort()).arg(path));
+}
+
+void StubHttpServer::setCertificate(const QSslCertificate &certificate, const QSslKey &key)
+{
+  certificate_ = certificate;
+  key_ = key;
+}
+
+#if (QT_VERSION >= 0x050000)
+void StubHttpServer::incomingConnection(qintptr socketDescriptor)
+#else
+void StubHttpServer::incomingConnection(int socketDescriptor)
+#endif
+{
+  if (certificate_.isNull()) {
+    QTcpServer::incomingConnection(socketDescriptor);
+    return;
+  }
+
+  QSslSocket *socket = new QSslSocket(this);
+  if (!socket->setSocketDescriptor(socketDescriptor)) {
+    delete socket;
+    return;
+  }
+  socket->setLocalCertificate(certificate_);
+  socket->setPrivateKey(key_);
+  addPendingConnection(socket);
+  socket->startServerEncryption();
+}
+
+QByteArray StubHttpServer::method(const QByteArray &request)
+{
+  return request.left(request.indexOf(' '));
+}
+
+/** Path with query as sent in request line */
+QByteArray StubHttpServer::path(const QByteArray &request)
+{
+  return request.left(request.indexOf("\r\n")).split(' ').value(1);
+}
+
+QByteArray StubHttpServer::header(const QByteArray &request, const QByteArray &name)
+{
+  QByteArray prefix = name.toLower() + ':';
+  QList<QByteArray> lines = request.left(request.indexOf("\r\n\r\n")).split('\n');
+  foreach (const QByteArray &line, lines) {
+    if (line.toLower().startsWith(prefix))
+      return line.mid(prefix.size()).trimmed();
+  }
+  return QByteArray();
+}
+
+QByteArray StubHttpServer::body(const QByteArray &request)
+{
+  return request.mid(request.indexOf("\r\n\r\n") + 4);
+}
+
+void StubHttpServer::slotNewConnection()
+{
+  while (QTcpSocket *socket = nextPendingConnection()) {
+    connect(socket, SIGNAL(readyRead()), this, SLOT(slotReadyRead()));
+    connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+  }
+}
+
+void StubHttpServer::slotReadyRead()
+{
+  QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+  QByteArray request = socket->property("request").toByteArray() + socket->readAll();
+  socket->setProperty("request", request);
+
+  int headerEnd = request.indexOf("\r\n\r\n");
+  if (headerEnd < 0)
+    return;
+  if (request.size() - headerEnd - 4 < header(request, "Content-Length").toInt())
+    return;
+
+  socket->setProperty("request", QByteArray());
+  respond(socket, request);
+}
@@ -0,0 +1,65 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#ifndef STUBHTTPSERVER_H
+#define STUBHTTPSERVER_H
+
+#include <QSslCertificate>
+#include <QSslKey>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUrl>
+
+/*! \brief Base of HTTP servers on localhost used by tests.
+ *
+ * Collects request of each connection with its body (Content-Length only)
+ * and passes it to respond(). Socket is deleted when it is disconnected.
+ * With certificate set, connections are accepted over TLS.
+ */
+class StubHttpServer : public QTcpServer
+{
+  Q_OBJECT
+public:
+  explicit StubHttpServer(QObject *parent = 0);
+
+  QUrl url(const QString &path) const;
+  void setCertificate(const QSslCertificate &certificate, const QSslKey &key);
+
+  static QByteArray method(const QByteArray &request);
+  static QByteArray path(const QByteArray &request);
+  static QByteArray header(const QByteArray &request, const QByteArray &name);
+  static QByteArray body(const QByteArray &request);
+
+protected:
+  virtual void respond(QTcpSocket *socket, const QByteArray &request) = 0;
+#if (QT_VERSION >= 0x050000)
+  void incomingConnection(qintptr socketDescriptor);
+#else
+  void incomingConnection(int socketDescriptor);
+#endif
+
+private slots:
+  void slotNewConnection();
+  void slotReadyRead();
+
+private:
+  QSslCertificate certificate_;
+  QSslKey key_;
+
+};
+
+#endif // STUBHTTPSERVER_H
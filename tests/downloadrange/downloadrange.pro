@@ -0,0 +1,13 @@
+TARGET = tst_downloadrange
+QT += network
+
+include(../tests.pri)
+
+INCLUDEPATH += $$SRC_DIR/downloads
+
+HEADERS += \
+    $$SRC_DIR/downloads/downloadrange.h
+
+SOURCES += \
+    tst_downloadrange.cpp \
+    $$SRC_DIR/downloads/downloadrange.cpp
@@ -0,0 +1,325 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include <QtTest>
+#include <QtNetwork>
+
+#include "downloadrange.h"
+#include "stubhttpserver.h"
+
+/*! \brief HTTP server on localhost serving one file with ranges.
+ *
+ * "/file" accepts Range and If-Range like servers DownloadItem resumes
+ * from, "/file?cut" sends only half of the file and closes connection.
+ */
+class RangeServer : public StubHttpServer
+{
+  Q_OBJECT
+public:
+  RangeServer() : etag_("\"v1\"") {}
+
+  void setContent(const QByteArray &content) { content_ = content; }
+  void setEtag(const QByteArray &etag) { etag_ = etag; }
+
+protected:
+  void respond(QTcpSocket *socket, const QByteArray &request)
+  {
+    QByteArray path = StubHttpServer::path(request);
+    QByteArray range = header(request, "Range");
+    QByteArray ifRange = header(request, "If-Range");
+
+    QByteArray headers = "ETag: " + etag_ + "\r\nAccept-Ranges: bytes\r\nConnection: close\r\n";
+    qint64 size = content_.size();
+    if (!range.isEmpty() && (ifRange.isEmpty() || (ifRange == etag_))) {
+      QList<QByteArray> bounds = range.mid(6).split('-');
+      qint64 first = bounds.value(0).toLongLong();
+      qint64 last = bounds.value(1).isEmpty() ? (size - 1) : bounds.value(1).toLongLong();
+      socket->write("HTTP/1.1 206 Partial Content\r\n" + headers +
+                    "Content-Range: bytes " + QByteArray::number(first) + "-" +
+                    QByteArray::number(last) + "/" + QByteArray::number(size) + "\r\n" +
+                    "Content-Length: " + QByteArray::number(last - first + 1) + "\r\n\r\n");
+      socket->write(content_.mid(first, last - first + 1));
+    } else {
+      socket->write("HTTP/1.1 200 OK\r\n" + headers +
+                    "Content-Length: " + QByteArray::number(size) + "\r\n\r\n");
+      socket->write(path.endsWith("?cut") ? content_.left(size / 2) : content_);
+    }
+    socket->disconnectFromHost();
+  }
+
+private:
+  QByteArray content_;
+  QByteArray etag_;
+
+};
+
+class TestDownloadRange : public QObject
+{
+  Q_OBJECT
+private slots:
+  void initTestCase();
+  void init();
+  void rangeHeader();
+  void ifRangeHeader();
+  void parseContentRange_data();
+  void parseContentRange();
+  void split_data();
+  void split();
+  void remaining();
+  void resume();
+  void changedFile();
+  void segments();
+
+private:
+  QNetworkReply *get(const QString &path, qint64 first = -1, qint64 last = -1);
+
+  RangeServer server_;
+  QNetworkAccessManager manager_;
+  QByteArray content_;
+
+};
+
+void TestDownloadRange::initTestCase()
+{
+  QVERIFY(server_.listen(QHostAddress::LocalHost));
+
+  content_.resize(4 * 1024 * 1024 + 123);
+  quint32 seed = 12345;
+  for (int i = 0; i < content_.size(); ++i) {
+    seed = seed * 1103515245 + 12345;
+    content_[i] = char(seed >> 16);
+  }
+  server_.setContent(content_);
+}
+
+void TestDownloadRange::init()
+{
+  server_.setEtag("\"v1\"");
+}
+
+/** Request with Range and If-Range as DownloadItem::startSegment() sends */
+QNetworkReply *TestDownloadRange::get(const QString &path, qint64 first, qint64 last)
+{
+  QNetworkRequest request(server_.url(path));
+  if (first >= 0) {
+    request.setRawHeader("Range", DownloadRange::rangeHeader(first, last));
+    request.setRawHeader("If-Range", DownloadRange::ifRangeHeader("\"v1\"", QByteArray()));
+  }
+  QNetworkReply *reply = manager_.get(request);
+  QEventLoop loop;
+  connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
+  QTimer::singleShot(10000, &loop, SLOT(quit()));
+  loop.exec();
+  return reply;
+}
+
+void TestDownloadRange::rangeHeader()
+{
+  QCOMPARE(DownloadRange::rangeHeader(0, -1), QByteArray("bytes=0-"));
+  QCOMPARE(DownloadRange::rangeHeader(100, 199), QByteArray("bytes=100-199"));
+  QCOMPARE(DownloadRange::rangeHeader(Q_INT64_C(5000000000), -1), QByteArray("bytes=5000000000-"));
+}
+
+void TestDownloadRange::ifRangeHeader()
+{
+  QByteArray date("Wed, 21 Oct 2015 07:28:00 GMT");
+  QCOMPARE(DownloadRange::ifRangeHeader("\"abc\"", date), QByteArray("\"abc\""));
+  QCOMPARE(DownloadRange::ifRangeHeader("W/\"abc\"", date), date);
+  QCOMPARE(DownloadRange::ifRangeHeader("", date), date);
+  QVERIFY(DownloadRange::ifRangeHeader("W/\"abc\"", "").isEmpty());
+}
+
+void TestDownloadRange::parseContentRange_data()
+{
+  QTest::addColumn<QByteArray>("header");
+  QTest::addColumn<bool>("valid");
+  QTest::addColumn<qint64>("first");
+  QTest::addColumn<qint64>("last");
+  QTest::addColumn<qint64>("total");
+
+  QTest::newRow("range") << QByteArray("bytes 100-199/1000") << true
+                         << qint64(100) << qint64(199) << qint64(1000);
+  QTest::newRow("unknown total") << QByteArray("bytes 0-99/*") << true
+                                 << qint64(0) << qint64(99) << qint64(-1);
+  QTest::newRow("upper case") << QByteArray("Bytes 0-0/1") << true
+                              << qint64(0) << qint64(0) << qint64(1);
+  QTest::newRow("large") << QByteArray("bytes 4294967296-4294967395/5000000000") << true
+                         << Q_INT64_C(4294967296) << Q_INT64_C(4294967395) << Q_INT64_C(5000000000);
+  QTest::newRow("unsatisfied") << QByteArray("bytes */1000") << false
+                               << qint64(0) << qint64(0) << qint64(0);
+  QTest::newRow("reversed") << QByteArray("bytes 200-100/1000") << false
+                            << qint64(0) << qint64(0) << qint64(0);
+  QTest::newRow("past end") << QByteArray("bytes 0-1000/1000") << false
+                            << qint64(0) << qint64(0) << qint64(0);
+  QTest::newRow("other unit") << QByteArray("items 0-1/2") << false
+                              << qint64(0) << qint64(0) << qint64(0);
+  QTest::newRow("empty") << QByteArray() << false
+                         << qint64(0) << qint64(0) << qint64(0);
+}
+
+void TestDownloadRange::parseContentRange()
+{
+  QFETCH(QByteArray, header);
+  QFETCH(bool, valid);
+  QFETCH(qint64, first);
+  QFETCH(qint64, last);
+  QFETCH(qint64, total);
+
+  qint64 parsedFirst = 0;
+  qint64 parsedLast = 0;
+  qint64 parsedTotal = 0;
+  QCOMPARE(DownloadRange::parseContentRange(header, &parsedFirst, &parsedLast, &parsedTotal), valid);
+  if (valid) {
+    QCOMPARE(parsedFirst, first);
+    QCOMPARE(parsedLast, last);
+    QCOMPARE(parsedTotal, total);
+  }
+}
+
+void TestDownloadRange::split_data()
+{
+  QTest::addColumn<qint64>("total");
+  QTest::addColumn<int>("count");
+  QTest::addColumn<int>("ranges");
+
+  QTest::newRow("even") << qint64(4000) << 4 << 4;
+  QTest::newRow("rest in last") << qint64(4003) << 4 << 4;
+  QTest::newRow("limited by size") << qint64(2500) << 4 << 2;
+  QTest::newRow("small file") << qint64(500) << 4 << 1;
+  QTest::newRow("one") << qint64(4000) << 1 << 1;
+  QTest::newRow("empty") << qint64(0) << 4 << 0;
+}
+
+/** Ranges follow each other and cover whole file */
+void TestDownloadRange::split()
+{
+  QFETCH(qint64, total);
+  QFETCH(int, count);
+  QFETCH(int, ranges);
+
+  QList<DownloadRange::Range> result = DownloadRange::split(total, count, 1000);
+  QCOMPARE(result.count(), ranges);
+
+  qint64 next = 0;
+  foreach (const DownloadRange::Range &range, result) {
+    QCOMPARE(range.first, next);
+    QVERIFY(range.second - range.first + 1 >= qMin(total, qint64(1000)));
+    next = range.second + 1;
+  }
+  if (ranges)
+    QCOMPARE(next, total);
+}
+
+void TestDownloadRange::remaining()
+{
+  QList<DownloadRange::Range> ranges;
+  ranges << qMakePair(qint64(100), qint64(199)) << qMakePair(qint64(500), qint64(-1));
+  QCOMPARE(DownloadRange::remaining(ranges, 1000), qint64(600));
+  QCOMPARE(DownloadRange::remaining(ranges, -1), qint64(100));
+  QCOMPARE(DownloadRange::remaining(QList<DownloadRange::Range>(), 1000), qint64(0));
+}
+
+/** Interrupted download continues from received data */
+void TestDownloadRange::resume()
+{
+  QScopedPointer<QNetworkReply> reply(get("/file?cut"));
+  QVERIFY(reply->isFinished());
+  QCOMPARE(reply->rawHeader("Accept-Ranges"), QByteArray("bytes"));
+  QByteArray data = reply->readAll();
+  QVERIFY(data.size() < content_.size());
+  QVERIFY(reply->error() != QNetworkReply::NoError);
+
+  reply.reset(get("/file", data.size()));
+  QCOMPARE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), 206);
+  qint64 first = -1;
+  qint64 last = -1;
+  qint64 total = -1;
+  QVERIFY(DownloadRange::parseContentRange(reply->rawHeader("Content-Range"),
+                                           &first, &last, &total));
+  QCOMPARE(first, qint64(data.size()));
+  QCOMPARE(total, qint64(content_.size()));
+
+  data.append(reply->readAll());
+  QVERIFY(data == content_);
+}
+
+/** Changed file is sent whole, DownloadItem restarts from beginning */
+void TestDownloadRange::changedFile()
+{
+  server_.setEtag("\"v2\"");
+  QScopedPointer<QNetworkReply> reply(get("/file", 1000));
+  QCOMPARE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), 200);
+  QVERIFY(reply->readAll() == content_);
+}
+
+/** File downloaded by four parallel ranges, time is compared with one request */
+void TestDownloadRange::segments()
+{
+  QElapsedTimer timer;
+  timer.start();
+  QScopedPointer<QNetworkReply> whole(get("/file"));
+  QVERIFY(whole->readAll() == content_);
+  qint64 wholeTime = timer.elapsed();
+
+  QList<DownloadRange::Range> ranges = DownloadRange::split(content_.size(), 4, 1024 * 1024);
+  QCOMPARE(ranges.count(), 4);
+
+  timer.restart();
+  QList<QNetworkReply*> replies;
+  foreach (const DownloadRange::Range &range, ranges) {
+    QNetworkRequest request(server_.url("/file"));
+    request.setRawHeader("Range", DownloadRange::rangeHeader(range.first, range.second));
+    replies.append(manager_.get(request));
+  }
+  QEventLoop loop;
+  foreach (QNetworkReply *reply, replies) {
+    connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
+  }
+  int finished = 0;
+  while ((finished < replies.count()) && (timer.elapsed() < 10000)) {
+    QTimer::singleShot(1000, &loop, SLOT(quit()));
+    loop.exec();
+    finished = 0;
+    foreach (QNetworkReply *reply, replies) {
+      if (reply->isFinished())
+        ++finished;
+    }
+  }
+  qint64 segmentsTime = timer.elapsed();
+  QCOMPARE(finished, replies.count());
+
+  QByteArray data(content_.size(), '\0');
+  for (int i = 0; i < ranges.count(); ++i) {
+    qint64 first = -1;
+    qint64 last = -1;
+    qint64 total = -1;
+    QVERIFY(DownloadRange::parseContentRange(replies.at(i)->rawHeader("Content-Range"),
+                                             &first, &last, &total));
+    QCOMPARE(first, ranges.at(i).first);
+    QByteArray part = replies.at(i)->readAll();
+    QCOMPARE(qint64(part.size()), last - first + 1);
+    data.replace(int(first), part.size(), part);
+  }
+  qDeleteAll(replies);
+  QVERIFY(data == content_);
+
+  qDebug() << "size:" << content_.size() << "one request:" << wholeTime << "ms"
+           << "four ranges:" << segmentsTime << "ms";
+}
+
+QTEST_MAIN(TestDownloadRange)
+#include "tst_downloadrange.moc"
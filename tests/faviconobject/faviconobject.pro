@@ -0,0 +1,20 @@
+TARGET = tst_faviconobject
+QT += network
+
+include(../tests.pri)
+
+# Stand-in of application header is found first, so FaviconObject is
+# built without the application
+INCLUDEPATH = $$PWD $$INCLUDEPATH
+INCLUDEPATH += $$SRC_DIR/main $$SRC_DIR/network
+
+HEADERS += \
+    mainapplication.h \
+    $$SRC_DIR/faviconobject.h \
+    $$SRC_DIR/network/hostthrottle.h \
+    $$SRC_DIR/network/networkmanager.h
+
+SOURCES += \
+    tst_faviconobject.cpp \
+    $$SRC_DIR/faviconobject.cpp \
+    $$SRC_DIR/network/hostthrottle.cpp
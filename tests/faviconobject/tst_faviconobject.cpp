@@ -0,0 +1,357 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include <QtTest>
+#include <QtNetwork>
+#include <QImage>
+
+#include "faviconobject.h"
+#include "globals.h"
+#include "mainapplication.h"
+#include "stubhttpserver.h"
+
+// Format of favicons.dat
+#define ICONS_MAGIC 0x46415631
+#define ICONS_VERSION 1
+
+// FaviconObject is linked without application, the test gives its own
+// globals and network manager which sends requests of all sites to server
+// on localhost
+Globals globals;
+
+Globals::Globals()
+  : logFileOutput_(false)
+  , noDebugOutput_(false)
+  , isInit_(false)
+  , isPortable_(false)
+{
+}
+
+MainApplication *MainApplication::getInstance()
+{
+  static MainApplication application;
+  return &application;
+}
+
+static quint16 serverPort = 0;
+
+NetworkManager::NetworkManager(bool, QObject *parent)
+  : QNetworkAccessManager(parent)
+  , ignoreAllWarnings_(false)
+  , adblockManager_(0)
+  , feedArchive_(0)
+  , imagePrefetcher_(0)
+{
+}
+
+NetworkManager::~NetworkManager()
+{
+}
+
+QNetworkReply *NetworkManager::createRequest(QNetworkAccessManager::Operation op,
+                                             const QNetworkRequest &request,
+                                             QIODevice *outgoingData)
+{
+  QUrl url = request.url();
+  QNetworkRequest localRequest(request);
+  localRequest.setRawHeader("X-Test-Host", url.host().toLatin1());
+  url.setScheme("http");
+  url.setHost("127.0.0.1");
+  url.setPort(serverPort);
+  localRequest.setUrl(url);
+  return QNetworkAccessManager::createRequest(op, localRequest, outgoingData);
+}
+
+void NetworkManager::slotAuthentication(QNetworkReply *, QAuthenticator *)
+{
+}
+
+void NetworkManager::slotProxyAuthentication(const QNetworkProxy &, QAuthenticator *)
+{
+}
+
+void NetworkManager::slotSslError(QNetworkReply *, QList<QSslError>)
+{
+}
+
+/*! \brief HTTP server on localhost answering for test sites.
+ *
+ * Sites "a*.test" link their icon "/icon.png" from main page, sites "b*.test"
+ * have "/favicon.ico" only, both icons are the same image. Sites "c*.test"
+ * have no icon, "busy*.test" answer 503. Site "rv.test" answers the first
+ * revalidation of its icon with 503 and the next ones with 304.
+ */
+class IconServer : public StubHttpServer
+{
+  Q_OBJECT
+public:
+  IconServer() : revalidations_(0) {}
+
+  int requests(const QString &host, const QString &path) const
+  {
+    return requests_.value(host + path);
+  }
+  QList<qint64> revalidationTimes() const { return revalidationTimes_; }
+
+  static QByteArray icon()
+  {
+    QImage image(32, 32, QImage::Format_ARGB32);
+    image.fill(0xffcc3300);
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+    return data;
+  }
+
+protected:
+  void respond(QTcpSocket *socket, const QByteArray &request)
+  {
+    QString host = QString::fromLatin1(StubHttpServer::header(request, "X-Test-Host"));
+    QString path = QString::fromLatin1(StubHttpServer::path(request));
+    requests_[host + path]++;
+
+    QByteArray status = "404 Not Found";
+    QByteArray headers;
+    QByteArray body;
+    if (host.startsWith("busy")) {
+      status = "503 Service Unavailable";
+      headers = "Retry-After: 3\r\n";
+    } else if (host == "rv.test") {
+      if (!StubHttpServer::header(request, "If-None-Match").isEmpty()) {
+        revalidationTimes_.append(QDateTime::currentDateTime().toMSecsSinceEpoch());
+        if (++revalidations_ == 1) {
+          status = "503 Service Unavailable";
+          headers = "Retry-After: 1\r\n";
+        } else {
+          status = "304 Not Modified";
+        }
+      }
+    } else if (host.startsWith("a") && (path == "/")) {
+      status = "200 OK";
+      headers = "Content-Type: text/html\r\n";
+      body = "<html><head><link rel=\"icon\" href=\"/icon.png\"></head></html>";
+    } else if (host.startsWith("b") && (path == "/")) {
+      status = "200 OK";
+      headers = "Content-Type: text/html\r\n";
+      body = "<html><head><title>Site</title></head></html>";
+    } else if ((host.startsWith("a") && (path == "/icon.png")) ||
+               (host.startsWith("b") && (path == "/favicon.ico"))) {
+      status = "200 OK";
+      headers = "Content-Type: image/png\r\nETag: \"icon1\"\r\n";
+      body = icon();
+    }
+
+    socket->write("HTTP/1.1 " + status + "\r\n" + headers +
+                  "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                  "Connection: close\r\n\r\n" + body);
+    socket->disconnectFromHost();
+  }
+
+private:
+  QHash<QString, int> requests_;
+  int revalidations_;
+  QList<qint64> revalidationTimes_;
+
+};
+
+/*! \brief Icons of feed sites.
+ *
+ * Icon is resolved once per site for all its feeds, equal icons of sites
+ * are stored once in favicons.dat. Busy hosts don't hold back other sites,
+ * busy server keeps known icon until it is revalidated.
+ */
+class TestFaviconObject : public QObject
+{
+  Q_OBJECT
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+  void perSiteResolution();
+  void savedIcons();
+  void throttledHostSkipped();
+  void revalidationBusy();
+
+private:
+  static bool waitCount(QSignalSpy *spy, int count, int timeout);
+
+  IconServer server_;
+  QString fileName_;
+
+};
+
+void TestFaviconObject::initTestCase()
+{
+  QVERIFY(server_.listen(QHostAddress::LocalHost));
+  serverPort = server_.serverPort();
+  mainApp->setDataDir(QDir::tempPath());
+  fileName_ = QDir::temp().absoluteFilePath("favicons.dat");
+  QFile::remove(fileName_);
+}
+
+void TestFaviconObject::cleanupTestCase()
+{
+  QFile::remove(fileName_);
+}
+
+bool TestFaviconObject::waitCount(QSignalSpy *spy, int count, int timeout)
+{
+  for (int i = 0; (i < timeout / 50) && (spy->count() < count); ++i) {
+    QTest::qWait(50);
+  }
+  return spy->count() >= count;
+}
+
+/** Feeds of one site get icon found by one search */
+void TestFaviconObject::perSiteResolution()
+{
+  FaviconObject object;
+  QSignalSpy spy(&object, SIGNAL(signalIconRecived(QString,QByteArray)));
+
+  QStringList feedUrls;
+  feedUrls << "http://a.test/feed1" << "http://a.test/feed2" << "http://a.test/feed3"
+           << "http://b.test/feed1" << "http://b.test/feed2";
+  foreach (const QString &feedUrl, feedUrls) {
+    object.requestUrl(QUrl(feedUrl).resolved(QUrl("/news")).toString(), feedUrl);
+  }
+  object.requestUrl("http://c.test/news", "http://c.test/feed");
+  QVERIFY(waitCount(&spy, feedUrls.count(), 10000));
+  QTest::qWait(200);
+
+  QCOMPARE(spy.count(), feedUrls.count());
+  QStringList iconFeeds;
+  for (int i = 0; i < spy.count(); ++i) {
+    iconFeeds.append(spy.at(i).at(0).toString());
+    QCOMPARE(spy.at(i).at(1).toByteArray(), spy.at(0).at(1).toByteArray());
+  }
+  iconFeeds.sort();
+  QCOMPARE(iconFeeds, feedUrls);
+
+  QCOMPARE(server_.requests("a.test", "/"), 1);
+  QCOMPARE(server_.requests("a.test", "/icon.png"), 1);
+  QCOMPARE(server_.requests("a.test", "/favicon.ico"), 0);
+  QCOMPARE(server_.requests("b.test", "/"), 1);
+  QCOMPARE(server_.requests("b.test", "/favicon.ico"), 1);
+}
+
+/** Equal icons of sites are saved once and used without requests */
+void TestFaviconObject::savedIcons()
+{
+  QFile file(fileName_);
+  QVERIFY(file.open(QIODevice::ReadOnly));
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_4_6);
+
+  quint32 magic;
+  qint32 version;
+  qint32 count;
+  in >> magic >> version >> count;
+  QCOMPARE(magic, quint32(ICONS_MAGIC));
+  QCOMPARE(version, qint32(ICONS_VERSION));
+  QCOMPARE(count, 3);
+
+  QSet<QByteArray> hashes;
+  for (int i = 0; i < count; ++i) {
+    QString siteUrl;
+    QByteArray hash;
+    QString iconUrl;
+    QString etag;
+    qint64 checked;
+    in >> siteUrl >> hash >> iconUrl >> etag >> checked;
+    if (siteUrl == "http://c.test") {
+      QVERIFY(hash.isEmpty());
+    } else {
+      QCOMPARE(etag, QString("\"icon1\""));
+      hashes.insert(hash);
+    }
+  }
+  QHash<QByteArray, QByteArray> icons;
+  in >> icons;
+  QCOMPARE(in.status(), QDataStream::Ok);
+  QCOMPARE(hashes.count(), 1);
+  QCOMPARE(icons.count(), 1);
+  QVERIFY(icons.contains(*hashes.begin()));
+  file.close();
+
+  FaviconObject object;
+  QSignalSpy spy(&object, SIGNAL(signalIconRecived(QString,QByteArray)));
+  object.requestUrl("http://b.test/news", "http://b.test/feed3");
+  QCOMPARE(spy.count(), 1);
+  QCOMPARE(spy.at(0).at(1).toByteArray(), icons.value(*hashes.begin()));
+  QCOMPARE(server_.requests("b.test", "/"), 1);
+}
+
+/** Site of throttled host waits in queue, site behind it is resolved */
+void TestFaviconObject::throttledHostSkipped()
+{
+  FaviconObject object;
+  QSignalSpy spy(&object, SIGNAL(signalIconRecived(QString,QByteArray)));
+
+  object.requestUrl("http://busy.test/news", "http://busy.test/feed");
+  for (int i = 0; (i < 100) && (server_.requests("busy.test", "/") < 2); ++i) {
+    QTest::qWait(50);
+  }
+  QCOMPARE(server_.requests("busy.test", "/"), 2);
+
+  QElapsedTimer timer;
+  timer.start();
+  object.requestUrl("https://busy.test/news", "https://busy.test/feed");
+  object.requestUrl("http://a2.test/news", "http://a2.test/feed");
+  QVERIFY(waitCount(&spy, 1, 10000));
+
+  QCOMPARE(spy.at(0).at(0).toString(), QString("http://a2.test/feed"));
+  QVERIFY2(timer.elapsed() < 2000, qPrintable(QString::number(timer.elapsed())));
+  QCOMPARE(server_.requests("busy.test", "/"), 2);
+}
+
+/** Busy server keeps known icon, it is revalidated when host is ready */
+void TestFaviconObject::revalidationBusy()
+{
+  QByteArray iconData = "stored icon";
+  QByteArray hash = QCryptographicHash::hash(iconData, QCryptographicHash::Sha1);
+  QHash<QByteArray, QByteArray> icons;
+  icons.insert(hash, iconData);
+
+  QFile file(fileName_);
+  QVERIFY(file.open(QIODevice::WriteOnly));
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_4_6);
+  out << quint32(ICONS_MAGIC) << qint32(ICONS_VERSION) << qint32(1);
+  out << QString("http://rv.test") << hash << QString("http://rv.test/icon.png")
+      << QString("\"rv1\"") << qint64(0);
+  out << icons;
+  file.close();
+
+  FaviconObject object;
+  QSignalSpy spy(&object, SIGNAL(signalIconRecived(QString,QByteArray)));
+  object.requestUrl("http://rv.test/news", "http://rv.test/feed");
+  QVERIFY(waitCount(&spy, 1, 5000));
+  for (int i = 0; (i < 100) && (server_.revalidationTimes().count() < 2); ++i) {
+    QTest::qWait(50);
+  }
+  QTest::qWait(200);
+
+  QCOMPARE(spy.count(), 1);
+  QCOMPARE(spy.at(0).at(1).toByteArray(), iconData);
+  QList<qint64> times = server_.revalidationTimes();
+  QCOMPARE(times.count(), 2);
+  QVERIFY2(times.at(1) - times.at(0) >= 900, qPrintable(QString::number(times.at(1) - times.at(0))));
+  QCOMPARE(server_.requests("rv.test", "/"), 0);
+}
+
+QTEST_MAIN(TestFaviconObject)
+#include "tst_faviconobject.moc"
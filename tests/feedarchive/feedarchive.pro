@@ -0,0 +1,13 @@
+TARGET = tst_feedarchive
+QT += network
+
+include(../tests.pri)
+
+INCLUDEPATH += $$SRC_DIR/network
+
+HEADERS += \
+    $$SRC_DIR/network/feedarchive.h
+
+SOURCES += \
+    tst_feedarchive.cpp \
+    $$SRC_DIR/network/feedarchive.cpp
@@ -0,0 +1,217 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include <QtTest>
+#include <QtNetwork>
+
+#include "feedarchive.h"
+#include "stubhttpserver.h"
+
+/*! \brief HTTP server on localhost with feeds that change on every request.
+ *
+ * "/feed" answers with body "1", "2" and so on, "/moved" redirects to
+ * "/feed", "/big" answers with 20 KB feed.
+ */
+class FeedServer : public StubHttpServer
+{
+  Q_OBJECT
+public:
+  FeedServer() : count_(0) {}
+
+protected:
+  void respond(QTcpSocket *socket, const QByteArray &request)
+  {
+    QByteArray path = StubHttpServer::path(request).split('?').value(0);
+    QByteArray response;
+    if (path == "/feed") {
+      QByteArray body = QByteArray::number(++count_);
+      response = "HTTP/1.1 200 OK\r\nContent-Type: application/rss+xml\r\n"
+                 "ETag: \"" + body + "\"\r\n"
+                 "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                 "Connection: close\r\n\r\n" + body;
+    } else if (path == "/moved") {
+      response = "HTTP/1.1 301 Moved Permanently\r\nLocation: " + url("/feed").toEncoded() +
+                 "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    } else if (path == "/big") {
+      QByteArray body = "<rss>" + QByteArray(20 * 1024, 'x') + "</rss>";
+      response = "HTTP/1.1 200 OK\r\nContent-Type: application/rss+xml\r\n"
+                 "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                 "Connection: close\r\n\r\n" + body;
+    } else {
+      response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    }
+    socket->write(response);
+    socket->disconnectFromHost();
+  }
+
+private:
+  int count_;
+
+};
+
+class TestFeedArchive : public QObject
+{
+  Q_OBJECT
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+  void replay();
+  void replayRedirect();
+  void replayMissing();
+  void replayRealTime();
+  void benchmarkReplay();
+
+private:
+  QNetworkReply *wait(QNetworkReply *reply);
+  void record(FeedArchive *archive, const QString &path);
+
+  FeedServer server_;
+  QNetworkAccessManager manager_;
+  QString fileName_;
+
+};
+
+QNetworkReply *TestFeedArchive::wait(QNetworkReply *reply)
+{
+  if (!reply->isFinished()) {
+    QEventLoop loop;
+    connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
+    QTimer::singleShot(5000, &loop, SLOT(quit()));
+    loop.exec();
+  }
+  return reply;
+}
+
+/** Same as RequestFeed does: body is read before reply is recorded */
+void TestFeedArchive::record(FeedArchive *archive, const QString &path)
+{
+  QElapsedTimer timer;
+  timer.start();
+  QScopedPointer<QNetworkReply> reply(wait(manager_.get(QNetworkRequest(server_.url(path)))));
+  QVERIFY(reply->isFinished());
+  archive->record(reply.data(), reply->readAll(), timer.elapsed());
+}
+
+void TestFeedArchive::initTestCase()
+{
+  QVERIFY(server_.listen(QHostAddress::LocalHost));
+  fileName_ = QDir::temp().absoluteFilePath(
+        QString("tst_feedarchive_%1.dat").arg(QCoreApplication::applicationPid()));
+
+  FeedArchive archive(FeedArchive::ModeRecord, fileName_);
+  record(&archive, "/feed");
+  record(&archive, "/feed");
+  record(&archive, "/moved");
+  for (int i = 0; i < 100; ++i) {
+    record(&archive, QString("/big?%1").arg(i));
+  }
+  archive.save();
+  QVERIFY(QFile::exists(fileName_));
+}
+
+void TestFeedArchive::cleanupTestCase()
+{
+  QFile::remove(fileName_);
+}
+
+/** Responses of one request come back in recorded order, the last repeats */
+void TestFeedArchive::replay()
+{
+  FeedArchive archive(FeedArchive::ModeReplay, fileName_);
+  QNetworkRequest request(server_.url("/feed"));
+
+  QStringList bodies;
+  for (int i = 0; i < 3; ++i) {
+    QScopedPointer<QNetworkReply> reply(wait(archive.replay(QNetworkAccessManager::GetOperation,
+                                                            request, 0)));
+    QVERIFY(reply->isFinished());
+    QCOMPARE(reply->error(), QNetworkReply::NoError);
+    QCOMPARE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), 200);
+    QCOMPARE(reply->rawHeader("Content-Type"), QByteArray("application/rss+xml"));
+    QByteArray body = reply->readAll();
+    QCOMPARE(reply->rawHeader("ETag"), "\"" + body + "\"");
+    bodies.append(QString::fromLatin1(body));
+  }
+  QCOMPARE(bodies, QStringList() << "1" << "2" << "2");
+}
+
+void TestFeedArchive::replayRedirect()
+{
+  FeedArchive archive(FeedArchive::ModeReplay, fileName_);
+  QScopedPointer<QNetworkReply> reply(wait(archive.replay(QNetworkAccessManager::GetOperation,
+                                                          QNetworkRequest(server_.url("/moved")), 0)));
+  QCOMPARE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), 301);
+  QCOMPARE(reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl(),
+           server_.url("/feed"));
+}
+
+void TestFeedArchive::replayMissing()
+{
+  FeedArchive archive(FeedArchive::ModeReplay, fileName_);
+  QScopedPointer<QNetworkReply> reply(wait(archive.replay(QNetworkAccessManager::GetOperation,
+                                                          QNetworkRequest(server_.url("/other")), 0)));
+  QCOMPARE(reply->error(), QNetworkReply::ContentNotFoundError);
+
+  // Other operation is other request
+  reply.reset(wait(archive.replay(QNetworkAccessManager::HeadOperation,
+                                  QNetworkRequest(server_.url("/feed")), 0)));
+  QCOMPARE(reply->error(), QNetworkReply::ContentNotFoundError);
+}
+
+/** In real time mode reply takes as long as the recorded one */
+void TestFeedArchive::replayRealTime()
+{
+  QString fileName = fileName_ + ".slow";
+  {
+    QNetworkRequest request(server_.url("/feed"));
+    QScopedPointer<QNetworkReply> reply(wait(manager_.get(request)));
+    FeedArchive archive(FeedArchive::ModeRecord, fileName);
+    archive.record(reply.data(), reply->readAll(), 300);
+    archive.save();
+  }
+
+  FeedArchive archive(FeedArchive::ModeReplay, fileName);
+  archive.setRealTime(true);
+  QElapsedTimer timer;
+  timer.start();
+  QScopedPointer<QNetworkReply> reply(wait(archive.replay(QNetworkAccessManager::GetOperation,
+                                                          QNetworkRequest(server_.url("/feed")), 0)));
+  qint64 elapsed = timer.elapsed();
+  QFile::remove(fileName);
+
+  QVERIFY(reply->isFinished());
+  QVERIFY2((elapsed >= 290) && (elapsed <= 600), qPrintable(QString::number(elapsed)));
+}
+
+/** Offline replay of 100 feeds of 20 KB, load of archive included */
+void TestFeedArchive::benchmarkReplay()
+{
+  qint64 bytes = 0;
+  QBENCHMARK_ONCE {
+    FeedArchive archive(FeedArchive::ModeReplay, fileName_);
+    for (int i = 0; i < 100; ++i) {
+      QNetworkRequest request(server_.url(QString("/big?%1").arg(i)));
+      QScopedPointer<QNetworkReply> reply(wait(archive.replay(QNetworkAccessManager::GetOperation,
+                                                              request, 0)));
+      bytes += reply->readAll().size();
+    }
+  }
+  QCOMPARE(bytes, qint64(100 * (20 * 1024 + 11)));
+}
+
+QTEST_MAIN(TestFeedArchive)
+#include "tst_feedarchive.moc"
@@ -0,0 +1,18 @@
+TARGET = tst_feedsproxymodel
+QT += sql
+isEqual(QT_MAJOR_VERSION, 5) {
+  QT += widgets
+}
+
+include(../tests.pri)
+
+INCLUDEPATH += $$SRC_DIR/feedsview
+
+HEADERS += \
+    $$SRC_DIR/feedsview/feedsmodel.h \
+    $$SRC_DIR/feedsview/feedsproxymodel.h
+
+SOURCES += \
+    tst_feedsproxymodel.cpp \
+    $$SRC_DIR/feedsview/feedsmodel.cpp \
+    $$SRC_DIR/feedsview/feedsproxymodel.cpp
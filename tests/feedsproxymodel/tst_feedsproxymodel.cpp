@@ -0,0 +1,181 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include <QtTest>
+#include <QtSql>
+
+#include "feedsmodel.h"
+#include "feedsproxymodel.h"
+
+#define FOLDERS_COUNT 50
+#define FEEDS_IN_FOLDER 40
+
+/*! \brief Filtering of feeds tree with 2,000 feeds in 50 folders.
+ *
+ * Feeds tree is filtered again after every update of counters and on every
+ * key press in find feed field, that should take less than 10 ms. Rows are
+ * counted through the whole proxy model, as expanded feeds view does.
+ */
+class TestFeedsProxyModel : public QObject
+{
+  Q_OBJECT
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+  void findFolders_data();
+  void findFolders();
+  void benchmarkRecount();
+  void benchmarkFind();
+
+private:
+  static QString feedTitle(int folder, int feed);
+  int visibleRows(const QModelIndex &parent = QModelIndex()) const;
+
+  FeedsModel *feedsModel_;
+  FeedsProxyModel *proxyModel_;
+
+};
+
+QString TestFeedsProxyModel::feedTitle(int folder, int feed)
+{
+  return QString("Feed %1").arg(folder * FEEDS_IN_FOLDER + feed);
+}
+
+int TestFeedsProxyModel::visibleRows(const QModelIndex &parent) const
+{
+  int count = proxyModel_->rowCount(parent);
+  int rows = count;
+  for (int i = 0; i < count; ++i) {
+    rows += visibleRows(proxyModel_->index(i, 0, parent));
+  }
+  return rows;
+}
+
+void TestFeedsProxyModel::initTestCase()
+{
+  QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE");
+  db.setDatabaseName(":memory:");
+  QVERIFY(db.open());
+
+  QSqlQuery q;
+  QVERIFY(q.exec("CREATE TABLE feeds(id integer primary key, text varchar, "
+                 "xmlUrl varchar, parentId integer, rowToParent integer, "
+                 "newCount integer default 0, unread integer default 0)"));
+
+  db.transaction();
+  for (int folder = 0; folder < FOLDERS_COUNT; ++folder) {
+    int folderId = folder + 1;
+    q.prepare("INSERT INTO feeds(id, text, xmlUrl, parentId, rowToParent, unread) "
+              "VALUES (?, ?, '', 0, ?, 1)");
+    q.addBindValue(folderId);
+    q.addBindValue(QString("Folder %1").arg(folder));
+    q.addBindValue(folder);
+    q.exec();
+
+    for (int feed = 0; feed < FEEDS_IN_FOLDER; ++feed) {
+      q.prepare("INSERT INTO feeds(text, xmlUrl, parentId, rowToParent, newCount, unread) "
+                "VALUES (?, ?, ?, ?, ?, ?)");
+      q.addBindValue(feedTitle(folder, feed));
+      q.addBindValue(QString("http://host%1.com/feed%2.xml").arg(folder).arg(feed));
+      q.addBindValue(folderId);
+      q.addBindValue(feed);
+      q.addBindValue(feed % 7 == 0 ? 1 : 0);
+      q.addBindValue(feed % 3);
+      q.exec();
+    }
+  }
+  QVERIFY(db.commit());
+
+  feedsModel_ = new FeedsModel(this);
+  proxyModel_ = new FeedsProxyModel(this);
+  proxyModel_->setSourceModel(feedsModel_);
+  QCOMPARE(visibleRows(), FOLDERS_COUNT * (FEEDS_IN_FOLDER + 1));
+}
+
+void TestFeedsProxyModel::cleanupTestCase()
+{
+  delete proxyModel_;
+  delete feedsModel_;
+}
+
+void TestFeedsProxyModel::findFolders_data()
+{
+  QTest::addColumn<QString>("findAct");
+  QTest::addColumn<QString>("findText");
+
+  QTest::newRow("name") << "findNameAct" << "feed 7";
+  QTest::newRow("name of one feed") << "findNameAct" << "feed 1999";
+  QTest::newRow("link") << "findLinkAct" << "host4";
+  QTest::newRow("nothing") << "findNameAct" << "missing";
+}
+
+/** Folders stay visible only with matching feeds inside */
+void TestFeedsProxyModel::findFolders()
+{
+  QFETCH(QString, findAct);
+  QFETCH(QString, findText);
+
+  int expected = 0;
+  for (int folder = 0; folder < FOLDERS_COUNT; ++folder) {
+    int found = 0;
+    for (int feed = 0; feed < FEEDS_IN_FOLDER; ++feed) {
+      QString text = (findAct == "findLinkAct") ?
+            QString("http://host%1.com/feed%2.xml").arg(folder).arg(feed) :
+            feedTitle(folder, feed);
+      if (text.contains(findText, Qt::CaseInsensitive))
+        found++;
+    }
+    if (found)
+      expected += found + 1;
+  }
+
+  proxyModel_->setFilter("filterFeedsAll_", QSet<int>(), findAct, findText);
+  QCOMPARE(visibleRows(), expected);
+
+  proxyModel_->setFilter("filterFeedsAll_", QSet<int>(), "findNameAct", "");
+  QCOMPARE(visibleRows(), FOLDERS_COUNT * (FEEDS_IN_FOLDER + 1));
+}
+
+/** Unread filter applied again after counters update, find text unchanged */
+void TestFeedsProxyModel::benchmarkRecount()
+{
+  QSet<int> idList;
+  idList << FOLDERS_COUNT + 1;
+  int rows = 0;
+  QBENCHMARK {
+    proxyModel_->setFilter("filterFeedsUnread_", idList, "findNameAct", "feed 1");
+    rows = visibleRows();
+  }
+  qDebug() << "visible rows:" << rows;
+}
+
+/** Find text changed as while typing, found folders are collected again */
+void TestFeedsProxyModel::benchmarkFind()
+{
+  int rows = 0;
+  int i = 0;
+  QBENCHMARK {
+    proxyModel_->setFilter("filterFeedsAll_", QSet<int>(), "findNameAct",
+                           (i++ % 2) ? "feed 1" : "feed 12");
+    rows = visibleRows();
+  }
+  qDebug() << "visible rows:" << rows;
+}
+
+QTEST_MAIN(TestFeedsProxyModel)
+
+#include "tst_feedsproxymodel.moc"
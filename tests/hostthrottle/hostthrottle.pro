@@ -0,0 +1,13 @@
+TARGET = tst_hostthrottle
+QT += network
+
+include(../tests.pri)
+
+INCLUDEPATH += $$SRC_DIR/network
+
+HEADERS += \
+    $$SRC_DIR/network/hostthrottle.h
+
+SOURCES += \
+    tst_hostthrottle.cpp \
+    $$SRC_DIR/network/hostthrottle.cpp
@@ -0,0 +1,193 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include <QtTest>
+#include <QtNetwork>
+
+#include "hostthrottle.h"
+#include "stubhttpserver.h"
+
+/*! \brief HTTP server on localhost answering each path with fixed response */
+class ThrottleServer : public StubHttpServer
+{
+  Q_OBJECT
+public:
+  void setResponse(const QString &path, int status, const QByteArray &headers)
+  {
+    QByteArray response = "HTTP/1.1 " + QByteArray::number(status) + " Stub\r\n";
+    response.append(headers);
+    response.append("Content-Length: 2\r\nConnection: close\r\n\r\nok");
+    responses_.insert(path, response);
+  }
+
+protected:
+  void respond(QTcpSocket *socket, const QByteArray &request)
+  {
+    QString path = QString::fromLatin1(StubHttpServer::path(request));
+    socket->write(responses_.value(path, "HTTP/1.1 404 Not Found\r\n"
+                                         "Content-Length: 0\r\nConnection: close\r\n\r\n"));
+    socket->disconnectFromHost();
+  }
+
+private:
+  QHash<QString, QByteArray> responses_;
+
+};
+
+class TestHostThrottle : public QObject
+{
+  Q_OBJECT
+private slots:
+  void initTestCase();
+  void retryDelay_data();
+  void retryDelay();
+  void throttleDecay();
+  void retryAfterOverrides();
+  void replies_data();
+  void replies();
+
+private:
+  QNetworkReply *get(const QString &path);
+
+  ThrottleServer server_;
+  QNetworkAccessManager manager_;
+
+};
+
+void TestHostThrottle::initTestCase()
+{
+  QVERIFY(server_.listen(QHostAddress::LocalHost));
+
+  QDateTime date = QDateTime::currentDateTime().toUTC().addSecs(60);
+  QByteArray httpDate = QLocale(QLocale::C).toString(date, "ddd, dd MMM yyyy hh:mm:ss 'GMT'").toLatin1();
+
+  server_.setResponse("/ok", 200, "");
+  server_.setResponse("/busy", 503, "Retry-After: 120\r\n");
+  server_.setResponse("/limited", 429, "Retry-After: " + httpDate + "\r\n");
+  server_.setResponse("/long", 503, "Retry-After: 100000\r\n");
+  server_.setResponse("/invalid", 429, "Retry-After: soon\r\n");
+  server_.setResponse("/plain", 503, "");
+}
+
+QNetworkReply *TestHostThrottle::get(const QString &path)
+{
+  QNetworkReply *reply = manager_.get(QNetworkRequest(server_.url(path)));
+  QEventLoop loop;
+  connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
+  QTimer::singleShot(5000, &loop, SLOT(quit()));
+  loop.exec();
+  return reply;
+}
+
+void TestHostThrottle::retryDelay_data()
+{
+  QTest::addColumn<int>("count");
+  QTest::addColumn<int>("delay");
+
+  QTest::newRow("first") << 1 << 500;
+  QTest::newRow("second") << 2 << 1000;
+  QTest::newRow("fifth") << 5 << 8000;
+  QTest::newRow("capped") << 20 << 30000;
+}
+
+/** Delay doubles with every repeat, jitter spreads it by 25% */
+void TestHostThrottle::retryDelay()
+{
+  QFETCH(int, count);
+  QFETCH(int, delay);
+
+  HostThrottle throttle;
+  for (int i = 0; i < 100; ++i) {
+    int retryDelay = throttle.retryDelay(count);
+    QVERIFY(retryDelay >= delay - delay / 4);
+    QVERIFY(retryDelay <= delay + delay / 4);
+  }
+}
+
+void TestHostThrottle::throttleDecay()
+{
+  HostThrottle throttle;
+  QVERIFY(!throttle.isThrottled("example.com"));
+
+  throttle.throttle("example.com", 0);
+  throttle.throttle("example.com", 0);
+  QVERIFY(throttle.isThrottled("example.com"));
+  QVERIFY(!throttle.isThrottled("example.org"));
+
+  throttle.success("example.com");
+  QVERIFY(throttle.isThrottled("example.com"));
+  throttle.success("example.com");
+  QVERIFY(!throttle.isThrottled("example.com"));
+}
+
+void TestHostThrottle::retryAfterOverrides()
+{
+  HostThrottle throttle;
+  qint64 now = QDateTime::currentDateTime().toMSecsSinceEpoch();
+
+  throttle.throttle("example.com", -1);
+  qint64 backoff = throttle.readyTime("example.com") - now;
+  QVERIFY(backoff >= 750);
+  QVERIFY(backoff <= 1250 + 100);
+
+  throttle.throttle("example.com", 60000);
+  qint64 retryAfter = throttle.readyTime("example.com") - now;
+  QVERIFY(retryAfter >= 60000);
+  QVERIFY(retryAfter <= 60000 + 100);
+
+  // Ready time is never moved back
+  throttle.throttle("example.com", 0);
+  QCOMPARE(throttle.readyTime("example.com") - now, retryAfter);
+
+  throttle.success("example.com");
+  throttle.success("example.com");
+  throttle.success("example.com");
+  QVERIFY(throttle.isThrottled("example.com"));
+}
+
+void TestHostThrottle::replies_data()
+{
+  QTest::addColumn<QString>("path");
+  QTest::addColumn<bool>("throttled");
+  QTest::addColumn<int>("minDelay");
+  QTest::addColumn<int>("maxDelay");
+
+  QTest::newRow("ok") << "/ok" << false << -1 << -1;
+  QTest::newRow("503 seconds") << "/busy" << true << 120000 << 120000;
+  QTest::newRow("429 date") << "/limited" << true << 55000 << 60000;
+  QTest::newRow("503 capped") << "/long" << true << 300000 << 300000;
+  QTest::newRow("429 invalid") << "/invalid" << true << -1 << -1;
+  QTest::newRow("503 no header") << "/plain" << true << -1 << -1;
+}
+
+void TestHostThrottle::replies()
+{
+  QFETCH(QString, path);
+  QFETCH(bool, throttled);
+  QFETCH(int, minDelay);
+  QFETCH(int, maxDelay);
+
+  QScopedPointer<QNetworkReply> reply(get(path));
+  QVERIFY(reply->isFinished());
+  QCOMPARE(HostThrottle::isThrottleReply(reply.data()), throttled);
+
+  int delay = HostThrottle::retryAfter(reply.data());
+  QVERIFY2((delay >= minDelay) && (delay <= maxDelay), qPrintable(QString::number(delay)));
+}
+
+QTEST_MAIN(TestHostThrottle)
+#include "tst_hostthrottle.moc"
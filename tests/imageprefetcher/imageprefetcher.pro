@@ -0,0 +1,20 @@
+TARGET = tst_imageprefetcher
+QT += network
+
+include(../tests.pri)
+
+# Stand-in of application header is found first, so ImagePrefetcher is
+# built without the application
+INCLUDEPATH = $$PWD $$INCLUDEPATH
+INCLUDEPATH += $$SRC_DIR/application $$SRC_DIR/main $$SRC_DIR/network
+
+HEADERS += \
+    mainapplication.h \
+    $$SRC_DIR/imageprefetcher.h \
+    $$SRC_DIR/application/settings.h \
+    $$SRC_DIR/network/networkmanager.h
+
+SOURCES += \
+    tst_imageprefetcher.cpp \
+    $$SRC_DIR/imageprefetcher.cpp \
+    $$SRC_DIR/application/settings.cpp
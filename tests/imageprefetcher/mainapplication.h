@@ -0,0 +1,42 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#ifndef MAINAPPLICATION_H
+#define MAINAPPLICATION_H
+
+#define mainApp MainApplication::getInstance()
+
+#include <QDir>
+
+/*! \brief Stand-in of application for test of image prefetcher.
+ *
+ * ImagePrefetcher takes only cache directory from application.
+ */
+class MainApplication
+{
+public:
+  static MainApplication *getInstance();
+
+  QString cacheDefaultDir() const { return cacheDir_; }
+  void setCacheDefaultDir(const QString &cacheDir) { cacheDir_ = cacheDir; }
+
+private:
+  QString cacheDir_;
+
+};
+
+#endif // MAINAPPLICATION_H
@@ -0,0 +1,283 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include <QtTest>
+#include <QtNetwork>
+
+#include "globals.h"
+#include "imageprefetcher.h"
+#include "mainapplication.h"
+#include "settings.h"
+#include "stubhttpserver.h"
+
+#define IMAGES_COUNT 20
+#define IMAGE_SIZE (32 * 1024)
+
+// ImagePrefetcher is linked without application, the test gives its own
+// globals and network manager
+Globals globals;
+
+Globals::Globals()
+  : logFileOutput_(false)
+  , noDebugOutput_(false)
+  , isInit_(false)
+  , isPortable_(false)
+{
+}
+
+MainApplication *MainApplication::getInstance()
+{
+  static MainApplication application;
+  return &application;
+}
+
+NetworkManager::NetworkManager(bool, QObject *parent)
+  : QNetworkAccessManager(parent)
+  , ignoreAllWarnings_(false)
+  , adblockManager_(0)
+  , feedArchive_(0)
+  , imagePrefetcher_(0)
+{
+}
+
+NetworkManager::~NetworkManager()
+{
+}
+
+QNetworkReply *NetworkManager::createRequest(QNetworkAccessManager::Operation op,
+                                             const QNetworkRequest &request,
+                                             QIODevice *outgoingData)
+{
+  return QNetworkAccessManager::createRequest(op, request, outgoingData);
+}
+
+void NetworkManager::slotAuthentication(QNetworkReply *, QAuthenticator *)
+{
+}
+
+void NetworkManager::slotProxyAuthentication(const QNetworkProxy &, QAuthenticator *)
+{
+}
+
+void NetworkManager::slotSslError(QNetworkReply *, QList<QSslError>)
+{
+}
+
+/*! \brief HTTP server on localhost with images "/image1.png" and so on.
+ *
+ * Images "/copy1.png" and so on have the same content as images with
+ * the same number.
+ */
+class ImageServer : public StubHttpServer
+{
+  Q_OBJECT
+public:
+  ImageServer() : requests_(0) {}
+
+  int requests() const { return requests_; }
+
+  static QByteArray image(int number)
+  {
+    return QByteArray(IMAGE_SIZE, char('a' + number % 26)) + QByteArray::number(number);
+  }
+
+protected:
+  void respond(QTcpSocket *socket, const QByteArray &request)
+  {
+    ++requests_;
+    QByteArray name = StubHttpServer::path(request).mid(1);
+    name.truncate(name.indexOf('.'));
+    QByteArray body = image(name.mid(name.startsWith("copy") ? 4 : 5).toInt());
+
+    socket->write("HTTP/1.1 200 OK\r\nContent-Type: image/png\r\n"
+                  "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                  "Connection: close\r\n\r\n" + body);
+    socket->disconnectFromHost();
+  }
+
+private:
+  int requests_;
+
+};
+
+/*! \brief Images of news stored for offline reading.
+ *
+ * Images of local server are prefetched once, then requests of browser are
+ * answered from store when network is not accessible or disk cache is in
+ * offline first mode.
+ */
+class TestImagePrefetcher : public QObject
+{
+  Q_OBJECT
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+  void prefetch();
+  void localReply_data();
+  void localReply();
+  void notStored();
+  void benchmarkLocalReply();
+
+private:
+  static QByteArray readReply(QNetworkReply *reply);
+  int storedCount();
+
+  ImageServer server_;
+  QString dir_;
+  ImagePrefetcher *prefetcher_;
+
+};
+
+void TestImagePrefetcher::initTestCase()
+{
+  QVERIFY(server_.listen(QHostAddress::LocalHost));
+  dir_ = QDir::temp().absoluteFilePath(
+        QString("tst_imageprefetcher_%1").arg(QCoreApplication::applicationPid()));
+  QVERIFY(QDir().mkpath(dir_));
+
+  Settings::createSettings(dir_ + "/settings.ini");
+  mainApp->setCacheDefaultDir(dir_);
+  prefetcher_ = new ImagePrefetcher(this);
+}
+
+void TestImagePrefetcher::cleanupTestCase()
+{
+  delete prefetcher_;
+
+  QDir prefetchDir(dir_ + "/prefetch");
+  foreach (const QString &fileName, prefetchDir.entryList(QDir::Files))
+    prefetchDir.remove(fileName);
+  QDir(dir_).rmdir("prefetch");
+  QFile::remove(dir_ + "/settings.ini");
+  QDir().rmdir(dir_);
+}
+
+QByteArray TestImagePrefetcher::readReply(QNetworkReply *reply)
+{
+  QSignalSpy spy(reply, SIGNAL(finished()));
+  for (int i = 0; (i < 500) && spy.isEmpty(); ++i) {
+    QTest::qWait(10);
+  }
+  return reply->readAll();
+}
+
+int TestImagePrefetcher::storedCount()
+{
+  int count = 0;
+  for (int i = 1; i <= IMAGES_COUNT; ++i) {
+    QByteArray data;
+    QByteArray contentType;
+    if (prefetcher_->localData(server_.url(QString("/image%1.png").arg(i)), &data, &contentType))
+      ++count;
+    if (prefetcher_->localData(server_.url(QString("/copy%1.png").arg(i)), &data, &contentType))
+      ++count;
+  }
+  return count;
+}
+
+/** Images of news are downloaded once, equal images are stored once */
+void TestImagePrefetcher::prefetch()
+{
+  QString html;
+  for (int i = 1; i <= IMAGES_COUNT; ++i) {
+    html += QString("<p><img src=\"/image%1.png\"> <img src='copy%1.png'></p>").arg(i);
+  }
+  prefetcher_->prefetchImages(html, server_.url("/news/").toString());
+  prefetcher_->prefetchImages(html, server_.url("/news/").toString());
+  for (int i = 0; (i < 100) && (storedCount() < 2 * IMAGES_COUNT); ++i) {
+    QTest::qWait(100);
+  }
+
+  QCOMPARE(storedCount(), 2 * IMAGES_COUNT);
+  QCOMPARE(server_.requests(), 2 * IMAGES_COUNT);
+  QStringList files = QDir(dir_ + "/prefetch").entryList(QDir::Files);
+  files.removeAll("index.dat");
+  QCOMPARE(files.count(), IMAGES_COUNT);
+}
+
+void TestImagePrefetcher::localReply_data()
+{
+  QTest::addColumn<bool>("offlineFirst");
+  QTest::addColumn<bool>("networkAccessible");
+  QTest::addColumn<bool>("local");
+
+  QTest::newRow("online") << false << true << false;
+  QTest::newRow("offline first") << true << true << true;
+  QTest::newRow("offline") << false << false << true;
+}
+
+/** Stored image is answered without server unless network is used */
+void TestImagePrefetcher::localReply()
+{
+  QFETCH(bool, offlineFirst);
+  QFETCH(bool, networkAccessible);
+  QFETCH(bool, local);
+
+  int requests = server_.requests();
+  QNetworkRequest request(server_.url("/copy7.png"));
+  QNetworkReply *reply = prefetcher_->localReply(request, offlineFirst,
+                                                 networkAccessible, this);
+  QCOMPARE(reply != NULL, local);
+  if (!reply)
+    return;
+
+  QCOMPARE(readReply(reply), ImageServer::image(7));
+  QCOMPARE(reply->error(), QNetworkReply::NoError);
+  QCOMPARE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), 200);
+  QCOMPARE(reply->header(QNetworkRequest::ContentTypeHeader).toString(), QString("image/png"));
+  QCOMPARE(server_.requests(), requests);
+  delete reply;
+}
+
+/** Image not stored goes to network even when it is not accessible */
+void TestImagePrefetcher::notStored()
+{
+  QNetworkRequest request(server_.url("/image100.png"));
+  QVERIFY(!prefetcher_->localReply(request, true, false, this));
+}
+
+void TestImagePrefetcher::benchmarkLocalReply()
+{
+  QElapsedTimer timer;
+  qint64 localTime = 0;
+  QBENCHMARK_ONCE {
+    timer.start();
+    for (int i = 1; i <= IMAGES_COUNT; ++i) {
+      QNetworkRequest request(server_.url(QString("/image%1.png").arg(i)));
+      QNetworkReply *reply = prefetcher_->localReply(request, false, false, this);
+      QVERIFY(reply);
+      QCOMPARE(readReply(reply).size(), ImageServer::image(i).size());
+      delete reply;
+    }
+    localTime = timer.elapsed();
+  }
+
+  QNetworkAccessManager manager;
+  timer.restart();
+  for (int i = 1; i <= IMAGES_COUNT; ++i) {
+    QNetworkReply *reply = manager.get(QNetworkRequest(server_.url(QString("/image%1.png").arg(i))));
+    QCOMPARE(readReply(reply).size(), ImageServer::image(i).size());
+    delete reply;
+  }
+  qint64 networkTime = timer.elapsed();
+
+  qDebug() << IMAGES_COUNT << "images from store in" << localTime << "ms,"
+           << "from local server in" << networkTime << "ms";
+}
+
+QTEST_MAIN(TestImagePrefetcher)
+#include "tst_imageprefetcher.moc"
@@ -0,0 +1,13 @@
+TARGET = tst_networkdiskcache
+QT += network
+
+include(../tests.pri)
+
+INCLUDEPATH += $$SRC_DIR/network
+
+HEADERS += \
+    $$SRC_DIR/network/networkdiskcache.h
+
+SOURCES += \
+    tst_networkdiskcache.cpp \
+    $$SRC_DIR/network/networkdiskcache.cpp
@@ -0,0 +1,223 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include <QtTest>
+#include <QtNetwork>
+
+#include "networkdiskcache.h"
+
+#define ITEM_SIZE (10 * 1024)
+// Cache is expired before new item is saved, so it may exceed its size by
+// the last item with its header
+#define OVERFLOW(itemSize) ((itemSize) + 2048)
+
+/*! \brief Eviction of browser disk cache.
+ *
+ * LruDiskCache removes items read long ago first, not items stored first.
+ * NetworkDiskCache keeps pages, images and media in caches with own size,
+ * so filling one of them doesn't evict items of others.
+ */
+class TestNetworkDiskCache : public QObject
+{
+  Q_OBJECT
+private slots:
+  void init();
+  void cleanup();
+  void lruEviction();
+  void separateBudgets();
+  void notStored();
+
+private:
+  static QNetworkCacheMetaData metaData(const QString &url, const QByteArray &contentType,
+                                        int size);
+  static bool store(QAbstractNetworkCache *cache, const QString &url,
+                    const QByteArray &contentType, int size);
+  static bool isCached(QAbstractNetworkCache *cache, const QString &url);
+  static qint64 directorySize(const QString &path);
+
+  QString cacheDir_;
+
+};
+
+void TestNetworkDiskCache::init()
+{
+  cacheDir_ = QDir::temp().absoluteFilePath(
+        QString("tst_networkdiskcache_%1").arg(QCoreApplication::applicationPid()));
+  QVERIFY(QDir().mkpath(cacheDir_));
+}
+
+void TestNetworkDiskCache::cleanup()
+{
+  QDirIterator it(cacheDir_, QDir::Files, QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    QFile::remove(it.next());
+  }
+  QStringList dirs;
+  QDirIterator dirIt(cacheDir_, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+  while (dirIt.hasNext()) {
+    dirs.prepend(dirIt.next());
+  }
+  foreach (const QString &dir, dirs) {
+    QDir().rmdir(dir);
+  }
+  QDir().rmdir(cacheDir_);
+}
+
+QNetworkCacheMetaData TestNetworkDiskCache::metaData(const QString &url,
+                                                     const QByteArray &contentType,
+                                                     int size)
+{
+  QNetworkCacheMetaData::RawHeaderList headers;
+  headers << qMakePair(QByteArray("Content-Type"), contentType)
+          << qMakePair(QByteArray("Content-Length"), QByteArray::number(size));
+
+  QNetworkCacheMetaData metaData;
+  metaData.setUrl(QUrl(url));
+  metaData.setRawHeaders(headers);
+  metaData.setSaveToDisk(true);
+  return metaData;
+}
+
+bool TestNetworkDiskCache::store(QAbstractNetworkCache *cache, const QString &url,
+                                 const QByteArray &contentType, int size)
+{
+  QIODevice *device = cache->prepare(metaData(url, contentType, size));
+  if (!device)
+    return false;
+  device->write(QByteArray(size, 'x'));
+  cache->insert(device);
+  return true;
+}
+
+bool TestNetworkDiskCache::isCached(QAbstractNetworkCache *cache, const QString &url)
+{
+  return cache->metaData(QUrl(url)).isValid();
+}
+
+qint64 TestNetworkDiskCache::directorySize(const QString &path)
+{
+  qint64 size = 0;
+  QDirIterator it(path, QDir::Files, QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    it.next();
+    size += it.fileInfo().size();
+  }
+  return size;
+}
+
+/** Items are evicted in order of their last read, not of their storing */
+void TestNetworkDiskCache::lruEviction()
+{
+  LruDiskCache cache;
+  cache.setCacheDirectory(cacheDir_);
+  cache.setMaximumCacheSize(100 * 1024);
+
+  for (int i = 1; i <= 8; ++i) {
+    QVERIFY(store(&cache, QString("http://site.test/%1").arg(i), "text/html", ITEM_SIZE));
+  }
+
+  // Items stored first are read last, so they are used most recently
+  QList<int> lruOrder;
+  lruOrder << 3 << 4 << 5 << 6 << 7 << 8 << 1 << 2;
+  foreach (int number, lruOrder) {
+    QIODevice *device = cache.data(QUrl(QString("http://site.test/%1").arg(number)));
+    QVERIFY(device);
+    delete device;
+    QTest::qSleep(5);
+  }
+
+  // Modification time of new files may be rounded down to seconds
+  QTest::qWait(1100);
+  for (int i = 9; i <= 12; ++i) {
+    QVERIFY(store(&cache, QString("http://site.test/%1").arg(i), "text/html", ITEM_SIZE));
+    lruOrder << i;
+  }
+
+  QVERIFY(directorySize(cacheDir_) <= cache.maximumCacheSize() + OVERFLOW(ITEM_SIZE));
+  QVERIFY(!isCached(&cache, "http://site.test/3"));
+  QVERIFY(isCached(&cache, "http://site.test/1"));
+  QVERIFY(isCached(&cache, "http://site.test/2"));
+  QVERIFY(isCached(&cache, "http://site.test/12"));
+
+  // Evicted items are the least recently used ones
+  bool evicted = true;
+  foreach (int number, lruOrder) {
+    bool cached = isCached(&cache, QString("http://site.test/%1").arg(number));
+    QVERIFY2(cached || evicted, qPrintable(QString("item %1 is evicted after used one").arg(number)));
+    evicted = evicted && !cached;
+  }
+}
+
+/** Media filling its cache doesn't evict pages and images */
+void TestNetworkDiskCache::separateBudgets()
+{
+  NetworkDiskCache cache;
+  cache.setCacheDirectory(cacheDir_);
+  cache.setMaximumCacheSize(NetworkDiskCache::CachePages, 100 * 1024);
+  cache.setMaximumCacheSize(NetworkDiskCache::CacheImages, 100 * 1024);
+  cache.setMaximumCacheSize(NetworkDiskCache::CacheMedia, 400 * 1024);
+
+  for (int i = 0; i < 5; ++i) {
+    QVERIFY(store(&cache, QString("http://site.test/page%1").arg(i), "text/html", ITEM_SIZE));
+    QVERIFY(store(&cache, QString("http://site.test/image%1.png").arg(i), "image/png", ITEM_SIZE));
+  }
+  for (int i = 0; i < 20; ++i) {
+    QVERIFY(store(&cache, QString("http://site.test/video%1.mp4").arg(i), "video/mp4", 90 * 1024));
+  }
+
+  QVERIFY(directorySize(cacheDir_ + "/pages") > 0);
+  QVERIFY(directorySize(cacheDir_ + "/images") > 0);
+  QVERIFY(directorySize(cacheDir_ + "/media") <= 400 * 1024 + OVERFLOW(90 * 1024));
+  for (int i = 0; i < 5; ++i) {
+    QVERIFY(isCached(&cache, QString("http://site.test/page%1").arg(i)));
+    QVERIFY(isCached(&cache, QString("http://site.test/image%1.png").arg(i)));
+  }
+  QVERIFY(!isCached(&cache, "http://site.test/video0.mp4"));
+  QVERIFY(isCached(&cache, "http://site.test/video19.mp4"));
+
+  // Images fill their own cache, media items stay
+  for (int i = 5; i < 20; ++i) {
+    QVERIFY(store(&cache, QString("http://site.test/image%1.png").arg(i), "image/png", ITEM_SIZE));
+  }
+  QVERIFY(directorySize(cacheDir_ + "/images") <= 100 * 1024 + OVERFLOW(ITEM_SIZE));
+  QVERIFY(!isCached(&cache, "http://site.test/image0.png"));
+  QVERIFY(isCached(&cache, "http://site.test/image19.png"));
+  QVERIFY(isCached(&cache, "http://site.test/video19.mp4"));
+  for (int i = 0; i < 5; ++i) {
+    QVERIFY(isCached(&cache, QString("http://site.test/page%1").arg(i)));
+  }
+}
+
+/** No-store responses and items over quarter of their cache aren't saved */
+void TestNetworkDiskCache::notStored()
+{
+  NetworkDiskCache cache;
+  cache.setCacheDirectory(cacheDir_);
+  cache.setMaximumCacheSize(NetworkDiskCache::CacheMedia, 400 * 1024);
+
+  QNetworkCacheMetaData noStore = metaData("http://site.test/private", "text/html", ITEM_SIZE);
+  QNetworkCacheMetaData::RawHeaderList headers = noStore.rawHeaders();
+  headers << qMakePair(QByteArray("Cache-Control"), QByteArray("private, no-store"));
+  noStore.setRawHeaders(headers);
+  QVERIFY(!cache.prepare(noStore));
+
+  QVERIFY(!store(&cache, "http://site.test/large.mp4", "video/mp4", 101 * 1024));
+  QVERIFY(store(&cache, "http://site.test/small.mp4", "video/mp4", 99 * 1024));
+}
+
+QTEST_MAIN(TestNetworkDiskCache)
+#include "tst_networkdiskcache.moc"
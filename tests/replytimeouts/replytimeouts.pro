@@ -0,0 +1,13 @@
+TARGET = tst_replytimeouts
+QT += network
+
+include(../tests.pri)
+
+INCLUDEPATH += $$SRC_DIR/network
+
+HEADERS += \
+    $$SRC_DIR/network/replytimeouts.h
+
+SOURCES += \
+    tst_replytimeouts.cpp \
+    $$SRC_DIR/network/replytimeouts.cpp
@@ -0,0 +1,163 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include <QtTest>
+#include <QtNetwork>
+
+#include "replytimeouts.h"
+#include "stubhttpserver.h"
+
+/*! \brief HTTP server on localhost which answers late or never.
+ *
+ * "/silent" is never answered, "/stall" gets headers after delay and then
+ * only part of the body, "/slow" gets whole answer after delay.
+ */
+class SlowServer : public StubHttpServer
+{
+  Q_OBJECT
+public:
+  SlowServer() : delay_(0) {}
+
+  void setDelay(int delay) { delay_ = delay; }
+
+protected:
+  void respond(QTcpSocket *socket, const QByteArray &request)
+  {
+    QByteArray path = StubHttpServer::path(request);
+    if (path == "/silent")
+      return;
+
+    socket->setProperty("path", path);
+    QTimer *timer = new QTimer(socket);
+    timer->setSingleShot(true);
+    connect(timer, SIGNAL(timeout()), this, SLOT(slotRespond()));
+    timer->start(delay_);
+  }
+
+private slots:
+  void slotRespond()
+  {
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender()->parent());
+    if (socket->property("path").toByteArray() == "/stall") {
+      socket->write("HTTP/1.1 200 OK\r\nContent-Length: 100\r\n\r\nok");
+    } else {
+      socket->write("HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: close\r\n\r\nok");
+      socket->disconnectFromHost();
+    }
+  }
+
+private:
+  int delay_;
+
+};
+
+class TestReplyTimeouts : public QObject
+{
+  Q_OBJECT
+private slots:
+  void initTestCase();
+  void stages_data();
+  void stages();
+
+protected slots:
+  void slotTimeout(QNetworkReply *reply, int stage);
+  void slotFinished();
+
+private:
+  SlowServer server_;
+  QNetworkAccessManager manager_;
+  QEventLoop *loop_;
+  int stage_;
+  bool finished_;
+
+};
+
+void TestReplyTimeouts::initTestCase()
+{
+  QVERIFY(server_.listen(QHostAddress::LocalHost));
+}
+
+void TestReplyTimeouts::slotTimeout(QNetworkReply *reply, int stage)
+{
+  stage_ = stage;
+  reply->abort();
+  loop_->quit();
+}
+
+void TestReplyTimeouts::slotFinished()
+{
+  finished_ = true;
+  loop_->quit();
+}
+
+void TestReplyTimeouts::stages_data()
+{
+  QTest::addColumn<QString>("path");
+  QTest::addColumn<int>("delay");
+  QTest::addColumn<int>("stage");
+  QTest::addColumn<int>("minTime");
+  QTest::addColumn<int>("maxTime");
+
+  // Timeouts are 300 ms for connect, 300 ms for first byte and 300 ms for
+  // transfer, plain HTTP has 600 ms until first response
+  QTest::newRow("no answer") << "/silent" << 0 << int(ReplyTimeouts::StageConnect) << 600 << 900;
+  QTest::newRow("late answer") << "/slow" << 450 << -1 << 450 << 600;
+  QTest::newRow("stalled transfer") << "/stall" << 450 << int(ReplyTimeouts::StageTransfer) << 750 << 1050;
+  QTest::newRow("stalled at once") << "/stall" << 0 << int(ReplyTimeouts::StageTransfer) << 300 << 600;
+}
+
+/** Deadline of each stage is counted from beginning of that stage, so
+ *  answer that came late still has whole transfer timeout.
+ */
+void TestReplyTimeouts::stages()
+{
+  QFETCH(QString, path);
+  QFETCH(int, delay);
+  QFETCH(int, stage);
+  QFETCH(int, minTime);
+  QFETCH(int, maxTime);
+
+  ReplyTimeouts timeouts;
+  timeouts.setTimeouts(300, 300, 300);
+  connect(&timeouts, SIGNAL(timeout(QNetworkReply*,int)),
+          this, SLOT(slotTimeout(QNetworkReply*,int)));
+  server_.setDelay(delay);
+
+  QEventLoop loop;
+  loop_ = &loop;
+  stage_ = -1;
+  finished_ = false;
+
+  QElapsedTimer timer;
+  timer.start();
+  QScopedPointer<QNetworkReply> reply(manager_.get(QNetworkRequest(server_.url(path))));
+  timeouts.addReply(reply.data());
+  connect(reply.data(), SIGNAL(finished()), this, SLOT(slotFinished()));
+  QTimer::singleShot(5000, &loop, SLOT(quit()));
+  loop.exec();
+
+  qint64 elapsed = timer.elapsed();
+  if (stage == -1) {
+    QVERIFY(finished_);
+    timeouts.removeReply(reply.data());
+  }
+  QCOMPARE(stage_, stage);
+  QVERIFY2((elapsed >= minTime) && (elapsed <= maxTime), qPrintable(QString::number(elapsed)));
+}
+
+QTEST_MAIN(TestReplyTimeouts)
+#include "tst_replytimeouts.moc"
@@ -0,0 +1,20 @@
+TARGET = tst_requestfeed
+QT += network sql
+
+include(../tests.pri)
+
+INCLUDEPATH += $$SRC_DIR/network $$SRC_DIR/main
+
+HEADERS += \
+    $$SRC_DIR/requestfeed.h \
+    $$SRC_DIR/network/networkmanager.h \
+    $$SRC_DIR/network/feedarchive.h \
+    $$SRC_DIR/network/hostthrottle.h \
+    $$SRC_DIR/network/replytimeouts.h
+
+SOURCES += \
+    tst_requestfeed.cpp \
+    $$SRC_DIR/requestfeed.cpp \
+    $$SRC_DIR/network/feedarchive.cpp \
+    $$SRC_DIR/network/hostthrottle.cpp \
+    $$SRC_DIR/network/replytimeouts.cpp
@@ -0,0 +1,403 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include <QtTest>
+#include <QtNetwork>
+
+#include "globals.h"
+#include "networkmanager.h"
+#include "requestfeed.h"
+
+#if QT_VERSION >= 0x050F00
+#define HTTP2_ALLOWED_ATTRIBUTE QNetworkRequest::Http2AllowedAttribute
+#define HTTP2_USED_ATTRIBUTE QNetworkRequest::Http2WasUsedAttribute
+#elif QT_VERSION >= 0x050900
+#define HTTP2_ALLOWED_ATTRIBUTE QNetworkRequest::HTTP2AllowedAttribute
+#define HTTP2_USED_ATTRIBUTE QNetworkRequest::HTTP2WasUsedAttribute
+#endif
+
+#if QT_VERSION >= 0x050300
+#define SERVICE_UNAVAILABLE_ERROR QNetworkReply::ServiceUnavailableError
+#else
+#define SERVICE_UNAVAILABLE_ERROR QNetworkReply::UnknownContentError
+#endif
+
+// Requests in progress per host, the most of them and hosts answered 503
+static QHash<QString, int> liveRequests;
+static QHash<QString, int> maxLiveRequests;
+static int maxThrottledRequests = 0;
+static int maxTotalRequests = 0;
+static QSet<QString> throttledHosts;
+
+/*! \brief Reply of fake host, answers with small feed after delay.
+ *
+ * Hosts which names start with "h2." answer as if over HTTP/2. Reply with
+ * \a error fails, 503 error asks to retry in one second. Hosts "reset." and
+ * "cut." lose connection after the whole feed and after its half.
+ */
+class FakeReply : public QNetworkReply
+{
+  Q_OBJECT
+public:
+  FakeReply(QNetworkAccessManager::Operation op, const QNetworkRequest &request,
+            QNetworkReply::NetworkError error, int delay, QObject *parent)
+    : QNetworkReply(parent)
+    , offset_(0)
+  {
+    setRequest(request);
+    setUrl(request.url());
+    setOperation(op);
+    if (error == SERVICE_UNAVAILABLE_ERROR) {
+      setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 503);
+      setRawHeader("Retry-After", "1");
+      setError(error, "Service Unavailable");
+    } else if (error != QNetworkReply::NoError) {
+      setError(error, "Connection refused");
+    } else {
+      setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
+      setHeader(QNetworkRequest::ContentTypeHeader, "application/rss+xml");
+#ifdef HTTP2_USED_ATTRIBUTE
+      setAttribute(HTTP2_USED_ATTRIBUTE, request.url().host().startsWith("h2."));
+#endif
+      if (op == QNetworkAccessManager::GetOperation) {
+        data_ = "<rss version=\"2.0\"><channel><title>Feed</title>";
+        for (int i = 0; i < 40; ++i) {
+          data_ += "<item><title>News " + QByteArray::number(i) + "</title>"
+              "<description>Text of news.</description></item>";
+        }
+        data_ += "</channel></rss>";
+        if (request.url().host().startsWith("cut."))
+          data_.truncate(data_.size() / 2);
+      }
+    }
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+    QString host = url().host();
+    int live = ++liveRequests[host];
+    maxLiveRequests[host] = qMax(maxLiveRequests.value(host), live);
+    if (throttledHosts.contains(host))
+      maxThrottledRequests = qMax(maxThrottledRequests, live);
+    int total = 0;
+    foreach (int hostLive, liveRequests)
+      total += hostLive;
+    maxTotalRequests = qMax(maxTotalRequests, total);
+
+    QTimer::singleShot(delay, this, SLOT(finish()));
+  }
+
+  void abort() {}
+  bool isSequential() const { return true; }
+  qint64 bytesAvailable() const
+  {
+    return data_.size() - offset_ + QIODevice::bytesAvailable();
+  }
+
+protected:
+  qint64 readData(char *data, qint64 maxSize)
+  {
+    qint64 size = qMin(maxSize, qint64(data_.size() - offset_));
+    memcpy(data, data_.constData() + offset_, size);
+    offset_ += size;
+    return size;
+  }
+
+private slots:
+  void finish()
+  {
+    liveRequests[url().host()]--;
+    if (error() == SERVICE_UNAVAILABLE_ERROR)
+      throttledHosts.insert(url().host());
+    emit metaDataChanged();
+    emit readyRead();
+    if (isConnectionLost())
+      setError(QNetworkReply::RemoteHostClosedError, "Connection closed");
+    emit finished();
+  }
+
+private:
+  bool isConnectionLost() const
+  {
+    return url().host().startsWith("reset.") || url().host().startsWith("cut.");
+  }
+
+  QByteArray data_;
+  qint64 offset_;
+
+};
+
+// RequestFeed is linked without application, the test gives its own globals
+// and network manager which answers by fake replies
+Globals globals;
+
+Globals::Globals()
+  : logFileOutput_(false)
+  , noDebugOutput_(false)
+  , isInit_(false)
+  , isPortable_(false)
+{
+}
+
+static int replyDelay = 0;
+static int requestsCount = 0;
+static int http2AllowedCount = 0;
+// Failures left per URL and times of requests per URL
+static QHash<QString, QList<QNetworkReply::NetworkError> > failures;
+static QHash<QString, QList<qint64> > requestTimes;
+
+NetworkManager::NetworkManager(bool, QObject *parent)
+  : QNetworkAccessManager(parent)
+  , ignoreAllWarnings_(false)
+  , adblockManager_(0)
+  , feedArchive_(0)
+  , imagePrefetcher_(0)
+{
+}
+
+NetworkManager::~NetworkManager()
+{
+}
+
+QNetworkReply *NetworkManager::createRequest(QNetworkAccessManager::Operation op,
+                                             const QNetworkRequest &request,
+                                             QIODevice *)
+{
+  ++requestsCount;
+#ifdef HTTP2_ALLOWED_ATTRIBUTE
+  if (request.attribute(HTTP2_ALLOWED_ATTRIBUTE).toBool())
+    ++http2AllowedCount;
+#endif
+  QString url = request.url().toString();
+  requestTimes[url].append(QDateTime::currentDateTime().toMSecsSinceEpoch());
+
+  QNetworkReply::NetworkError error = QNetworkReply::NoError;
+  if (!failures.value(url).isEmpty())
+    error = failures[url].takeFirst();
+  return new FakeReply(op, request, error, replyDelay, this);
+}
+
+void NetworkManager::slotAuthentication(QNetworkReply *, QAuthenticator *)
+{
+}
+
+void NetworkManager::slotProxyAuthentication(const QNetworkProxy &, QAuthenticator *)
+{
+}
+
+void NetworkManager::slotSslError(QNetworkReply *, QList<QSslError>)
+{
+}
+
+/*! \brief Connections of RequestFeed to HTTP/2 and HTTP/1 hosts.
+ *
+ * RequestFeed allows six requests at once, host that has answered over
+ * HTTP/2 gets up to 50 streams in its connection. Host that has answered
+ * 503 gets one request at a time, failed requests are repeated after
+ * growing delay.
+ */
+class TestRequestFeed : public QObject
+{
+  Q_OBJECT
+private slots:
+  void init();
+  void http2Streams();
+  void http1Connections();
+  void manyFeeds();
+  void retryBackoff();
+  void streamErrorAfterEnd();
+
+private:
+  static QStringList feedUrls(const QString &host, int count);
+  bool update(RequestFeed *requestFeed, const QStringList &urls);
+
+};
+
+void TestRequestFeed::init()
+{
+  replyDelay = 0;
+  requestsCount = 0;
+  http2AllowedCount = 0;
+  failures.clear();
+  requestTimes.clear();
+  liveRequests.clear();
+  maxLiveRequests.clear();
+  maxThrottledRequests = 0;
+  maxTotalRequests = 0;
+  throttledHosts.clear();
+}
+
+QStringList TestRequestFeed::feedUrls(const QString &host, int count)
+{
+  QStringList urls;
+  for (int i = 0; i < count; ++i)
+    urls.append(QString("http://%1/feed%2").arg(host).arg(i));
+  return urls;
+}
+
+/** Request feeds of \a urls and wait until all are finished */
+bool TestRequestFeed::update(RequestFeed *requestFeed, const QStringList &urls)
+{
+  QSignalSpy spy(requestFeed, SIGNAL(connectionStatsReported()));
+  for (int i = 0; i < urls.count(); ++i) {
+    requestFeed->requestUrl(i + 1, urls.at(i), QDateTime());
+  }
+  for (int i = 0; (i < 300) && spy.isEmpty(); ++i) {
+    QTest::qWait(100);
+  }
+  return !spy.isEmpty();
+}
+
+/** Streams are limited per host, not by number of requests */
+void TestRequestFeed::http2Streams()
+{
+#ifndef HTTP2_ALLOWED_ATTRIBUTE
+#if QT_VERSION >= 0x050000
+  QSKIP("HTTP/2 needs Qt 5.9 or later");
+#else
+  QSKIP("HTTP/2 needs Qt 5.9 or later", SkipAll);
+#endif
+#else
+  RequestFeed requestFeed(30, 6, 2);
+
+  // First reply tells host uses HTTP/2
+  QVERIFY(!requestFeed.isHttp2Host("h2.test"));
+  QVERIFY(update(&requestFeed, feedUrls("h2.test", 1)));
+  QVERIFY(requestFeed.isHttp2Host("h2.test"));
+
+  // Requests are started every 50 ms, so 50 of them are sent before
+  // the first one is answered and the rest waits for free streams
+  replyDelay = 4000;
+  QVERIFY(update(&requestFeed, feedUrls("h2.test", 60)));
+  RequestFeed::ConnectionStats stats = requestFeed.connectionStats();
+  QCOMPARE(stats.requests, 60);
+  QCOMPARE(stats.http2Requests, 60);
+  QCOMPARE(stats.maxHostRequests, 50);
+
+  QCOMPARE(requestsCount, 61);
+  QCOMPARE(http2AllowedCount, requestsCount);
+#endif
+}
+
+/** Host without HTTP/2 gets as many requests as the setting allows */
+void TestRequestFeed::http1Connections()
+{
+  RequestFeed requestFeed(30, 6, 2);
+
+  replyDelay = 1000;
+  QVERIFY(update(&requestFeed, feedUrls("plain.test", 20)));
+  QVERIFY(!requestFeed.isHttp2Host("plain.test"));
+  RequestFeed::ConnectionStats stats = requestFeed.connectionStats();
+  QCOMPARE(stats.requests, 20);
+  QCOMPARE(stats.http2Requests, 0);
+  QCOMPARE(stats.maxHostRequests, 6);
+#ifdef HTTP2_ALLOWED_ATTRIBUTE
+  QCOMPARE(http2AllowedCount, requestsCount);
+#endif
+}
+
+/** Feeds of three hosts, one of them asks to wait by 503 */
+void TestRequestFeed::manyFeeds()
+{
+  RequestFeed requestFeed(30, 6, 3);
+  QSignalSpy spy(&requestFeed, SIGNAL(getUrlDone(int,int,QString,QString,QByteArray,QDateTime,QString)));
+
+  QStringList urls;
+  QStringList aUrls = feedUrls("a.test", 20);
+  QStringList bUrls = feedUrls("b.test", 20);
+  QStringList busyUrls = feedUrls("busy.test", 10);
+  for (int i = 0; i < 20; ++i) {
+    urls << aUrls.at(i) << bUrls.at(i);
+    if (i < busyUrls.count())
+      urls << busyUrls.at(i);
+  }
+  for (int i = 0; i < 3; ++i)
+    failures[busyUrls.at(i)] << SERVICE_UNAVAILABLE_ERROR;
+
+  // Replies are slower than one request per 50 ms, so all six requests
+  // are in progress most of the time
+  replyDelay = 500;
+  QElapsedTimer timer;
+  timer.start();
+  QVERIFY(update(&requestFeed, urls));
+  qDebug() << "update of" << urls.count() << "feeds of 3 hosts in" << timer.elapsed() << "ms";
+
+  QCOMPARE(spy.count(), urls.count());
+  for (int i = 0; i < spy.count(); ++i)
+    QVERIFY(spy.at(i).at(0).toInt() >= 0);
+  QCOMPARE(requestsCount, urls.count() + 3);
+
+  QVERIFY(throttledHosts.contains("busy.test"));
+  QCOMPARE(maxThrottledRequests, 1);
+  QCOMPARE(maxTotalRequests, 6);
+  QVERIFY(maxLiveRequests.value("a.test") > 1);
+}
+
+/** Delay of repeat doubles from 500 ms, jitter spreads it by 25% */
+void TestRequestFeed::retryBackoff()
+{
+  RequestFeed requestFeed(30, 6, 3);
+  QString url = "http://flaky.test/feed";
+  failures[url] << QNetworkReply::ConnectionRefusedError
+                << QNetworkReply::ConnectionRefusedError;
+
+  QVERIFY(update(&requestFeed, QStringList() << url));
+  QList<qint64> times = requestTimes.value(url);
+  QCOMPARE(times.count(), 3);
+
+  qint64 first = times.at(1) - times.at(0);
+  qint64 second = times.at(2) - times.at(1);
+  QVERIFY2((first >= 375) && (first <= 725), qPrintable(QString::number(first)));
+  QVERIFY2((second >= 750) && (second <= 1350), qPrintable(QString::number(second)));
+}
+
+/** Stream which connection is lost after end of feed isn't repeated */
+void TestRequestFeed::streamErrorAfterEnd()
+{
+  RequestFeed requestFeed(30, 6, 2);
+  requestFeed.setStreamParsing(true);
+  QSignalSpy dataSpy(&requestFeed, SIGNAL(getUrlData(int,QByteArray,QDateTime,bool)));
+  QSignalSpy abortSpy(&requestFeed, SIGNAL(getUrlAbort(int)));
+  QSignalSpy doneSpy(&requestFeed, SIGNAL(getUrlDone(int,int,QString,QString,QByteArray,QDateTime,QString)));
+
+  QString resetUrl = "http://reset.test/feed";
+  QString cutUrl = "http://cut.test/feed";
+  requestFeed.requestUrl(1, resetUrl, QDateTime());
+  requestFeed.requestUrl(2, cutUrl, QDateTime());
+  for (int i = 0; (i < 100) && doneSpy.isEmpty(); ++i) {
+    QTest::qWait(100);
+  }
+
+  // Whole feed is passed to parser and finished once
+  QCOMPARE(requestTimes.value(resetUrl).count(), 1);
+  int finishedCount = 0;
+  foreach (const QList<QVariant> &arguments, dataSpy) {
+    if ((arguments.at(0).toInt() == 1) && arguments.at(3).toBool())
+      ++finishedCount;
+  }
+  QCOMPARE(finishedCount, 1);
+
+  // Half of feed is dropped by parser, request is repeated and fails
+  QCOMPARE(requestTimes.value(cutUrl).count(), 2);
+  QCOMPARE(abortSpy.count(), 2);
+  foreach (const QList<QVariant> &arguments, abortSpy)
+    QCOMPARE(arguments.at(0).toInt(), 2);
+  QCOMPARE(doneSpy.count(), 1);
+  QCOMPARE(doneSpy.at(0).at(0).toInt(), -1);
+  QCOMPARE(doneSpy.at(0).at(1).toInt(), 2);
+}
+
+QTEST_MAIN(TestRequestFeed)
+#include "tst_requestfeed.moc"
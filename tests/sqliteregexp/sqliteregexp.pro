@@ -0,0 +1,7 @@
+TARGET = tst_sqliteregexp
+QT += sql
+
+include(../tests.pri)
+include(../../3rdparty/sqlite.pri)
+
+SOURCES += tst_sqliteregexp.cpp
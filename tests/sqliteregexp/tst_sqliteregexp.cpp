@@ -0,0 +1,202 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include <QtTest>
+
+#include <sqlite3.h>
+#include <sqliteextension.h>
+#include <qzregexp.h>
+
+class TestSQLiteRegExp : public QObject
+{
+  Q_OBJECT
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+  void compatibility_data();
+  void compatibility();
+  void patternPerRow();
+  void benchmarkRegexp_data();
+  void benchmarkRegexp();
+  void benchmarkCompilePerRow();
+
+private:
+  static bool matches(const QString &pattern, const QString &text);
+  int count(const QString &sql, const QString &pattern = QString());
+
+  sqlite3 *db_;
+  QStringList titles_;
+
+};
+
+/** Behaviour REGEXP had before patterns were cached: new case insensitive
+ *  regexp for every row.
+ */
+bool TestSQLiteRegExp::matches(const QString &pattern, const QString &text)
+{
+  QzRegExp regExp(pattern, Qt::CaseInsensitive);
+#if (QT_VERSION >= 0x050000)
+  return regExp.match(text).hasMatch();
+#else
+  return (regExp.indexIn(text) > -1);
+#endif
+}
+
+int TestSQLiteRegExp::count(const QString &sql, const QString &pattern)
+{
+  sqlite3_stmt *stmt = 0;
+  if (sqlite3_prepare16_v2(db_, sql.utf16(), -1, &stmt, 0) != SQLITE_OK)
+    return -1;
+  if (!pattern.isNull())
+    sqlite3_bind_text16(stmt, 1, pattern.utf16(), -1, SQLITE_TRANSIENT);
+
+  int result = -1;
+  if (sqlite3_step(stmt) == SQLITE_ROW)
+    result = sqlite3_column_int(stmt, 0);
+  sqlite3_finalize(stmt);
+  return result;
+}
+
+/** 100,000 titles, as many as a large news table has */
+void TestSQLiteRegExp::initTestCase()
+{
+  QVERIFY(sqlite3_open(":memory:", &db_) == SQLITE_OK);
+  installSQLiteExtension(db_);
+
+  static const char *words[] = {
+    "Linux", "release", "kernel", "update", "security", "browser", "video",
+    "market", "football", "weather", "election", "science", "space", "game",
+    "music", "review", "Qt", "google", "phone", "energy", "climate",
+    "travel", "health", "startup", "crypto", "movie", "festival", "court"
+  };
+  const int wordsCount = sizeof(words) / sizeof(words[0]);
+
+  quint32 seed = 12345;
+  for (int i = 0; i < 100000; ++i) {
+    QString title;
+    for (int j = 0; j < 6; ++j) {
+      seed = seed * 1103515245 + 12345;
+      title.append(words[(seed >> 8) % wordsCount]);
+      title.append(' ');
+    }
+    titles_.append(title + QString::number(i % 600));
+  }
+  titles_.append(QString::fromUtf8("\xd0\x9d\xd0\xbe\xd0\xb2\xd0\xbe\xd1\x81\xd1\x82\xd0\xb8 "
+                                   "\xd0\xb4\xd0\xbd\xd1\x8f"));
+
+  sqlite3_exec(db_, "CREATE TABLE news(title TEXT)", 0, 0, 0);
+  sqlite3_exec(db_, "BEGIN", 0, 0, 0);
+  sqlite3_stmt *stmt = 0;
+  sqlite3_prepare_v2(db_, "INSERT INTO news(title) VALUES (?)", -1, &stmt, 0);
+  foreach (const QString &title, titles_) {
+    sqlite3_bind_text16(stmt, 1, title.utf16(), -1, SQLITE_TRANSIENT);
+    sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+  }
+  sqlite3_finalize(stmt);
+  QVERIFY(sqlite3_exec(db_, "COMMIT", 0, 0, 0) == SQLITE_OK);
+}
+
+void TestSQLiteRegExp::cleanupTestCase()
+{
+  sqlite3_close(db_);
+}
+
+void TestSQLiteRegExp::compatibility_data()
+{
+  QTest::addColumn<QString>("pattern");
+
+  QTest::newRow("literal") << "kernel";
+  QTest::newRow("case") << "LINUX";
+  QTest::newRow("anchors") << "^qt .* 42$";
+  QTest::newRow("alternation") << "(football|festival) court";
+  QTest::newRow("class") << "[a-f]+ \\d{3}$";
+  QTest::newRow("word boundary") << "\\bgame\\b";
+  QTest::newRow("dot") << "s.ace";
+  QTest::newRow("cyrillic") << QString::fromUtf8("\xd0\x9d\xd0\x9e\xd0\x92\xd0\x9e\xd0\xa1\xd0\xa2\xd0\x98");
+  QTest::newRow("invalid") << "(linux";
+  QTest::newRow("empty") << "";
+}
+
+/** Cached and per statement patterns give the same rows as a regexp
+ *  compiled for each row.
+ */
+void TestSQLiteRegExp::compatibility()
+{
+  QFETCH(QString, pattern);
+
+  int expected = 0;
+  foreach (const QString &title, titles_) {
+    if (matches(pattern, title))
+      ++expected;
+  }
+
+  QString sql = "SELECT count(*) FROM news WHERE title REGEXP ?";
+  QCOMPARE(count(sql, pattern), expected);
+  // Second statement takes pattern from process cache
+  QCOMPARE(count(sql, pattern), expected);
+}
+
+/** Pattern changes from row to row, auxiliary data must not be reused */
+void TestSQLiteRegExp::patternPerRow()
+{
+  sqlite3_exec(db_, "CREATE TABLE filters(pattern TEXT, title TEXT)", 0, 0, 0);
+  sqlite3_exec(db_, "INSERT INTO filters VALUES ('^linux', 'Linux release')", 0, 0, 0);
+  sqlite3_exec(db_, "INSERT INTO filters VALUES ('^linux', 'Kernel release')", 0, 0, 0);
+  sqlite3_exec(db_, "INSERT INTO filters VALUES ('release$', 'Kernel release')", 0, 0, 0);
+  sqlite3_exec(db_, "INSERT INTO filters VALUES ('^kernel', 'Linux release')", 0, 0, 0);
+  sqlite3_exec(db_, "INSERT INTO filters VALUES ('^linux', 'linux kernel')", 0, 0, 0);
+
+  QCOMPARE(count("SELECT count(*) FROM filters WHERE title REGEXP pattern"), 3);
+  sqlite3_exec(db_, "DROP TABLE filters", 0, 0, 0);
+}
+
+void TestSQLiteRegExp::benchmarkRegexp_data()
+{
+  QTest::addColumn<QString>("pattern");
+
+  QTest::newRow("literal") << "kernel";
+  QTest::newRow("alternation") << "(football|festival) court";
+  QTest::newRow("class") << "[a-f]+ \\d{3}$";
+}
+
+void TestSQLiteRegExp::benchmarkRegexp()
+{
+  QFETCH(QString, pattern);
+
+  int found = 0;
+  QBENCHMARK_ONCE {
+    found = count("SELECT count(*) FROM news WHERE title REGEXP ?", pattern);
+  }
+  qDebug() << "rows:" << titles_.count() << "found:" << found;
+}
+
+/** Baseline: pattern compiled for every row, as REGEXP did before */
+void TestSQLiteRegExp::benchmarkCompilePerRow()
+{
+  int found = 0;
+  QBENCHMARK_ONCE {
+    foreach (const QString &title, titles_) {
+      if (matches("(football|festival) court", title))
+        ++found;
+    }
+  }
+  qDebug() << "rows:" << titles_.count() << "found:" << found;
+}
+
+QTEST_MAIN(TestSQLiteRegExp)
+#include "tst_sqliteregexp.moc"
@@ -0,0 +1,20 @@
+# Common settings of unit tests, sources are taken from ../src
+isEqual(QT_MAJOR_VERSION, 5) {
+  QT += testlib
+  DEFINES += HAVE_QT5
+} else {
+  CONFIG += qtestlib
+}
+
+TEMPLATE = app
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+SRC_DIR = $$PWD/../src
+INCLUDEPATH += $$SRC_DIR
+
+include($$PWD/../3rdparty/qupzilla/qupzilla.pri)
+
+contains(QT, network) {
+  include($$PWD/common/common.pri)
+}
@@ -0,0 +1,23 @@
+# Unit tests and benchmarks of self-contained components.
+# Build and run: qmake && make && make check
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    adblockmatcher \
+    adblocksearchtree \
+    ahocorasick \
+    categorycounts \
+    downloadrange \
+    faviconobject \
+    feedarchive \
+    feedsproxymodel \
+    hostthrottle \
+    imageprefetcher \
+    networkdiskcache \
+    replytimeouts \
+    requestfeed \
+    sqliteregexp \
+    updatepipeline \
+    userfilters \
+    websubrequest \
+    websubserver
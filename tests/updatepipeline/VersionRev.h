@@ -0,0 +1,2 @@
+// Stand-in of revision file generated by qmake of application
+#define VCS_REVISION "0"
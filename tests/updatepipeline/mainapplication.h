@@ -0,0 +1,59 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#ifndef MAINAPPLICATION_H
+#define MAINAPPLICATION_H
+
+#define mainApp MainApplication::getInstance()
+
+#include "mainwindow.h"
+
+/*! \brief Stand-in of application for test of update pipeline.
+ *
+ * ParseObject and Database take only database file, data directory and
+ * news settings of main window from application.
+ */
+class MainApplication
+{
+public:
+  MainApplication() : mainWindow_(0) {}
+
+  static MainApplication *getInstance();
+
+  QString dataDir() const { return QDir::tempPath(); }
+  QString dbFileName() const { return dbFileName_; }
+  void setDbFileName(const QString &fileName) { dbFileName_ = fileName; }
+  bool storeDBMemory() const { return false; }
+  bool dbFileExists() const { return false; }
+  bool isNoDebugOutput() const { return true; }
+  bool isSaveDataLastFeed() const { return false; }
+
+  // Window lives until the end of test
+  MainWindow *mainWindow()
+  {
+    if (!mainWindow_)
+      mainWindow_ = new MainWindow;
+    return mainWindow_;
+  }
+
+private:
+  QString dbFileName_;
+  MainWindow *mainWindow_;
+
+};
+
+#endif // MAINAPPLICATION_H
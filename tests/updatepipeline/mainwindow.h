@@ -0,0 +1,49 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#ifndef MAINWINDOW_H
+#define MAINWINDOW_H
+
+#ifdef HAVE_QT5
+#include <QtWidgets>
+#else
+#include <QtGui>
+#endif
+
+/*! \brief Stand-in of main window with news settings used by ParseObject */
+class MainWindow : public QWidget
+{
+public:
+  MainWindow()
+    : markIdenticalNewsRead_(true)
+    , avoidOldNews_(false)
+  {}
+
+  static QStringList nameLabels() {
+    QStringList nameLabels;
+    nameLabels << "Important" << "Work" << "Personal"
+               << "To Do" << "Later" << "Amusingly";
+    return nameLabels;
+  }
+
+  bool markIdenticalNewsRead_;
+  bool avoidOldNews_;
+  QDate avoidedOldNewsDate_;
+
+};
+
+#endif // MAINWINDOW_H
@@ -0,0 +1,396 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include <QtTest>
+#include <QtNetwork>
+#include <QtSql>
+
+#include "database.h"
+#include "feedarchive.h"
+#include "globals.h"
+#include "mainapplication.h"
+#include "networkmanager.h"
+#include "parseobject.h"
+#include "requestfeed.h"
+#include "settings.h"
+#include "stubhttpserver.h"
+
+#define FEEDS_COUNT 20
+#define NEWS_COUNT 20
+#define SLOW_PARTS 10
+#define SLOW_PART_DELAY 20
+
+// Pipeline is linked without application, the test gives its own globals
+// and network manager which answers from archive in replay mode
+Globals globals;
+
+Globals::Globals()
+  : logFileOutput_(false)
+  , noDebugOutput_(false)
+  , isInit_(false)
+  , isPortable_(false)
+{
+}
+
+MainApplication *MainApplication::getInstance()
+{
+  static MainApplication application;
+  return &application;
+}
+
+NetworkManager::NetworkManager(bool, QObject *parent)
+  : QNetworkAccessManager(parent)
+  , ignoreAllWarnings_(false)
+  , adblockManager_(0)
+  , feedArchive_(0)
+  , imagePrefetcher_(0)
+{
+}
+
+NetworkManager::~NetworkManager()
+{
+}
+
+QNetworkReply *NetworkManager::createRequest(QNetworkAccessManager::Operation op,
+                                             const QNetworkRequest &request,
+                                             QIODevice *outgoingData)
+{
+  if (feedArchive_ && (feedArchive_->mode() == FeedArchive::ModeReplay))
+    return feedArchive_->replay(op, request, this);
+  return QNetworkAccessManager::createRequest(op, request, outgoingData);
+}
+
+void NetworkManager::slotAuthentication(QNetworkReply *, QAuthenticator *)
+{
+}
+
+void NetworkManager::slotProxyAuthentication(const QNetworkProxy &, QAuthenticator *)
+{
+}
+
+void NetworkManager::slotSslError(QNetworkReply *, QList<QSslError>)
+{
+}
+
+/*! \brief HTTP server on localhost with RSS feeds "/feed1", "/feed2" and so on
+ *
+ * Feeds "/slow/feed1" and so on are sent in parts with delay between them,
+ * as slow server does it.
+ */
+class FeedServer : public StubHttpServer
+{
+  Q_OBJECT
+public:
+  FeedServer() : requests_(0) {}
+
+  int requests() const { return requests_; }
+
+protected:
+  void respond(QTcpSocket *socket, const QByteArray &request)
+  {
+    ++requests_;
+    QByteArray path = StubHttpServer::path(request);
+    bool slow = path.startsWith("/slow/");
+    QByteArray feed = path.mid(slow ? 10 : 5);
+    QByteArray body = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<rss version=\"2.0\"><channel><title>Feed " + feed + "</title>"
+        "<link>http://example.com/" + feed + "</link>"
+        "<description>Feed of update pipeline test</description>";
+    for (int i = 0; i < NEWS_COUNT; ++i) {
+      QByteArray news = feed + "-" + QByteArray::number(i);
+      body += "<item><title>News " + news + "</title>"
+          "<link>http://example.com/" + news + "</link>"
+          "<guid>" + news + "</guid>"
+          "<pubDate>Mon, 19 Oct 2026 10:" + QByteArray::number(10 + i) + ":00 GMT</pubDate>"
+          "<description>" + QByteArray("Text of news. ").repeated(50) + "</description>"
+          "</item>";
+    }
+    body += "</channel></rss>";
+
+    socket->write("HTTP/1.1 200 OK\r\nContent-Type: application/rss+xml\r\n"
+                  "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                  "Connection: close\r\n\r\n");
+    if (!slow) {
+      socket->write(body);
+      socket->disconnectFromHost();
+      return;
+    }
+
+    socket->setProperty("body", body);
+    QTimer *timer = new QTimer(socket);
+    connect(timer, SIGNAL(timeout()), this, SLOT(slotWritePart()));
+    timer->start(SLOW_PART_DELAY);
+  }
+
+private slots:
+  void slotWritePart()
+  {
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender()->parent());
+    QByteArray body = socket->property("body").toByteArray();
+    int size = body.size() / SLOW_PARTS + 1;
+    socket->write(body.left(size));
+    socket->setProperty("body", body.mid(size));
+    if (body.size() <= size) {
+      qobject_cast<QTimer*>(sender())->stop();
+      socket->disconnectFromHost();
+    }
+  }
+
+private:
+  int requests_;
+
+};
+
+/*! \brief Update of feeds wired as UpdateObject does it.
+ *
+ * RequestFeed gets feeds, ParseObject parses them and commits their news.
+ * Time of every stage is summed over all feeds, time of first news is
+ * counted from start of update.
+ */
+class UpdatePipeline : public QObject
+{
+  Q_OBJECT
+public:
+  explicit UpdatePipeline(FeedArchive *feedArchive)
+    : requestFeed_(30, 6, 2)
+    , pending_(0)
+    , parseTime_(0)
+    , commitTime_(0)
+    , wallTime_(0)
+    , firstNewsTime_(-1)
+  {
+    if (feedArchive)
+      requestFeed_.setFeedArchive(feedArchive);
+    connect(&requestFeed_, SIGNAL(getUrlDone(int,int,QString,QString,QByteArray,QDateTime,QString)),
+            this, SLOT(getUrlDone(int,int,QString,QString,QByteArray,QDateTime,QString)));
+    connect(&requestFeed_, SIGNAL(getUrlData(int,QByteArray,QDateTime,bool)),
+            this, SLOT(getUrlData(int,QByteArray,QDateTime,bool)));
+    connect(&requestFeed_, SIGNAL(getUrlAbort(int)),
+            &parseObject_, SLOT(abortXmlData(int)));
+    connect(&parseObject_, SIGNAL(signalStageTimes(int,int,int)),
+            this, SLOT(slotStageTimes(int,int,int)));
+    connect(&parseObject_, SIGNAL(signalFinishUpdate(int,bool,int,QString)),
+            this, SLOT(finishUpdate(int,bool,int,QString)));
+  }
+
+  void setStreamParsing(bool streamParsing)
+  {
+    requestFeed_.setStreamParsing(streamParsing);
+  }
+
+  bool update(const QStringList &feedUrls)
+  {
+    QSignalSpy spy(&requestFeed_, SIGNAL(connectionStatsReported()));
+    timer_.start();
+    firstNewsTime_ = -1;
+    pending_ = feedUrls.count();
+    for (int i = 0; i < feedUrls.count(); ++i) {
+      requestFeed_.requestUrl(i + 1, feedUrls.at(i), QDateTime());
+    }
+    for (int i = 0; (i < 1200) && (pending_ || spy.isEmpty()); ++i) {
+      QTest::qWait(50);
+    }
+    wallTime_ = timer_.elapsed();
+    return !pending_ && !spy.isEmpty();
+  }
+
+  QString report() const
+  {
+    return QString("fetch %1 ms (sum of requests), parse %2 ms, commit %3 ms, "
+                   "first news %4 ms, update %5 ms").
+        arg(requestFeed_.connectionStats().requestsTime).
+        arg(parseTime_).arg(commitTime_).arg(firstNewsTime_).arg(wallTime_);
+  }
+
+private slots:
+  void getUrlDone(int, int feedId, QString, QString, QByteArray data,
+                  QDateTime dtReply, QString codecName)
+  {
+    if (!data.isEmpty()) {
+      parseObject_.parseXml(data, feedId, dtReply, codecName);
+      checkFirstNews();
+    } else {
+      --pending_;
+    }
+  }
+
+  void getUrlData(int feedId, QByteArray data, QDateTime dtReply, bool finished)
+  {
+    parseObject_.parseXmlData(data, feedId, dtReply, finished);
+    checkFirstNews();
+  }
+
+  void slotStageTimes(int, int parseTime, int commitTime)
+  {
+    parseTime_ += parseTime;
+    commitTime_ += commitTime;
+  }
+
+  void finishUpdate(int, bool, int, QString)
+  {
+    --pending_;
+  }
+
+private:
+  void checkFirstNews()
+  {
+    if (firstNewsTime_ >= 0) return;
+
+    QSqlQuery q;
+    q.exec("SELECT count(*) FROM news");
+    if (q.next() && q.value(0).toInt())
+      firstNewsTime_ = timer_.elapsed();
+  }
+
+  RequestFeed requestFeed_;
+  ParseObject parseObject_;
+  QElapsedTimer timer_;
+  int pending_;
+  int parseTime_;
+  int commitTime_;
+  qint64 wallTime_;
+  qint64 firstNewsTime_;
+
+};
+
+/*! \brief Update of feeds through fetch, parse and commit stages.
+ *
+ * Feeds of local server are recorded to archive once, then update is
+ * replayed from archive without network, so every run gets the same data.
+ */
+class TestUpdatePipeline : public QObject
+{
+  Q_OBJECT
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+  void replay();
+  void benchmarkReplay();
+  void benchmarkStreaming_data();
+  void benchmarkStreaming();
+
+private:
+  static int newsCount();
+
+  FeedServer server_;
+  QStringList feedUrls_;
+  QString fileName_;
+
+};
+
+int TestUpdatePipeline::newsCount()
+{
+  QSqlQuery q;
+  q.exec("SELECT count(*) FROM news");
+  return q.next() ? q.value(0).toInt() : -1;
+}
+
+void TestUpdatePipeline::initTestCase()
+{
+  QVERIFY(server_.listen(QHostAddress::LocalHost));
+  fileName_ = QDir::temp().absoluteFilePath(
+        QString("tst_updatepipeline_%1").arg(QCoreApplication::applicationPid()));
+
+  Settings::createSettings(fileName_ + ".ini");
+  mainApp->setDbFileName(fileName_ + ".db");
+  Database::initialization();
+
+  QSqlQuery q;
+  for (int i = 1; i <= FEEDS_COUNT; ++i) {
+    feedUrls_.append(server_.url(QString("/feed%1").arg(i)).toString());
+    q.prepare("INSERT INTO feeds(id, text, title, xmlUrl) VALUES (?, ?, ?, ?)");
+    q.addBindValue(i);
+    q.addBindValue(QString("Feed %1").arg(i));
+    q.addBindValue(QString("Feed %1").arg(i));
+    q.addBindValue(feedUrls_.last());
+    QVERIFY(q.exec());
+  }
+
+  UpdatePipeline pipeline(new FeedArchive(FeedArchive::ModeRecord, fileName_ + ".dat"));
+  QVERIFY(pipeline.update(feedUrls_));
+  qDebug() << "recorded:" << qPrintable(pipeline.report());
+  QCOMPARE(server_.requests(), FEEDS_COUNT);
+  QCOMPARE(newsCount(), FEEDS_COUNT * NEWS_COUNT);
+  QVERIFY(QFile::exists(fileName_ + ".dat"));
+}
+
+void TestUpdatePipeline::cleanupTestCase()
+{
+  QFile::remove(fileName_ + ".dat");
+  QFile::remove(fileName_ + ".db");
+  QFile::remove(fileName_ + ".ini");
+}
+
+/** Replayed update adds the same news without requests to server */
+void TestUpdatePipeline::replay()
+{
+  QSqlQuery q;
+  QVERIFY(q.exec("DELETE FROM news"));
+
+  UpdatePipeline pipeline(new FeedArchive(FeedArchive::ModeReplay, fileName_ + ".dat"));
+  QVERIFY(pipeline.update(feedUrls_));
+  QCOMPARE(server_.requests(), FEEDS_COUNT);
+  QCOMPARE(newsCount(), FEEDS_COUNT * NEWS_COUNT);
+}
+
+void TestUpdatePipeline::benchmarkReplay()
+{
+  QSqlQuery q;
+  QVERIFY(q.exec("DELETE FROM news"));
+
+  UpdatePipeline pipeline(new FeedArchive(FeedArchive::ModeReplay, fileName_ + ".dat"));
+  bool updated = false;
+  QBENCHMARK_ONCE {
+    updated = pipeline.update(feedUrls_);
+  }
+  QVERIFY(updated);
+  qDebug() << "feeds:" << FEEDS_COUNT << "news:" << newsCount()
+           << qPrintable(pipeline.report());
+}
+
+void TestUpdatePipeline::benchmarkStreaming_data()
+{
+  QTest::addColumn<bool>("streamParsing");
+
+  QTest::newRow("buffered") << false;
+  QTest::newRow("streamed") << true;
+}
+
+/** Feeds of slow server are parsed while downloading or after download */
+void TestUpdatePipeline::benchmarkStreaming()
+{
+  QFETCH(bool, streamParsing);
+
+  QSqlQuery q;
+  QVERIFY(q.exec("DELETE FROM news"));
+  QStringList feedUrls;
+  for (int i = 1; i <= FEEDS_COUNT; ++i)
+    feedUrls.append(server_.url(QString("/slow/feed%1").arg(i)).toString());
+
+  UpdatePipeline pipeline(0);
+  pipeline.setStreamParsing(streamParsing);
+  bool updated = false;
+  QBENCHMARK_ONCE {
+    updated = pipeline.update(feedUrls);
+  }
+  QVERIFY(updated);
+  QCOMPARE(newsCount(), FEEDS_COUNT * NEWS_COUNT);
+  qDebug() << (streamParsing ? "streamed:" : "buffered:") << qPrintable(pipeline.report());
+}
+
+QTEST_MAIN(TestUpdatePipeline)
+#include "tst_updatepipeline.moc"
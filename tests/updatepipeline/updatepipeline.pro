@@ -0,0 +1,49 @@
+TARGET = tst_updatepipeline
+QT += network sql xml
+isEqual(QT_MAJOR_VERSION, 5) {
+  QT += widgets
+}
+
+include(../tests.pri)
+include(../../3rdparty/sqlite.pri)
+
+# Stand-ins of application headers are found first, so ParseObject and
+# Database are built without the application
+INCLUDEPATH = $$PWD $$INCLUDEPATH
+INCLUDEPATH += \
+    $$SRC_DIR/application \
+    $$SRC_DIR/common \
+    $$SRC_DIR/database \
+    $$SRC_DIR/main \
+    $$SRC_DIR/network \
+    $$SRC_DIR/newsfilters
+
+HEADERS += \
+    mainapplication.h \
+    mainwindow.h \
+    $$SRC_DIR/parseobject.h \
+    $$SRC_DIR/requestfeed.h \
+    $$SRC_DIR/application/settings.h \
+    $$SRC_DIR/common/common.h \
+    $$SRC_DIR/database/database.h \
+    $$SRC_DIR/database/newsstateupdater.h \
+    $$SRC_DIR/network/feedarchive.h \
+    $$SRC_DIR/network/hostthrottle.h \
+    $$SRC_DIR/network/networkmanager.h \
+    $$SRC_DIR/network/replytimeouts.h \
+    $$SRC_DIR/newsfilters/ahocorasick.h \
+    $$SRC_DIR/newsfilters/userfilters.h
+
+SOURCES += \
+    tst_updatepipeline.cpp \
+    $$SRC_DIR/parseobject.cpp \
+    $$SRC_DIR/requestfeed.cpp \
+    $$SRC_DIR/application/settings.cpp \
+    $$SRC_DIR/common/common.cpp \
+    $$SRC_DIR/database/database.cpp \
+    $$SRC_DIR/database/newsstateupdater.cpp \
+    $$SRC_DIR/network/feedarchive.cpp \
+    $$SRC_DIR/network/hostthrottle.cpp \
+    $$SRC_DIR/network/replytimeouts.cpp \
+    $$SRC_DIR/newsfilters/ahocorasick.cpp \
+    $$SRC_DIR/newsfilters/userfilters.cpp
@@ -0,0 +1,238 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include <QtTest>
+#include <QtSql>
+
+#include <sqlitedriver.h>
+
+#include "userfilters.h"
+
+/*! \brief Compare UserFilters with SQL that ParseObject::runUserFilter builds.
+ *
+ * Conditions are checked against news of an in-memory database once with
+ * the SQL fragment of runUserFilter and once with compiled filters. The
+ * database is opened with SQLiteDriver of the application, so UPPER and
+ * REGEXP are the same as in runUserFilter.
+ */
+class TestUserFilters : public QObject
+{
+  Q_OBJECT
+private slots:
+  void initTestCase();
+  void sqlParity_data();
+  void sqlParity();
+
+private:
+  static QString sqlCondition(int field, int condition, const QString &content);
+  void setFilter(int field, int condition, const QString &content);
+  QSet<int> matchSql(int field, int condition, const QString &content);
+  QSet<int> matchCompiled();
+
+  QSqlDatabase db_;
+
+};
+
+void TestUserFilters::initTestCase()
+{
+  db_ = QSqlDatabase::addDatabase(new SQLiteDriver());
+  db_.setDatabaseName(":memory:");
+  QVERIFY(db_.open());
+
+  QSqlQuery q(db_);
+  QVERIFY(q.exec("CREATE TABLE filters(id integer primary key, "
+                 "name text, type integer, feeds text, enable integer, num integer)"));
+  QVERIFY(q.exec("CREATE TABLE filterConditions(id integer primary key, "
+                 "idFilter integer, field text, condition text, content text)"));
+  QVERIFY(q.exec("CREATE TABLE filterActions(id integer primary key, "
+                 "idFilter integer, action text, params text)"));
+  QVERIFY(q.exec("CREATE TABLE news(id integer primary key, feedId integer, "
+                 "title text, description text, author_name text, "
+                 "category text, link_href text)"));
+
+  q.prepare("INSERT INTO news(feedId, title, description, author_name, category, link_href) "
+            "VALUES (1, ?, ?, ?, ?, ?)");
+  const char *rows[][5] = {
+    { "Qt 5.15 released", "Weekly news about Qt", "John Smith", "Software", "http://example.com/qt" },
+    { "QT_5 50% OFF", "Sale", "SMITH", "Shop", "https://Example.com/Sale" },
+    { "Linux kernel", "", 0, "software/kernel", "http://kernel.org/" },
+    { "weekly digest", 0, "jane", 0, "http://example.org/weekly" },
+    { "\xd0\xbf\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82 world",
+      "\xd0\x9d\xd0\xbe\xd0\xb2\xd0\xbe\xd1\x81\xd1\x82\xd0\xb8 \xd0\xb4\xd0\xbd\xd1\x8f",
+      "\xc3\x89mile", "Soci\xc3\xa9t\xc3\xa9", "http://example.ru/" }
+  };
+  for (unsigned i = 0; i < sizeof(rows) / sizeof(rows[0]); ++i) {
+    for (int j = 0; j < 5; ++j) {
+      q.addBindValue(rows[i][j] ? QVariant(QString::fromUtf8(rows[i][j])) :
+                                  QVariant(QVariant::String));
+    }
+    QVERIFY(q.exec());
+  }
+}
+
+void TestUserFilters::sqlParity_data()
+{
+  QTest::addColumn<int>("field");
+  QTest::addColumn<int>("condition");
+  QTest::addColumn<QString>("content");
+
+  QTest::newRow("title contains") << 0 << 0 << "qt";
+  QTest::newRow("title not contains") << 0 << 1 << "QT";
+  QTest::newRow("title is") << 0 << 2 << "linux KERNEL";
+  QTest::newRow("title is not") << 0 << 3 << "linux kernel";
+  QTest::newRow("title begins") << 0 << 4 << "qt";
+  QTest::newRow("title ends") << 0 << 5 << "Released";
+  QTest::newRow("title underscore") << 0 << 0 << "t_5";
+  QTest::newRow("title percent") << 0 << 4 << "qt%off";
+  QTest::newRow("description contains") << 1 << 0 << "WEEKLY";
+  QTest::newRow("description not contains") << 1 << 1 << "sale";
+  QTest::newRow("author contains") << 2 << 0 << "smith";
+  QTest::newRow("author not contains") << 2 << 1 << "smith";
+  QTest::newRow("author is") << 2 << 2 << "john smith";
+  QTest::newRow("category begins") << 3 << 4 << "software";
+  QTest::newRow("category ends") << 3 << 5 << "KERNEL";
+  QTest::newRow("link contains") << 5 << 0 << "EXAMPLE.com";
+  QTest::newRow("link begins") << 5 << 4 << "https";
+  QTest::newRow("link is not") << 5 << 3 << "http://kernel.org/";
+  QTest::newRow("news contains") << 6 << 0 << "weekly";
+  QTest::newRow("news not contains") << 6 << 1 << "qt";
+  QTest::newRow("title cyrillic") << 0 << 0
+                                  << QString::fromUtf8("\xd0\x9f\xd0\xa0\xd0\x98\xd0\x92\xd0\x95\xd0\xa2");
+  QTest::newRow("news cyrillic") << 6 << 0
+                                 << QString::fromUtf8("\xd0\xbd\xd0\x9e\xd0\x92\xd0\xbe\xd1\x81\xd0\xa2\xd0\xb8");
+  QTest::newRow("author accented") << 2 << 2 << QString::fromUtf8("\xc3\xa9MILE");
+  QTest::newRow("category accented ends") << 3 << 5 << QString::fromUtf8("\xc3\x89T\xc3\x89");
+  QTest::newRow("title regexp") << 0 << 6 << "^qt[ _]5";
+  QTest::newRow("description regexp") << 1 << 2 << "news|sale";
+  QTest::newRow("author regexp") << 2 << 4 << "smith$";
+  QTest::newRow("category regexp") << 3 << 6 << "^soft";
+  QTest::newRow("link regexp") << 5 << 6 << "\\.org/";
+  QTest::newRow("news regexp") << 6 << 2 << "WEEKLY|kernel";
+}
+
+void TestUserFilters::sqlParity()
+{
+  QFETCH(int, field);
+  QFETCH(int, condition);
+  QFETCH(QString, content);
+
+  setFilter(field, condition, content);
+  QCOMPARE(matchCompiled(), matchSql(field, condition, content));
+}
+
+/** Copy of conditions generated by ParseObject::runUserFilter */
+QString TestUserFilters::sqlCondition(int field, int condition, const QString &content)
+{
+  static const char *columns[] = {
+    "title", "description", "author_name", "category", 0, "link_href"
+  };
+  // Number of regExp condition differs between fields
+  static const int regExpConditions[] = { 6, 2, 4, 6, -1, 6, 2 };
+  QString value = content;
+  value.replace("'", "''");
+
+  if (condition == regExpConditions[field]) {
+    if (field == 6)
+      return QString("(title REGEXP '%1' OR description REGEXP '%1')").arg(value);
+    return QString("%1 REGEXP '%2'").arg(QString::fromLatin1(columns[field]), value);
+  }
+
+  if (field == 6) {
+    QString upper = value.toUpper();
+    if (condition == 0)
+      return QString("(UPPER(title) LIKE '%%1%' OR UPPER(description) LIKE '%%1%')").arg(upper);
+    return QString("(UPPER(title) NOT LIKE '%%1%' OR UPPER(description) NOT LIKE '%%1%')").arg(upper);
+  }
+
+  QString column = columns[field];
+  if (field != 5) {
+    column = QString("UPPER(%1)").arg(column);
+    value = value.toUpper();
+  }
+  // Description and author have no "begins with"/"ends with"
+  switch (condition) {
+  case 0: return QString("%1 LIKE '%%2%'").arg(column, value);
+  case 1: return QString("%1 NOT LIKE '%%2%'").arg(column, value);
+  case 2: return QString("%1 LIKE '%2'").arg(column, value);
+  case 3: return QString("%1 NOT LIKE '%2'").arg(column, value);
+  case 4: return QString("%1 LIKE '%2%'").arg(column, value);
+  case 5: return QString("%1 LIKE '%%2'").arg(column, value);
+  }
+  return QString();
+}
+
+void TestUserFilters::setFilter(int field, int condition, const QString &content)
+{
+  QSqlQuery q(db_);
+  q.exec("DELETE FROM filters");
+  q.exec("DELETE FROM filterConditions");
+  q.exec("DELETE FROM filterActions");
+  q.exec("INSERT INTO filters(id, name, type, feeds, enable, num) "
+         "VALUES (1, 'test', 1, ',1,', 1, 1)");
+  q.exec("INSERT INTO filterActions(idFilter, action, params) VALUES (1, 0, '')");
+  q.prepare("INSERT INTO filterConditions(idFilter, field, condition, content) "
+            "VALUES (1, ?, ?, ?)");
+  q.addBindValue(field);
+  q.addBindValue(condition);
+  q.addBindValue(content);
+  q.exec();
+}
+
+QSet<int> TestUserFilters::matchSql(int field, int condition, const QString &content)
+{
+  QSet<int> ids;
+  QSqlQuery q(db_);
+  if (!q.exec(QString("SELECT id FROM news WHERE feedId=1 AND (%1)").
+              arg(sqlCondition(field, condition, content)))) {
+    qWarning() << q.lastError().text();
+  }
+  while (q.next()) {
+    ids.insert(q.value(0).toInt());
+  }
+  return ids;
+}
+
+QSet<int> TestUserFilters::matchCompiled()
+{
+  UserFilters filters;
+  filters.compile(db_);
+
+  QSet<int> ids;
+  QSqlQuery q(db_);
+  q.exec("SELECT id, title, description, author_name, category, link_href FROM news");
+  while (q.next()) {
+    UserFilterNews news;
+    news.title = q.value(1).toString();
+    news.description = q.value(2).toString();
+    news.authorName = q.value(3).toString();
+    news.category = q.value(4).toString();
+    news.link = q.value(5).toString();
+    news.newState = 1;
+    news.read = 0;
+    news.starred = 0;
+    news.deleted = 0;
+
+    QStringList sounds;
+    QStringList colors;
+    if (filters.apply(1, &news, &sounds, &colors))
+      ids.insert(q.value(0).toInt());
+  }
+  return ids;
+}
+
+QTEST_MAIN(TestUserFilters)
+#include "tst_userfilters.moc"
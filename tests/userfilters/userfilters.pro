@@ -0,0 +1,16 @@
+TARGET = tst_userfilters
+QT += sql
+
+include(../tests.pri)
+include(../../3rdparty/sqlite.pri)
+
+INCLUDEPATH += $$SRC_DIR/newsfilters
+
+HEADERS += \
+    $$SRC_DIR/newsfilters/ahocorasick.h \
+    $$SRC_DIR/newsfilters/userfilters.h
+
+SOURCES += \
+    tst_userfilters.cpp \
+    $$SRC_DIR/newsfilters/ahocorasick.cpp \
+    $$SRC_DIR/newsfilters/userfilters.cpp
@@ -0,0 +1,175 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include <QtTest>
+
+#include "websubrequest.h"
+
+class TestWebSubRequest : public QObject
+{
+  Q_OBJECT
+private slots:
+  void append_data();
+  void append();
+  void partialData();
+  void parseQuery();
+  void hmac_data();
+  void hmac();
+  void signature_data();
+  void signature();
+
+};
+
+void TestWebSubRequest::append_data()
+{
+  QTest::addColumn<QByteArray>("data");
+  QTest::addColumn<int>("code");
+
+  QTest::newRow("get") << QByteArray("GET /websub/1?hub.mode=subscribe HTTP/1.1\r\n"
+                                     "Host: localhost\r\n\r\n") << 200;
+  QTest::newRow("post") << QByteArray("POST /websub/1 HTTP/1.1\r\n"
+                                      "Content-Length: 7\r\n\r\n<feed/>") << 200;
+  QTest::newRow("header incomplete") << QByteArray("GET /websub/1 HTTP/1.1\r\n") << 0;
+  QTest::newRow("content incomplete") << QByteArray("POST /websub/1 HTTP/1.1\r\n"
+                                                    "Content-Length: 8\r\n\r\n<feed/>") << 0;
+  QTest::newRow("no version") << QByteArray("GET /websub/1\r\n\r\n") << 400;
+  QTest::newRow("bad header") << QByteArray("GET /websub/1 HTTP/1.1\r\n"
+                                            "Host\r\n\r\n") << 400;
+  QTest::newRow("bad length") << QByteArray("POST /websub/1 HTTP/1.1\r\n"
+                                            "Content-Length: -1\r\n\r\n") << 400;
+  QTest::newRow("large content") << QByteArray("POST /websub/1 HTTP/1.1\r\n"
+                                               "Content-Length: 20000000\r\n\r\n") << 413;
+  QTest::newRow("large header") << QByteArray("GET /websub/1 HTTP/1.1\r\nX: ") +
+                                   QByteArray(70000, 'x') << 431;
+}
+
+void TestWebSubRequest::append()
+{
+  QFETCH(QByteArray, data);
+  QFETCH(int, code);
+
+  WebSubRequest request;
+  QCOMPARE(request.append(data), code);
+}
+
+/** Request is complete only when its last byte arrives */
+void TestWebSubRequest::partialData()
+{
+  QByteArray data("POST /websub/12?a=b HTTP/1.1\r\n"
+                  "Content-Type: application/atom+xml; charset=\"windows-1251\"\r\n"
+                  "Content-Length: 7\r\n\r\n<feed/>");
+
+  WebSubRequest request;
+  for (int i = 0; i < data.size() - 1; ++i)
+    QCOMPARE(request.append(data.mid(i, 1)), 0);
+  QCOMPARE(request.append(data.right(1)), 200);
+
+  QCOMPARE(request.method(), QString("POST"));
+  QCOMPARE(request.path(), QString("/websub/12"));
+  QCOMPARE(request.query(), QString("a=b"));
+  QVERIFY(request.hasHeader("content-type"));
+  QCOMPARE(request.content(), QByteArray("<feed/>"));
+  QCOMPARE(request.codecName(), QString("windows-1251"));
+}
+
+void TestWebSubRequest::parseQuery()
+{
+  QHash<QString, QString> params = WebSubRequest::parseQuery(
+        "hub.mode=subscribe&hub.topic=http%3A%2F%2Fexample.com%2Ffeed%3Fa%3D1"
+        "&hub.challenge=a+b&&hub.lease_seconds");
+  QCOMPARE(params.count(), 4);
+  QCOMPARE(params.value("hub.mode"), QString("subscribe"));
+  QCOMPARE(params.value("hub.topic"), QString("http://example.com/feed?a=1"));
+  QCOMPARE(params.value("hub.challenge"), QString("a b"));
+  QVERIFY(params.contains("hub.lease_seconds"));
+}
+
+void TestWebSubRequest::hmac_data()
+{
+  QTest::addColumn<int>("algorithm");
+  QTest::addColumn<QByteArray>("key");
+  QTest::addColumn<QByteArray>("message");
+  QTest::addColumn<QByteArray>("digest");
+
+  // RFC 2202 and RFC 4231
+  QTest::newRow("sha1") << int(QCryptographicHash::Sha1) << QByteArray("Jefe")
+                        << QByteArray("what do ya want for nothing?")
+                        << QByteArray("effcdf6ae5eb2fa2d27416d5f184df9c259a7c79");
+  QTest::newRow("sha1 long key") << int(QCryptographicHash::Sha1) << QByteArray(80, '\xaa')
+                                 << QByteArray("Test Using Larger Than Block-Size Key - Hash Key First")
+                                 << QByteArray("aa4ae5e15272d00e95705637ce8a3b55ed402112");
+#ifdef HAVE_QT5
+  QTest::newRow("sha256") << int(QCryptographicHash::Sha256) << QByteArray("Jefe")
+                          << QByteArray("what do ya want for nothing?")
+                          << QByteArray("5bdcc146bf60754e6a042426089575c7"
+                                        "5a003f089d2739839dec58b964ec3843");
+#endif
+}
+
+void TestWebSubRequest::hmac()
+{
+  QFETCH(int, algorithm);
+  QFETCH(QByteArray, key);
+  QFETCH(QByteArray, message);
+  QFETCH(QByteArray, digest);
+
+  QCOMPARE(WebSubRequest::hmac(QCryptographicHash::Algorithm(algorithm), key, message).toHex(),
+           digest);
+}
+
+void TestWebSubRequest::signature_data()
+{
+  QTest::addColumn<QString>("secret");
+  QTest::addColumn<QByteArray>("signature");
+  QTest::addColumn<bool>("valid");
+
+  QByteArray sha1("f38e73e7d772790d36ded9be19b36748b2a27335");
+  QTest::newRow("sha1") << "secret" << "sha1=" + sha1 << true;
+  QTest::newRow("upper case") << "secret" << "sha1=" + sha1.toUpper() << true;
+  QTest::newRow("other secret") << "secret2" << "sha1=" + sha1 << false;
+  QTest::newRow("changed") << "secret" << "sha1=" + sha1.left(39) + "6" << false;
+  QTest::newRow("short") << "secret" << "sha1=" + sha1.left(20) << false;
+  QTest::newRow("unknown method") << "secret" << "md5=" + sha1 << false;
+  QTest::newRow("no method") << "secret" << sha1 << false;
+  QTest::newRow("unsigned") << "secret" << QByteArray() << false;
+  QTest::newRow("no secret") << "" << "sha1=" + sha1 << false;
+#ifdef HAVE_QT5
+  QTest::newRow("sha512") << "secret"
+                          << QByteArray("sha512=384ccd8dbbe4e9af2519c641f8c9da094d600f81617283772712527e6484"
+                                        "1de36bb901fbb336a95fe96811d03de0c574537044d4bdcfc9559aa97e4eec5f8c7a")
+                          << true;
+#endif
+}
+
+void TestWebSubRequest::signature()
+{
+  QFETCH(QString, secret);
+  QFETCH(QByteArray, signature);
+  QFETCH(bool, valid);
+
+  QByteArray data("POST /websub/1 HTTP/1.1\r\n");
+  if (!signature.isEmpty())
+    data.append("X-Hub-Signature: " + signature + "\r\n");
+  data.append("Content-Length: 7\r\n\r\n<feed/>");
+
+  WebSubRequest request;
+  QCOMPARE(request.append(data), 200);
+  QCOMPARE(request.verifySignature(secret), valid);
+}
+
+QTEST_MAIN(TestWebSubRequest)
+#include "tst_websubrequest.moc"
@@ -0,0 +1,12 @@
+TARGET = tst_websubrequest
+
+include(../tests.pri)
+
+INCLUDEPATH += $$SRC_DIR/network
+
+HEADERS += \
+    $$SRC_DIR/network/websubrequest.h
+
+SOURCES += \
+    tst_websubrequest.cpp \
+    $$SRC_DIR/network/websubrequest.cpp
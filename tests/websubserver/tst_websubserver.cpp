@@ -0,0 +1,339 @@
+/* ============================================================
+* QuiteRSS is a open-source cross-platform RSS/Atom news feeds reader
+* Copyright (C) 2011-2020 QuiteRSS Team <quiterssteam@gmail.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+* ============================================================ */
+#include <QtTest>
+#include <QtNetwork>
+#include <QtSql>
+
+#include "database.h"
+#include "globals.h"
+#include "networkmanager.h"
+#include "stubhttpserver.h"
+#include "websubrequest.h"
+#include "websubserver.h"
+
+// WebSubServer is linked without application, database and network
+// manager, the test gives its own in-memory database and plain manager
+Globals globals;
+
+Globals::Globals()
+  : logFileOutput_(false)
+  , noDebugOutput_(false)
+  , isInit_(false)
+  , isPortable_(false)
+{
+}
+
+QSqlDatabase Database::connection(const QString &)
+{
+  return QSqlDatabase::database();
+}
+
+NetworkManager::NetworkManager(bool, QObject *parent)
+  : QNetworkAccessManager(parent)
+  , ignoreAllWarnings_(true)
+  , adblockManager_(0)
+  , feedArchive_(0)
+  , imagePrefetcher_(0)
+{
+  connect(this, SIGNAL(sslErrors(QNetworkReply*,QList<QSslError>)),
+          this, SLOT(slotSslError(QNetworkReply*,QList<QSslError>)));
+}
+
+NetworkManager::~NetworkManager()
+{
+}
+
+QNetworkReply *NetworkManager::createRequest(QNetworkAccessManager::Operation op,
+                                             const QNetworkRequest &request,
+                                             QIODevice *outgoingData)
+{
+  return QNetworkAccessManager::createRequest(op, request, outgoingData);
+}
+
+void NetworkManager::slotAuthentication(QNetworkReply *, QAuthenticator *)
+{
+}
+
+void NetworkManager::slotProxyAuthentication(const QNetworkProxy &, QAuthenticator *)
+{
+}
+
+// Hub certificate is self-signed
+void NetworkManager::slotSslError(QNetworkReply *reply, QList<QSslError>)
+{
+  reply->ignoreSslErrors();
+}
+
+/*! \brief Stand-in WebSub hub.
+ *
+ * Accepts (un)subscription requests on "/hub" and verifies intent of
+ * subscriber at its callback right after. "/feed" is the topic, every
+ * request of it is counted as poll.
+ */
+class HubServer : public StubHttpServer
+{
+  Q_OBJECT
+public:
+  HubServer() : polls_(0) {}
+
+  QHash<QString, QString> params() const { return params_; }
+  int polls() const { return polls_; }
+
+signals:
+  void verified(bool ok);
+
+protected:
+  void respond(QTcpSocket *socket, const QByteArray &request)
+  {
+    QByteArray path = StubHttpServer::path(request);
+    if ((method(request) == "POST") && (path == "/hub")) {
+      params_ = WebSubRequest::parseQuery(QString::fromLatin1(body(request)));
+      socket->write("HTTP/1.1 202 Accepted\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+      QTimer::singleShot(0, this, SLOT(verifyIntent()));
+    } else if (path == "/feed") {
+      ++polls_;
+      socket->write("HTTP/1.1 200 OK\r\nContent-Length: 5\r\nConnection: close\r\n\r\n<rss>");
+    } else {
+      socket->write("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+    }
+    socket->disconnectFromHost();
+  }
+
+private slots:
+  void verifyIntent()
+  {
+    QByteArray query = "hub.mode=" + QUrl::toPercentEncoding(params_.value("hub.mode")) +
+        "&hub.topic=" + QUrl::toPercentEncoding(params_.value("hub.topic")) +
+        "&hub.challenge=challenge42&hub.lease_seconds=3600";
+    QUrl callback = QUrl::fromEncoded(params_.value("hub.callback").toLatin1() + "?" + query);
+    QNetworkReply *reply = manager_.get(QNetworkRequest(callback));
+    connect(reply, SIGNAL(finished()), this, SLOT(slotVerifyFinished()));
+  }
+
+  void slotVerifyFinished()
+  {
+    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+    reply->deleteLater();
+    emit verified(reply->readAll() == "challenge42");
+  }
+
+private:
+  QNetworkAccessManager manager_;
+  QHash<QString, QString> params_;
+  int polls_;
+
+};
+
+/*! \brief Subscription and push through WebSubServer end to end.
+ *
+ * Feed 1 is subscribed at hub over HTTPS, so it gets secret and content
+ * pushed with signature is passed to parsing. Feed 2 is subscribed at hub
+ * over HTTP and its pushes only notify of update.
+ */
+class TestWebSubServer : public QObject
+{
+  Q_OBJECT
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+  void signedPush();
+  void deniedWithoutRequest();
+  void unsignedPushNotifies();
+
+private:
+  static bool waitFor(const QSignalSpy &spy, int count);
+  bool subscribe(int feedId, HubServer *hub);
+  int post(int feedId, const QByteArray &content, const QByteArray &signature);
+  int get(int feedId, const QByteArray &query);
+  bool isPolled(int feedId);
+  QUrl callbackUrl(int feedId) const;
+
+  HubServer httpsHub_;
+  HubServer httpHub_;
+  WebSubServer *server_;
+  int port_;
+  QNetworkAccessManager manager_;
+
+};
+
+bool TestWebSubServer::waitFor(const QSignalSpy &spy, int count)
+{
+  for (int i = 0; (i < 50) && (spy.count() < count); ++i) {
+    QTest::qWait(100);
+  }
+  return spy.count() >= count;
+}
+
+void TestWebSubServer::initTestCase()
+{
+  QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE");
+  db.setDatabaseName(":memory:");
+  QVERIFY(db.open());
+
+  QSqlQuery q(db);
+  QVERIFY(q.exec("CREATE TABLE feeds(id integer primary key, xmlUrl text, "
+                 "disableUpdate integer default 0, updated text)"));
+  QVERIFY(q.exec("CREATE TABLE feeds_ex(id integer primary key, feedId integer, "
+                 "name text, value text)"));
+
+  QFile certificateFile(":/hub.crt");
+  QFile keyFile(":/hub.key");
+  QVERIFY(certificateFile.open(QFile::ReadOnly) && keyFile.open(QFile::ReadOnly));
+  httpsHub_.setCertificate(QSslCertificate(certificateFile.readAll()),
+                           QSslKey(keyFile.readAll(), QSsl::Rsa));
+  QVERIFY(httpsHub_.listen(QHostAddress::LocalHost));
+  QVERIFY(httpHub_.listen(QHostAddress::LocalHost));
+
+  // Callback address has to be known before the server starts
+  QTcpServer freePort;
+  QVERIFY(freePort.listen(QHostAddress::LocalHost));
+  port_ = freePort.serverPort();
+  freePort.close();
+
+  QString updated = QDateTime::currentDateTimeUtc().toString("yyyy-MM-ddTHH:mm:ss");
+  q.prepare("INSERT INTO feeds(id, xmlUrl, updated) VALUES (?, ?, ?)");
+  q.addBindValue(QVariantList() << 1 << 2);
+  q.addBindValue(QVariantList() << httpsHub_.url("/feed").toString()
+                                << httpHub_.url("/feed").toString());
+  q.addBindValue(QVariantList() << updated << updated);
+  QVERIFY(q.execBatch());
+
+  server_ = new WebSubServer("127.0.0.1", port_, QString("http://127.0.0.1:%1/").arg(port_));
+  server_->start();
+}
+
+void TestWebSubServer::cleanupTestCase()
+{
+  delete server_;
+}
+
+QUrl TestWebSubServer::callbackUrl(int feedId) const
+{
+  return QUrl(QString("http://127.0.0.1:%1/websub/%2").arg(port_).arg(feedId));
+}
+
+bool TestWebSubServer::subscribe(int feedId, HubServer *hub)
+{
+  QSignalSpy spy(hub, SIGNAL(verified(bool)));
+  server_->slotHubFound(feedId, hub->url("/hub").toString(), hub->url("/feed").toString());
+  return waitFor(spy, 1) && spy.at(0).at(0).toBool();
+}
+
+int TestWebSubServer::post(int feedId, const QByteArray &content, const QByteArray &signature)
+{
+  QNetworkRequest request(callbackUrl(feedId));
+  request.setHeader(QNetworkRequest::ContentTypeHeader, "application/rss+xml; charset=utf-8");
+  if (!signature.isEmpty())
+    request.setRawHeader("X-Hub-Signature", signature);
+
+  QScopedPointer<QNetworkReply> reply(manager_.post(request, content));
+  QEventLoop loop;
+  connect(reply.data(), SIGNAL(finished()), &loop, SLOT(quit()));
+  QTimer::singleShot(5000, &loop, SLOT(quit()));
+  loop.exec();
+  return reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+}
+
+int TestWebSubServer::get(int feedId, const QByteArray &query)
+{
+  QUrl url = QUrl::fromEncoded(callbackUrl(feedId).toEncoded() + "?" + query);
+  QScopedPointer<QNetworkReply> reply(manager_.get(QNetworkRequest(url)));
+  QEventLoop loop;
+  connect(reply.data(), SIGNAL(finished()), &loop, SLOT(quit()));
+  QTimer::singleShot(5000, &loop, SLOT(quit()));
+  loop.exec();
+  return reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+}
+
+/** Feed is taken by update timer, as UpdateObject selects feeds */
+bool TestWebSubServer::isPolled(int feedId)
+{
+  QSqlQuery q;
+  q.exec(QString("SELECT id FROM feeds WHERE id=%1 AND %2").
+         arg(feedId).arg(WebSubServer::pollCondition(24 * 3600)));
+  return q.next();
+}
+
+void TestWebSubServer::signedPush()
+{
+  QVERIFY(isPolled(1));
+  QVERIFY(subscribe(1, &httpsHub_));
+
+  QHash<QString, QString> params = httpsHub_.params();
+  QCOMPARE(params.value("hub.mode"), QString("subscribe"));
+  QCOMPARE(params.value("hub.callback"), callbackUrl(1).toString());
+  QString secret = params.value("hub.secret");
+  QVERIFY(!secret.isEmpty());
+
+  // Lease is active, feed waits for pushes instead of polling
+  QVERIFY(!isPolled(1));
+
+  QSignalSpy received(server_, SIGNAL(signalPushReceived(int,QByteArray,QString)));
+  QByteArray content = "<rss><channel><item><title>Pushed</title></item></channel></rss>";
+  QByteArray signature = "sha1=" + WebSubRequest::hmac(QCryptographicHash::Sha1,
+                                                       secret.toUtf8(), content).toHex();
+  QCOMPARE(post(1, content, signature), 202);
+  QCOMPARE(received.count(), 1);
+  QCOMPARE(received.at(0).at(0).toInt(), 1);
+  QCOMPARE(received.at(0).at(1).toByteArray(), content);
+  QCOMPARE(received.at(0).at(2).toString(), QString("utf-8"));
+
+  // Wrong or missing signature is acknowledged and ignored
+  QCOMPARE(post(1, content, "sha1=0123456789abcdef0123456789abcdef01234567"), 202);
+  QCOMPARE(post(1, content, QByteArray()), 202);
+  QCOMPARE(received.count(), 1);
+
+  QCOMPARE(httpsHub_.polls(), 0);
+}
+
+/** Denial of active subscription would end it, it is not asked for */
+void TestWebSubServer::deniedWithoutRequest()
+{
+  QByteArray topic = QUrl::toPercentEncoding(httpsHub_.url("/feed").toString());
+  QCOMPARE(get(1, "hub.mode=denied&hub.topic=" + topic), 404);
+  QVERIFY(!isPolled(1));
+
+  QSignalSpy received(server_, SIGNAL(signalPushReceived(int,QByteArray,QString)));
+  QString secret = httpsHub_.params().value("hub.secret");
+  QByteArray content = "<rss/>";
+  QCOMPARE(post(1, content, "sha1=" + WebSubRequest::hmac(QCryptographicHash::Sha1,
+                                                          secret.toUtf8(), content).toHex()), 202);
+  QCOMPARE(received.count(), 1);
+}
+
+/** Hub over HTTP gets no secret, its pushes make feed to be requested */
+void TestWebSubServer::unsignedPushNotifies()
+{
+  QVERIFY(subscribe(2, &httpHub_));
+  QVERIFY(!httpHub_.params().contains("hub.secret"));
+
+  QSignalSpy received(server_, SIGNAL(signalPushReceived(int,QByteArray,QString)));
+  QSignalSpy notified(server_, SIGNAL(signalPushNotified(int)));
+  QCOMPARE(post(2, "<rss/>", QByteArray()), 202);
+  QCOMPARE(received.count(), 0);
+  QCOMPARE(notified.count(), 1);
+  QCOMPARE(notified.at(0).at(0).toInt(), 2);
+
+  // Not oftener than once a minute
+  QCOMPARE(post(2, "<rss/>", QByteArray()), 202);
+  QCOMPARE(notified.count(), 1);
+  QCOMPARE(httpHub_.polls(), 0);
+}
+
+QTEST_MAIN(TestWebSubServer)
+#include "tst_websubserver.moc"
@@ -0,0 +1,19 @@
+TARGET = tst_websubserver
+QT += network sql
+
+include(../tests.pri)
+
+INCLUDEPATH += $$SRC_DIR/network $$SRC_DIR/database $$SRC_DIR/main
+
+HEADERS += \
+    $$SRC_DIR/network/networkmanager.h \
+    $$SRC_DIR/network/websubrequest.h \
+    $$SRC_DIR/network/websubserver.h
+
+SOURCES += \
+    tst_websubserver.cpp \
+    $$SRC_DIR/network/websubrequest.cpp \
+    $$SRC_DIR/network/websubserver.cpp
+
+# Self-signed certificate of stand-in hub, valid for 127.0.0.1
+RESOURCES += websubserver.qrc